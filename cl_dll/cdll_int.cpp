@@ -25,6 +25,7 @@
 
 #include "pm_shared.h"
 #include "pm_defs.h"
+#include "profiler.h"
 
 #include <string.h>
 #include "hud_servers.h"
@@ -227,6 +228,8 @@ redraw the HUD.
 */
 int DLLEXPORT HUD_Redraw( float time, int intermission )
 {    
+	PROF_SCOPE( "HUD_Redraw" );
+
 	return gHUD.Redraw( time, intermission );
 }
 
@@ -271,6 +274,8 @@ Called by engine every frame that client .dll is loaded
 */
 void DLLEXPORT HUD_Frame( double time )
 {
+	GL_ProfileFrame();
+
 	ServersThink( time );
 
 	GetClientVoiceMgr()->Frame(time);
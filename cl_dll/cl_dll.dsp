@@ -209,6 +209,10 @@ SOURCE=..\game_shared\jigglebones.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\game_shared\jobs.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\game_shared\material.cpp
 # End Source File
 # Begin Source File
@@ -233,6 +237,10 @@ SOURCE=..\game_shared\procbones.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\game_shared\profiler.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\stamina.cpp
 # End Source File
 # Begin Source File
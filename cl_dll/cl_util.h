@@ -102,6 +102,9 @@ extern cvar_t	*r_lightmap;
 extern cvar_t	*r_speeds;
 extern cvar_t	*r_decals;
 extern cvar_t	*r_studio_decals;
+extern cvar_t	*r_threads;
+extern cvar_t	*r_loadprofile;
+extern cvar_t	*r_profile;
 extern cvar_t	*r_hand;
 extern cvar_t	*r_sunshadows;
 extern cvar_t	*r_sun_allowed;
@@ -316,3 +319,10 @@ extern void BuildGammaTable( void );
 extern float TextureToLinear( int c );
 extern int LinearToTexture( float f );
 extern void GL_GpuMemUsage_f( void );
+extern void GL_BoneMathCheck_f( void );
+extern void GL_TraceMeshBench_f( void );
+extern void R_PrepFrameBench_f( void );
+extern void R_PrepFrameRecord_f( void );
+extern void R_ProfileDump_f( void );
+extern void R_ProfileCapture_f( void );
+extern void GL_ProfileFrame( void );
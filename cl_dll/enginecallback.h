@@ -71,7 +71,7 @@ extern render_api_t gRenderfuncs;
 #define GetConsoleStringSize	(*gEngfuncs.pfnDrawConsoleStringLen)
 #define DrawSetTextColor	(*gEngfuncs.pfnDrawSetTextColor)
 
-#define LOAD_FILE( x, y )	(*gEngfuncs.COM_LoadFile)( x, 5, y )
+#define LOAD_FILE( x, y )	R_LoadFile( x, y )	// counted by load profiler
 #define FREE_FILE		(*gEngfuncs.COM_FreeFile)
 #define SAVE_FILE		(*gRenderfuncs.pfnSaveFile)
 
@@ -156,6 +156,7 @@ inline void PlaySound( int iSound, float vol ) { gEngfuncs.pfnPlaySoundByIndex(
 #define IMAGE_EXISTS( path )		( FILE_EXISTS( va( "%s.tga", path )) || FILE_EXISTS( va( "%s.dds", path )))
 
 extern void ALERT( ALERT_TYPE level, const char *szFmt, ... );
+extern byte *R_LoadFile( const char *filename, int *length );
 	
 inline bool FILE_EXISTS( const char *filename )
 {
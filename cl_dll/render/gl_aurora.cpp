@@ -13,6 +13,7 @@
 #include "gl_local.h"
 #include "gl_studio.h"
 #include "gl_aurora.h"
+#include "jobs.h"
 
 CParticleSystemManager	g_pParticleSystems; // buz - static single object
 
@@ -54,6 +55,7 @@ void UTIL_RemoveAurora( cl_entity_t *ent )
 CParticleSystemManager :: CParticleSystemManager( void )
 {
 	m_pFirstSystem = NULL;
+	InitParticlePool();
 }
 
 CParticleSystemManager :: ~CParticleSystemManager( void )
@@ -92,69 +94,54 @@ void CParticleSystemManager :: MarkSystemForDeletion( CParticleSystem *pSys )
 	pSys->m_pEntity = NULL;
 }
 
-// blended particles don't use the z-buffer, so we need to sort them before drawing.
-// for efficiency, only the systems are sorted - individual particles just get drawn in order of creation.
-// (this should actually make things look better - no ugly popping when one particle passes through another.)
-void CParticleSystemManager :: SortSystems( void )
+void CParticleSystemManager :: InitParticlePool( void )
 {
-	CParticleSystem *pSystem, *pLast;
-	CParticleSystem *pBeforeCompare, *pCompare;
-	
-	if( !m_pFirstSystem ) return;
+	memset( m_ParticlePool, 0, sizeof( m_ParticlePool ));
 
-	// calculate how far away each system is from the viewer
-	for( pSystem = m_pFirstSystem; pSystem; pSystem = pSystem->m_pNextSystem )
-		pSystem->CalculateDistance();
+	for( int i = 0; i < MAX_AURORA_PARTICLES - 1; i++ )
+		m_ParticlePool[i].nextpart = &m_ParticlePool[i+1];
+	m_ParticlePool[MAX_AURORA_PARTICLES-1].nextpart = NULL;
 
-	// do an insertion sort on the systems
-	pLast = m_pFirstSystem;
-	pSystem = pLast->m_pNextSystem;
+	m_pFreeParticles = m_ParticlePool;
+	m_iNumQueued = 0;
+}
 
-	while( pSystem )
+CParticle *CParticleSystemManager :: AllocParticle( void )
+{
+	CParticle *pPart = m_pFreeParticles;
+
+	if( !pPart )
 	{
-		if( pLast->m_fViewerDist < pSystem->m_fViewerDist )
-		{
-			// pSystem is in the wrong place! First, let's unlink it from the list
-			pLast->m_pNextSystem = pSystem->m_pNextSystem;
+		ALERT( at_aiconsole, "Overflow %d aurora particles\n", MAX_AURORA_PARTICLES );
+		return NULL;
+	}
 
-			// then find somewhere to insert it
-			if( m_pFirstSystem == pLast || m_pFirstSystem->m_fViewerDist < pSystem->m_fViewerDist )
-			{
-				// pSystem comes before the first system, insert it there
-				pSystem->m_pNextSystem = m_pFirstSystem;
-				m_pFirstSystem = pSystem;
-			}
-			else
-			{
-				// insert pSystem somewhere within the sorted part of the list
-				pBeforeCompare = m_pFirstSystem;
-				pCompare = pBeforeCompare->m_pNextSystem;
+	m_pFreeParticles = pPart->nextpart;
+	pPart->nextpart = NULL;
 
-				while( pCompare != pLast )
-				{
-					if( pCompare->m_fViewerDist < pSystem->m_fViewerDist )
-					{
-						// pSystem comes before pCompare. We've found where it belongs.
-						break;
-					}
-
-					pBeforeCompare = pCompare;
-					pCompare = pBeforeCompare->m_pNextSystem;
-				}
+	return pPart;
+}
 
-				// we've found where pSystem belongs. Insert it between pBeforeCompare and pCompare.
-				pBeforeCompare->m_pNextSystem = pSystem;
-				pSystem->m_pNextSystem = pCompare;
-			}
-		}
-		else
-		{
-			// pSystem is in the right place, move on
-			pLast = pSystem;
-		}
+void CParticleSystemManager :: FreeParticle( CParticle *pPart )
+{
+	pPart->nextpart = m_pFreeParticles;
+	m_pFreeParticles = pPart;
+}
 
-		pSystem = pLast->m_pNextSystem;
-	}
+void CParticleSystemManager :: QueueParticle( CParticle *pPart )
+{
+	ASSERT( m_iNumQueued < MAX_AURORA_PARTICLES );
+	m_pUpdateQueue[m_iNumQueued++] = pPart;
+}
+
+void CParticleSystemManager :: IntegrateJob( void *context, int current, int threadnum )
+{
+	CParticleSystemManager *pManager = (CParticleSystemManager *)context;
+	int start = current * AURORA_JOB_CHUNK;
+	int end = Q_min( start + AURORA_JOB_CHUNK, pManager->m_iNumQueued );
+
+	for( int i = start; i < end; i++ )
+		CParticleSystem :: IntegrateParticle( pManager->m_pUpdateQueue[i], pManager->m_flFrameTime );
 }
 
 void CParticleSystemManager :: UpdateSystems( void )
@@ -168,15 +155,16 @@ void CParticleSystemManager :: UpdateSystems( void )
 	CParticleSystem *pLast = NULL;
 	pSystem = m_pFirstSystem;
 
+	m_flFrameTime = tr.frametime;
+	m_iNumQueued = 0;
+
+	// update systems and collect the particles to integrate
 	while( pSystem )
 	{
-		state = pSystem->UpdateSystem( tr.frametime );
+		state = pSystem->UpdateSystem( m_flFrameTime );
 
 		if( state != AURORA_REMOVE )
 		{
-			if( state == AURORA_DRAW )
-				pSystem->DrawSystem();
-
 			pLast = pSystem;
 			pSystem = pSystem->m_pNextSystem;
 		}
@@ -199,6 +187,21 @@ void CParticleSystemManager :: UpdateSystems( void )
 		}
 	}
 
+	// integrate all the particles in parallel
+	JOB_RunOnIndividual(( m_iNumQueued + AURORA_JOB_CHUNK - 1 ) / AURORA_JOB_CHUNK, this, IntegrateJob );
+
+	// bounces and sprays are using the engine so do it in main thread
+	for( pSystem = m_pFirstSystem; pSystem != NULL; pSystem = pSystem->m_pNextSystem )
+	{
+		if( pSystem->m_iState == AURORA_INVISIBLE )
+			continue;
+
+		pSystem->PostUpdateSystem( m_flFrameTime );
+
+		if( pSystem->m_iState == AURORA_DRAW )
+			pSystem->DrawSystem();
+	}
+
 	gEngfuncs.pTriAPI->RenderMode( kRenderNormal );
 }
 
@@ -215,6 +218,7 @@ void CParticleSystemManager :: ClearSystems( void )
 	}
 
 	m_pFirstSystem = NULL;
+	InitParticlePool();
 }
 
 CParticleType :: CParticleType( CParticleType *pNext )
@@ -353,7 +357,11 @@ CParticleSystem :: CParticleSystem( cl_entity_t *ent, const char *szFilename, in
 	m_iKillCondition = CONTENTS_NONE;
 	m_iEntAttachment = attachment;
 	m_pActiveParticle = NULL;
+	m_pUpdateParticle = NULL;
 	m_pMainParticle = NULL;
+	m_iMaxParticles = 0;
+	m_iNumParticles = 0;
+	m_iState = AURORA_INVISIBLE;
 	m_fLifeTime = lifetime;
 	m_pNextSystem = NULL;
 	m_iLightingModel = 0;
@@ -371,7 +379,7 @@ CParticleSystem :: CParticleSystem( cl_entity_t *ent, const char *szFilename, in
 		c_bCosTableInit = true;
 	}
 
-	char *afile = (char *)gEngfuncs.COM_LoadFile( (char *)szFilename, 5, NULL );
+	char *afile = (char *)LOAD_FILE( szFilename, NULL );
 	char szToken[1024];
 	char *pfile = afile;
 
@@ -444,29 +452,23 @@ CParticleSystem :: CParticleSystem( cl_entity_t *ent, const char *szFilename, in
 
 void CParticleSystem :: AllocateParticles( int iParticles )
 {
-	m_pAllParticles = new CParticle[iParticles];
-	memset( m_pAllParticles, 0, sizeof( CParticle ) * iParticles );
-	m_pFreeParticle = m_pAllParticles;
+	// just a budget, particles itself are shared
+	m_iMaxParticles = iParticles;
+	m_iNumParticles = 0;
 	m_pActiveParticle = NULL;
 	m_pMainParticle = NULL;
-
-	// initialise the linked list
-	CParticle *pLast = m_pAllParticles;
-	CParticle *pParticle = pLast + 1;
-
-	for( int i = 1; i < iParticles; i++ )
-	{
-		pLast->nextpart = pParticle;
-		pLast = pParticle;
-		pParticle++;
-	}
-
-	pLast->nextpart = NULL;
 }
 
 CParticleSystem :: ~CParticleSystem( void )
 {
-	delete[] m_pAllParticles;
+	CParticle *pParticle, *pNextParticle;
+
+	// give particles back to the pool
+	for( pParticle = m_pActiveParticle; pParticle != NULL; pParticle = pNextParticle )
+	{
+		pNextParticle = pParticle->nextpart;
+		g_pParticleSystems.FreeParticle( pParticle );
+	}
 
 	CParticleType *pType = m_pFirstType;
 	CParticleType *pNext;
@@ -769,13 +771,16 @@ CParticleType *CParticleSystem :: ParseType( char *&pfile )
 
 CParticle *CParticleSystem :: ActivateParticle( void )
 {
-	CParticle *pActivated = m_pFreeParticle;
+	if( m_iNumParticles >= m_iMaxParticles )
+		return NULL;
+
+	CParticle *pActivated = g_pParticleSystems.AllocParticle();
 
 	if( pActivated )
 	{
-		m_pFreeParticle = pActivated->nextpart;
 		pActivated->nextpart = m_pActiveParticle;
 		m_pActiveParticle = pActivated;
+		m_iNumParticles++;
 	}
 
 	return pActivated;
@@ -808,7 +813,7 @@ AURSTATE CParticleSystem :: UpdateSystem( float frametime )
 	{
 		// don't update if the system is outside the player's PVS.
 		if( m_pEntity->curstate.messagenum != r_currentMessageNum )
-			return AURORA_INVISIBLE;
+			return (m_iState = AURORA_INVISIBLE);
 
 		// time-based particle system
 		if( m_fLifeTime != 0.0f )
@@ -876,40 +881,48 @@ AURSTATE CParticleSystem :: UpdateSystem( float frametime )
 
 	// last particle is died, allow to remove partsystem
 	if( !m_pEntity && !m_pActiveParticle )
-		return AURORA_REMOVE;
+		return (m_iState = AURORA_REMOVE);
 
 	CParticle	*pParticle = m_pActiveParticle;
 	CParticle	*pLast = NULL;
+	CParticle	*pNext;
 
 	while( pParticle )
 	{
 		if( UpdateParticle( pParticle, frametime ))
 		{
+			if( frametime != 0.0f )
+				g_pParticleSystems.QueueParticle( pParticle );
 			pLast = pParticle;
 			pParticle = pParticle->nextpart;
 		}
 		else
 		{
 			// deactivate it
-			if( pLast )
-			{
-				pLast->nextpart = pParticle->nextpart;
-				pParticle->nextpart = m_pFreeParticle;
-				m_pFreeParticle = pParticle;
-				pParticle = pLast->nextpart;
-			}
-			else
-			{
-				// deactivate the first CParticle in the list
-				m_pActiveParticle = pParticle->nextpart;
-				pParticle->nextpart = m_pFreeParticle;
-				m_pFreeParticle = pParticle;
-				pParticle = m_pActiveParticle;
-			}
+			pNext = pParticle->nextpart;
+
+			if( pLast ) pLast->nextpart = pNext;
+			else m_pActiveParticle = pNext; // deactivate the first CParticle in the list
+
+			g_pParticleSystems.FreeParticle( pParticle );
+			m_iNumParticles--;
+			pParticle = pNext;
 		}
 	}
 
-	return AURORA_DRAW;
+	// particles sprayed after this point will be updated on a next frame
+	m_pUpdateParticle = m_pActiveParticle;
+
+	return (m_iState = AURORA_DRAW);
+}
+
+void CParticleSystem :: PostUpdateSystem( float frametime )
+{
+	if( frametime == 0.0f )
+		return;
+
+	for( CParticle *pParticle = m_pUpdateParticle; pParticle != NULL; pParticle = pParticle->nextpart )
+		PostUpdateParticle( pParticle, frametime );
 }
 
 void CParticleSystem :: DrawSystem( void )
@@ -978,14 +991,43 @@ bool CParticleSystem :: UpdateParticle( CParticle *part, float frametime )
 		// not tied to an entity, check whether it's time to die
 		if( part->age_death >= 0.0f && part->age > part->age_death )
 			return false;
+	}
 
+	return true;
+}
+
+// runs in a worker thread, don't call the engine here
+void CParticleSystem :: IntegrateParticle( CParticle *part, float frametime )
+{
+	if( !part->m_pEntity )
+	{
 		// apply acceleration and velocity
 		if( part->m_fDrag )
 			part->velocity += (part->velocity - part->m_vecWind) * (-part->m_fDrag * frametime);
 
 		part->velocity += part->accel * frametime;
 		part->origin += part->velocity * frametime;
+	}
+
+	part->m_fSize += part->m_fSizeStep * frametime;
+	part->m_fAlpha += part->m_fAlphaStep * frametime;
+	part->m_fRed += part->m_fRedStep * frametime;
+	part->m_fGreen += part->m_fGreenStep * frametime;
+	part->m_fBlue += part->m_fBlueStep * frametime;
+	part->frame += part->m_fFrameStep * frametime;
+
+	if( part->m_fAngleStep )
+	{
+		part->m_fAngle += part->m_fAngleStep * frametime;
+		while( part->m_fAngle < 0 ) part->m_fAngle += 360;
+		while( part->m_fAngle > 360 ) part->m_fAngle -= 360;
+	}
+}
 
+void CParticleSystem :: PostUpdateParticle( CParticle *part, float frametime )
+{
+	if( !part->m_pEntity )
+	{
 		if( part->pType->m_bBouncing )
 		{
 			Vector vecTarget = part->origin + part->velocity * frametime;
@@ -1033,22 +1075,6 @@ bool CParticleSystem :: UpdateParticle( CParticle *part, float frametime )
 			}
 		}
 	}
-
-	part->m_fSize += part->m_fSizeStep * frametime;
-	part->m_fAlpha += part->m_fAlphaStep * frametime;
-	part->m_fRed += part->m_fRedStep * frametime;
-	part->m_fGreen += part->m_fGreenStep * frametime;
-	part->m_fBlue += part->m_fBlueStep * frametime;
-	part->frame += part->m_fFrameStep * frametime;
-
-	if( part->m_fAngleStep )
-	{
-		part->m_fAngle += part->m_fAngleStep * frametime;
-		while( part->m_fAngle < 0 ) part->m_fAngle += 360;
-		while( part->m_fAngle > 360 ) part->m_fAngle -= 360;
-	}
-
-	return true;
 }
 
 void CParticleSystem :: DrawParticle( CParticle *part, const vec3_t &right, const vec3_t &up )
@@ -22,6 +22,9 @@ class CParticleSystem;
 
 #include "randomrange.h"
 
+#define MAX_AURORA_PARTICLES	32768	// shared between all the systems
+#define AURORA_JOB_CHUNK	256	// particles per update job
+
 struct CParticle
 {
 	CParticle		*nextpart;
@@ -152,6 +155,9 @@ public:
 						// MUST CHECK WHETHER THIS RESULT IS NULL!
 	// returns false if the particle has died
 	bool UpdateParticle( CParticle *part, float frametime );
+	void PostUpdateParticle( CParticle *part, float frametime );
+	void PostUpdateSystem( float frametime );
+	static void IntegrateParticle( CParticle *part, float frametime );
 	void DrawParticle( CParticle *part, const Vector &right, const Vector &up );
 
 	// Utility functions that have to be public
@@ -166,6 +172,7 @@ public:
 	CParticleSystem	*m_pNextSystem;
 
 	CParticle		*m_pActiveParticle;
+	AURSTATE		m_iState;		// result of last UpdateSystem
 	float		m_fViewerDist;
 	cl_entity_t	*m_pEntity;
 	int 		m_iEntAttachment;
@@ -180,11 +187,12 @@ private:
 	static float	c_fCosTable[360 + 90];
 	static bool	c_bCosTableInit;
 
-	// the block of allocated particles
-	CParticle		*m_pAllParticles;
+	// particles are allocated from the CParticleSystemManager pool
+	int		m_iMaxParticles;
+	int		m_iNumParticles;
 
-	// First particles in the linked list for the active particles and the dead particles
-	CParticle		*m_pFreeParticle;
+	// list head at the moment of update, particles sprayed later are not updated this frame
+	CParticle		*m_pUpdateParticle;
 	CParticle		*m_pMainParticle; // the "source" particle.
 
 	CParticleType	*m_pFirstType;
@@ -201,9 +209,24 @@ public:
 	void MarkSystemForDeletion( CParticleSystem *pSys );
 	void UpdateSystems( void );
 	void ClearSystems( void );
-	void SortSystems( void );
+
+	// shared particle pool
+	CParticle *AllocParticle( void );
+	void FreeParticle( CParticle *pPart );
+	void QueueParticle( CParticle *pPart );
 private:
+	void InitParticlePool( void );
+	static void IntegrateJob( void *context, int current, int threadnum );
+
 	CParticleSystem	*m_pFirstSystem;
+
+	CParticle		m_ParticlePool[MAX_AURORA_PARTICLES];
+	CParticle		*m_pFreeParticles;
+
+	// particles that should be integrated this frame
+	CParticle		*m_pUpdateQueue[MAX_AURORA_PARTICLES];
+	int		m_iNumQueued;
+	float		m_flFrameTime;
 };
 
 extern CParticleSystemManager	g_pParticleSystems; // buz
@@ -81,8 +81,11 @@ void GL_PrintStats( int params )
 		break;
 	case 2:
 		R_Speeds_Printf( "DIP count %3i\nShader bind %3i\n", r_stats.num_flushes, r_stats.num_shader_binds );
+		R_Speeds_Printf( "Uniforms %3i uploaded, %3i skipped\n", r_stats.num_uniform_uploads, r_stats.num_uniform_skips );
 		R_Speeds_Printf( "Frame total tris %3i\n", r_stats.c_total_tris );
-		R_Speeds_Printf( "Total GLSL shaders %3i", num_glsl_programs - 1 );
+		R_Speeds_Printf( "Total GLSL shaders %3i\n", num_glsl_programs - 1 );
+		R_Speeds_Printf( "Bone jobs %3i (%i threads)\n", r_stats.c_bone_jobs, JOB_NumThreads( ));
+		R_Speeds_Printf( "Anim cache %3i hits, %3i misses", r_stats.c_anim_cache_hits, r_stats.c_anim_cache_misses );
 		break;
 	case 3:
 		Q_snprintf( r_speeds_msg, sizeof( r_speeds_msg ), "%3i mirrors\n%3i shadow passes\n%3i screencopy\n%3i occluded",
@@ -119,6 +122,76 @@ void GL_PrintStats( int params )
 	}
 }
 
+/*
+==============
+GL_ProfileFrame
+
+close the profiler frame and open the next one,
+called once per client frame
+==============
+*/
+void GL_ProfileFrame( void )
+{
+	if( !g_fRenderInitialized || !r_profile )
+		return;
+
+	PROF_EndFrame();
+
+	if( r_profile->value > 0.0f )
+		PROF_Summary( r_profile_msg, sizeof( r_profile_msg ), r_profile->value < 2.0f );
+	else r_profile_msg[0] = '\0';
+
+	PROF_BeginFrame( r_profile->value > 0.0f );
+}
+
+/*
+==============
+R_ProfileDump_f
+
+print the whole call tree into console
+==============
+*/
+void R_ProfileDump_f( void )
+{
+	static char	text[16384];
+	char		*line, *next;
+
+	if( !PROF_Summary( text, sizeof( text ), false ))
+	{
+		Msg( "profiler is not active, set r_profile 1 first\n" );
+		return;
+	}
+
+	// console has a limited print buffer
+	for( line = text; *line; line = next )
+	{
+		if(( next = Q_strchr( line, '\n' )) != NULL )
+			*next++ = '\0';
+		else next = line + Q_strlen( line );
+
+		Msg( "%s\n", line );
+	}
+}
+
+/*
+==============
+R_ProfileCapture_f
+
+write next frames as a chrome trace
+==============
+*/
+void R_ProfileCapture_f( void )
+{
+	char	filename[MAX_PATH];
+	int	numframes = 60;
+
+	if( CMD_ARGC() > 1 )
+		numframes = Q_atoi( CMD_ARGV( 1 ));
+
+	Q_snprintf( filename, sizeof( filename ), "profile/frames_cl_%s.json", ( worldmodel && world->name[0] ) ? world->name : "nomap" );
+	PROF_StartCapture( numframes, filename );
+}
+
 /*
 ==============
 GL_ComputeScreenRays
@@ -205,6 +278,10 @@ bool GL_BackendStartFrame( ref_viewpass_t *rvp, int params )
 		memset( &r_buildstats, 0, sizeof( r_buildstats ));
 	}
 
+	// wait for cubemaps too
+	if( RENDER_GET_PARM( PARM_CLIENT_ACTIVE, 0 ) && ( !worldmodel || ( !world->loading_cubemaps && world->rebuilding_cubemaps == CMREBUILD_INACTIVE )))
+		R_ReportLoadProfile();
+
 	if( !g_fRenderInitialized )
 		return 0;
 
@@ -413,6 +490,10 @@ bool GL_BackendStartFrame( ref_viewpass_t *rvp, int params )
 	// setup light animation tables
 	R_AnimateLight();
 
+	// rebuild invalidated lightmap pages
+	if( R_UpdateLightmapPages( ))
+		R_StudioClearLightCache(); // studio blocks on that pages are cleared too
+
 	return 1;
 }
 
@@ -485,6 +566,7 @@ void GL_BackendEndFrame( ref_viewpass_t *rvp, int params )
 	// fill the r_speeds message
 	GL_PrintStats( params );
 
+	R_GrassUpdateFrame();
 	R_UnloadFarGrass();
 
 	tr.params_changed = false;
@@ -569,15 +651,39 @@ int R_GetSpriteTexture( const model_t *m_pSpriteModel, int frame )
 	return R_GetSpriteFrame( m_pSpriteModel, frame )->gl_texturenum;
 }
 
-void R_RenderQuadPrimitive( CSolidEntry *entry )
+static Vector	quad_verts[MAX_QUAD_BATCH*4];
+static float	quad_coords[MAX_QUAD_BATCH*4][2];
+static byte	quad_colors[MAX_QUAD_BATCH*4][4];
+
+static const float quad_texcoords[4][2] =
 {
-	if( entry->m_bDrawType != DRAWTYPE_QUAD )
-		return;
+{ 0.0f, 1.0f },
+{ 0.0f, 0.0f },
+{ 1.0f, 0.0f },
+{ 1.0f, 1.0f },
+};
+
+/*
+===============
+R_RenderQuadPrimitives
+
+draw the run of sorted quads that share texture
+and rendermode with a single call, returns
+number of entries that was drawn
+===============
+*/
+int R_RenderQuadPrimitives( CTransEntry *entries, int count )
+{
+	CTransEntry *first = entries;
+	int numQuads = 0;
+
+	if( first->m_bDrawType != DRAWTYPE_QUAD )
+		return 1;
 
 	GL_CleanupDrawState();
 
 	// select properly rendermode
-	switch( entry->m_iRenderMode )
+	switch( first->m_iRenderMode )
 	{
 	case kRenderTransAlpha:
 		GL_AlphaTest( GL_TRUE );
@@ -602,33 +708,62 @@ void R_RenderQuadPrimitive( CSolidEntry *entry )
 		break;
 	}
 
-	int	r, g, b, a;
-
-	// draw the particle
-	GL_BindTexture( GL_TEXTURE0, entry->m_hTexture );
+	// draw the particles
+	GL_BindTexture( GL_TEXTURE0, first->m_hTexture );
 	pglTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
-	UnpackRGBA( r, g, b, a, entry->m_iColor );
-	pglColor4ub( r, g, b, a );
 
-	pglBegin( GL_QUADS );
-		pglTexCoord2f( 0.0f, 1.0f );
-		pglVertex3fv( RI->frame.primverts[entry->m_iStartVertex+0] );
+	while( numQuads < count && numQuads < MAX_QUAD_BATCH )
+	{
+		CTransEntry *entry = &entries[numQuads];
 
-		pglTexCoord2f( 0.0f, 0.0f );
-		pglVertex3fv( RI->frame.primverts[entry->m_iStartVertex+1] );
+		if( entry->m_bDrawType != DRAWTYPE_QUAD )
+			break;
 
-		pglTexCoord2f( 1.0f, 0.0f );
-		pglVertex3fv( RI->frame.primverts[entry->m_iStartVertex+2] );
+		if( entry->m_hTexture != first->m_hTexture || entry->m_iRenderMode != first->m_iRenderMode )
+			break;
 
-		pglTexCoord2f( 1.0f, 1.0f );
-		pglVertex3fv( RI->frame.primverts[entry->m_iStartVertex+3] );
-	pglEnd();
+		int r, g, b, a;
+		UnpackRGBA( r, g, b, a, entry->m_iColor );
 
-	if( entry->m_iRenderMode == kRenderGlow )
+		for( int j = 0; j < 4; j++ )
+		{
+			int v = numQuads * 4 + j;
+
+			quad_verts[v] = RI->frame.primverts[entry->m_iStartVertex+j];
+			quad_coords[v][0] = quad_texcoords[j][0];
+			quad_coords[v][1] = quad_texcoords[j][1];
+			quad_colors[v][0] = r;
+			quad_colors[v][1] = g;
+			quad_colors[v][2] = b;
+			quad_colors[v][3] = a;
+		}
+		numQuads++;
+	}
+
+	pglEnableClientState( GL_VERTEX_ARRAY );
+	pglVertexPointer( 3, GL_FLOAT, 0, quad_verts );
+
+	pglEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	pglTexCoordPointer( 2, GL_FLOAT, 0, quad_coords );
+
+	pglEnableClientState( GL_COLOR_ARRAY );
+	pglColorPointer( 4, GL_UNSIGNED_BYTE, 0, quad_colors );
+
+	pglDrawArrays( GL_QUADS, 0, numQuads * 4 );
+	r_stats.c_total_tris += numQuads * 2;
+	r_stats.num_flushes++;
+
+	pglDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	pglDisableClientState( GL_VERTEX_ARRAY );
+	pglDisableClientState( GL_COLOR_ARRAY );
+
+	if( first->m_iRenderMode == kRenderGlow )
 		pglEnable( GL_DEPTH_TEST );
 
-	if( entry->m_iRenderMode == kRenderTransAlpha )
+	if( first->m_iRenderMode == kRenderTransAlpha )
 		GL_AlphaTest( GL_FALSE );
+
+	return numQuads;
 }
 
 int R_AllocFrameBuffer( int viewport[4] )
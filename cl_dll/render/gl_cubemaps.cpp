@@ -23,6 +23,156 @@ GNU General Public License for more details.
 #include <mathlib.h>
 #include "gl_world.h"
 
+#define CUBEMAP_MAX_DIST	99999.0f
+
+typedef struct
+{
+	Vector		pos;
+	const mplane_t	*plane;		// accept only cubemaps on front of plane (may be NULL)
+	int		maxcount;		// 1 or 2
+	int		count;
+	int		best[2];
+	float		bestDist[2];	// squared distances
+} cubequery_t;
+
+static int	cubemap_sort_axis;
+
+static int CL_CubemapCompare( const void *a, const void *b )
+{
+	float v1 = world->cubemaps[*(const short *)a].origin[cubemap_sort_axis];
+	float v2 = world->cubemaps[*(const short *)b].origin[cubemap_sort_axis];
+
+	if( v1 < v2 ) return -1;
+	if( v1 > v2 ) return 1;
+	return ( *(const short *)a - *(const short *)b );
+}
+
+static int CL_BuildCubemapNode( short *indexes, int count, int *numnodes )
+{
+	Vector mins, maxs;
+	int i, axis = 0;
+
+	if( count <= 0 ) return -1;
+
+	ClearBounds( mins, maxs );
+	for( i = 0; i < count; i++ )
+		AddPointToBounds( world->cubemaps[indexes[i]].origin, mins, maxs );
+
+	// split by the largest extent
+	Vector size = maxs - mins;
+	if( size[1] > size[axis] ) axis = 1;
+	if( size[2] > size[axis] ) axis = 2;
+
+	cubemap_sort_axis = axis;
+	qsort( indexes, count, sizeof( short ), CL_CubemapCompare );
+
+	int median = count / 2;
+	int nodenum = (*numnodes)++;
+	mcubenode_t *node = &world->cubemap_tree[nodenum];
+
+	node->cubemap = indexes[median];
+	node->axis = axis;
+	node->children[0] = CL_BuildCubemapNode( indexes, median, numnodes );
+	node->children[1] = CL_BuildCubemapNode( indexes + median + 1, count - median - 1, numnodes );
+
+	return nodenum;
+}
+
+/*
+=================
+CL_BuildCubemapTree
+
+build k-d tree over cubemap origins
+=================
+*/
+void CL_BuildCubemapTree( void )
+{
+	short indexes[MAX_MAP_CUBEMAPS];
+	int numnodes = 0;
+
+	for( int i = 0; i < world->num_cubemaps; i++ )
+		indexes[i] = i;
+
+	world->cubemap_root = CL_BuildCubemapNode( indexes, world->num_cubemaps, &numnodes );
+}
+
+static void CL_AddCubemapCandidate( cubequery_t *q, int cubemap, float dist )
+{
+	int i;
+
+	// lower index wins for equal distances
+	for( i = 0; i < q->count; i++ )
+	{
+		if( dist < q->bestDist[i] || ( dist == q->bestDist[i] && cubemap < q->best[i] ))
+			break;
+	}
+
+	if( i >= q->maxcount )
+		return;
+
+	if( q->count < q->maxcount )
+		q->count++;
+
+	for( int j = q->count - 1; j > i; j-- )
+	{
+		q->best[j] = q->best[j-1];
+		q->bestDist[j] = q->bestDist[j-1];
+	}
+
+	q->best[i] = cubemap;
+	q->bestDist[i] = dist;
+}
+
+static void CL_SearchCubemapTree( cubequery_t *q, int nodenum )
+{
+	if( nodenum < 0 ) return;
+
+	mcubenode_t *node = &world->cubemap_tree[nodenum];
+	mcubemap_t *check = &world->cubemaps[node->cubemap];
+	float delta = q->pos[node->axis] - check->origin[node->axis];
+	int side = ( delta < 0.0f ) ? 0 : 1;
+
+	CL_SearchCubemapTree( q, node->children[side] );
+
+	if( !q->plane || PlaneDiff( check->origin, q->plane ) >= 0.0f )
+	{
+		float dist = ( check->origin - q->pos ).LengthSqr();
+
+		if( dist < CUBEMAP_MAX_DIST * CUBEMAP_MAX_DIST )
+			CL_AddCubemapCandidate( q, node->cubemap, dist );
+	}
+
+	// other side can't contain anything closer than worst result
+	float worst = ( q->count < q->maxcount ) ? ( CUBEMAP_MAX_DIST * CUBEMAP_MAX_DIST ) : q->bestDist[q->maxcount - 1];
+
+	if( delta * delta <= worst )
+		CL_SearchCubemapTree( q, node->children[!side] );
+}
+
+static int CL_QueryCubemaps( cubequery_t *q, const Vector &pos, const mplane_t *plane, int maxcount )
+{
+	q->pos = pos;
+	q->plane = plane;
+	q->maxcount = maxcount;
+	q->count = 0;
+
+	if( world->num_cubemaps > 0 )
+		CL_SearchCubemapTree( q, world->cubemap_root );
+
+	return q->count;
+}
+
+static void CL_SurfacePlane( const msurface_t *surf, mplane_t *plane )
+{
+	*plane = *surf->plane;
+
+	if( FBitSet( surf->flags, SURF_PLANEBACK ))
+	{
+		plane->normal = -plane->normal;
+		plane->dist = -plane->dist;
+	}
+}
+
 /*
 =================
 CL_FindNearestCubeMap
@@ -32,24 +182,15 @@ find the nearest cubemap for a given point
 */
 void CL_FindNearestCubeMap( const Vector &pos, mcubemap_t **result )
 {
-	if( !result ) return;
+	cubequery_t q;
 
-	float maxDist = 99999.0f;
-	*result = NULL;
+	if( !result ) return;
 
-	for( int i = 0; i < world->num_cubemaps; i++ )
+	if( CL_QueryCubemaps( &q, pos, NULL, 1 ))
 	{
-		mcubemap_t *check = &world->cubemaps[i];
-		float dist = VectorDistance( check->origin, pos );
-
-		if( dist < maxDist )
-		{
-			*result = check;
-			maxDist = dist;
-		}
+		*result = &world->cubemaps[q.best[0]];
 	}
-
-	if( !*result )
+	else
 	{
 		// this may happens if map
 		// doesn't have any cubemaps
@@ -66,34 +207,19 @@ find the nearest cubemap on front of plane
 */
 void CL_FindNearestCubeMapForSurface( const Vector &pos, const msurface_t *surf, mcubemap_t **result )
 {
-	if( !result ) return;
-
-	float maxDist = 99999.0f;
 	mplane_t plane;
-	*result = NULL;
+	cubequery_t q;
 
-	plane = *surf->plane;
+	if( !result ) return;
 
-	if( FBitSet( surf->flags, SURF_PLANEBACK ))
-	{
-		plane.normal = -plane.normal;
-		plane.dist = -plane.dist;
-	}
+	CL_SurfacePlane( surf, &plane );
 
-	for( int i = 0; i < world->num_cubemaps; i++ )
+	if( CL_QueryCubemaps( &q, pos, &plane, 1 ))
 	{
-		mcubemap_t *check = &world->cubemaps[i];
-		float dist = VectorDistance( check->origin, pos );
-
-		if( dist < maxDist && PlaneDiff( check->origin, &plane ) >= 0.0f )
-		{
-			*result = check;
-			maxDist = dist;
-		}
+		*result = &world->cubemaps[q.best[0]];
+		return;
 	}
 
-	if( *result ) return;
-
 	// fallback to default method
 	CL_FindNearestCubeMap( pos, result );
 }
@@ -107,43 +233,27 @@ find the two nearest cubemaps for a given point
 */
 void CL_FindTwoNearestCubeMap( const Vector &pos, mcubemap_t **result1, mcubemap_t **result2 )
 {
+	cubequery_t q;
+
 	if( !result1 || !result2 )
 		return;
 
-	float maxDist1 = 99999.0f;
-	float maxDist2 = 99999.0f;
-	*result1 = *result2 = NULL;
+	int count = CL_QueryCubemaps( &q, pos, NULL, 2 );
 
-	for( int i = 0; i < world->num_cubemaps; i++ )
+	if( count > 0 )
 	{
-		mcubemap_t *check = &world->cubemaps[i];
-		float dist = VectorDistance( check->origin, pos );
-
-		if( dist < maxDist1 )
-		{
-			*result1 = check;
-			maxDist1 = dist;
-		}
-		else if( dist < maxDist2 && dist > maxDist1 )
-		{
-			*result2 = check;
-			maxDist2 = dist;
-		}
+		*result1 = &world->cubemaps[q.best[0]];
 	}
-
-	if( !*result1 )
+	else
 	{
 		// this may happens if map
 		// doesn't have any cubemaps
 		*result1 = &world->defaultCubemap;
 	}
 
-	if( !*result2 )
-	{
-		// this may happens if map
-		// doesn't have any cubemaps
-		*result2 = *result1;
-	}
+	if( count > 1 )
+		*result2 = &world->cubemaps[q.best[1]];
+	else *result2 = *result1;
 }
 
 /*
@@ -155,43 +265,20 @@ find the two nearest cubemaps on front of plane
 */
 void CL_FindTwoNearestCubeMapForSurface( const Vector &pos, const msurface_t *surf, mcubemap_t **result1, mcubemap_t **result2 )
 {
-	if( !result1 || !result2 ) return;
-
-	float maxDist1 = 99999.0f;
-	float maxDist2 = 99999.0f;
 	mplane_t plane;
-	*result1 = NULL;
-	*result2 = NULL;
+	cubequery_t q;
 
-	plane = *surf->plane;
-
-	if( FBitSet( surf->flags, SURF_PLANEBACK ))
-	{
-		plane.normal = -plane.normal;
-		plane.dist = -plane.dist;
-	}
+	if( !result1 || !result2 ) return;
 
-	for( int i = 0; i < world->num_cubemaps; i++ )
-	{
-		mcubemap_t *check = &world->cubemaps[i];
-		float dist = VectorDistance( check->origin, pos );
-
-		if( dist < maxDist1 && PlaneDiff( check->origin, &plane ) >= 0.0f )
-		{
-			*result1 = check;
-			maxDist1 = dist;
-		}
-		else if( dist < maxDist2 && dist > maxDist1 )
-		{
-			*result2 = check;
-			maxDist2 = dist;
-		}
-	}
+	CL_SurfacePlane( surf, &plane );
+	int count = CL_QueryCubemaps( &q, pos, &plane, 2 );
 
-	if( *result1 )
+	if( count > 0 )
 	{
-		if( !*result2 )
-			*result2 = *result1;
+		*result1 = &world->cubemaps[q.best[0]];
+		if( count > 1 )
+			*result2 = &world->cubemaps[q.best[1]];
+		else *result2 = *result1;
 		return;
 	}
 
@@ -114,9 +114,9 @@ bool R_CullBrushModel( cl_entity_t *e )
 	return R_CullModel( e, absmin, absmax );
 }
 
-static bool R_SunLightShadow( void )
+static bool R_SunLightShadow( const CDynLight *pl )
 {
-	if( RI->currentlight && RI->currentlight->type == LIGHT_DIRECTIONAL && FBitSet( RI->params, RP_SHADOWVIEW ))
+	if( pl && pl->type == LIGHT_DIRECTIONAL && FBitSet( RI->params, RP_SHADOWVIEW ))
 		return true;
 	return false;
 }
@@ -128,7 +128,7 @@ R_AllowFacePlaneCulling
 allow to culling backfaces
 =================
 */
-static bool R_AllowFacePlaneCulling( msurface_t *surf )
+static bool R_AllowFacePlaneCulling( msurface_t *surf, cl_entity_t *e, const CDynLight *pl )
 {
 	if( !glState.faceCull )
 		return false;
@@ -136,11 +136,11 @@ static bool R_AllowFacePlaneCulling( msurface_t *surf )
 	if( FBitSet( surf->flags, SURF_TWOSIDE ))
 		return false;
 
-	if( !FBitSet( RI->params, RP_SHADOWVIEW ) && RI->currentlight && RI->currentlight->type == LIGHT_DIRECTIONAL )
+	if( !FBitSet( RI->params, RP_SHADOWVIEW ) && pl && pl->type == LIGHT_DIRECTIONAL )
 		return false;
 
 	// don't cull transparent surfaces because we should be draw decals on them
-	if( FBitSet( surf->flags, SURF_HAS_DECALS ) && !R_OpaqueEntity( RI->currententity ))
+	if( FBitSet( surf->flags, SURF_HAS_DECALS ) && !R_OpaqueEntity( e ))
 		return false;
 
 	return true;
@@ -148,15 +148,14 @@ static bool R_AllowFacePlaneCulling( msurface_t *surf )
 
 /*
 =================
-R_CullSurface
+R_CullSurfaceExt
 
-cull invisible surfaces
+cull invisible surfaces for specified entity and light
+doesn't touch RI->currententity so it's safe to call from jobs
 =================
 */
-int R_CullSurface( msurface_t *surf, const Vector &vieworg, CFrustum *frustum, int clipFlags )
+int R_CullSurfaceExt( msurface_t *surf, const Vector &vieworg, CFrustum *frustum, int clipFlags, cl_entity_t *e, const CDynLight *pl )
 {
-	cl_entity_t *e = RI->currententity;
-
 	if( !surf || !surf->texinfo || !surf->texinfo->texture )
 		return CULL_OTHER;
 
@@ -166,11 +165,11 @@ int R_CullSurface( msurface_t *surf, const Vector &vieworg, CFrustum *frustum, i
 	if( CVAR_TO_BOOL( r_nocull ))
 		return CULL_VISIBLE;
 
-	if( R_SunLightShadow( ))
+	if( R_SunLightShadow( pl ))
 		return CULL_VISIBLE;
 
 	// because light or shadow passes required both sides for right self-shadowing
-	if( R_AllowFacePlaneCulling( surf ))
+	if( R_AllowFacePlaneCulling( surf, e, pl ))
 	{
 		float	dist;
 
@@ -226,6 +225,52 @@ int R_CullSurface( msurface_t *surf, const Vector &vieworg, CFrustum *frustum, i
 	return CULL_VISIBLE;
 }
 
+/*
+=================
+R_CullSurface
+
+cull invisible surfaces
+=================
+*/
+int R_CullSurface( msurface_t *surf, const Vector &vieworg, CFrustum *frustum, int clipFlags )
+{
+	return R_CullSurfaceExt( surf, vieworg, frustum, clipFlags, RI->currententity, RI->currentlight );
+}
+
+/*
+=================
+R_CullWorldFaces
+
+frustum cull of all visible world faces
+four at once, results goes into world->culledfaces
+=================
+*/
+void R_CullWorldFaces( CFrustum *frustum )
+{
+	int	i, numgroups;
+
+	if( !world->culledfaces || !world->packedsurfs )
+		return;
+
+	memset( world->culledfaces, 0x00, (worldmodel->numsurfaces + 7) >> 3 );
+
+	if( CVAR_TO_BOOL( r_nocull ) || R_SunLightShadow( RI->currentlight ))
+		return;
+
+	numgroups = (worldmodel->numsurfaces + PACKED_BOXES - 1) / PACKED_BOXES;
+
+	for( i = 0; i < numgroups; i++ )
+	{
+		int	shift = (i & 1) << 2;
+		int	visible = (RI->view.visfaces[i >> 1] >> shift) & 0xF;
+
+		if( !visible ) continue; // nothing to cull
+
+		int culled = frustum->CullBoxes( &world->packedsurfs[i * PACKED_BOX_FLOATS] ) & visible;
+		world->culledfaces[i >> 1] |= (culled << shift);
+	}
+}
+
 /*
 ================
 R_CullNodeTopView
@@ -19,6 +19,8 @@
 #include "gl_world.h"
 #include "gl_shader.h"
 #include "vertex_fmt.h"
+#include "studio.h"
+#include "trace.h"
 
 void GL_GpuMemUsage_f( void )
 {
@@ -36,6 +38,203 @@ void GL_GpuMemUsage_f( void )
 	Msg( "GPU used memory %s\n", Q_memprint(( total_mem_kb - cur_avail_mem_kb ) * 1024 ));
 }
 
+static float BoneMathError( const Vector4D &a, const Vector4D &b )
+{
+	return Q_max( Q_max( fabs( a.x - b.x ), fabs( a.y - b.y )), Q_max( fabs( a.z - b.z ), fabs( a.w - b.w )));
+}
+
+static Vector4D BoneMathRandomQuat( void )
+{
+	Vector4D q( RANDOM_FLOAT( -1, 1 ), RANDOM_FLOAT( -1, 1 ), RANDOM_FLOAT( -1, 1 ), RANDOM_FLOAT( -1, 1 ));
+	return q.Normalize();
+}
+
+/*
+=============
+GL_BoneMathCheck_f
+
+compare batch bone kernels with scalar versions
+=============
+*/
+void GL_BoneMathCheck_f( void )
+{
+	Vector4D	src[MAXSTUDIOBONES], dst[MAXSTUDIOBONES];
+	Vector4D	ref[MAXSTUDIOBONES], out[MAXSTUDIOBONES];
+	float	weights[MAXSTUDIOBONES];
+	byte	noalign[MAXSTUDIOBONES];
+	Vector	pos[MAXSTUDIOBONES];
+	matrix3x4	mat[MAXSTUDIOBONES];
+	float	slerpError = 0.0f;
+	float	blendError = 0.0f;
+	float	matrixError = 0.0f;
+	int	i, j, pass;
+
+	for( pass = 0; pass < 64; pass++ )
+	{
+		int count = RANDOM_LONG( 1, MAXSTUDIOBONES );
+
+		for( i = 0; i < count; i++ )
+		{
+			src[i] = BoneMathRandomQuat();
+			dst[i] = BoneMathRandomQuat();
+			pos[i] = Vector( RANDOM_FLOAT( -64, 64 ), RANDOM_FLOAT( -64, 64 ), RANDOM_FLOAT( -64, 64 ));
+			noalign[i] = ( RANDOM_LONG( 0, 7 ) == 0 ) ? 1 : 0;
+			weights[i] = ( RANDOM_LONG( 0, 7 ) == 0 ) ? 0.0f : RANDOM_FLOAT( 0.0f, 1.0f );
+
+			// test special cases too
+			if( RANDOM_LONG( 0, 15 ) == 0 ) dst[i] = src[i];
+			if( RANDOM_LONG( 0, 15 ) == 0 ) dst[i] = Vector4D( -src[i].x, -src[i].y, -src[i].z, -src[i].w );
+		}
+
+		// slerp
+		memcpy( out, src, sizeof( Vector4D ) * count );
+		QuaternionSlerpBatch( out, dst, weights, noalign, count );
+
+		for( i = 0; i < count; i++ )
+		{
+			ref[i] = src[i];
+			if( weights[i] <= 0.0f ) continue;
+			if( noalign[i] ) QuaternionSlerpNoAlign( ref[i], dst[i], weights[i], ref[i] );
+			else QuaternionSlerp( ref[i], dst[i], weights[i], ref[i] );
+		}
+
+		for( i = 0; i < count; i++ )
+			slerpError = Q_max( slerpError, BoneMathError( ref[i], out[i] ));
+
+		// nlerp
+		memcpy( out, src, sizeof( Vector4D ) * count );
+		QuaternionBlendBatch( out, dst, weights, noalign, count );
+
+		for( i = 0; i < count; i++ )
+		{
+			ref[i] = src[i];
+			if( weights[i] <= 0.0f ) continue;
+			if( noalign[i] ) QuaternionBlendNoAlign( ref[i], dst[i], weights[i], ref[i] );
+			else QuaternionBlend( ref[i], dst[i], weights[i], ref[i] );
+		}
+
+		for( i = 0; i < count; i++ )
+			blendError = Q_max( blendError, BoneMathError( ref[i], out[i] ));
+
+		// quaternion to matrix
+		QuaternionMatrixBatch( src, pos, mat, count );
+
+		for( i = 0; i < count; i++ )
+		{
+			matrix3x4 check = matrix3x4( pos[i], src[i] );
+
+			for( j = 0; j < 12; j++ )
+				matrixError = Q_max( matrixError, fabs( ((const float *)check)[j] - ((const float *)mat[i])[j] ));
+		}
+	}
+
+	Msg( "bone math kernels: %s\n", MathLib_HaveSSE() ? "SSE" : "scalar" );
+	Msg( "slerp max error %g %s\n", slerpError, ( slerpError < 1e-4f ) ? "^2OK^7" : "^1FAILED^7" );
+	Msg( "blend max error %g %s\n", blendError, ( blendError < 1e-4f ) ? "^2OK^7" : "^1FAILED^7" );
+	Msg( "matrix max error %g %s\n", matrixError, ( matrixError < 1e-4f ) ? "^2OK^7" : "^1FAILED^7" );
+}
+
+/*
+=============
+GL_TraceMeshBench_f
+
+compare BVH and areanode paths for the collision meshes
+=============
+*/
+void GL_TraceMeshBench_f( void )
+{
+	static const Vector hullSizes[3][2] =
+	{
+	{ Vector( 0, 0, 0 ), Vector( 0, 0, 0 ) },
+	{ Vector( -16, -16, -36 ), Vector( 16, 16, 36 ) },
+	{ Vector( -16, -16, -18 ), Vector( 16, 16, 18 ) },
+	};
+	int	numTraces = 10000;
+	int	numModels = 0;
+
+	if( CMD_ARGC() > 1 )
+		numTraces = bound( 1, Q_atoi( CMD_ARGV( 1 )), 1000000 );
+
+	Vector *starts = new Vector[numTraces];
+	Vector *ends = new Vector[numTraces];
+
+	for( int i = 1; ; i++ )
+	{
+		model_t *mod = (model_t *)MODEL_HANDLE( i );
+		if( !mod ) break;
+
+		// bench only meshes that already in use
+		if( mod->type != mod_studio || !mod->bodymesh || !mod->bodymesh->GetMesh( ))
+			continue;
+
+		mmesh_t *pMesh = mod->bodymesh->GetMesh();
+		areanode_t *pHeadNode = mod->bodymesh->GetHeadNode();
+		Vector mins = pMesh->mins - Vector( 32, 32, 32 );
+		Vector maxs = pMesh->maxs + Vector( 32, 32, 32 );
+		double times[2] = { 0.0, 0.0 };
+		int mismatches = 0;
+		trace_t tr[2];
+		TraceMesh trm;
+
+		for( int j = 0; j < numTraces; j++ )
+		{
+			for( int k = 0; k < 3; k++ )
+			{
+				starts[j][k] = RANDOM_FLOAT( mins[k], maxs[k] );
+				ends[j][k] = RANDOM_FLOAT( mins[k], maxs[k] );
+			}
+
+			// every tenth trace is a position test
+			if(( j % 10 ) == 9 ) ends[j] = starts[j];
+		}
+
+		trm.SetTraceMesh( pMesh, pHeadNode, i );
+
+		for( int pass = 0; pass < 2; pass++ )
+		{
+			trm.SetBVHEnabled( pass != 0 );
+			double start = Sys_DoubleTime();
+
+			for( int j = 0; j < numTraces; j++ )
+			{
+				const Vector *hull = hullSizes[j % 3];
+
+				trm.SetMeshOrientation( g_vecZero, g_vecZero, Vector( 1.0f, 1.0f, 1.0f ));
+				trm.SetupTrace( starts[j], hull[0], hull[1], ends[j], &tr[0] );
+				trm.DoTrace();
+			}
+
+			times[pass] = Sys_DoubleTime() - start;
+		}
+
+		// compare results
+		for( int j = 0; j < numTraces; j++ )
+		{
+			const Vector *hull = hullSizes[j % 3];
+
+			for( int pass = 0; pass < 2; pass++ )
+			{
+				trm.SetBVHEnabled( pass != 0 );
+				trm.SetMeshOrientation( g_vecZero, g_vecZero, Vector( 1.0f, 1.0f, 1.0f ));
+				trm.SetupTrace( starts[j], hull[0], hull[1], ends[j], &tr[pass] );
+				trm.DoTrace();
+			}
+
+			if( fabs( tr[0].fraction - tr[1].fraction ) > 0.001f || tr[0].startsolid != tr[1].startsolid || tr[0].allsolid != tr[1].allsolid )
+				mismatches++;
+		}
+
+		Msg( "%s: %i facets, %i nodes, %s %.2f ms, BVH %.2f ms, %i mismatches\n", mod->name, pMesh->numfacets, pMesh->numnodes,
+			pHeadNode ? "areanodes" : "brute force", times[0] * 1000.0, times[1] * 1000.0, mismatches );
+		numModels++;
+	}
+
+	delete [] starts;
+	delete [] ends;
+
+	if( !numModels ) Msg( "no collision meshes in use\n" );
+}
+
 void DBG_PrintVertexVBOSizes( void )
 {
 	if( developer_level < at_aiconsole )
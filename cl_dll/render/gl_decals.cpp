@@ -21,6 +21,9 @@
 #include "gl_world.h"
 #include "gl_studio.h"
 #include "gl_occlusion.h"
+#if defined( HAVE_SSE_MATH )
+#include <xmmintrin.h>
+#endif
 
 #define MAX_CLIPVERTS		64	// don't change this
 #define MAX_GROUPENTRIES		512
@@ -32,6 +35,10 @@
 #define MAX_DECAL_VERTS		(MAX_DECAL_VERTICES * MAX_BRUSH_DECALS)
 #define MAX_DECAL_ELEMS		(MAX_DECAL_INDICES * MAX_BRUSH_DECALS)
 
+#define MAX_DECAL_QUEUE		128	// decals created in one frame
+#define MAX_DECAL_BATCH		32	// decals that walks the BSP together (bits in mask)
+#define MAX_DECAL_MODELS		1024	// model handles to check for touched bmodels
+
 typedef CUtlArray<int> CIntVector;
 
 typedef struct decalVertex_s
@@ -59,6 +66,14 @@ typedef struct
 
 	mplane_t			planes[6];
 	mplane_t			splitPlanes[2];
+	float			cullPlanes[4][8];	// planes as x, y, z, dist for point culling
+
+	// source request, used to place this decal on touched bmodels
+	Vector			srcPosition;
+	Vector			srcNormal;
+	char			srcName[64];
+	int			srcFlags;
+	bool			source;
 
 	Vector			textureVecs[2];
 
@@ -217,15 +232,44 @@ DecalGroup *DecalGroup :: FindGroup( const char *name )
 	return NULL; // nothing found
 }
 
+// each decal in pool owns a fixed slot for the single fragment
 static dvert_t		g_decalVertexCache[MAX_DECAL_VERTS];	// 4.00 mbytes here if max decals count is 4096
 static word		g_decalIndexCache[MAX_DECAL_ELEMS];	// 1.5 mbytes here if max decals count is 4096
-static unsigned int		g_decalVertUsed;
-static unsigned int		g_decalElemUsed;
 
 static brushdecal_t		gDecalPool[MAX_BRUSH_DECALS];
 static int		gDecalCycle;
 static int		gDecalCount;
 
+// decals are queued and built once per frame
+static decalClip_t		g_decalQueue[MAX_DECAL_QUEUE];
+static int		g_numQueuedDecals;
+static decalClip_t		*g_decalBatch[MAX_DECAL_BATCH];
+static int		g_numBatchDecals;
+
+typedef struct
+{
+	model_t			*model;
+	int			entityIndex;
+	Vector			absmin, absmax;
+	bool			bounded;		// world has no bounds check
+} decalSubmodel_t;
+
+static decalSubmodel_t	g_decalSubmodels[MAX_DECAL_MODELS];
+static int		g_numDecalSubmodels;
+
+// copy of the source request, queue can be built while bmodels are processed
+typedef struct
+{
+	model_t			*model;
+	Vector			position;
+	Vector			normal;
+	float			angle;
+	char			name[64];
+	int			flags;
+} decalSource_t;
+
+static decalSource_t	g_decalSources[MAX_DECAL_QUEUE];
+
 // ===========================
 // Decals creation
 // ===========================
@@ -526,10 +570,32 @@ static uint R_DecalPointHashKey( const Vector &point, uint hashSize )
 R_DecalPointCull
 ==================
 */
-static void R_DecalPointCull( const mplane_t *planes, int numVertices, const bvert_t *vertices, byte *cullBits )
+static void R_DecalPointCull( const decalClip_t *clip, int numVertices, const bvert_t *vertices, byte *cullBits )
 {
-	float	d0, d1, d2, d3, d4, d5;
-	int	bits;
+#if defined( HAVE_SSE_MATH )
+	// four planes at once, lanes 6 and 7 are always in front
+	__m128	nx0 = _mm_loadu_ps( &clip->cullPlanes[0][0] ), nx1 = _mm_loadu_ps( &clip->cullPlanes[0][4] );
+	__m128	ny0 = _mm_loadu_ps( &clip->cullPlanes[1][0] ), ny1 = _mm_loadu_ps( &clip->cullPlanes[1][4] );
+	__m128	nz0 = _mm_loadu_ps( &clip->cullPlanes[2][0] ), nz1 = _mm_loadu_ps( &clip->cullPlanes[2][4] );
+	__m128	dist0 = _mm_loadu_ps( &clip->cullPlanes[3][0] ), dist1 = _mm_loadu_ps( &clip->cullPlanes[3][4] );
+
+	for( int i = 0; i < numVertices; i++ )
+	{
+		__m128 x = _mm_set1_ps( vertices[i].vertex.x );
+		__m128 y = _mm_set1_ps( vertices[i].vertex.y );
+		__m128 z = _mm_set1_ps( vertices[i].vertex.z );
+
+		__m128 d0 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, nx0 ), _mm_mul_ps( y, ny0 )), _mm_mul_ps( z, nz0 ));
+		__m128 d1 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, nx1 ), _mm_mul_ps( y, ny1 )), _mm_mul_ps( z, nz1 ));
+		d0 = _mm_sub_ps( d0, dist0 );
+		d1 = _mm_sub_ps( d1, dist1 );
+
+		cullBits[i] = _mm_movemask_ps( d0 ) | ( _mm_movemask_ps( d1 ) << 4 );
+	}
+#else
+	const mplane_t	*planes = clip->planes;
+	float		d0, d1, d2, d3, d4, d5;
+	int		bits;
 
 	for( int i = 0; i < numVertices; i++ )
 	{
@@ -551,6 +617,7 @@ static void R_DecalPointCull( const mplane_t *planes, int numVertices, const bve
 
 		cullBits[i] = bits;
 	}
+#endif
 }
 
 /*
@@ -764,27 +831,14 @@ static void R_AddDecal( decalClip_t *clip, msurface_t *surf )
 		SetBits( newdecal->flags, FDECAL_DONTSAVE );
 	else clip->current = newdecal;
 
-	// init vertex cache
-	if( newdecal->numVerts < clip->numVertices )
-	{
-		// FIXME: cache realloc provoked 'leaks' in cache array
-		if( newdecal->numVerts )
-			ALERT( at_aiconsole, "R_AddDecal: vertex cache was reallocated (%i < %i)\n", newdecal->numVerts, clip->numVertices );
-		newdecal->verts = &g_decalVertexCache[g_decalVertUsed];
-		g_decalVertUsed += clip->numVertices;
-		newdecal->numVerts = clip->numVertices;
-	}
+	// fragment is never exceeds the slot size so reused decal
+	// just overwrite the old one, no reallocations are needed
+	int slot = newdecal - gDecalPool;
 
-	// init index cache
-	if( newdecal->numElems < clip->numIndices )
-	{
-		// FIXME: cache realloc provoked 'leaks' in cache array
-		if( newdecal->numElems )
-			ALERT( at_aiconsole, "R_AddDecal: index cache was reallocated (%i < %i)\n", newdecal->numElems, clip->numIndices );
-		newdecal->elems = &g_decalIndexCache[g_decalElemUsed];
-		g_decalElemUsed += clip->numIndices;
-		newdecal->numElems = clip->numIndices;
-	}
+	newdecal->verts = &g_decalVertexCache[slot * MAX_DECAL_VERTICES];
+	newdecal->elems = &g_decalIndexCache[slot * MAX_DECAL_INDICES];
+	newdecal->numVerts = clip->numVertices;
+	newdecal->numElems = clip->numIndices;
 
 	// Copy the indices
 	memcpy( newdecal->elems, clip->indices, clip->numIndices * sizeof( word ));
@@ -944,7 +998,7 @@ static void R_ClipSurfaceToDecal( decalClip_t *clip, msurface_t *fa )
 	}
 
 	// Categorize all points by the planes
-	R_DecalPointCull( clip->planes, esrf->numverts, verts, cullBits );
+	R_DecalPointCull( clip, esrf->numverts, verts, cullBits );
 
 	// clip the surface
 	for( int i = 0; i < esrf->numverts - 2; i++ )
@@ -976,7 +1030,7 @@ static void R_ClipSurfaceToDecal( decalClip_t *clip, msurface_t *fa )
 	R_AddDecal( clip, fa );
 }
 
-static void R_DecalNodeSurfaces( mnode_t *node, decalClip_t *clip )
+static void R_DecalNodeSurfaces( mnode_t *node, uint mask )
 {
 	// iterate over all surfaces in the node
 	msurface_t *surf = worldmodel->surfaces + node->firstsurface;
@@ -989,47 +1043,80 @@ static void R_DecalNodeSurfaces( mnode_t *node, decalClip_t *clip )
 		if( FBitSet( surf->flags, ( SURF_DRAWTURB|SURF_DRAWSKY|SURF_CONVEYOR|SURF_DRAWTILED )))
 			continue;
 
-		// no puddles on transparent surfaces or mirrors
-		if( FBitSet( clip->flags, FDECAL_PUDDLE ) && FBitSet( surf->flags, ( SURF_TRANSPARENT|SURF_REFLECT )))
-			continue;
+		for( int j = 0; j < g_numBatchDecals; j++ )
+		{
+			decalClip_t *clip = g_decalBatch[j];
 
-		if( !BoundsIntersect( esrf->mins, esrf->maxs, clip->mins, clip->maxs ))
-			continue;
+			if( !FBitSet( mask, BIT( j )))
+				continue;
+
+			// no puddles on transparent surfaces or mirrors
+			if( FBitSet( clip->flags, FDECAL_PUDDLE ) && FBitSet( surf->flags, ( SURF_TRANSPARENT|SURF_REFLECT )))
+				continue;
+
+			if( !BoundsIntersect( esrf->mins, esrf->maxs, clip->mins, clip->maxs ))
+				continue;
 
-		R_ClipSurfaceToDecal( clip, surf );
+			R_ClipSurfaceToDecal( clip, surf );
+		}
 	}
 }
 
-static void R_DecalNode( mnode_t *node, decalClip_t *clip )
+/*
+==================
+R_DecalNode
+
+walk the BSP once for the whole batch,
+mask is a set of decals that touches the node
+==================
+*/
+static void R_DecalNode( mnode_t *node, uint mask )
 {
+	uint	front = 0, back = 0, onplane = 0;
+
 	ASSERT( node != NULL );
 
 	// hit a leaf
 	if( node->contents < 0 )
 		return;
 
-	int s = BOX_ON_PLANE_SIDE( clip->mins, clip->maxs, node->plane );
+	for( int i = 0; i < g_numBatchDecals; i++ )
+	{
+		decalClip_t *clip = g_decalBatch[i];
 
-	if( s == 3 ) R_DecalNodeSurfaces( node, clip );
-	if( s & 1 ) R_DecalNode( node->children[0], clip );
-	if( s & 2 ) R_DecalNode( node->children[1], clip );
+		if( !FBitSet( mask, BIT( i )))
+			continue;
+
+		int s = BOX_ON_PLANE_SIDE( clip->mins, clip->maxs, node->plane );
+
+		if( s == 3 ) SetBits( onplane, BIT( i ));
+		if( s & 1 ) SetBits( front, BIT( i ));
+		if( s & 2 ) SetBits( back, BIT( i ));
+	}
+
+	if( onplane ) R_DecalNodeSurfaces( node, onplane );
+	if( front ) R_DecalNode( node->children[0], front );
+	if( back ) R_DecalNode( node->children[1], back );
 }
 
-void CreateDecal( const Vector &vecEndPos, const Vector &vecPlaneNormal, float angle, const char *name, int flags, int entityIndex, int modelIndex, bool source )
+/*
+==================
+R_QueueDecal
+
+setup the clip volume and put it into the queue
+==================
+*/
+static void R_QueueDecal( const Vector &vecEndPos, const Vector &vecPlaneNormal, float angle, const char *name, int flags, int entityIndex, int modelIndex, bool source )
 {
 	int	srcFlags = flags;
 
-	if( !pDecalGroupList )
-		return;
-
-	// probably this never happens
-	if(( g_decalVertUsed >= MAX_DECAL_VERTS ) || ( g_decalElemUsed >= MAX_DECAL_ELEMS ))
+	if( g_numQueuedDecals == MAX_DECAL_QUEUE )
 	{
-		ALERT( at_error, "CreateDecal: cache decal is overflow!\n" );
+		ALERT( at_aiconsole, "R_QueueDecal: decal queue is full\n" );
 		return;
 	}
 
-	decalClip_t decalClip; // intermediate struct that used only for build new decals
+	decalClip_t &decalClip = g_decalQueue[g_numQueuedDecals]; // intermediate struct that used only for build new decals
 	cl_entity_t *ent = NULL;
 
 	decalClip.decalDesc = DecalGroup::GetEntry( name, flags );
@@ -1160,23 +1247,61 @@ void CreateDecal( const Vector &vecEndPos, const Vector &vecPlaneNormal, float a
 	// clear the hash table
 	memset( decalClip.verticesHashTable, 0, sizeof( decalClip.verticesHashTable ));
 
-	// g-cont. now using walking on bsp-tree instead of stupid linear search
-	R_DecalNode( &decalClip.model->nodes[decalClip.model->hulls[0].firstclipnode], &decalClip );
-	if( !source ) return; // to avoid recursion
+	// clip planes in SoA layout, padding planes are never culls
+	for( int i = 0; i < 8; i++ )
+	{
+		if( i >= 6 )
+		{
+			decalClip.cullPlanes[0][i] = decalClip.cullPlanes[1][i] = decalClip.cullPlanes[2][i] = 0.0f;
+			decalClip.cullPlanes[3][i] = -1.0f;
+			continue;
+		}
+
+		const mplane_t *plane = &decalClip.planes[i];
+
+		decalClip.cullPlanes[0][i] = plane->normal.x;
+		decalClip.cullPlanes[1][i] = plane->normal.y;
+		decalClip.cullPlanes[2][i] = plane->normal.z;
+		decalClip.cullPlanes[3][i] = plane->dist;
+	}
+
+	// remember the request to place decal on touched bmodels
+	decalClip.srcPosition = vecEndPos;
+	decalClip.srcNormal = vecPlaneNormal;
+	Q_strncpy( decalClip.srcName, name, sizeof( decalClip.srcName ));
+	decalClip.srcFlags = srcFlags;
+	decalClip.source = source;
+
+	g_numQueuedDecals++;
+}
+
+/*
+==================
+R_GatherDecalSubmodels
+
+collect brush models that may receive
+the decal fragments, shared by whole batch
+==================
+*/
+static void R_GatherDecalSubmodels( void )
+{
+	g_numDecalSubmodels = 0;
 
-	// trying to place decals on contacted submodels too
-	// FIXME: this is doesn't working
-	for( int i = 0; i < 1024; i++ )
+	for( int i = 0; i < MAX_DECAL_MODELS; i++ )
 	{
 		model_t *mod = MODEL_HANDLE( i );
 
-		if( !mod || mod->type != mod_brush || mod == decalClip.model )
+		if( !mod || mod->type != mod_brush )
 			continue;
 
 		if( mod->firstmodelsurface >= worldmodel->numsurfaces || !mod->nummodelsurfaces )
 			continue;	// skip weird models
 
-		int entityIndex = 0;
+		decalSubmodel_t *sub = &g_decalSubmodels[g_numDecalSubmodels];
+
+		sub->model = mod;
+		sub->entityIndex = 0;
+		sub->bounded = false;
 
 		if( mod->name[0] == '*' )
 		{
@@ -1185,18 +1310,136 @@ void CreateDecal( const Vector &vecEndPos, const Vector &vecPlaneNormal, float a
 			if( !e ) continue; // entity invisible on the client
 
 			gl_state_t *glm = GL_GetCache( e->hCachedMatrix );
-			Vector absmin, absmax;
 
-			TransformAABB( glm->transform, mod->mins, mod->maxs, absmin, absmax );
+			TransformAABB( glm->transform, mod->mins, mod->maxs, sub->absmin, sub->absmax );
+			sub->entityIndex = e->index;
+			sub->bounded = true;
+		}
+
+		g_numDecalSubmodels++;
+	}
+}
+
+/*
+==================
+R_BuildQueuedDecals
+
+group decals by model and walk the tree once per group
+==================
+*/
+static void R_BuildQueuedDecals( void )
+{
+	for( int i = 0; i < g_numQueuedDecals; i++ )
+	{
+		model_t *model = g_decalQueue[i].model;
+		uint mask = 0;
+		int j;
+
+		if( !model ) continue; // already built
 
-			if( !BoundsIntersect( absmin, absmax, vecEndPos, vecEndPos ))
-				continue;	// no intersection with this model
-			entityIndex = e->index;
+		g_numBatchDecals = 0;
+
+		for( j = i; j < g_numQueuedDecals && g_numBatchDecals < MAX_DECAL_BATCH; j++ )
+		{
+			if( g_decalQueue[j].model != model )
+				continue;
+
+			SetBits( mask, BIT( g_numBatchDecals ));
+			g_decalBatch[g_numBatchDecals++] = &g_decalQueue[j];
 		}
 
+		// g-cont. now using walking on bsp-tree instead of stupid linear search
+		R_DecalNode( &model->nodes[model->hulls[0].firstclipnode], mask );
+
+		for( j = 0; j < g_numBatchDecals; j++ )
+			g_decalBatch[j]->model = NULL;
+	}
+
+	g_numQueuedDecals = g_numBatchDecals = 0;
+}
+
+/*
+==================
+R_QueueSubmodelDecals
+
+trying to place decals on contacted submodels too
+FIXME: this is doesn't working
+==================
+*/
+static void R_QueueSubmodelDecals( const decalSource_t *src )
+{
+	for( int i = 0; i < g_numDecalSubmodels; i++ )
+	{
+		const decalSubmodel_t *sub = &g_decalSubmodels[i];
+
+		if( sub->model == src->model )
+			continue;
+
+		if( sub->bounded && !BoundsIntersect( sub->absmin, sub->absmax, src->position, src->position ))
+			continue;	// no intersection with this model
+
+		// too many decals, build them right now
+		if( g_numQueuedDecals == MAX_DECAL_QUEUE )
+			R_BuildQueuedDecals();
+
 		// trying to place decal on neighbored bmodel
-		CreateDecal( vecEndPos, vecPlaneNormal, angle, name, srcFlags, entityIndex, 0, false );
+		R_QueueDecal( src->position, src->normal, src->angle, src->name, src->flags, sub->entityIndex, 0, false );
+	}
+}
+
+/*
+==================
+R_FlushDecalQueue
+
+build all the decals that was created since last frame
+==================
+*/
+void R_FlushDecalQueue( void )
+{
+	int	i, numsources = 0;
+
+	if( !g_numQueuedDecals )
+		return;
+
+	PROF_SCOPE( "R_FlushDecalQueue" );
+
+	for( i = 0; i < g_numQueuedDecals; i++ )
+	{
+		const decalClip_t *clip = &g_decalQueue[i];
+
+		if( !clip->source )
+			continue;
+
+		decalSource_t *src = &g_decalSources[numsources++];
+
+		src->model = clip->model;
+		src->position = clip->srcPosition;
+		src->normal = clip->srcNormal;
+		src->angle = clip->angle;
+		Q_strncpy( src->name, clip->srcName, sizeof( src->name ));
+		src->flags = clip->srcFlags;
 	}
+
+	// list is built once per batch
+	if( numsources > 0 )
+		R_GatherDecalSubmodels();
+
+	for( i = 0; i < numsources; i++ )
+		R_QueueSubmodelDecals( &g_decalSources[i] );
+
+	R_BuildQueuedDecals();
+}
+
+void CreateDecal( const Vector &vecEndPos, const Vector &vecPlaneNormal, float angle, const char *name, int flags, int entityIndex, int modelIndex, bool source )
+{
+	if( !pDecalGroupList )
+		return;
+
+	// too many decals at one frame, build them right now
+	if( g_numQueuedDecals == MAX_DECAL_QUEUE )
+		R_FlushDecalQueue();
+
+	R_QueueDecal( vecEndPos, vecPlaneNormal, angle, name, flags, entityIndex, modelIndex, source );
 }
 
 void CreateDecal( pmtrace_t *tr, const char *name, float angle, bool visent )
@@ -1253,6 +1496,9 @@ int SaveDecalList( decallist_t *pBaseList, int count )
 	brushdecal_t *pdecal, *pdecals;
 	int total = 0, depth;
 
+	// decals from this frame is not built yet
+	R_FlushDecalQueue();
+
 	for( int i = 0; i < gDecalCount; i++ )
 	{
 		pdecal = &gDecalPool[i];
@@ -1678,6 +1924,8 @@ static void R_RenderTransListDecalsDebug( drawlist_t drawlist_type )
 
 void R_RenderDecalsSolidList( drawlist_t drawlist_type )
 {
+	PROF_SCOPE( "R_RenderDecalsSolidList" );
+
 	if( FBitSet( RI->params, ( RP_ENVVIEW|RP_SKYVIEW )))
 		return;
 
@@ -1746,6 +1994,8 @@ void R_RenderDecalsSolidList( drawlist_t drawlist_type )
 
 void R_RenderDecalsTransList( drawlist_t drawlist_type )
 {
+	PROF_SCOPE( "R_RenderDecalsTransList" );
+
 	if( FBitSet( RI->params, ( RP_ENVVIEW|RP_SKYVIEW )))
 		return;
 
@@ -1835,8 +2085,8 @@ void ClearDecals( void )
 	}
 
 	memset( gDecalPool, 0, sizeof( gDecalPool ));
-	g_decalVertUsed = g_decalElemUsed = 0;
 	gDecalCount = gDecalCycle = 0;
+	g_numQueuedDecals = 0;
 }
 
 // ===========================
@@ -1844,12 +2094,13 @@ void ClearDecals( void )
 // ===========================
 void DecalsInit( void )
 {
+	LOAD_ZONE( "DecalsInit" );
 	ADD_COMMAND( "pastedecal", PasteViewDecal );
 	ADD_COMMAND( "cleardecals", ClearDecals );
 
 	ALERT( at_aiconsole, "Loading decals\n" );
 
-	char *pfile = (char *)gEngfuncs.COM_LoadFile( "gfx/decals/decalinfo.txt", 5, NULL );
+	char *pfile = (char *)LOAD_FILE( "gfx/decals/decalinfo.txt", NULL );
 
 	if( !pfile )
 	{
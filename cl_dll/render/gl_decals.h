@@ -97,6 +97,7 @@ typedef struct brushdecal_s
 void DecalsInit( void );
 void ClearDecals( void );
 void DecalsShutdown( void );
+void R_FlushDecalQueue( void );
 void R_RenderDecalsSolidList( drawlist_t drawlist_type );
 void R_RenderDecalsTransList( drawlist_t drawlist_type );
 void R_RenderDecalsTransEntry( CTransEntry *entry, drawlist_t drawlist_type );
@@ -22,6 +22,7 @@ GNU General Public License for more details.
 #include "gl_studio.h"
 #include "gl_world.h"
 #include "gl_grass.h"
+#include "jobs.h"
 
 /*
 =============================================================================
@@ -129,6 +130,39 @@ int HasDynamicLights( void )
 	return numDlights;
 }
 
+//=====================================
+// R_GatherVisibleLights
+//
+// Collect dynamic lights that touching the
+// current view, so their drawlists can be
+// built in parallel before drawing
+//=====================================
+int R_GatherVisibleLights( CDynLight *lights[MAX_DLIGHTS] )
+{
+	CDynLight *pl = tr.dlights;
+	int numlights = 0;
+
+	for( int i = 0; i < MAX_DLIGHTS; i++, pl++ )
+	{
+		if( pl->Expired( )) continue;
+
+		if( pl->type == LIGHT_SPOT || pl->type == LIGHT_OMNI )
+		{
+			if( !pl->Active( )) continue;
+
+			if( !Mod_CheckBoxVisible( pl->absmin, pl->absmax ))
+				continue;
+
+			if( R_CullFrustum( &pl->frustum ))
+				continue;
+		}
+
+		lights[numlights++] = pl;
+	}
+
+	return numlights;
+}
+
 //=====================================
 // HasStaticLights
 //
@@ -711,18 +745,26 @@ static float LightIntensityInBox( mworldlight_t *wl, const Vector &mid, const Ve
 R_FindWorldLights
 
 search for lights that potentially can lit bbox
+NOTE: main thread only, candidates and lightgrid stamps are shared
 =================
 */
 void R_FindWorldLights( const Vector &origin, const Vector &mins, const Vector &maxs, byte lights[MAXDYNLIGHTS], bool skipZ )
 {
-	mworldlight_t *wl = world->worldlights;
+	static int candidates[MAX_LIGHT_CANDIDATES];
 	Vector absmin = origin + mins;
 	Vector absmax = origin + maxs;
-	vec2_t indexes[32];
-	int count = 0;
+	lightselect_t select;
 
-	for( int i = 0; i < world->numworldlights; i++, wl++ )
+	ASSERT( !JOB_InProgress( ));
+
+	// only lights which cells is touched by bbox
+	int count = Mod_GatherWorldLights( absmin, absmax, candidates, ARRAYSIZE( candidates ));
+	Mod_InitLightSelect( &select, (int)cv_deferred_maxlights->value );
+
+	for( int i = 0; i < count; i++ )
 	{
+		mworldlight_t *wl = world->worldlights + candidates[i];
+
 		if( !Mod_BoxVisible( absmin, absmax, wl->pvs ))
 			continue;
 
@@ -733,48 +775,12 @@ void R_FindWorldLights( const Vector &origin, const Vector &mins, const Vector &
 
 		Vector add = wl->intensity * ratio;
 		float illum = VectorMax( add );
-//Msg( "#%i, type %d, illum %.5f, intensity %g %g %g\n", i, wl->emittype, illum, wl->intensity[0], wl->intensity[1], wl->intensity[2] );
-		if( illum <= 4e-3 )
-			continue;
-
-		if( count >= ARRAYSIZE( indexes ) / 2 )
-			break;
-
-		indexes[count][0] = i;
-		indexes[count][1] = illum;
-		count++;
-	}
 
-	memset( lights, 255, sizeof( byte ) * MAXDYNLIGHTS );
-get_next_light:
-	float maxIllum = 0.0;
-	int ignored = -1;
-	int light = 255;
-
-	for( int i = 0; i < count; i++ )
-	{
-		if( indexes[i][0] == -1.0f )
+		if( illum <= 4e-3 )
 			continue;
 
-		// skylight has a maximum priority
-		if( indexes[i][1] > maxIllum )
-		{
-			maxIllum = indexes[i][1];
-			light = indexes[i][0];
-			ignored = i;
-		}
+		Mod_AddLightToSelect( &select, candidates[i], illum );
 	}
 
-	if( ignored == -1 )
-		return;
-
-	int i;
-	for( i = 0; i < (int)cv_deferred_maxlights->value && lights[i] != 255; i++ );
-	if( i < (int)cv_deferred_maxlights->value )
-		lights[i] = light;	// nearest light for surf
-	indexes[ignored][0] = -1;	// this light is handled
-
-//	if( count > (int)cv_deferred_maxlights->value && i == (int)cv_deferred_maxlights->value )
-//		Msg( "skipped light %i intensity %g, type %d\n", light, maxIllum, world->worldlights[light].emittype );
-	goto get_next_light;	
+	Mod_FinishLightSelect( &select, lights );
 }
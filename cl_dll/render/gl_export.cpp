@@ -173,6 +173,18 @@ static dllfunc_t drawrangeelementsextfuncs[] =
 { NULL, NULL }
 };
 
+static dllfunc_t multidrawfuncs[] =
+{
+{ "glMultiDrawElements" , (void **)&pglMultiDrawElements },
+{ NULL, NULL }
+};
+
+static dllfunc_t multidrawextfuncs[] =
+{
+{ "glMultiDrawElementsEXT" , (void **)&pglMultiDrawElementsEXT },
+{ NULL, NULL }
+};
+
 static dllfunc_t debugoutputfuncs[] =
 {
 { "glDebugMessageControlARB" , (void **)&pglDebugMessageControlARB },
@@ -540,6 +552,14 @@ static void GL_InitExtensions( void )
 		return;
 	}
 
+	// batching world surfaces
+	GL_CheckExtension( "glMultiDrawElements", multidrawfuncs, "gl_multidraw", R_MULTI_DRAW_EXT );
+
+	if( !GL_Support( R_MULTI_DRAW_EXT ))
+		GL_CheckExtension( "GL_EXT_multi_draw_arrays", multidrawextfuncs, "gl_multidraw", R_MULTI_DRAW_EXT );
+
+	if( pglMultiDrawElementsEXT == NULL ) pglMultiDrawElementsEXT = pglMultiDrawElements;
+
 	// multitexture
 	glConfig.max_texture_units = 1;
 	GL_CheckExtension( "GL_ARB_multitexture", multitexturefuncs, "gl_arb_multitexture", R_ARB_MULTITEXTURE, true );
@@ -983,6 +1003,7 @@ bool GL_Init( void )
 	InitRain();	// rain
 	DecalsInit();
 	R_GrassInit();
+	JOB_Init( (int)r_threads->value );
 
 	return true;
 }
@@ -996,6 +1017,7 @@ void GL_Shutdown( void )
 {
 	int	i;
 
+	JOB_Shutdown();
 	g_StudioRenderer.DestroyAllModelInstances();
 	g_StudioRenderer.FreeStudioCacheVL();
 	g_StudioRenderer.FreeStudioCacheFL();
@@ -1021,6 +1043,7 @@ void GL_Shutdown( void )
 	R_FreeCinematics();
 	DecalsShutdown();
 	R_GrassShutdown();
+	ShutdownRain();
 	GL_FreeGPUShaders();
 	GL_FreeDrawbuffers();
 
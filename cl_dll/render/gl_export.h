@@ -1208,6 +1208,8 @@ EXTERN void ( APIENTRY *pglClientActiveTextureARB)( GLenum );
 EXTERN void ( APIENTRY *pglGetCompressedTexImage)( GLenum target, GLint lod, const void* data );
 EXTERN void ( APIENTRY *pglDrawRangeElements)( GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices );
 EXTERN void ( APIENTRY *pglDrawRangeElementsEXT)( GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices );
+EXTERN void ( APIENTRY *pglMultiDrawElements)( GLenum mode, const GLsizei *count, GLenum type, const GLvoid* *indices, GLsizei primcount );
+EXTERN void ( APIENTRY *pglMultiDrawElementsEXT)( GLenum mode, const GLsizei *count, GLenum type, const GLvoid* *indices, GLsizei primcount );
 EXTERN void ( APIENTRY *pglDrawElements)(GLenum mode, GLsizei count, GLenum type, const void *indices);
 EXTERN void ( APIENTRY *pglVertexPointer)(GLint size, GLenum type, GLsizei stride, const void *ptr);
 EXTERN void ( APIENTRY *pglNormalPointer)(GLenum type, GLsizei stride, const void *ptr);
@@ -20,6 +20,9 @@ GNU General Public License for more details.
 #include "gl_local.h"
 #include <mathlib.h>
 #include <stringlib.h>
+#if defined( HAVE_SSE_MATH )
+#include <xmmintrin.h>
+#endif
 
 void CFrustum :: ClearFrustum( void )
 {
@@ -315,6 +318,77 @@ bool CFrustum :: CullBox( const Vector &mins, const Vector &maxs, int userClipFl
 	return false;
 }
 
+/*
+=================
+CullBoxes
+
+same as CullBox but for four packed boxes at once
+=================
+*/
+int CFrustum :: CullBoxes( const float *packed, int userClipFlags )
+{
+	int iClipFlags;
+
+	if( CVAR_TO_BOOL( r_nocull ))
+		return 0;
+
+	if( userClipFlags != 0 )
+		iClipFlags = userClipFlags;
+	else iClipFlags = clipFlags;
+#if defined( HAVE_SSE_MATH )
+	__m128 mins[3], maxs[3];
+	__m128 culled = _mm_setzero_ps();
+
+	mins[0] = _mm_loadu_ps( packed + PACKED_BOXES * 0 );
+	mins[1] = _mm_loadu_ps( packed + PACKED_BOXES * 1 );
+	mins[2] = _mm_loadu_ps( packed + PACKED_BOXES * 2 );
+	maxs[0] = _mm_loadu_ps( packed + PACKED_BOXES * 3 );
+	maxs[1] = _mm_loadu_ps( packed + PACKED_BOXES * 4 );
+	maxs[2] = _mm_loadu_ps( packed + PACKED_BOXES * 5 );
+
+	for( int i = 0; i < FRUSTUM_PLANES; i++ )
+	{
+		if( !FBitSet( iClipFlags, BIT( i )))
+			continue;
+
+		const mplane_t *p = &planes[i];
+
+		// select the nearest corner to the plane positive side
+		__m128 x = FBitSet( p->signbits, 1 ) ? mins[0] : maxs[0];
+		__m128 y = FBitSet( p->signbits, 2 ) ? mins[1] : maxs[1];
+		__m128 z = FBitSet( p->signbits, 4 ) ? mins[2] : maxs[2];
+
+		__m128 dot = _mm_mul_ps( x, _mm_set1_ps( p->normal.x ));
+		dot = _mm_add_ps( dot, _mm_mul_ps( y, _mm_set1_ps( p->normal.y )));
+		dot = _mm_add_ps( dot, _mm_mul_ps( z, _mm_set1_ps( p->normal.z )));
+		culled = _mm_or_ps( culled, _mm_cmplt_ps( dot, _mm_set1_ps( p->dist )));
+	}
+
+	return _mm_movemask_ps( culled );
+#else
+	int culled = 0;
+
+	for( int i = 0; i < FRUSTUM_PLANES; i++ )
+	{
+		if( !FBitSet( iClipFlags, BIT( i )))
+			continue;
+
+		const mplane_t *p = &planes[i];
+		const float *x = packed + ( FBitSet( p->signbits, 1 ) ? 0 : 3 ) * PACKED_BOXES;
+		const float *y = packed + ( FBitSet( p->signbits, 2 ) ? 1 : 4 ) * PACKED_BOXES;
+		const float *z = packed + ( FBitSet( p->signbits, 4 ) ? 2 : 5 ) * PACKED_BOXES;
+
+		for( int j = 0; j < PACKED_BOXES; j++ )
+		{
+			if( p->normal.x * x[j] + p->normal.y * y[j] + p->normal.z * z[j] < p->dist )
+				SetBits( culled, BIT( j ));
+		}
+	}
+
+	return culled;
+#endif
+}
+
 bool CFrustum :: CullSphere( const Vector &centre, float radius, int userClipFlags )
 {
 	int iClipFlags;
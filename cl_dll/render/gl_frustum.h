@@ -26,6 +26,21 @@ GNU General Public License for more details.
 #define FRUSTUM_NEAR	5
 #define FRUSTUM_PLANES	6
 
+// bounds of four boxes packed for CullBoxes:
+// mins.x[4], mins.y[4], mins.z[4], maxs.x[4], maxs.y[4], maxs.z[4]
+#define PACKED_BOXES	4
+#define PACKED_BOX_FLOATS	( PACKED_BOXES * 6 )
+
+inline void PackBoxBounds( float *packed, int slot, const float *mins, const float *maxs )
+{
+	packed[PACKED_BOXES*0+slot] = mins[0];
+	packed[PACKED_BOXES*1+slot] = mins[1];
+	packed[PACKED_BOXES*2+slot] = mins[2];
+	packed[PACKED_BOXES*3+slot] = maxs[0];
+	packed[PACKED_BOXES*4+slot] = maxs[1];
+	packed[PACKED_BOXES*5+slot] = maxs[2];
+}
+
 class CFrustum
 {
 public:
@@ -46,6 +61,7 @@ public:
 
 	// cull methods
 	bool CullBox( const Vector &mins, const Vector &maxs, int userClipFlags = 0 );
+	int CullBoxes( const float *packed, int userClipFlags = 0 );	// returns bitmask of culled boxes
 	bool CullSphere( const Vector &centre, float radius, int userClipFlags = 0 );
 	bool CullFrustum( CFrustum *frustum, int userClipFlags = 0 );
 
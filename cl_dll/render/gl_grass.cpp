@@ -22,6 +22,7 @@ GNU General Public License for more details.
 #include <utlarray.h>
 #include <stringlib.h>
 #include "vertex_fmt.h"
+#include "jobs.h"
 
 #define LEAF_MAX_EXPAND	48.0f
 #define DENSITY_FACTOR	0.0001f
@@ -29,13 +30,42 @@ GNU General Public License for more details.
 grasstexture_t		grasstexs[GRASS_TEXTURES];
 CUtlArray<grassentry_t>	grassInfo;
 
-// intermediate arrays used for creating VBO's
-static gvert_t		m_arraygvert[MAX_GRASS_VERTS];
-static word		m_indexarray[MAX_GRASS_ELEMS];
-static int		m_iNumVertex, m_iNumIndex, m_iVertexState;
-static int		m_iTotalVerts = 0;
-static int		m_iTextureWidth;
-static int		m_iTextureHeight;
+#define RAND_NTAB		32
+
+// predictable random generator (private copy per build, engine one is not thread-safe)
+typedef struct
+{
+	int		idum;
+	int		iy;
+	int		iv[RAND_NTAB];
+} grassrandom_t;
+
+// intermediate state used for building meshes on job threads
+typedef struct
+{
+	gvert_t		*verts;		// current mesh
+	word		*elems;
+	int		numVertex;
+	int		numIndex;
+	int		vertexState;
+	int		maxVertex;	// reserved space
+	int		maxIndex;
+	int		textureWidth;
+	int		textureHeight;
+	grassrandom_t	random;
+} grassbuild_t;
+
+static grasshdr_t		*m_pGrassPending[MAX_GRASS_PENDING];
+static int		m_iNumGrassPending;
+static grasshdr_t		*m_pGrassBuild[GRASS_BUILDS_PER_FRAME];
+static grasshdr_t		*m_pGrassHead;	// most recently used
+static grasshdr_t		*m_pGrassTail;	// least recently used
+static msurface_t		**m_pGrassSurfaces;	// world surfaces with grass (prefetch ring)
+static int		m_iNumGrassSurfaces;
+static int		m_iGrassRingPos;
+static Vector		m_vecGrassLastOrigin;
+static Vector		m_vecGrassVelocity;
+static byte		m_grassGamma[256];	// TEXTURE_TO_TEXGAMMA copy for job threads
 static float		m_flGrassFadeStart;
 static float		m_flGrassFadeDist;
 static float		m_flGrassFadeEnd;
@@ -275,6 +305,73 @@ static grass_loader_t pfnMeshLoaderGL30[GRASSLOADER_COUNT] =
 { CreateBufferBaseBumpGL30, BindBufferBaseBumpGL30, "BumpBaseBuffer" },
 };
 
+/*
+================
+R_GrassRandomSeed
+
+same generator as engine uses (ran1)
+so bushes placement is not changed
+================
+*/
+#define RAND_IA		16807
+#define RAND_IM		2147483647
+#define RAND_IQ		127773
+#define RAND_IR		2836
+#define RAND_NDIV		( 1 + ( RAND_IM - 1 ) / RAND_NTAB )
+#define RAND_AM		( 1.0 / RAND_IM )
+#define RAND_RNMX		( 1.0 - 1.2e-7 )
+
+static void R_GrassRandomSeed( grassrandom_t *rnd, int seed )
+{
+	rnd->idum = seed;
+
+	if( 1000 < rnd->idum )
+		rnd->idum = -rnd->idum;
+	else if( -1000 < rnd->idum )
+		rnd->idum -= 22261048;
+	rnd->iy = 0;
+}
+
+static int R_GrassRandomLong( grassrandom_t *rnd )
+{
+	int	j, k;
+
+	if( rnd->idum <= 0 || !rnd->iy )
+	{
+		if( -rnd->idum < 1 )
+			rnd->idum = 1;
+		else rnd->idum = -rnd->idum;
+
+		for( j = RAND_NTAB + 7; j >= 0; j-- )
+		{
+			k = rnd->idum / RAND_IQ;
+			rnd->idum = RAND_IA * ( rnd->idum - k * RAND_IQ ) - RAND_IR * k;
+			if( rnd->idum < 0 ) rnd->idum += RAND_IM;
+			if( j < RAND_NTAB ) rnd->iv[j] = rnd->idum;
+		}
+		rnd->iy = rnd->iv[0];
+	}
+
+	k = rnd->idum / RAND_IQ;
+	rnd->idum = RAND_IA * ( rnd->idum - k * RAND_IQ ) - RAND_IR * k;
+	if( rnd->idum < 0 ) rnd->idum += RAND_IM;
+	j = rnd->iy / RAND_NDIV;
+	rnd->iy = rnd->iv[j];
+	rnd->iv[j] = rnd->idum;
+
+	return rnd->iy;
+}
+
+static float R_GrassRandomFloat( grassrandom_t *rnd, float flLow, float flHigh )
+{
+	float	fl = (float)RAND_AM * R_GrassRandomLong( rnd );
+
+	if( fl > (float)RAND_RNMX )
+		fl = (float)RAND_RNMX;
+
+	return ( fl * ( flHigh - flLow )) + flLow;
+}
+
 /*
 ================
 R_GetPointForBush
@@ -282,11 +379,11 @@ R_GetPointForBush
 compute 16 points for single bush
 ================
 */
-static const Vector R_GetPointForBush( int vertexNum, const Vector &pos, float scale )
+static const Vector R_GetPointForBush( grassbuild_t *build, int vertexNum, const Vector &pos, float scale )
 {
-	float s1 = ( m_iTextureWidth * 0.075f ) * scale;
-	float s2 = ( m_iTextureWidth * 0.1f ) * scale;
-	float s3 = ( m_iTextureHeight * 0.1f ) * scale;
+	float s1 = ( build->textureWidth * 0.075f ) * scale;
+	float s2 = ( build->textureWidth * 0.1f ) * scale;
+	float s3 = ( build->textureHeight * 0.1f ) * scale;
 
 	switch(( vertexNum & 15 ))
 	{
@@ -373,24 +470,24 @@ R_AdvanceVertex
 routine to build quad sequences
 ================
 */
-bool R_GrassAdvanceVertex( void )
+static bool R_GrassAdvanceVertex( grassbuild_t *build )
 {
-	if((( m_iNumIndex + 6 ) >= MAX_GRASS_ELEMS ) || (( m_iNumVertex + 4 ) >= MAX_GRASS_VERTS ))
+	if((( build->numIndex + 6 ) >= build->maxIndex ) || (( build->numVertex + 4 ) >= build->maxVertex ))
 		return false;
 
-	if( m_iVertexState++ < 3 )
+	if( build->vertexState++ < 3 )
 	{
-		m_indexarray[m_iNumIndex++] = m_iNumVertex;
+		build->elems[build->numIndex++] = build->numVertex;
 	}
 	else
 	{
 		// we've already done triangle (0, 1, 2), now draw (2, 3, 0)
-		m_indexarray[m_iNumIndex++] = m_iNumVertex - 1;
-		m_indexarray[m_iNumIndex++] = m_iNumVertex;
-		m_indexarray[m_iNumIndex++] = m_iNumVertex - 3;
-		m_iVertexState = 0;
+		build->elems[build->numIndex++] = build->numVertex - 1;
+		build->elems[build->numIndex++] = build->numVertex;
+		build->elems[build->numIndex++] = build->numVertex - 3;
+		build->vertexState = 0;
 	}
-	m_iNumVertex++;
+	build->numVertex++;
 
 	return true;
 }
@@ -401,9 +498,10 @@ R_GrassLightForVertex
 
 We already have a valid spot on texture
 Just find lightmap point and update grass color
+NOTE: called from job threads
 ================
 */
-void R_GrassLightForVertex( msurface_t *fa, mextrasurf_t *es, const Vector &vertex, float posz, float light[MAXLIGHTMAPS], float delux[MAXLIGHTMAPS] )
+static void R_GrassLightForVertex( msurface_t *fa, mextrasurf_t *es, const Vector &vertex, float posz, float light[MAXLIGHTMAPS], float delux[MAXLIGHTMAPS] )
 {
 	if( !worldmodel->lightdata || !fa->samples )
 		return;
@@ -428,9 +526,9 @@ void R_GrassLightForVertex( msurface_t *fa, mextrasurf_t *es, const Vector &vert
 	for( map = 0; map < MAXLIGHTMAPS && fa->styles[map] != 255; map++ )
 	{
 		color24 out;
-		out.r = TEXTURE_TO_TEXGAMMA( lm->r );
-		out.g = TEXTURE_TO_TEXGAMMA( lm->g );
-		out.b = TEXTURE_TO_TEXGAMMA( lm->b );
+		out.r = m_grassGamma[lm->r];
+		out.g = m_grassGamma[lm->g];
+		out.b = m_grassGamma[lm->b];
 		light[map] = PackColor( out );
 		lm += size; // skip to next lightmap
 	}
@@ -469,12 +567,12 @@ R_CreateSingleBush
 create a bush with specified pos
 ================
 */
-bool R_CreateSingleBush( msurface_t *surf, mextrasurf_t *es, grasshdr_t *hdr, const Vector &pos, float size )
+static bool R_CreateSingleBush( grassbuild_t *build, msurface_t *surf, mextrasurf_t *es, grasshdr_t *hdr, const Vector &pos, float size )
 {
 	for( int i = 0; i < 16; i++ )
 	{
-		gvert_t *entry = &m_arraygvert[m_iNumVertex];
-		Vector vertex = R_GetPointForBush( i, pos, size );
+		gvert_t *entry = &build->verts[build->numVertex];
+		Vector vertex = R_GetPointForBush( build, i, pos, size );
 		memcpy( entry->styles, surf->styles, sizeof( entry->styles ));
 		R_GrassLightForVertex( surf, es, vertex, pos.z, entry->light, entry->delux );
 		AddPointToBounds( vertex, hdr->mins, hdr->maxs ); // build bbox for grass
@@ -491,7 +589,7 @@ bool R_CreateSingleBush( msurface_t *surf, mextrasurf_t *es, grasshdr_t *hdr, co
 		entry->normal[3] = i;
 
 		// generate indices
-		if( !R_GrassAdvanceVertex( ))
+		if( !R_GrassAdvanceVertex( build ))
 		{
 			// vertexes is out
 			return false;
@@ -501,9 +599,9 @@ bool R_CreateSingleBush( msurface_t *surf, mextrasurf_t *es, grasshdr_t *hdr, co
 	return true;
 }
 
-void R_CreateSurfaceVBO( grass_t *pOut )
+static void R_CreateSurfaceVBO( grass_t *pOut, gvert_t *verts, word *elems )
 {
-	if( !m_iNumVertex ) return; // empty mesh?
+	if( !pOut->numVerts ) return; // empty mesh?
 
 	GL_CheckVertexArrayBinding();
 
@@ -513,9 +611,9 @@ void R_CreateSurfaceVBO( grass_t *pOut )
 
 	// move data to video memory
 	if( glConfig.version < ACTUAL_GL_VERSION )
-		pfnMeshLoaderGL21[type].CreateBuffer( pOut, m_arraygvert );
-	else pfnMeshLoaderGL30[type].CreateBuffer( pOut, m_arraygvert );
-	CreateIndexBuffer( pOut, m_indexarray );
+		pfnMeshLoaderGL21[type].CreateBuffer( pOut, verts );
+	else pfnMeshLoaderGL30[type].CreateBuffer( pOut, verts );
+	CreateIndexBuffer( pOut, elems );
 
 	// link it with vertex array object
 	pglGenVertexArrays( 1, &pOut->vao );
@@ -530,7 +628,7 @@ void R_CreateSurfaceVBO( grass_t *pOut )
 	tr.total_vbo_memory += pOut->cacheSize;
 }
 
-void R_DeleteSurfaceVBO( grass_t *pOut )
+static void R_DeleteSurfaceVBO( grass_t *pOut )
 {
 	if( pOut->vao ) pglDeleteVertexArrays( 1, &pOut->vao );
 	if( pOut->vbo ) pglDeleteBuffersARB( 1, &pOut->vbo );
@@ -539,6 +637,42 @@ void R_DeleteSurfaceVBO( grass_t *pOut )
 	pOut->cacheSize = 0;
 }
 
+/*
+================
+R_GrassReserveForEntry
+
+compute space for mesh with single texture
+================
+*/
+static void R_GrassReserveForEntry( mextrasurf_t *es, grassentry_t *entry, int *numVerts, int *numElems )
+{
+	bvert_t *v0, *v1, *v2;
+	int numSamples = 0;
+
+	v0 = &world->vertexes[es->firstvertex];
+
+	for( int i = 1; i < es->numverts - 1; i++ )
+	{
+		v1 = &world->vertexes[es->firstvertex+i+0];
+		v2 = &world->vertexes[es->firstvertex+i+1];
+
+		// must be matched with R_BuildGrassMesh
+		Vector areaVec = CrossProduct( v1->vertex - v0->vertex, v2->vertex - v0->vertex );
+		float area = 0.5f * areaVec.Length();
+		numSamples += (int)( area * entry->density * DENSITY_FACTOR );
+	}
+
+	if( numSamples <= 0 )
+	{
+		*numVerts = *numElems = 0;
+		return;
+	}
+
+	// R_GrassAdvanceVertex keeps a small gap at the end
+	*numVerts = min( numSamples * 16 + 4, MAX_GRASS_VERTS );
+	*numElems = min( numSamples * 24 + 4, MAX_GRASS_ELEMS );
+}
+
 /*
 ================
 R_BuildGrassMesh
@@ -546,18 +680,18 @@ R_BuildGrassMesh
 build mesh with single texture
 ================
 */
-bool R_BuildGrassMesh( msurface_t *surf, mextrasurf_t *es, grassentry_t *entry, grasshdr_t *hdr, grass_t *out )
+static bool R_BuildGrassMesh( grassbuild_t *build, msurface_t *surf, mextrasurf_t *es, grassentry_t *entry, grasshdr_t *hdr, grass_t *out )
 {
 	mfaceinfo_t *land = surf->texinfo->faceinfo;
 	bvert_t *v0, *v1, *v2;
 
 	// update random set to get predictable positions for grass 'random' placement
-	RANDOM_SEED(( surf - worldmodel->surfaces ) * entry->seed );
+	R_GrassRandomSeed( &build->random, ( surf - worldmodel->surfaces ) * entry->seed );
 
-	m_iNumVertex = m_iNumIndex = m_iVertexState = 0;
+	build->numVertex = build->numIndex = build->vertexState = 0;
 
-	m_iTextureWidth = RENDER_GET_PARM( PARM_TEX_WIDTH, grasstexs[entry->texture].gl_texturenum );
-	m_iTextureHeight = RENDER_GET_PARM( PARM_TEX_HEIGHT, grasstexs[entry->texture].gl_texturenum );
+	build->textureWidth = grasstexs[entry->texture].width;
+	build->textureHeight = grasstexs[entry->texture].height;
 
 	// turn the face into a bunch of polygons, and compute the area of each
 	v0 = &world->vertexes[es->firstvertex];
@@ -583,8 +717,8 @@ bool R_BuildGrassMesh( msurface_t *surf, mextrasurf_t *es, grassentry_t *entry,
 		for( int j = 0; j < numSamples; j++ )
 		{
 			// Create a random sample...
-			float u = RANDOM_FLOAT( 0.0f, 1.0f );
-			float v = RANDOM_FLOAT( 0.0f, 1.0f );
+			float u = R_GrassRandomFloat( &build->random, 0.0f, 1.0f );
+			float v = R_GrassRandomFloat( &build->random, 0.0f, 1.0f );
 
 			if( v > ( 1.0f - u ))
 			{
@@ -592,28 +726,27 @@ bool R_BuildGrassMesh( msurface_t *surf, mextrasurf_t *es, grassentry_t *entry,
 				v = 1.0f - v;
 			}
 
-			float size = RANDOM_FLOAT( entry->min, entry->max );
+			float size = R_GrassRandomFloat( &build->random, entry->min, entry->max );
 
 			Vector pos = v0->vertex + e1 * u + e2 * v;
 
 			if( !Mod_CheckLayerNameForPixel( land, pos, entry->name ))
 				continue;	// rejected by heightmap
 
-			if( !R_CreateSingleBush( surf, es, hdr, pos, size ))
+			if( !R_CreateSingleBush( build, surf, es, hdr, pos, size ))
 				goto build_mesh; // vertices is out (more than 2048 bushes per surface created)
 		}
 	}
 
 	// nothing to added?
-	if( !m_iNumVertex ) return false;
+	if( !build->numVertex ) return false;
 
 build_mesh:
 	// give lightnums from surface
 	memcpy( out->lights, es->lights, sizeof( byte ) * MAXDYNLIGHTS );
 	out->texture = entry->texture;
-	out->numVerts = m_iNumVertex;
-	out->numElems = m_iNumIndex;
-	R_CreateSurfaceVBO( out );
+	out->numVerts = build->numVertex;
+	out->numElems = build->numIndex;
 
 	return true;
 }
@@ -623,47 +756,197 @@ build_mesh:
 R_ConstructGrassForSurface
 
 compile all the grassdata with
-specified texture into single VBO
+specified texture into staging arrays
+NOTE: called from job threads
 ================
 */
-void R_ConstructGrassForSurface( msurface_t *surf, mextrasurf_t *es )
+static void R_ConstructGrassForSurface( grasshdr_t *hdr )
 {
-	// already init or not specified?
-	if( es->grass || !es->grasscount )
-		return;
-
-	size_t grasshdr_size = sizeof( grasshdr_t ) + sizeof( grass_t ) * ( es->grasscount - 1 );
-	grasshdr_t *hdr = es->grass = (grasshdr_t *)IEngineStudio.Mem_Calloc( 1, grasshdr_size );
-	hdr->mins = es->mins;
-	hdr->maxs = es->maxs;
-	hdr->count = 0;
+	msurface_t *surf = hdr->surf;
+	mextrasurf_t *es = surf->info;
+	gvert_t *verts = hdr->verts;
+	word *elems = hdr->elems;
+	grassbuild_t build;
 
-	for( int i = 0; i < grassInfo.Count(); i++ )
+	for( int i = 0; i < grassInfo.Count() && hdr->count < es->grasscount; i++ )
 	{
 		grassentry_t *entry = &grassInfo[i];
 
 		if( !Mod_CheckLayerNameForSurf( surf, entry->name ))
 			continue;
 
+		R_GrassReserveForEntry( es, entry, &build.maxVertex, &build.maxIndex );
+		if( !build.maxVertex ) continue;
+
+		build.verts = verts;
+		build.elems = elems;
+
 		// create a single mesh for all the bushes that have same texture
-		if( !R_BuildGrassMesh( surf, es, entry, hdr, &hdr->g[hdr->count] ))
+		if( !R_BuildGrassMesh( &build, surf, es, entry, hdr, &hdr->g[hdr->count] ))
 			continue;	// failed to build for some reasons
 
+		verts += build.numVertex;
+		elems += build.numIndex;
 		hdr->count++;
 	}
+}
+
+static void R_GrassBuildJob( void *context, int current, int threadnum )
+{
+	grasshdr_t **list = (grasshdr_t **)context;
 
+	R_ConstructGrassForSurface( list[current] );
+}
+
+/*
+================
+R_QueueGrassForSurface
+
+reserve staging space and put the
+surface into pending list
+================
+*/
+static void R_QueueGrassForSurface( msurface_t *surf, bool priority )
+{
+	mextrasurf_t *es = surf->info;
+	int numVerts = 0, numElems = 0;
+	grasshdr_t *hdr;
+
+	if( es->grass )
+	{
+		// become visible while waiting
+		if( priority && es->grass->state != GRASS_READY )
+			SetBits( es->grass->flags, FGRASSHDR_PRIORITY );
+		return;
+	}
+
+	if( !es->grasscount || m_iNumGrassPending >= MAX_GRASS_PENDING )
+		return; // not specified or try again next frame
+
+	for( int i = 0; i < grassInfo.Count(); i++ )
+	{
+		grassentry_t *entry = &grassInfo[i];
+		int verts, elems;
+
+		if( !Mod_CheckLayerNameForSurf( surf, entry->name ))
+			continue;
+
+		R_GrassReserveForEntry( es, entry, &verts, &elems );
+		numVerts += verts;
+		numElems += elems;
+	}
+
+	if( !numVerts )
+	{
+		// nothing to build
+		ClearBits( surf->flags, SURF_GRASS_UPDATE );
+		es->grasscount = 0;
+		return;
+	}
+
+	size_t grasshdr_size = sizeof( grasshdr_t ) + sizeof( grass_t ) * ( es->grasscount - 1 );
+	hdr = es->grass = (grasshdr_t *)IEngineStudio.Mem_Calloc( 1, grasshdr_size );
+	hdr->verts = (gvert_t *)Mem_Alloc( sizeof( gvert_t ) * numVerts + sizeof( word ) * numElems );
+	hdr->elems = (word *)( hdr->verts + numVerts );
+	hdr->surf = surf;
+	hdr->mins = es->mins;
+	hdr->maxs = es->maxs;
+	hdr->state = GRASS_QUEUED;
+	if( priority ) SetBits( hdr->flags, FGRASSHDR_PRIORITY );
+
+	m_pGrassPending[m_iNumGrassPending++] = hdr;
 	ClearBits( surf->flags, SURF_GRASS_UPDATE );
+}
+
+static void R_GrassRemovePending( grasshdr_t *hdr )
+{
+	for( int i = 0; i < m_iNumGrassPending; i++ )
+	{
+		if( m_pGrassPending[i] != hdr )
+			continue;
+
+		// keep the order
+		memmove( &m_pGrassPending[i], &m_pGrassPending[i+1], ( m_iNumGrassPending - i - 1 ) * sizeof( grasshdr_t* ));
+		m_iNumGrassPending--;
+		return;
+	}
+}
+
+static void R_GrassUnlink( grasshdr_t *hdr )
+{
+	if( hdr->prev ) hdr->prev->next = hdr->next;
+	else m_pGrassHead = hdr->next;
+	if( hdr->next ) hdr->next->prev = hdr->prev;
+	else m_pGrassTail = hdr->prev;
+	hdr->prev = hdr->next = NULL;
+}
+
+static void R_GrassLinkHead( grasshdr_t *hdr )
+{
+	hdr->prev = NULL;
+	hdr->next = m_pGrassHead;
+	if( m_pGrassHead ) m_pGrassHead->prev = hdr;
+	else m_pGrassTail = hdr;
+	m_pGrassHead = hdr;
+}
+
+/*
+================
+R_GrassTouch
+
+move grass to the head of LRU list
+================
+*/
+static void R_GrassTouch( grasshdr_t *hdr )
+{
+	hdr->lastframe = tr.realframecount;
+
+	if( m_pGrassHead == hdr )
+		return;
+
+	R_GrassUnlink( hdr );
+	R_GrassLinkHead( hdr );
+}
+
+/*
+================
+R_UploadGrassForSurface
+
+move staging arrays to video memory
+returns false if nothing was uploaded
+================
+*/
+static bool R_UploadGrassForSurface( grasshdr_t *hdr )
+{
+	mextrasurf_t *es = hdr->surf->info;
+	gvert_t *verts = hdr->verts;
+	word *elems = hdr->elems;
+
+	for( int i = 0; i < hdr->count; i++ )
+	{
+		R_CreateSurfaceVBO( &hdr->g[i], verts, elems );
+		verts += hdr->g[i].numVerts;
+		elems += hdr->g[i].numElems;
+	}
+
+	Mem_Free( hdr->verts );
+	hdr->verts = NULL;
+	hdr->elems = NULL;
 
 	// bah! failed to create
 	if( !hdr->count )
 	{
-		Mem_Free( es->grass );
+		Mem_Free( hdr );
 		es->grasscount = 0;
 		es->grass = NULL;
+		return false;
 	}
 
-	// restore normal randomization
-	RANDOM_SEED( 0 );
+	hdr->state = GRASS_READY;
+	hdr->lastframe = tr.realframecount;
+	R_GrassLinkHead( hdr );
+
+	return true;
 }
 
 void R_RemoveGrassForSurface( mextrasurf_t *es )
@@ -675,8 +958,16 @@ void R_RemoveGrassForSurface( mextrasurf_t *es )
 
 	grasshdr_t *hdr = es->grass;
 
-	for( int i = 0; i < hdr->count; i++ )
-		R_DeleteSurfaceVBO( &hdr->g[i] );
+	if( hdr->state == GRASS_READY )
+	{
+		for( int i = 0; i < hdr->count; i++ )
+			R_DeleteSurfaceVBO( &hdr->g[i] );
+		R_GrassUnlink( hdr );
+	}
+	else R_GrassRemovePending( hdr );
+
+	if( hdr->verts )
+		Mem_Free( hdr->verts );
 
 	es->grass = NULL;
 	Mem_Free( hdr );
@@ -1134,6 +1425,9 @@ byte R_GrassTextureForName( const char *name )
 		grasstexs[i].gl_texturenum = tr.defaultTexture;
 	}
 
+	grasstexs[i].width = RENDER_GET_PARM( PARM_TEX_WIDTH, grasstexs[i].gl_texturenum );
+	grasstexs[i].height = RENDER_GET_PARM( PARM_TEX_HEIGHT, grasstexs[i].gl_texturenum );
+
 	return i;
 }
 
@@ -1493,7 +1787,18 @@ void R_PrecacheGrass( msurface_t *s, mextraleaf_t *leaf )
 		}
 		else
 		{
-			// already created?
+			if( hdr->state != GRASS_READY )
+			{
+				// still in progress, but it's visible now
+				SetBits( hdr->flags, FGRASSHDR_PRIORITY );
+			}
+			else if( leaf && !FBitSet( hdr->flags, FGRASSHDR_BOUNDS ))
+			{
+				// prevent to expand leafs too much
+				AddPointToBounds( hdr->mins, leaf->mins, leaf->maxs, LEAF_MAX_EXPAND );
+				AddPointToBounds( hdr->maxs, leaf->mins, leaf->maxs, LEAF_MAX_EXPAND );
+				SetBits( hdr->flags, FGRASSHDR_BOUNDS );
+			}
 			return;
 		}
 	}
@@ -1504,16 +1809,8 @@ void R_PrecacheGrass( msurface_t *s, mextraleaf_t *leaf )
 	if( curdist > m_flGrassFadeEnd && ( e->curstate.renderfx != SKYBOX_ENTITY ))
 		return; // too far
 
-	// initialize grass for surface
-	R_ConstructGrassForSurface( s, es );
-	hdr = es->grass; // refresh the pointer
-
-	if( hdr && leaf )
-	{
-		// prevent to expand leafs too much
-		AddPointToBounds( hdr->mins, leaf->mins, leaf->maxs, LEAF_MAX_EXPAND );
-		AddPointToBounds( hdr->maxs, leaf->mins, leaf->maxs, LEAF_MAX_EXPAND );
-	}
+	// job threads will build it at end of the frame
+	R_QueueGrassForSurface( s, true );
 }
 
 /*
@@ -1554,10 +1851,13 @@ void R_AddGrassToDrawList( msurface_t *s, drawlist_t drawlist_type )
 		R_RemoveGrassForSurface( es );
 
 	if( !es->grass && RP_NORMALPASS( ))
-		R_ConstructGrassForSurface( s, es );
+		R_QueueGrassForSurface( s, true );
 
 	grasshdr_t *hdr = es->grass;
-	if( !hdr ) return; // face completely missed grass or creation was failed
+	if( !hdr || hdr->state != GRASS_READY )
+		return; // face completely missed grass or it's not built yet
+
+	R_GrassTouch( hdr );
 
 	gl_state_t *glm = GL_GetCache( e->hCachedMatrix );
 
@@ -1634,6 +1934,157 @@ void R_AddGrassToDrawList( msurface_t *s, drawlist_t drawlist_type )
 	}
 }
 
+/*
+================
+R_GrassPrefetch
+
+predict view position and queue the
+grass ahead of the camera
+================
+*/
+static void R_GrassPrefetch( void )
+{
+	Vector delta = tr.cached_vieworigin - m_vecGrassLastOrigin;
+	m_vecGrassLastOrigin = tr.cached_vieworigin;
+
+	if( tr.frametime > 0.0 )
+	{
+		if( delta.Length() > GRASS_TELEPORT_DIST )
+			m_vecGrassVelocity = g_vecZero; // teleported
+		else m_vecGrassVelocity = ( m_vecGrassVelocity + delta * ( 1.0f / tr.frametime )) * 0.5f;
+	}
+
+	if( !CVAR_TO_BOOL( r_grass ) || !m_iNumGrassSurfaces )
+		return;
+
+	Vector predicted = tr.cached_vieworigin + m_vecGrassVelocity * GRASS_PREDICT_TIME;
+	int count = min( GRASS_RING_STEP, m_iNumGrassSurfaces );
+
+	// check a part of surfaces each frame
+	for( int i = 0; i < count && m_iNumGrassPending < MAX_GRASS_PENDING; i++ )
+	{
+		msurface_t *surf = m_pGrassSurfaces[m_iGrassRingPos];
+		mextrasurf_t *es = surf->info;
+
+		m_iGrassRingPos = ( m_iGrassRingPos + 1 ) % m_iNumGrassSurfaces;
+
+		if( es->grass || !es->grasscount )
+			continue; // already queued or failed
+
+		if( VectorDistance( predicted, es->origin ) > m_flGrassFadeEnd )
+			continue;
+
+		R_QueueGrassForSurface( surf, false );
+	}
+}
+
+/*
+================
+R_GrassBuildPending
+
+build queued surfaces on job threads
+================
+*/
+static void R_GrassBuildPending( void )
+{
+	int numStaged = 0, numBuilds = 0;
+	grasshdr_t *hdr;
+	int i, pass;
+
+	for( i = 0; i < m_iNumGrassPending; i++ )
+	{
+		if( m_pGrassPending[i]->state == GRASS_STAGED )
+			numStaged++;
+	}
+
+	int maxBuilds = min( GRASS_BUILDS_PER_FRAME, GRASS_MAX_STAGED - numStaged );
+
+	// visible surfaces goes first
+	for( pass = 0; pass < 2; pass++ )
+	{
+		for( i = 0; i < m_iNumGrassPending && numBuilds < maxBuilds; i++ )
+		{
+			hdr = m_pGrassPending[i];
+
+			if( hdr->state != GRASS_QUEUED )
+				continue;
+
+			if( !pass && !FBitSet( hdr->flags, FGRASSHDR_PRIORITY ))
+				continue;
+
+			hdr->state = GRASS_BUILDING;
+			m_pGrassBuild[numBuilds++] = hdr;
+		}
+	}
+
+	if( numBuilds <= 0 ) return;
+
+	// job threads can't call the engine
+	for( i = 0; i < 256; i++ )
+		m_grassGamma[i] = TEXTURE_TO_TEXGAMMA( i );
+
+	JOB_RunOnIndividual( numBuilds, m_pGrassBuild, R_GrassBuildJob );
+
+	for( i = 0; i < numBuilds; i++ )
+		m_pGrassBuild[i]->state = GRASS_STAGED;
+}
+
+/*
+================
+R_GrassUploadPending
+
+upload built meshes with per-frame budget
+================
+*/
+static void R_GrassUploadPending( void )
+{
+	int numUploads = 0;
+	grasshdr_t *hdr;
+
+	// visible surfaces goes first
+	for( int pass = 0; pass < 2; pass++ )
+	{
+		int numPending = 0;
+
+		for( int i = 0; i < m_iNumGrassPending; i++ )
+		{
+			hdr = m_pGrassPending[i];
+
+			if( hdr->state == GRASS_STAGED && ( pass || FBitSet( hdr->flags, FGRASSHDR_PRIORITY )))
+			{
+				// empty meshes are released for free
+				if( !hdr->count || numUploads < GRASS_UPLOADS_PER_FRAME )
+				{
+					if( R_UploadGrassForSurface( hdr ))
+						numUploads++;
+					continue;
+				}
+			}
+
+			m_pGrassPending[numPending++] = hdr;
+		}
+
+		m_iNumGrassPending = numPending;
+	}
+}
+
+/*
+================
+R_GrassUpdateFrame
+
+prefetch, build and upload the grass
+================
+*/
+void R_GrassUpdateFrame( void )
+{
+	if( !FBitSet( world->features, WORLD_HAS_GRASS ))
+		return; // don't waste time
+
+	R_GrassPrefetch();
+	R_GrassBuildPending();
+	R_GrassUploadPending();
+}
+
 /*
 ================
 R_UnloadFarGrass
@@ -1643,29 +2094,87 @@ release far VBO's
 */
 void R_UnloadFarGrass( void )
 {
+	grasshdr_t *hdr, *prev;
+
 	if( !FBitSet( world->features, WORLD_HAS_GRASS ))
 		return; // don't waste time
 
-	if( ++tr.grassunloadframe < 300 )
-		return; // run every three seconds
-
-	// check surfaces
-	for( int i = 0; i < worldmodel->numsurfaces; i++ )
+	// walk from least recently used
+	for( hdr = m_pGrassTail; hdr != NULL; hdr = prev )
 	{
-		msurface_t *surf = &worldmodel->surfaces[i];
-		mextrasurf_t *es = surf->info;
+		prev = hdr->prev;
 
-		if( !es->grasscount ) continue; // surface doesn't contain grass
+		if(( tr.realframecount - hdr->lastframe ) < GRASS_UNLOAD_FRAMES )
+			break; // all the rest was used recently
+
+		mextrasurf_t *es = hdr->surf->info;
 		float curdist = VectorDistance( tr.cached_vieworigin, es->origin );
 
-		if( curdist > m_flGrassFadeEnd )
-		{
-			if( curdist > ( m_flGrassFadeEnd * 2.0f ) && es->grass )
-				R_RemoveGrassForSurface( es );
-		}
+		if( curdist > ( m_flGrassFadeEnd * 2.0f ))
+			R_RemoveGrassForSurface( es );
+		else R_GrassTouch( hdr ); // still close, check again later
+	}
+}
+
+/*
+================
+R_GrassSetupWorld
+
+collect the surfaces for prefetch ring
+================
+*/
+void R_GrassSetupWorld( void )
+{
+	LOAD_ZONE( "R_GrassSetupWorld" );
+	int i, count = 0;
+
+	m_iNumGrassSurfaces = m_iGrassRingPos = 0;
+	m_vecGrassLastOrigin = m_vecGrassVelocity = g_vecZero;
+
+	if( !FBitSet( world->features, WORLD_HAS_GRASS ))
+		return;
+
+	// brushmodels are not included, their origins is local
+	for( i = 0; i < worldmodel->nummodelsurfaces; i++ )
+	{
+		if( worldmodel->surfaces[worldmodel->firstmodelsurface + i].info->grasscount )
+			count++;
+	}
+
+	if( !count ) return;
+
+	m_pGrassSurfaces = (msurface_t **)Mem_Alloc( sizeof( msurface_t* ) * count );
+
+	for( i = 0; i < worldmodel->nummodelsurfaces; i++ )
+	{
+		msurface_t *surf = &worldmodel->surfaces[worldmodel->firstmodelsurface + i];
+
+		if( surf->info->grasscount )
+			m_pGrassSurfaces[m_iNumGrassSurfaces++] = surf;
+	}
+}
+
+/*
+================
+R_GrassFreeWorld
+
+throw grass vbo's and pending meshes
+================
+*/
+void R_GrassFreeWorld( void )
+{
+	if( FBitSet( world->features, WORLD_HAS_GRASS ))
+	{
+		for( int i = 0; i < worldmodel->numsurfaces; i++ )
+			R_RemoveGrassForSurface( worldmodel->surfaces[i].info );
 	}
 
-	tr.grassunloadframe = 0;
+	if( m_pGrassSurfaces )
+		Mem_Free( m_pGrassSurfaces );
+	m_pGrassSurfaces = NULL;
+	m_iNumGrassSurfaces = m_iGrassRingPos = 0;
+	m_iNumGrassPending = 0;
+	m_pGrassHead = m_pGrassTail = NULL;
 }
 
 /*
@@ -1677,9 +2186,10 @@ parse grass definitions and load textures
 */
 void R_GrassInit( void )
 {
+	LOAD_ZONE( "R_GrassInit" );
 	static int random_seed = 1; // starts from 1
 
-	char *afile = (char *)gEngfuncs.COM_LoadFile( "gfx/grass/grassinfo.txt", 5, NULL );
+	char *afile = (char *)LOAD_FILE( "gfx/grass/grassinfo.txt", NULL );
 	if( !afile ) ALERT( at_error, "couldn't load grassinfo.txt\n" );
 
 	// remove grass description from the pervious map
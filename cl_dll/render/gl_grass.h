@@ -23,6 +23,14 @@ GNU General Public License for more details.
 #define MAX_GRASS_VERTS	( MAX_GRASS_ELEMS / 2 )	// ( numelems / 1.5 ) actually
 #define MAX_GRASS_BUSHES	( MAX_GRASS_VERTS / 16 )	// one bush contain 4 poly, so we have 2048 bushes max per one surface
 #define GRASS_SKY_DIST	BOGUS_RANGE		// in-world grass never reach this value
+#define MAX_GRASS_PENDING	1024			// surfaces waiting for build or upload
+#define GRASS_BUILDS_PER_FRAME	32			// surfaces that built by job threads per frame
+#define GRASS_UPLOADS_PER_FRAME	8			// surfaces that uploaded into video memory per frame
+#define GRASS_MAX_STAGED	64			// don't build too much ahead of upload
+#define GRASS_RING_STEP	256			// surfaces checked by prefetch ring per frame
+#define GRASS_PREDICT_TIME	0.5f			// how far ahead of the camera we build grass (in seconds)
+#define GRASS_TELEPORT_DIST	512.0f			// reset prediction when view moved too far
+#define GRASS_UNLOAD_FRAMES	300			// unused grass is candidate for unload after this
 
 typedef struct grassentry_s
 {
@@ -38,6 +46,8 @@ typedef struct grasstexture_s
 {
 	char	name[256];	// path to grass texture
 	int	gl_texturenum;	// gl-texture
+	int	width;		// cached here because job threads can't ask engine
+	int	height;
 } grasstexture_t;
 
 typedef struct gvert_s
@@ -94,8 +104,25 @@ typedef struct
 	const char*		BufferName;	// debug
 } grass_loader_t;
 
+// grasshdr_t->state
+#define GRASS_QUEUED	0		// waiting for job threads
+#define GRASS_BUILDING	1		// selected for build this frame
+#define GRASS_STAGED	2		// vertices is built, waiting for upload
+#define GRASS_READY		3		// uploaded and can be drawn
+
+// grasshdr_t->flags
+#define FGRASSHDR_PRIORITY	BIT( 0 )		// requested by visible surface, build it first
+#define FGRASSHDR_BOUNDS	BIT( 1 )		// leaf bounds already expanded
+
 typedef struct grasshdr_s
 {
+	msurface_t	*surf;		// owner surface
+	struct grasshdr_s	*prev, *next;	// LRU list of uploaded meshes
+	int		lastframe;	// last frame when grass was in use
+	byte		state;
+	byte		flags;
+	gvert_t		*verts;		// staging vertices for all the meshes (freed after upload)
+	word		*elems;		// staging indices for all the meshes
 	Vector		mins, maxs;	// per-poly culling
 	int		count;		// total bush count for this poly
 	grass_t		g[1];		// variable sized
@@ -112,5 +139,8 @@ extern void R_AddGrassToDrawList( msurface_t *s, drawlist_t type );
 extern void R_PrecacheGrass( msurface_t *s, mextraleaf_t *leaf );
 extern void R_RemoveGrassForSurface( mextrasurf_t *es );
 extern void R_UnloadFarGrass( void );
+extern void R_GrassUpdateFrame( void );
+extern void R_GrassSetupWorld( void );
+extern void R_GrassFreeWorld( void );
 
 #endif//GL_GRASS_H
\ No newline at end of file
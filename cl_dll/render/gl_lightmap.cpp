@@ -27,47 +27,207 @@ GNU General Public License for more details.
 /*
 =============================================================================
 
-  LIGHTMAP ALLOCATION
+  SKYLINE ATLAS
 
 =============================================================================
 */
-static int LM_AllocBlock( unsigned short w, unsigned short h, unsigned short *x, unsigned short *y )
+/*
+=================
+R_InitAtlas
+
+empty skyline: one segment at the bottom of the page
+=================
+*/
+void R_InitAtlas( atlas_t *atlas, int width, int height )
+{
+	atlas->numnodes = 1;
+	atlas->nodes[0].x = 0;
+	atlas->nodes[0].y = 0;
+	atlas->nodes[0].width = width;
+	atlas->width = width;
+	atlas->height = height;
+	atlas->usedpixels = 0;
+}
+
+/*
+=================
+R_AtlasFitBlock
+
+returns top of the skyline under the block
+that starts at given node or -1 if doesn't fit
+=================
+*/
+static int R_AtlasFitBlock( const atlas_t *atlas, int index, int w, int h )
+{
+	int	widthleft = w;
+	int	i = index;
+	int	y;
+
+	if( atlas->nodes[index].x + w > atlas->width )
+		return -1;
+
+	y = atlas->nodes[index].y;
+
+	while( widthleft > 0 )
+	{
+		if( i >= atlas->numnodes )
+			return -1;
+
+		y = Q_max( y, (int)atlas->nodes[i].y );
+		if( y + h > atlas->height )
+			return -1;
+
+		widthleft -= atlas->nodes[i].width;
+		i++;
+	}
+
+	return y;
+}
+
+/*
+=================
+R_AllocAtlasBlock
+
+skyline bottom-left packer: choose the lowest
+top edge, ties are going to the narrowest segment
+=================
+*/
+bool R_AllocAtlasBlock( atlas_t *atlas, int w, int h, unsigned short *x, unsigned short *y )
 {
-	gl_lightmap_t	*lms = &tr.lightmaps[tr.current_lightmap_texture];
-	unsigned short	i, j, best, best2;
+	int	bestindex = -1;
+	int	besttop = atlas->height + 1;
+	int	bestwidth = atlas->width + 1;
+	int	i, top, shrink;
+	atlasnode_t	*node, *prev;
 
-	best = BLOCK_SIZE;
+	if( w <= 0 || h <= 0 || w > atlas->width || h > atlas->height )
+		return false;
+
+	// inserted segment may add one node
+	if( atlas->numnodes >= MAX_ATLAS_NODES )
+		return false;
 
-	for( i = 0; i < BLOCK_SIZE - w; i++ )
+	for( i = 0; i < atlas->numnodes; i++ )
 	{
-		best2 = 0;
+		top = R_AtlasFitBlock( atlas, i, w, h );
+		if( top < 0 ) continue;
 
-		for( j = 0; j < w; j++ )
+		if( top + h < besttop || ( top + h == besttop && atlas->nodes[i].width < bestwidth ))
 		{
-			if( lms->allocated[i+j] >= best )
-				break;
-			if( lms->allocated[i+j] > best2 )
-				best2 = lms->allocated[i+j];
+			bestwidth = atlas->nodes[i].width;
+			besttop = top + h;
+			bestindex = i;
 		}
+	}
+
+	if( bestindex == -1 )
+		return false; // atlas is full
+
+	*x = atlas->nodes[bestindex].x;
+	*y = besttop - h;
+
+	// insert new segment over the block
+	memmove( &atlas->nodes[bestindex+1], &atlas->nodes[bestindex], ( atlas->numnodes - bestindex ) * sizeof( atlasnode_t ));
+	node = &atlas->nodes[bestindex];
+	node->x = *x;
+	node->y = besttop;
+	node->width = w;
+	atlas->numnodes++;
+
+	// cut off segments that hidden by the new one
+	for( i = bestindex + 1; i < atlas->numnodes; i++ )
+	{
+		node = &atlas->nodes[i];
+		prev = &atlas->nodes[i-1];
 
-		if( j == w )
-		{	
-			// this is a valid spot
-			*x = i;
-			*y = best = best2;
+		if( node->x >= prev->x + prev->width )
+			break;
+
+		shrink = prev->x + prev->width - node->x;
+
+		if( node->width <= shrink )
+		{
+			memmove( node, node + 1, ( atlas->numnodes - i - 1 ) * sizeof( atlasnode_t ));
+			atlas->numnodes--;
+			i--;
+			continue;
 		}
+
+		node->x += shrink;
+		node->width -= shrink;
+		break;
+	}
+
+	// merge neighbours at the same height
+	for( i = 0; i < atlas->numnodes - 1; i++ )
+	{
+		node = &atlas->nodes[i];
+
+		if( node->y != atlas->nodes[i+1].y )
+			continue;
+
+		node->width += atlas->nodes[i+1].width;
+		memmove( &atlas->nodes[i+1], &atlas->nodes[i+2], ( atlas->numnodes - i - 2 ) * sizeof( atlasnode_t ));
+		atlas->numnodes--;
+		i--;
+	}
+
+	atlas->usedpixels += w * h;
+
+	return true;
+}
+
+/*
+=============================================================================
+
+  LIGHTMAP ALLOCATION
+
+=============================================================================
+*/
+static atlas_t	lm_backup;
+
+/*
+=================
+LM_AllocBlocks
+
+alloc blocks for all the styles on a given page.
+page is unchanged if any of them doesn't fit
+=================
+*/
+static bool LM_AllocBlocks( int page, int numstyles, word w, word h, word *light_s, word *light_t )
+{
+	atlas_t	*atlas = &tr.lightmaps[page].atlas;
+	int	map;
+
+	if( page > tr.current_lightmap_texture || tr.lightmaps[page].state == LM_DONE )
+		return false;
+
+	// single block doesn't need the rollback
+	if( numstyles > 1 )
+	{
+		lm_backup.numnodes = atlas->numnodes;
+		lm_backup.usedpixels = atlas->usedpixels;
+		memcpy( lm_backup.nodes, atlas->nodes, atlas->numnodes * sizeof( atlasnode_t ));
+	}
+
+	for( map = 0; map < numstyles; map++ )
+	{
+		if( !R_AllocAtlasBlock( atlas, w, h, &light_s[map], &light_t[map] ))
+			break;
 	}
 
-	if( best + h > BLOCK_SIZE )
+	if( map != numstyles )
 	{
-		// current lightmap is full
-		lms->state = LM_DONE;
+		if( map > 0 )
+		{
+			atlas->numnodes = lm_backup.numnodes;
+			atlas->usedpixels = lm_backup.usedpixels;
+			memcpy( atlas->nodes, lm_backup.nodes, lm_backup.numnodes * sizeof( atlasnode_t ));
+		}
 		return false;
-          }
+	}
 
-	for( i = 0; i < w; i++ )
-		lms->allocated[*x + i] = best + h;
-	lms->state = LM_USED; // lightmap in use
+	tr.lightmaps[page].state = LM_USED; // lightmap in use
 
 	return true;
 }
@@ -76,10 +236,11 @@ static void LM_InitBlock( void )
 {
 	word	dummy;
 	gl_lightmap_t *lms = &tr.lightmaps[tr.current_lightmap_texture];
-	memset( lms->allocated, 0, sizeof( lms->allocated ));
+
+	R_InitAtlas( &lms->atlas, BLOCK_SIZE, BLOCK_SIZE );
 
 	// first block at pos 0,0 used as black lightmap for studiomodel
-	LM_AllocBlock( 1, 1, &dummy, &dummy );
+	LM_AllocBlocks( tr.current_lightmap_texture, 1, 1, 1, &dummy, &dummy );
 }
 
 static void LM_UploadPages( bool lightmap, bool deluxmap )
@@ -126,12 +287,20 @@ static void LM_UploadPages( bool lightmap, bool deluxmap )
 
 static void LM_GoToNextPage( void )
 {
-	gl_lightmap_t *lms = &tr.lightmaps[tr.current_lightmap_texture];
+	if( tr.current_lightmap_texture + 1 >= MAX_LIGHTMAPS )
+		HOST_ERROR( "MAX_LIGHTMAPS limit exceded\n" );
 
-	if( lms->state != LM_DONE ) return; // current atlas not completed
+	tr.current_lightmap_texture++;
+	LM_InitBlock();
+}
 
-	if( ++tr.current_lightmap_texture == MAX_LIGHTMAPS )
-		HOST_ERROR( "MAX_LIGHTMAPS limit exceded\n" );
+static int LM_NumStyles( const byte *styles )
+{
+	int	map;
+
+	for( map = 0; map < MAXLIGHTMAPS && styles[map] != LS_NONE; map++ );
+
+	return map;
 }
 
 /*
@@ -168,7 +337,7 @@ void GL_AllocLightmapForFace( msurface_t *surf )
 {
 	mextrasurf_t	*esrf = surf->info;
 	word		smax, tmax;
-	int		map;
+	int		numstyles, page;
 
 	// always reject the tiled faces
 	if( FBitSet( surf->flags, SURF_DRAWSKY ))
@@ -181,24 +350,124 @@ void GL_AllocLightmapForFace( msurface_t *surf )
 	int sample_size = Mod_SampleSizeForFace( surf );
 	smax = ( surf->info->lightextents[0] / sample_size ) + 1;
 	tmax = ( surf->info->lightextents[1] / sample_size ) + 1;
-new_page:
-	// alloc blocks for all the styles on current page
-	for( map = 0; map < MAXLIGHTMAPS && surf->styles[map] != LS_NONE; map++ )
+	numstyles = LM_NumStyles( surf->styles );
+
+	// first fit: older pages may still have the holes
+	for( page = 0; page <= tr.current_lightmap_texture; page++ )
+	{
+		if( LM_AllocBlocks( page, numstyles, smax, tmax, esrf->light_s, esrf->light_t ))
+			break;
+	}
+
+	if( page > tr.current_lightmap_texture )
 	{
-		if( !LM_AllocBlock( smax, tmax, &esrf->light_s[map], &esrf->light_t[map] ))
+		// no room for next 1-4 blocks on any page
+		LM_GoToNextPage();
+		page = tr.current_lightmap_texture;
+
+		if( !LM_AllocBlocks( page, numstyles, smax, tmax, esrf->light_s, esrf->light_t ))
 		{
-			// current page is not enough room for next 1-4 blocks
-			LM_GoToNextPage();
-			LM_InitBlock();
-			goto new_page;
+			ALERT( at_error, "GL_AllocLightmapForFace: face %i is too large (%i x %i x %i)\n", (int)( surf - worldmodel->surfaces ), smax, tmax, numstyles );
+			return;
 		}
 	}
 
 	// lightmap will be uploaded as far as player can see it
-	esrf->lightmaptexturenum = tr.current_lightmap_texture;
+	esrf->lightmaptexturenum = page;
 	SetBits( surf->flags, SURF_LM_UPDATE|SURF_DM_UPDATE );
 }
 
+typedef struct
+{
+	word	face;
+	word	smax, tmax;
+	int	order;	// position in texture-sorted list
+} lmface_t;
+
+static int LM_FaceCompare( const void *a, const void *b )
+{
+	const lmface_t	*fa = (const lmface_t *)a;
+	const lmface_t	*fb = (const lmface_t *)b;
+
+	// tallest blocks first, then widest
+	if( fa->tmax != fb->tmax )
+		return fb->tmax - fa->tmax;
+	if( fa->smax != fb->smax )
+		return fb->smax - fa->smax;
+
+	// keep texture order for equal blocks
+	return fa->order - fb->order;
+}
+
+/*
+=================
+GL_AllocLightmapsForWorld
+
+alloc faces from tallest to smallest
+to keep the skyline flat and pages dense
+=================
+*/
+void GL_AllocLightmapsForWorld( void )
+{
+	lmface_t	*faces;
+	int	i, numfaces = 0;
+
+	faces = (lmface_t *)Mem_Alloc( world->numsortedfaces * sizeof( lmface_t ));
+
+	for( i = 0; i < world->numsortedfaces; i++ )
+	{
+		msurface_t *surf = &worldmodel->surfaces[world->sortedfaces[i]];
+		lmface_t *lf = &faces[numfaces];
+
+		if( FBitSet( surf->flags, SURF_DRAWSKY ))
+			continue;
+
+		if( !surf->samples && !surf->info->normals )
+			continue;
+
+		int sample_size = Mod_SampleSizeForFace( surf );
+		lf->smax = ( surf->info->lightextents[0] / sample_size ) + 1;
+		lf->tmax = ( surf->info->lightextents[1] / sample_size ) + 1;
+		lf->face = world->sortedfaces[i];
+		lf->order = i;
+		numfaces++;
+	}
+
+	qsort( faces, numfaces, sizeof( lmface_t ), LM_FaceCompare );
+
+	// allocate the lightmap coords, create lightmap textures (empty at this moment)
+	for( i = 0; i < numfaces; i++ )
+		GL_AllocLightmapForFace( &worldmodel->surfaces[faces[i].face] );
+
+	// group faces by page to rebuild the whole page at once
+	world->lightmapfaces = (unsigned short *)Mem_Alloc( Q_max( numfaces, 1 ) * sizeof( unsigned short ));
+
+	for( i = 0; i < numfaces; i++ )
+	{
+		msurface_t *surf = &worldmodel->surfaces[faces[i].face];
+
+		if( FBitSet( surf->flags, SURF_LM_UPDATE|SURF_DM_UPDATE ))
+			tr.lightmaps[surf->info->lightmaptexturenum].numfaces++;
+	}
+
+	for( i = 1; i <= tr.current_lightmap_texture; i++ )
+		tr.lightmaps[i].firstface = tr.lightmaps[i-1].firstface + tr.lightmaps[i-1].numfaces;
+
+	for( i = 0; i <= tr.current_lightmap_texture; i++ )
+		tr.lightmaps[i].numfaces = 0;
+
+	for( i = 0; i < numfaces; i++ )
+	{
+		msurface_t *surf = &worldmodel->surfaces[faces[i].face];
+		gl_lightmap_t *lms = &tr.lightmaps[surf->info->lightmaptexturenum];
+
+		if( FBitSet( surf->flags, SURF_LM_UPDATE|SURF_DM_UPDATE ))
+			world->lightmapfaces[lms->firstface + lms->numfaces++] = faces[i].face;
+	}
+
+	Mem_Free( faces );
+}
+
 /*
 =================
 Mod_AllocLightmapForFace
@@ -210,21 +479,19 @@ just create lmcoords and set lmnum
 bool GL_AllocLightmapForFace( mstudiosurface_t *surf )
 {
 	word	smax, tmax;
-	int	map;
+	int	numstyles;
 
 	smax = surf->lightextents[0] + 1;
 	tmax = surf->lightextents[1] + 1;
+	numstyles = LM_NumStyles( surf->styles );
 
-	// alloc blocks for all the styles on current page
-	for( map = 0; map < MAXLIGHTMAPS && surf->styles[map] != LS_NONE; map++ )
+	// whole mesh should be kept on a single page so we use current page only
+	if( !LM_AllocBlocks( tr.current_lightmap_texture, numstyles, smax, tmax, surf->light_s, surf->light_t ))
 	{
-		if( !LM_AllocBlock( smax, tmax, &surf->light_s[map], &surf->light_t[map] ))
-		{
-			// current page is not enough room for next 1-4 blocks
-			LM_GoToNextPage();
-			LM_InitBlock();
-			return false;
-		}
+		// current page is not enough room for next 1-4 blocks
+		tr.lightmaps[tr.current_lightmap_texture].state = LM_DONE;
+		LM_GoToNextPage();
+		return false;
 	}
 
 	// lightmap will be uploaded as far as player can see it
@@ -240,7 +507,26 @@ GL_EndBuildingLightmaps
 */
 void GL_EndBuildingLightmaps( bool lightmap, bool deluxmap )
 {
+	LOAD_ZONE( "GL_EndBuildingLightmaps" );
+	int	i, numpages = 0;
+	double	usedpixels = 0.0;
+
+	for( i = 0; i < MAX_LIGHTMAPS && tr.lightmaps[i].state != LM_FREE; i++ )
+	{
+		usedpixels += tr.lightmaps[i].atlas.usedpixels;
+		numpages++;
+	}
+
+	if( numpages > 0 )
+	{
+		double occupancy = usedpixels / ((double)numpages * BLOCK_SIZE * BLOCK_SIZE);
+		ALERT( at_aiconsole, "lightmaps: %i pages %ix%i, %.1f%% occupied\n", numpages, BLOCK_SIZE, BLOCK_SIZE, occupancy * 100.0 );
+	}
+
 	LM_UploadPages( lightmap, deluxmap );
+
+	// fill the pages at first frame
+	R_InvalidateLightmapPages(( lightmap ? LM_DIRTY_LIGHTMAP : 0 ) | ( deluxmap ? LM_DIRTY_DELUXMAP : 0 ));
 }
 
 /*
@@ -250,7 +536,7 @@ R_BuildLightMapForStyle
 write lightmap into page for a given style
 =================
 */
-static void R_BuildLightMapForStyle( msurface_t *surf, byte *dest, int style )
+static void R_BuildLightMapForStyle( msurface_t *surf, byte *dest, int style, int pitch, int firstrow, int numrows )
 {
 	mextrasurf_t	*esrf = surf->info;
 	int		stride, size;
@@ -274,14 +560,14 @@ static void R_BuildLightMapForStyle( msurface_t *surf, byte *dest, int style )
 	tmax = ( surf->info->lightextents[1] / sample_size ) + 1;
 	size = smax * tmax;
 
-	// jump to specified style
-	lm = surf->samples + size * style;
-	sm = esrf->shadows + size * style;
+	// jump to specified style and row
+	lm = surf->samples + size * style + smax * firstrow;
+	sm = esrf->shadows + size * style + smax * firstrow;
 
 	// put into texture format
-	stride = (smax * 4) - (smax << 2);
+	stride = pitch - (smax << 2);
 
-	for( t = 0; t < tmax; t++, dest += stride )
+	for( t = 0; t < numrows; t++, dest += stride )
 	{
 		for( s = 0; s < smax; s++ )
 		{
@@ -356,7 +642,7 @@ R_BuildDeluxMapForStyle
 write deluxmap into page for a given style
 =================
 */
-static void R_BuildDeluxMapForStyle( msurface_t *surf, byte *dest, int style )
+static void R_BuildDeluxMapForStyle( msurface_t *surf, byte *dest, int style, int pitch, int firstrow, int numrows )
 {
 	mextrasurf_t	*esrf = surf->info;
 	int		stride, size;
@@ -379,13 +665,13 @@ static void R_BuildDeluxMapForStyle( msurface_t *surf, byte *dest, int style )
 	tmax = ( surf->info->lightextents[1] / sample_size ) + 1;
 	size = smax * tmax;
 
-	// jump to specified style
-	dm = esrf->normals + size * style;
+	// jump to specified style and row
+	dm = esrf->normals + size * style + smax * firstrow;
 
 	// put into texture format
-	stride = (smax * 4) - (smax << 2);
+	stride = pitch - (smax << 2);
 
-	for( t = 0; t < tmax; t++, dest += stride )
+	for( t = 0; t < numrows; t++, dest += stride )
 	{
 		for( s = 0; s < smax; s++ )
 		{
@@ -475,7 +761,7 @@ static void R_UpdateLightMap( msurface_t *surf )
 		// write lightmaps into page
 		for( map = 0; map < MAXLIGHTMAPS && surf->styles[map] != LS_NONE; map++ )
 		{
-			R_BuildLightMapForStyle( surf, buf, map );
+			R_BuildLightMapForStyle( surf, buf, map, smax * 4, 0, tmax );
 			pglTexSubImage2D( GL_TEXTURE_2D, 0, esrf->light_s[map], esrf->light_t[map], smax, tmax, GL_RGBA, GL_UNSIGNED_BYTE, buf );
 		}
 	}
@@ -490,7 +776,7 @@ static void R_UpdateLightMap( msurface_t *surf )
 		// write lightmaps into page
 		for( map = 0; map < MAXLIGHTMAPS && surf->styles[map] != LS_NONE; map++ )
 		{
-			R_BuildDeluxMapForStyle( surf, buf, map );
+			R_BuildDeluxMapForStyle( surf, buf, map, smax * 4, 0, tmax );
 			pglTexSubImage2D( GL_TEXTURE_2D, 0, esrf->light_s[map], esrf->light_t[map], smax, tmax, GL_RGBA, GL_UNSIGNED_BYTE, buf );
 		}
 	}
@@ -545,6 +831,132 @@ static void R_UpdateLightMap( mstudiosurface_t *surf )
 	ClearBits( surf->flags, SURF_DM_UPDATE );
 }
 
+/*
+=================
+R_InvalidateLightmapPages
+
+world faces will be rebuilt by whole pages
+=================
+*/
+void R_InvalidateLightmapPages( int flags )
+{
+	for( int i = 0; i < MAX_LIGHTMAPS && tr.lightmaps[i].state != LM_FREE; i++ )
+		SetBits( tr.lightmaps[i].dirty, flags );
+}
+
+/*
+=================
+LM_RebuildPage
+
+write all the world faces of the page into the staging
+buffer and upload it by bands of LM_BAND_ROWS
+=================
+*/
+static void LM_RebuildPage( gl_lightmap_t *lms, bool deluxmap )
+{
+	static byte	*staging = NULL;
+	static int	stagingsize = 0;
+	int		i, j, map, height;
+	int		pitch = BLOCK_SIZE * 4;
+	int		y0, y1, t0, t1;
+
+	if( stagingsize < pitch * LM_BAND_ROWS )
+	{
+		if( staging ) Mem_Free( staging );
+		stagingsize = pitch * LM_BAND_ROWS;
+		staging = (byte *)Mem_Alloc( stagingsize );
+	}
+
+	// skip the unused rows at the top of the page
+	for( i = height = 0; i < lms->atlas.numnodes; i++ )
+		height = Q_max( height, (int)lms->atlas.nodes[i].y );
+
+	GL_BindTexture( GL_TEXTURE0, deluxmap ? lms->deluxmap : lms->lightmap );
+
+	for( y0 = 0; y0 < height; y0 += LM_BAND_ROWS )
+	{
+		y1 = Q_min( y0 + LM_BAND_ROWS, height );
+		memset( staging, 0, pitch * ( y1 - y0 ));
+
+		// restore dummy pixel for studiomodels
+		if( y0 == 0 && deluxmap )
+		{
+			staging[0] = staging[1] = 127;
+			staging[2] = 255;
+		}
+
+		for( i = 0; i < lms->numfaces; i++ )
+		{
+			msurface_t *surf = &worldmodel->surfaces[world->lightmapfaces[lms->firstface + i]];
+			mextrasurf_t *esrf = surf->info;
+			int sample_size = Mod_SampleSizeForFace( surf );
+			int tmax = ( esrf->lightextents[1] / sample_size ) + 1;
+
+			for( map = 0; map < MAXLIGHTMAPS && surf->styles[map] != LS_NONE; map++ )
+			{
+				// clip the block by the band
+				t0 = Q_max( (int)esrf->light_t[map], y0 );
+				t1 = Q_min( (int)esrf->light_t[map] + tmax, y1 );
+				if( t0 >= t1 ) continue;
+
+				byte *dest = staging + ( t0 - y0 ) * pitch + esrf->light_s[map] * 4;
+				j = t0 - esrf->light_t[map];
+
+				if( deluxmap ) R_BuildDeluxMapForStyle( surf, dest, map, pitch, j, t1 - t0 );
+				else R_BuildLightMapForStyle( surf, dest, map, pitch, j, t1 - t0 );
+			}
+		}
+
+		pglTexSubImage2D( GL_TEXTURE_2D, 0, 0, y0, BLOCK_SIZE, y1 - y0, GL_RGBA, GL_UNSIGNED_BYTE, staging );
+	}
+}
+
+/*
+=================
+R_UpdateLightmapPages
+
+rebuild invalidated pages with a few uploads
+instead of per-face updates while drawing.
+returns true if any page was rewritten
+=================
+*/
+bool R_UpdateLightmapPages( void )
+{
+	bool	updated = false;
+	int	i, j;
+
+	if( !worldmodel || !world->lightmapfaces )
+		return false;
+
+	for( i = 0; i < MAX_LIGHTMAPS && tr.lightmaps[i].state != LM_FREE; i++ )
+	{
+		gl_lightmap_t *lms = &tr.lightmaps[i];
+		int clearflags = 0;
+
+		if( !lms->dirty ) continue;
+
+		if( FBitSet( lms->dirty, LM_DIRTY_LIGHTMAP ))
+		{
+			if( lms->lightmap ) LM_RebuildPage( lms, false );
+			SetBits( clearflags, SURF_LM_UPDATE );
+		}
+
+		if( FBitSet( lms->dirty, LM_DIRTY_DELUXMAP ))
+		{
+			if( lms->deluxmap ) LM_RebuildPage( lms, true );
+			SetBits( clearflags, SURF_DM_UPDATE );
+		}
+
+		for( j = 0; j < lms->numfaces; j++ )
+			ClearBits( worldmodel->surfaces[world->lightmapfaces[lms->firstface + j]].flags, clearflags );
+
+		lms->dirty = 0;
+		updated = true;
+	}
+
+	return updated;
+}
+
 /*
 ========================
 R_TextureCoords
@@ -28,6 +28,7 @@ GNU General Public License for more details.
 #include "enginefeatures.h"
 #include <utlarray.h>
 #include <matrix.h>
+#include "profiler.h"
 
 #define ACTUAL_GL_VERSION	30.0f
 
@@ -38,6 +39,7 @@ GNU General Public License for more details.
 #define MAX_SUBVIEW_FACES	1024			// mirrors, portals, monitors, water, puddles. NOTE: multipass faces can merge view passes
 #define MAX_OCCLUDED_FACES	1024			// mirrors + water
 #define MAX_SORTED_MESHES	2048			// studio only
+#define MAX_QUAD_BATCH	1024			// particles and sprites per one draw call
 #define MAX_MOVIES		16			// max various movies per level
 #define MAX_MOVIE_TEXTURES	64			// max # of unique video textures per level
 #define MAX_LIGHTSTYLES	64			// a byte limit, don't modify
@@ -242,17 +244,41 @@ typedef enum
 	LM_DONE,		// completely full
 } lmstate_t;
 
+#define MAX_ATLAS_NODES	1024			// skyline segments per atlas page
+
+typedef struct
+{
+	unsigned short	x, y;
+	unsigned short	width;
+} atlasnode_t;
+
+// skyline rectangle packer
+typedef struct
+{
+	atlasnode_t	nodes[MAX_ATLAS_NODES];	// sorted by x, covers whole width
+	int		numnodes;
+	int		width, height;
+	int		usedpixels;	// for occupancy report
+} atlas_t;
+
+#define LM_BAND_ROWS	256			// rows per staging upload
+#define LM_DIRTY_LIGHTMAP	BIT( 0 )
+#define LM_DIRTY_DELUXMAP	BIT( 1 )
+
 typedef struct
 {
 	lmstate_t		state;
-	unsigned short	allocated[BLOCK_SIZE_MAX];
+	atlas_t		atlas;
 	int		lightmap;
 	int		deluxmap;	
+	int		firstface;	// world faces on this page (world->lightmapfaces)
+	int		numfaces;
+	int		dirty;		// LM_DIRTY_* page needs to be rebuilt
 } gl_lightmap_t;
 
 typedef struct
 {
-	unsigned short	allocated[SHADOW_SIZE];
+	atlas_t		atlas;
 	CFrameBuffer	shadowmap;
 } gl_shadowmap_t;
 
@@ -432,6 +458,7 @@ enum
 	R_TEXTURECUBEMAP_EXT,
 	R_SHADER_GLSL100_EXT,
 	R_DRAW_RANGEELEMENTS_EXT,
+	R_MULTI_DRAW_EXT,		// glMultiDrawElements
 	R_TEXTURE_3D_EXT,
 	R_SHADER_OBJECTS_EXT,
 	R_VERTEX_SHADER_EXT,	// glsl vertex program
@@ -471,6 +498,7 @@ enum
 typedef struct
 {
 	bool		fCustomRendering;
+	bool		fPrepBench;			// rebuilding drawlists for prepframe_bench, no events
 	bool		fClearScreen;			// force clear if world shaders failed to build
 	int		fGamePaused;
 
@@ -549,7 +577,6 @@ typedef struct
 	int		num_framebuffers;
 
 	int		realframecount;	// not including passes
-	int		grassunloadframe;	// unload too far grass to save video memory
 
 	Vector		ambientLight;	// at vieworg
 	int		waterlevel;	// player waterlevel
@@ -634,6 +661,9 @@ typedef struct
 
 	unsigned int	c_culled_entities;
 	unsigned int	c_total_tris;	// triangle count
+	unsigned int	c_bone_jobs;	// studio models that computed bones in parallel
+	unsigned int	c_anim_cache_hits;	// decompressed animation frames reused
+	unsigned int	c_anim_cache_misses;
 
 	unsigned int	c_subview_passes;
 	unsigned int	c_shadow_passes;
@@ -645,6 +675,8 @@ typedef struct
 
 	unsigned int	num_shader_binds;
 	unsigned int	num_flushes;
+	unsigned int	num_uniform_uploads;
+	unsigned int	num_uniform_skips;	// values matched the shadow copy
 
 	msurface_t	*debug_surface;
 } ref_stats_t;
@@ -721,6 +753,7 @@ extern float		gldepthmin, gldepthmax;
 extern int		sunSize[MAX_SHADOWMAPS];
 extern char		r_speeds_msg[2048];
 extern char		r_depth_msg[2048];
+extern char		r_profile_msg[4096];
 extern model_t		*worldmodel;
 extern int		g_iGunMode;
 extern ref_stats_t		r_stats;
@@ -742,7 +775,7 @@ void GL_BackendEndFrame( ref_viewpass_t *rvp, int params );
 int R_GetSpriteTexture( const model_t *m_pSpriteModel, int frame );
 void GL_BindDrawbuffer( gl_drawbuffer_t *framebuffer );
 void GL_DepthRange( GLfloat depthmin, GLfloat depthmax );
-void R_RenderQuadPrimitive( CSolidEntry *entry );
+int R_RenderQuadPrimitives( CTransEntry *entries, int count );
 void GL_LoadMatrix( const matrix4x4 &source );
 void GL_LoadTexMatrix( const matrix4x4 &source );
 void GL_BindFrameBuffer( int buffer, int texture );
@@ -769,6 +802,7 @@ void GL_Setup3D( void );
 //
 // gl_cubemaps.cpp
 //
+void CL_BuildCubemapTree( void );
 void CL_FindNearestCubeMap( const Vector &pos, mcubemap_t **result );
 void CL_FindTwoNearestCubeMap( const Vector &pos, mcubemap_t **result1, mcubemap_t **result2 );
 void CL_FindNearestCubeMapForSurface( const Vector &pos, const msurface_t *surf, mcubemap_t **result );
@@ -780,6 +814,8 @@ void CL_BuildCubemaps_f( void );
 //
 bool R_CullModel( cl_entity_t *e, const Vector &mins, const Vector &maxs );
 int R_CullSurface( msurface_t *surf, const Vector &vieworg, CFrustum *frustum, int clipFlags = 0 );
+int R_CullSurfaceExt( msurface_t *surf, const Vector &vieworg, CFrustum *frustum, int clipFlags, cl_entity_t *e, const CDynLight *pl );
+void R_CullWorldFaces( CFrustum *frustum );
 bool R_CullBrushModel( cl_entity_t *e );
 bool R_CullNodeTopView( mnode_t *node );
 
@@ -826,10 +862,15 @@ void GL_FreeDrawbuffers( void );
 //
 void R_UpdateSurfaceParams( msurface_t *surf );
 void R_UpdateSurfaceParams( struct mstudiosurface_s *surf );
+void R_InitAtlas( atlas_t *atlas, int width, int height );
+bool R_AllocAtlasBlock( atlas_t *atlas, int w, int h, unsigned short *x, unsigned short *y );
 void GL_BeginBuildingLightmaps( void );
+void GL_AllocLightmapsForWorld( void );
 void GL_AllocLightmapForFace( msurface_t *surf );
 bool GL_AllocLightmapForFace( struct mstudiosurface_s *surf );
 void GL_EndBuildingLightmaps( bool lightmap, bool deluxmap );
+void R_InvalidateLightmapPages( int flags );
+bool R_UpdateLightmapPages( void );
 void R_TextureCoords( msurface_t *surf, const Vector &vec, float *out );
 void R_GlobalCoords( msurface_t *surf, const Vector &point, float *out );
 void R_GlobalCoords( msurface_t *surf, const Vector &point, const Vector &absmin, const Vector &absmax, float scale, float *out );
@@ -853,6 +894,7 @@ void R_SetupDynamicLights( void );
 void CL_ClearDlights( void );
 void R_AnimateLight( void );
 int HasDynamicLights( void );
+int R_GatherVisibleLights( CDynLight *lights[MAX_DLIGHTS] );
 int HasStaticLights( void );
 void CL_DecayLights( void );
 
@@ -875,10 +917,77 @@ void R_RenderTransList( void );
 void R_SetupFrustum( void );
 void R_Clear( int bitMask );
 
+//
+// gl_primitive.cpp
+//
+drawsort_t *R_AllocDrawKeys( int count );
+drawsort_t *R_SortDrawKeys( drawsort_t *keys, int count );
+
+/*
+=================
+R_SortDrawList
+
+sort drawlist entries by packed keys to reduce state changes
+=================
+*/
+template< class T >
+void R_SortDrawList( CUtlArray<T> &list )
+{
+	int	i, j, count = list.Count();
+	drawsort_t	*keys;
+
+	if( count < 2 ) return;
+
+	keys = R_AllocDrawKeys( count );
+
+	for( i = 0; i < count; i++ )
+	{
+		keys[i].key = list[i].GetSortKey();
+		keys[i].index = i;
+	}
+
+	keys = R_SortDrawKeys( keys, count );
+
+	// apply permutation in place, following the cycles
+	for( i = 0; i < count; i++ )
+	{
+		if( keys[i].index == i )
+			continue;
+
+		T temp = list[i];
+
+		for( j = i; keys[j].index != i; )
+		{
+			int	k = keys[j].index;
+			list[j] = list[k];
+			keys[j].index = j;
+			j = k;
+		}
+
+		list[j] = temp;
+		keys[j].index = j;
+	}
+}
+
 //
 // gl_rmisc.cpp
 //
 void R_NewMap( void );
+void R_BeginLoadZone( const char *name, const char *detail = NULL );
+void R_EndLoadZone( void );
+void R_CountLoadBytes( size_t bytes );
+void R_ReportLoadProfile( void );
+
+// scoped load-time zone, see r_loadprofile
+class CLoadZone
+{
+public:
+	CLoadZone( const char *name, const char *detail = NULL ) { R_BeginLoadZone( name, detail ); }
+	~CLoadZone() { R_EndLoadZone(); }
+};
+
+#define LOAD_ZONE( name )		CLoadZone loadZone( name )
+#define LOAD_ZONE_DETAIL( name, detail )	CLoadZone loadZone( name, detail )
 void R_VidInit( void );
 void CL_InitMaterials( void );
 matdesc_t *CL_FindMaterial( const char *name );
@@ -907,6 +1016,8 @@ void GL_CheckTextureAlpha( char *options, int texturenum );
 void GL_EncodeNormal( char *options, int texturenum );
 void GL_BindShader( struct glsl_prog_s *shader );
 void GL_FreeUberShaders( void );
+void GL_PrecacheShaderManifest( const char *mapname );
+void GL_SaveShaderManifest( const char *mapname );
 void GL_InitGPUShaders( void );
 void GL_FreeGPUShaders( void );
 
@@ -966,6 +1077,7 @@ bool Mod_CheckLayerNameForSurf( msurface_t *surf, const char *checkName );
 bool Mod_CheckLayerNameForPixel( mfaceinfo_t *land, const Vector &point, const char *checkName );
 int Mod_FatPVS( model_t *model, const vec3_t org, float radius, byte *visbuffer, int visbytes, bool merge, bool fullvis );
 void Mod_FindStaticLights( byte *vislight, byte lights[MAXDYNLIGHTS], const Vector &origin );
+int Mod_GatherWorldLights( const Vector &absmin, const Vector &absmax, int *list, int maxlist );
 void R_ProcessWorldData( model_t *mod, qboolean create, const byte *buffer );
 bool R_AddSurfaceToDrawList( msurface_t *surf, drawlist_t type );
 void R_MarkVisibleLights( byte lights[MAXDYNLIGHTS] );
@@ -994,5 +1106,6 @@ void R_DrawWeather( void );
 void ParseRain( void );
 void ResetRain( void );
 void InitRain( void );
+void ShutdownRain( void );
 
 #endif//GL_LOCAL_H
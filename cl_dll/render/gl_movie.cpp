@@ -83,6 +83,7 @@ int R_PrecacheCinematic( const char *cinname )
 
 void R_InitCinematics( void )
 {
+	LOAD_ZONE( "R_InitCinematics" );
 	const char *name, *ext;
 
 	// make sure what we have texture to draw cinematics
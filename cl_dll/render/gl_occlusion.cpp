@@ -162,6 +162,7 @@ R_RenderOcclusionList
 void R_RenderSurfOcclusionList( void )
 {
 	int	i;
+	PROF_SCOPE( "R_RenderSurfOcclusionList" );
 
 	if( !RP_NORMALPASS() || !CVAR_TO_BOOL( r_occlusion_culling ))
 		return;
@@ -22,6 +22,65 @@ GNU General Public License for more details.
 #include "gl_studio.h"
 #include "gl_world.h"
 #include "gl_grass.h"
+#include "jobs.h"
+
+// drawkey layout for surfaces: program 16, material 12, lightmap 8, cubemap 10, entity 10, depth 8
+// drawkey layout for meshes: program 16, entity 14, material 12, lightmap 8, depth 14
+#define DRAWKEY_FIELD( value, bits, shift )	(((drawkey_t)((value) & ((1 << (bits)) - 1))) << (shift))
+
+#define RADIX_BITS		8
+#define RADIX_SIZE		(1 << RADIX_BITS)
+#define RADIX_PASSES	((int)( sizeof( drawkey_t ) * 8 / RADIX_BITS ))
+#define RADIX_JOB_COUNT	4096	// don't split small lists across the threads
+
+typedef struct
+{
+	drawsort_t	*src;
+	drawsort_t	*dst;
+	int		count;
+	int		numchunks;
+	int		shift;
+	int		offsets[MAX_JOB_THREADS][RADIX_SIZE];
+} radixsort_t;
+
+static CUtlArray<drawsort_t>	r_drawkeys;
+static radixsort_t		r_radix;
+
+/*
+=================
+R_DrawKeyDepth
+
+quantized distance along view direction
+=================
+*/
+static int R_DrawKeyDepth( const Vector &origin, int bits )
+{
+	float	depth = DotProduct( origin - GetVieworg(), GetVForward( ));
+	int	maxdepth = (1 << bits) - 1;
+
+	if( RI->view.farClip <= 0.0f )
+		return 0;
+
+	return bound( 0, (int)( depth / RI->view.farClip * maxdepth ), maxdepth );
+}
+
+/*
+=================
+R_FloatSortBits
+
+unsigned value with the same order as float
+=================
+*/
+static unsigned int R_FloatSortBits( float value )
+{
+	unsigned int	bits;
+
+	memcpy( &bits, &value, sizeof( bits ));
+
+	if( FBitSet( bits, 0x80000000U ))
+		return ~bits;
+	return bits | 0x80000000U;
+}
 
 void CSolidEntry :: SetRenderPrimitive( const Vector verts[4], const Vector4D &color, int texture, int rendermode )
 {
@@ -33,6 +92,7 @@ void CSolidEntry :: SetRenderPrimitive( const Vector verts[4], const Vector4D &c
 	m_iColor = PackRGBA( color.x * 255, color.y * 255, color.z * 255, color.w * 255 );
 	m_iRenderMode = rendermode;
 	m_hTexture = texture;
+	m_iSortKey = DRAWKEY_FIELD( texture, 16, 48 ) | DRAWKEY_FIELD( rendermode, 8, 40 );
 }
 
 void CSolidEntry :: SetRenderSurface( msurface_t *surface, word hProgram )
@@ -42,6 +102,17 @@ void CSolidEntry :: SetRenderSurface( msurface_t *surface, word hProgram )
 	m_pParentEntity = RI->currententity;
 	m_pRenderModel = RI->currentmodel;
 	m_hProgram = hProgram;
+
+	mextrasurf_t *es = surface->info;
+	int cubemap = es->cubemap[0] ? ( es->cubemap[0] - world->cubemaps ) : 0;
+	Vector origin = (es->mins + es->maxs) * 0.5f;
+
+	if( m_pParentEntity && m_pParentEntity->index != 0 )
+		origin += m_pParentEntity->origin;
+
+	m_iSortKey = DRAWKEY_FIELD( hProgram, 16, 48 ) | DRAWKEY_FIELD( surface->texinfo->texture->gl_texturenum, 12, 36 );
+	m_iSortKey |= DRAWKEY_FIELD( es->lightmaptexturenum, 8, 28 ) | DRAWKEY_FIELD( cubemap, 10, 18 );
+	m_iSortKey |= DRAWKEY_FIELD( m_pParentEntity ? m_pParentEntity->index : 0, 10, 8 ) | DRAWKEY_FIELD( R_DrawKeyDepth( origin, 8 ), 8, 0 );
 }
 
 void CSolidEntry :: SetRenderMesh( vbomesh_t *mesh, word hProgram )
@@ -51,6 +122,16 @@ void CSolidEntry :: SetRenderMesh( vbomesh_t *mesh, word hProgram )
 	m_pParentEntity = RI->currententity;
 	m_pRenderModel = RI->currentmodel;
 	m_hProgram = hProgram;
+
+	m_iSortKey = DRAWKEY_FIELD( hProgram, 16, 48 ) | DRAWKEY_FIELD( m_pParentEntity->index, 14, 34 );
+	m_iSortKey |= DRAWKEY_FIELD( mesh->skinref, 12, 22 ) | DRAWKEY_FIELD( mesh->lightmapnum, 8, 14 );
+	m_iSortKey |= DRAWKEY_FIELD( R_DrawKeyDepth( m_pParentEntity->origin, 14 ), 14, 0 );
+}
+
+drawkey_t CTransEntry :: GetSortKey( void ) const
+{
+	// farthest first, then the state
+	return ((drawkey_t)~R_FloatSortBits( m_flViewDist ) << 32) | ( m_iSortKey >> 32 );
 }
 
 void CTransEntry :: ComputeViewDistance( const Vector &absmin, const Vector &absmax )
@@ -96,4 +177,119 @@ void CTransEntry :: RenderScissorDebug( void )
 	if( !m_bScissorReady ) return;
 
 	R_DrawScissorRectangle( m_vecRect.x, m_vecRect.y, m_vecRect.z, m_vecRect.w );
-}
\ No newline at end of file
+}
+
+/*
+=================
+R_RadixHistogram
+
+count the digits for one chunk of list
+=================
+*/
+static void R_RadixHistogram( void *context, int chunk, int threadnum )
+{
+	radixsort_t *rs = (radixsort_t *)context;
+	int start = (rs->count * chunk) / rs->numchunks;
+	int end = (rs->count * ( chunk + 1 )) / rs->numchunks;
+	int *counts = rs->offsets[chunk];
+
+	memset( counts, 0, sizeof( rs->offsets[0] ));
+
+	for( int i = start; i < end; i++ )
+		counts[(rs->src[i].key >> rs->shift) & (RADIX_SIZE - 1)]++;
+}
+
+/*
+=================
+R_RadixScatter
+
+move chunk items into the sorted positions
+=================
+*/
+static void R_RadixScatter( void *context, int chunk, int threadnum )
+{
+	radixsort_t *rs = (radixsort_t *)context;
+	int start = (rs->count * chunk) / rs->numchunks;
+	int end = (rs->count * ( chunk + 1 )) / rs->numchunks;
+	int *offsets = rs->offsets[chunk];
+
+	for( int i = start; i < end; i++ )
+		rs->dst[offsets[(rs->src[i].key >> rs->shift) & (RADIX_SIZE - 1)]++] = rs->src[i];
+}
+
+/*
+=================
+R_AllocDrawKeys
+
+scratch buffer for drawlist sorting
+=================
+*/
+drawsort_t *R_AllocDrawKeys( int count )
+{
+	// second half is used by radix sort
+	r_drawkeys.EnsureCount( count * 2 );
+
+	return r_drawkeys.Base();
+}
+
+/*
+=================
+R_SortDrawKeys
+
+stable LSD radix sort, returns sorted keys
+large lists are splitted across the job threads
+=================
+*/
+drawsort_t *R_SortDrawKeys( drawsort_t *keys, int count )
+{
+	radixsort_t	*rs = &r_radix;
+	drawkey_t		diff = 0;
+	int		i, j, pass, total;
+
+	if( count < 2 ) return keys;
+
+	// skip the digits which are same for all the keys
+	for( i = 1; i < count; i++ )
+		diff |= keys[i].key ^ keys[0].key;
+
+	rs->src = keys;
+	rs->dst = keys + count;
+	rs->count = count;
+
+	if( count >= RADIX_JOB_COUNT )
+		rs->numchunks = JOB_NumThreads();
+	else rs->numchunks = 1;
+
+	for( pass = 0; pass < RADIX_PASSES; pass++ )
+	{
+		rs->shift = pass * RADIX_BITS;
+
+		if( !(( diff >> rs->shift ) & ( RADIX_SIZE - 1 )))
+			continue;
+
+		if( rs->numchunks > 1 )
+			JOB_RunOnIndividual( rs->numchunks, rs, R_RadixHistogram );
+		else R_RadixHistogram( rs, 0, 0 );
+
+		// turn counts into offsets, chunks are kept in order to stay stable
+		for( i = 0, total = 0; i < RADIX_SIZE; i++ )
+		{
+			for( j = 0; j < rs->numchunks; j++ )
+			{
+				int	cnt = rs->offsets[j][i];
+				rs->offsets[j][i] = total;
+				total += cnt;
+			}
+		}
+
+		if( rs->numchunks > 1 )
+			JOB_RunOnIndividual( rs->numchunks, rs, R_RadixScatter );
+		else R_RadixScatter( rs, 0, 0 );
+
+		drawsort_t *temp = rs->src;
+		rs->src = rs->dst;
+		rs->dst = temp;
+	}
+
+	return rs->src;
+}
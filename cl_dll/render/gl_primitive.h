@@ -22,6 +22,19 @@ GNU General Public License for more details.
 #define DRAWTYPE_MESH	2
 #define DRAWTYPE_QUAD	3
 
+// packed state for drawlist sorting
+#ifdef _MSC_VER
+typedef unsigned __int64	drawkey_t;
+#else
+typedef unsigned long long	drawkey_t;
+#endif
+
+typedef struct
+{
+	drawkey_t		key;
+	int		index;	// position in unsorted list
+} drawsort_t;
+
 //#pragma pack(1)
 
 class CSolidEntry
@@ -31,9 +44,11 @@ public:
 	void SetRenderSurface( msurface_t *surface, word hProgram );
 	void SetRenderMesh( struct vbomesh_s *mesh, word hProgram );
 	virtual bool IsTranslucent( void ) { return false; }
+	virtual drawkey_t GetSortKey( void ) const { return m_iSortKey; }
 	int GetType( void ) { return m_bDrawType; }
 
 	byte			m_bDrawType;	// type of entry
+	drawkey_t			m_iSortKey;	// program, material, lightmap, etc
 
 	union
 	{
@@ -67,6 +82,7 @@ public:
 	void ComputeViewDistance( const Vector &absmin, const Vector &absmax );
 	void ComputeScissor( const Vector &absmin, const Vector &absmax );
 	virtual bool IsTranslucent( void ) { return true; }
+	virtual drawkey_t GetSortKey( void ) const;	// back to front
 	void RequestScreenColor( void );
 	void RequestScreenDepth( void );
 	void RenderScissorDebug( void );
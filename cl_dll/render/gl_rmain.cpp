@@ -35,6 +35,7 @@ ref_stats_t	r_stats;
 ref_buildstats_t	r_buildstats;
 char		r_speeds_msg[2048];
 char		r_depth_msg[2048];
+char		r_profile_msg[4096];
 model_t		*worldmodel = NULL;
 float		gldepthmin, gldepthmax;
 int		sunSize[MAX_SHADOWMAPS] = { 1024, 1024, 1024, 1024 };
@@ -255,6 +256,75 @@ gl_state_t *GL_GetCache( word hCachedMatrix )
 	return glm;
 }
 
+/*
+=======================================================================
+
+	FRAME PREPARATION BENCHMARK
+
+=======================================================================
+*/
+#define PREPBENCH_MAX_VIEWS	65536
+
+enum
+{
+	PREP_VISIBILITY = 0,	// view setup, PVS and world leafs
+	PREP_ENTITIES,		// submodels, studiomodels, sprites and bones
+	PREP_PARTICLES,
+	PREP_SURFACES,		// world faces culling and drawlists
+	PREP_LIGHTS,		// dynamic lights setup
+	PREP_SORT,		// drawlists sorting
+	PREP_STAGES
+};
+
+static const char *r_prepstagename[PREP_STAGES] =
+{
+	"visibility",
+	"entities",
+	"particles",
+	"surfaces",
+	"lights",
+	"sort",
+};
+
+typedef struct
+{
+	Vector		origin;
+	Vector		angles;
+	float		fov_x;
+	float		fov_y;
+} prepview_t;
+
+typedef struct
+{
+	double		*stages;		// not NULL while benchmark is running
+	double		stamp;
+	int		numframes;	// pending benchmark
+	bool		recording;
+	char		pathname[64];
+	CUtlArray<prepview_t>	path;
+} prepbench_t;
+
+static prepbench_t		r_prepbench;
+
+/*
+===============
+R_PrepStage
+
+add time since previous stage, -1 is just reset the timer
+===============
+*/
+static void R_PrepStage( int stage )
+{
+	if( !r_prepbench.stages )
+		return;
+
+	double	time = Sys_DoubleTime();
+
+	if( stage >= 0 )
+		r_prepbench.stages[stage] += time - r_prepbench.stamp;
+	r_prepbench.stamp = time;
+}
+
 /*
 ===============
 R_MarkWorldVisibleFaces
@@ -265,6 +335,7 @@ instead of RecursiveWorldNode
 void R_MarkWorldVisibleFaces( model_t *model )
 {
 	float		maxdist = 0.0f;
+	int		group = -1, culled = 0;
 	msurface_t	**mark;
 	mleaf_t		*leaf;
 	int		i, j;
@@ -282,7 +353,19 @@ void R_MarkWorldVisibleFaces( model_t *model )
 
 		if( CHECKVISBIT( RI->view.pvsarray, leaf->cluster ) && ( leaf->efrags || leaf->nummarksurfaces ))
 		{
-			if( RI->view.frustum.CullBox( eleaf->mins, eleaf->maxs ))
+			if( model == worldmodel && world->packedleafs )
+			{
+				// cull four leafs at once
+				if(( i / PACKED_BOXES ) != group )
+				{
+					group = i / PACKED_BOXES;
+					culled = RI->view.frustum.CullBoxes( &world->packedleafs[group * PACKED_BOX_FLOATS] );
+				}
+
+				if( FBitSet( culled, BIT( i % PACKED_BOXES )))
+					continue;
+			}
+			else if( RI->view.frustum.CullBox( eleaf->mins, eleaf->maxs ))
 				continue;
 
 			// do additional culling in dev_overview mode
@@ -317,6 +400,10 @@ void R_MarkWorldVisibleFaces( model_t *model )
 						R_PrecacheGrass( surf, eleaf );
 					SETVISBIT( RI->view.visfaces, *mark - model->surfaces );
 				}
+
+				// leaf bounds may be expanded by grass
+				if( model == worldmodel && world->packedleafs )
+					PackBoxBounds( &world->packedleafs[(i / PACKED_BOXES) * PACKED_BOX_FLOATS], i % PACKED_BOXES, eleaf->mins, eleaf->maxs );
 			}
 		}
 	}
@@ -350,7 +437,9 @@ static void R_SetupViewCache( const ref_viewpass_t *rvp )
 {
 	const ref_overview_t *ov = GET_OVERVIEW_PARMS();
 	model_t *model = worldmodel;
+	PROF_SCOPE( "R_SetupViewCache" );
 
+	R_PrepStage( -1 );
 	RI->view.changed = 0; // always clearing changes at start of frame
 
 	if( !model && FBitSet( RI->params, RP_DRAW_WORLD ))
@@ -588,12 +677,15 @@ static void R_SetupViewCache( const ref_viewpass_t *rvp )
 			RI->view.parallelSplitDistances[NUM_SHADOW_SPLITS] = farClip;
 		}
 
+		R_PrepStage( PREP_VISIBILITY );
+
 		// don't draw the entities while render skybox or cubemap
 		if( !FBitSet( RI->params, ( RP_ENVVIEW|RP_SKYVIEW )))
 		{
 			// before process of tr.draw_entities
 			// we can add muzzleflashes here
 			R_RunViewmodelEvents();
+			R_BeginStudioBoneJobs();
 
 			// brush faces not added here!
 			// only marks as visible in RI->view.visfaces array
@@ -619,11 +711,19 @@ static void R_SetupViewCache( const ref_viewpass_t *rvp )
 				}
 			}
 
+			// compute bones for deferred studiomodels
+			R_FinishStudioBoneJobs();
+			R_PrepStage( PREP_ENTITIES );
+
 			// add particles to deferred list
 			g_pParticleSystems.UpdateSystems();
 			g_pParticles.Update();
+			R_PrepStage( PREP_PARTICLES );
 		}
 
+		// frustum culling for world faces is batched
+		if( model != NULL ) R_CullWorldFaces( frustum );
+
 		// create drawlist for faces, do additional culling for world faces
 		for( i = 0; model != NULL && i < world->numsortedfaces; i++ )
 		{
@@ -656,7 +756,7 @@ static void R_SetupViewCache( const ref_viewpass_t *rvp )
 
 					R_AddGrassToDrawList( surf, DRAWLIST_SOLID );
 
-					if( R_CullSurface( surf, GetVieworg(), frustum ))
+					if( R_CullSurface( surf, GetVieworg(), NULL ) || CHECKVISBIT( world->culledfaces, j ))
 					{
 						CLEARVISBIT( RI->view.visfaces, j ); // not visible
 						continue;
@@ -696,12 +796,19 @@ static void R_SetupViewCache( const ref_viewpass_t *rvp )
 				}
 			}
 		}
+
+		// sorting list to reduce state switches
+		if( !CVAR_TO_BOOL( cv_nosort ))
+			R_SortDrawList( RI->frame.solid_faces );
+
+		R_PrepStage( PREP_SURFACES );
 	}
 	else if( !FBitSet( RI->params, ( RP_ENVVIEW|RP_SKYVIEW )))
 	{
 		// before process of tr.draw_entities
 		// we can add muzzleflashes here
 		R_RunViewmodelEvents();
+		R_BeginStudioBoneJobs();
 
 		// update entity params for every frame
 		for( int i = 0; i < tr.num_draw_entities; i++ )
@@ -723,6 +830,9 @@ static void R_SetupViewCache( const ref_viewpass_t *rvp )
 			default: HOST_ERROR( "R_SetupViewCache: mod_bad\n" );
 			}
 		}
+
+		R_FinishStudioBoneJobs();
+		R_PrepStage( PREP_ENTITIES );
 	}
 
 	// setup dynamic lights
@@ -732,6 +842,8 @@ static void R_SetupViewCache( const ref_viewpass_t *rvp )
 		R_SetupDynamicLights();
 	}
 
+	R_PrepStage( PREP_LIGHTS );
+
 	// cache client frame
 	RI->view.client_frame = tr.realframecount;		
 }
@@ -858,6 +970,7 @@ NOTE: particles are drawing with engine methods
 void R_DrawParticles( qboolean trans )
 {
 	ref_viewpass_t	rvp;
+	PROF_SCOPE( "R_DrawParticles" );
 
 	if( FBitSet( RI->params, ( RP_ENVVIEW|RP_SKYVIEW )))
 		return;
@@ -883,23 +996,6 @@ void R_DrawParticles( qboolean trans )
 	DRAW_PARTICLES( &rvp, trans, tr.frametime );
 }
 
-/*
-=================
-R_SortTransMeshes
-
-compare translucent meshes
-=================
-*/
-static int R_SortTransMeshes( const CTransEntry *a, const CTransEntry *b )
-{
-	if( a->m_flViewDist > b->m_flViewDist )
-		return -1;
-	if( a->m_flViewDist < b->m_flViewDist )
-		return 1;
-
-	return 0;
-}
-
 /*
 ===============
 R_RenderTransList
@@ -907,6 +1003,8 @@ R_RenderTransList
 */
 void R_RenderTransList( void )
 {
+	PROF_SCOPE( "R_RenderTransList" );
+
 	if( !RI->frame.trans_list.Count() )
 		return;
 
@@ -919,7 +1017,7 @@ void R_RenderTransList( void )
 		pglEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
 
 	// sorting by distance
-	RI->frame.trans_list.Sort( R_SortTransMeshes );
+	R_SortDrawList( RI->frame.trans_list );
 
 	for( int i = 0; i < RI->frame.trans_list.Count(); i++ )
 	{
@@ -934,7 +1032,8 @@ void R_RenderTransList( void )
 			R_RenderTransMesh( entry );
 			break;
 		case DRAWTYPE_QUAD:
-			R_RenderQuadPrimitive( entry );
+			// neighbour quads are merged into one draw call
+			i += R_RenderQuadPrimitives( entry, RI->frame.trans_list.Count() - i ) - 1;
 			break;
 		}
 	}
@@ -964,6 +1063,7 @@ R_RenderScene
 void R_RenderScene( const ref_viewpass_t *rvp, int params )
 {
 	int	err;
+	PROF_SCOPE( "R_RenderScene" );
 	
 	// now we know about pass specific
 	RI->params = params;
@@ -1017,6 +1117,7 @@ R_RenderDeferredScene
 void R_RenderDeferredScene( const ref_viewpass_t *rvp, int params )
 {
 	int	err;
+	PROF_SCOPE( "R_RenderDeferredScene" );
 
 	// now we know about pass specific
 	RI->params = params;
@@ -1049,6 +1150,272 @@ void R_RenderDeferredScene( const ref_viewpass_t *rvp, int params )
 	R_ResetGLstate();
 }
 
+/*
+===============
+R_FrameListBytes
+
+memory held by the frame list after the build
+===============
+*/
+template< class T >
+static size_t R_FrameListBytes( const CUtlArray<T> &list )
+{
+	return (size_t)list.NumAllocated() * sizeof( T );
+}
+
+/*
+===============
+R_RunPrepBench
+
+rebuild the frame drawlists without drawing
+and measure every stage of the preparation
+===============
+*/
+static void R_RunPrepBench( const ref_viewpass_t *rvp, int params )
+{
+	int		numframes = r_prepbench.numframes;
+	int		numviews = r_prepbench.path.Count();
+	double		stages[PREP_STAGES];
+	double		total = 0.0, worst = 0.0;
+	size_t		bytes = 0, maxbytes = 0;
+	ref_viewpass_t	vp = *rvp;
+
+	r_prepbench.numframes = 0;
+	memset( stages, 0, sizeof( stages ));
+
+	// recompute the studio bones in every pass but don't run the events again
+	tr.fPrepBench = true;
+
+	for( int i = 0; i < numframes; i++ )
+	{
+		if( numviews > 0 )
+		{
+			const prepview_t *view = &r_prepbench.path[i % numviews];
+
+			vp.vieworigin = view->origin;
+			vp.viewangles = view->angles;
+			vp.fov_x = view->fov_x;
+			vp.fov_y = view->fov_y;
+		}
+
+		RI->params = params;
+		tr.frametime = 0.0; // don't run particles and lights
+		RI->view.client_frame = tr.realframecount - 1; // force to rebuild drawlists
+
+		double start = Sys_DoubleTime();
+		r_prepbench.stages = stages;
+
+		R_SetupViewCache( &vp );
+
+		if( !CVAR_TO_BOOL( cv_nosort ))
+		{
+			R_SortDrawList( RI->frame.solid_meshes );
+			R_SortDrawList( RI->frame.trans_list );
+		}
+
+		R_PrepStage( PREP_SORT );
+		r_prepbench.stages = NULL;
+
+		double frametime = Sys_DoubleTime() - start;
+		worst = Q_max( worst, frametime );
+		total += frametime;
+
+		size_t framebytes = 0;
+		framebytes += R_FrameListBytes( RI->frame.solid_faces );
+		framebytes += R_FrameListBytes( RI->frame.solid_meshes );
+		framebytes += R_FrameListBytes( RI->frame.grass_list );
+		framebytes += R_FrameListBytes( RI->frame.trans_list );
+		framebytes += R_FrameListBytes( RI->frame.primverts );
+		maxbytes = Q_max( maxbytes, framebytes );
+		bytes += framebytes;
+	}
+
+	tr.frametime = tr.saved_frametime;
+	tr.fPrepBench = false;
+
+	if( numviews > 0 )
+		Msg( "%i frames along %s (%i views)\n", numframes, r_prepbench.pathname, numviews );
+	else Msg( "%i frames from current view\n", numframes );
+
+	Msg( "total %.3f ms avg, %.3f ms worst\n", total * 1000.0 / numframes, worst * 1000.0 );
+
+	for( int i = 0; i < PREP_STAGES; i++ )
+		Msg( "%12s %.3f ms\n", r_prepstagename[i], stages[i] * 1000.0 / numframes );
+
+	Msg( "drawlists hold %s per frame, %s worst\n", Q_memprint( bytes / numframes ), Q_memprint( maxbytes ));
+	Msg( "last frame: %i solid faces, %i solid meshes, %i translucent, %i grass\n", RI->frame.solid_faces.Count(),
+		RI->frame.solid_meshes.Count(), RI->frame.trans_list.Count(), RI->frame.grass_list.Count( ));
+}
+
+/*
+===============
+R_LoadPrepPath
+
+camera path is a text file with origin, angles and fov per line
+===============
+*/
+static bool R_LoadPrepPath( const char *filename )
+{
+	char	*afile = (char *)LOAD_FILE( filename, NULL );
+	char	token[256];
+	prepview_t	view;
+
+	if( !afile )
+	{
+		Msg( "couldn't load %s\n", filename );
+		return false;
+	}
+
+	r_prepbench.path.Purge();
+	Q_strncpy( r_prepbench.pathname, filename, sizeof( r_prepbench.pathname ));
+
+	char *pfile = afile;
+
+	while( r_prepbench.path.Count() < PREPBENCH_MAX_VIEWS )
+	{
+		float	values[8];
+		int	i;
+
+		for( i = 0; i < 8; i++ )
+		{
+			if(( pfile = COM_ParseFile( pfile, token )) == NULL )
+				break;
+			values[i] = Q_atof( token );
+		}
+
+		if( i != 8 ) break;
+
+		view.origin = Vector( values[0], values[1], values[2] );
+		view.angles = Vector( values[3], values[4], values[5] );
+		view.fov_x = values[6];
+		view.fov_y = values[7];
+
+		if( view.fov_x <= 0.0f || view.fov_y <= 0.0f )
+			continue; // bad fov will trigger HOST_ERROR
+
+		r_prepbench.path.AddToTail( view );
+	}
+
+	FREE_FILE( afile );
+
+	if( !r_prepbench.path.Count( ))
+	{
+		Msg( "%s doesn't contain valid views\n", filename );
+		return false;
+	}
+
+	return true;
+}
+
+/*
+===============
+R_SavePrepPath
+===============
+*/
+static void R_SavePrepPath( void )
+{
+	int	numviews = r_prepbench.path.Count();
+	size_t	maxsize = numviews * 128;
+	char	*buffer = (char *)Mem_Alloc( maxsize );
+	size_t	length = 0;
+
+	for( int i = 0; i < numviews; i++ )
+	{
+		const prepview_t *view = &r_prepbench.path[i];
+
+		length += Q_snprintf( buffer + length, maxsize - length, "%g %g %g %g %g %g %g %g\n",
+			view->origin.x, view->origin.y, view->origin.z,
+			view->angles.x, view->angles.y, view->angles.z,
+			view->fov_x, view->fov_y );
+	}
+
+	if( SAVE_FILE( r_prepbench.pathname, buffer, length ))
+		Msg( "%s: %i views saved\n", r_prepbench.pathname, numviews );
+	else Msg( "couldn't write %s\n", r_prepbench.pathname );
+
+	Mem_Free( buffer );
+}
+
+/*
+===============
+R_PrepFrameBench_f
+
+measure frame preparation without drawing
+===============
+*/
+void R_PrepFrameBench_f( void )
+{
+	if( CMD_ARGC() < 2 )
+	{
+		Msg( "Usage: prepframe_bench <frames> [camera path]\n" );
+		return;
+	}
+
+	if( !worldmodel )
+	{
+		Msg( "prepframe_bench: no map loaded\n" );
+		return;
+	}
+
+	if( CMD_ARGC() > 2 )
+	{
+		if( !R_LoadPrepPath( CMD_ARGV( 2 )))
+			return;
+	}
+	else r_prepbench.path.Purge();
+
+	// will be executed at end of the next frame
+	r_prepbench.numframes = bound( 1, Q_atoi( CMD_ARGV( 1 )), 100000 );
+}
+
+/*
+===============
+R_PrepFrameRecord_f
+
+record the camera path for prepframe_bench
+===============
+*/
+void R_PrepFrameRecord_f( void )
+{
+	if( r_prepbench.recording )
+	{
+		r_prepbench.recording = false;
+		R_SavePrepPath();
+		r_prepbench.path.Purge();
+		return;
+	}
+
+	if( CMD_ARGC() < 2 )
+	{
+		Msg( "Usage: prepframe_record <filename>, call again to stop recording\n" );
+		return;
+	}
+
+	Q_strncpy( r_prepbench.pathname, CMD_ARGV( 1 ), sizeof( r_prepbench.pathname ));
+	r_prepbench.path.Purge();
+	r_prepbench.recording = true;
+}
+
+/*
+===============
+R_RecordPrepView
+===============
+*/
+static void R_RecordPrepView( const ref_viewpass_t *rvp )
+{
+	prepview_t	view;
+
+	if( r_prepbench.path.Count() >= PREPBENCH_MAX_VIEWS )
+		return;
+
+	view.origin = rvp->vieworigin;
+	view.angles = rvp->viewangles;
+	view.fov_x = rvp->fov_x;
+	view.fov_y = rvp->fov_y;
+
+	r_prepbench.path.AddToTail( view );
+}
+
 /*
 ===============
 HUD_RenderFrame
@@ -1064,6 +1431,7 @@ int HUD_RenderFrame( const struct ref_viewpass_s *rvp )
 {
 	int		refParams = RP_NONE;
 	ref_viewpass_t	defVP = *rvp;
+	PROF_SCOPE( "HUD_RenderFrame" );
 
 	// setup some renderer flags
 	if( !FBitSet( rvp->flags, RF_DRAW_CUBEMAP ))
@@ -1093,6 +1461,12 @@ int HUD_RenderFrame( const struct ref_viewpass_s *rvp )
 	if( !GL_BackendStartFrame( &defVP, refParams ))
 		return 0;
 
+	// build decals that was created since last frame
+	R_FlushDecalQueue();
+
+	if( r_prepbench.recording && FBitSet( refParams, RP_DRAW_WORLD ) && RP_NORMALPASS( ))
+		R_RecordPrepView( &defVP );
+
 	if( CVAR_TO_BOOL( cv_deferred ))
 	{
 		if( !CVAR_TO_BOOL( cv_deferred_full ))
@@ -1113,6 +1487,9 @@ int HUD_RenderFrame( const struct ref_viewpass_s *rvp )
 
 	GL_BackendEndFrame( &defVP, refParams );
 
+	if( r_prepbench.numframes > 0 && FBitSet( refParams, RP_DRAW_WORLD ) && RP_NORMALPASS( ))
+		R_RunPrepBench( &defVP, refParams );
+
 	return 1;
 }
 
@@ -1144,10 +1521,11 @@ BOOL HUD_SpeedsMessage( char *out, size_t size )
 	if( !g_fRenderInitialized || !CVAR_TO_BOOL( cv_renderer ))
 		return false; // let the engine use built-in counters
 
-	if( r_speeds->value <= 0 ) return false;
+	if( r_speeds->value <= 0 && r_profile->value <= 0 ) return false;
 	if( !out || !size ) return false;
 
 	Q_strncpy( out, r_speeds_msg, size );
+	if( r_profile->value > 0 ) Q_strncat( out, r_profile_msg, size );
 
 	return true;
 }
@@ -1170,6 +1548,7 @@ void HUD_BuildLightmaps( void )
 
 	for( i = 0; i < worldmodel->numsurfaces; i++ )
 		SetBits( worldmodel->surfaces[i].flags, SURF_LM_UPDATE|SURF_GRASS_UPDATE );
+	R_InvalidateLightmapPages( LM_DIRTY_LIGHTMAP );
 
 	R_StudioClearLightCache();
 }
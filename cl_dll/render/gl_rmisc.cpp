@@ -39,7 +39,7 @@ void CL_LoadMaterials( const char *path )
 {
 	ALERT( at_aiconsole, "loading %s\n", path );
 
-	char *afile = (char *)gEngfuncs.COM_LoadFile( (char *)path, 5, NULL );
+	char *afile = (char *)LOAD_FILE( path, NULL );
 
 	if( !afile )
 	{
@@ -636,11 +636,12 @@ load the landscape definitions
 */
 void R_LoadLandscapes( const char *filename )
 {
+	LOAD_ZONE( "R_LoadLandscapes" );
 	char filepath[256];
 
 	Q_snprintf( filepath, sizeof( filepath ), "maps/%s_land.txt", filename );
 
-	char *afile = (char *)gEngfuncs.COM_LoadFile( filepath, 5, NULL );
+	char *afile = (char *)LOAD_FILE( filepath, NULL );
 	if( !afile ) return;
 
 	ALERT( at_aiconsole, "loading %s\n", filepath );
@@ -996,6 +997,7 @@ create VBO cache for vertex-lit and lightmapped studio models
 */
 void GL_InitModelLightCache( void )
 {
+	LOAD_ZONE( "GL_InitModelLightCache" );
 	char		*entities = worldmodel->entities;
 	static char	worldname[64];
 	char		token[2048];
@@ -1028,6 +1030,7 @@ Called always when map is changed or restarted
 */
 void R_NewMap( void )
 {
+	LOAD_ZONE( "R_NewMap" );
 	// setup special flags
 	for( int i = 0; i < worldmodel->numsurfaces; i++ )
 	{
@@ -1172,7 +1175,6 @@ void GL_MapChanged( void )
 	R_InitRefState();
 
 	tr.glsl_valid_sequence = 1;
-	tr.grassunloadframe = 0;
 	tr.fClearScreen = false;
 	tr.realframecount = 1;
 	tr.num_cin_used = 0;
@@ -1199,4 +1201,263 @@ void GL_MapChanged( void )
 	g_StudioRenderer.VidInit();
 
 	GL_InitModelLightCache();
-}
\ No newline at end of file
+}
+/*
+=======================================================================
+
+	LOAD-TIME PROFILER
+
+=======================================================================
+*/
+#define MAX_LOAD_ZONES	4096
+#define MAX_LOAD_DEPTH	32
+#define MAX_LOAD_STAGES	128
+
+typedef struct
+{
+	const char	*name;		// static string, used to group stages
+	char		detail[64];	// model or map name
+	double		start;
+	double		end;
+	int		depth;
+	size_t		bytes;		// read from disk inside this zone (inclusive)
+} loadzone_t;
+
+typedef struct
+{
+	const char	*name;
+	int		count;
+	double		total;		// inclusive
+	double		self;		// without nested zones
+	size_t		bytes;
+} loadstage_t;
+
+static loadzone_t	r_loadzones[MAX_LOAD_ZONES];
+static int	r_numloadzones;
+static int	r_loadstack[MAX_LOAD_DEPTH];
+static int	r_loaddepth;
+static size_t	r_loadbytes;	// total read since last report
+static bool	r_loadpending;	// map is loading, zones are recorded until the report
+
+/*
+===============
+R_BeginLoadZone
+
+open nested timer, zones are dropped if the buffer is full
+or if they are opened during play (e.g. lazy shader compiles)
+===============
+*/
+void R_BeginLoadZone( const char *name, const char *detail )
+{
+	int	index = -1;
+
+	if( r_loaddepth >= MAX_LOAD_DEPTH )
+	{
+		r_loaddepth++;	// keep begin/end balanced
+		return;
+	}
+
+	// new map is loading, latch until the report
+	if( !RENDER_GET_PARM( PARM_CLIENT_ACTIVE, 0 ))
+		r_loadpending = true;
+
+	if( r_loadpending && r_numloadzones < MAX_LOAD_ZONES )
+	{
+		loadzone_t *zone = &r_loadzones[r_numloadzones];
+
+		zone->name = name;
+		zone->depth = r_loaddepth;
+		zone->bytes = 0;
+		zone->end = 0.0;
+		if( detail ) Q_strncpy( zone->detail, detail, sizeof( zone->detail ));
+		else zone->detail[0] = '\0';
+		zone->start = Sys_DoubleTime();
+		index = r_numloadzones++;
+	}
+
+	r_loadstack[r_loaddepth++] = index;
+}
+
+void R_EndLoadZone( void )
+{
+	if( r_loaddepth <= 0 )
+		return;
+
+	if( --r_loaddepth >= MAX_LOAD_DEPTH )
+		return;
+
+	int index = r_loadstack[r_loaddepth];
+	if( index >= 0 ) r_loadzones[index].end = Sys_DoubleTime();
+}
+
+/*
+===============
+R_CountLoadBytes
+
+charge all the opened zones
+===============
+*/
+void R_CountLoadBytes( size_t bytes )
+{
+	if( !r_loadpending )
+		return;
+
+	r_loadbytes += bytes;
+
+	for( int i = 0; i < Q_min( r_loaddepth, MAX_LOAD_DEPTH ); i++ )
+	{
+		if( r_loadstack[i] >= 0 )
+			r_loadzones[r_loadstack[i]].bytes += bytes;
+	}
+}
+
+byte *R_LoadFile( const char *filename, int *length )
+{
+	int	size = 0;
+	byte	*buffer;
+
+	buffer = (*gEngfuncs.COM_LoadFile)( (char *)filename, 5, &size );
+	if( buffer ) R_CountLoadBytes( size );
+	if( length ) *length = size;
+
+	return buffer;
+}
+
+/*
+===============
+R_WriteLoadTrace
+
+export zones as Chrome trace-event JSON (chrome://tracing, perfetto)
+===============
+*/
+static void R_WriteLoadTrace( void )
+{
+	char	filename[MAX_PATH];
+	char	detail[64];
+	size_t	size = 64 + r_numloadzones * ( 192 + sizeof( detail ));
+	char	*json = (char *)Mem_Alloc( size );
+	double	base = r_loadzones[0].start;
+	size_t	len;
+
+	len = Q_snprintf( json, size, "{\"traceEvents\":[\n" );
+
+	for( int i = 0; i < r_numloadzones; i++ )
+	{
+		loadzone_t *zone = &r_loadzones[i];
+		int j;
+
+		// paths may contain the backslashes
+		for( j = 0; zone->detail[j]; j++ )
+			detail[j] = ( zone->detail[j] == '\\' || zone->detail[j] == '"' ) ? '/' : zone->detail[j];
+		detail[j] = '\0';
+
+		len += Q_snprintf( json + len, size - len, "{\"name\":\"%s\",\"cat\":\"load\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+		"\"ts\":%.0f,\"dur\":%.0f,\"args\":{\"detail\":\"%s\",\"bytes\":%u}}%s\n",
+		zone->name, ( zone->start - base ) * 1000000.0, ( zone->end - zone->start ) * 1000000.0,
+		detail, (unsigned int)zone->bytes, ( i == r_numloadzones - 1 ) ? "" : "," );
+	}
+
+	len += Q_snprintf( json + len, size - len, "]}\n" );
+
+	Q_snprintf( filename, sizeof( filename ), "profile/load_%s.json", world->name[0] ? world->name : "nomap" );
+
+	if( SAVE_FILE( filename, json, len ))
+		ALERT( at_console, "load trace written to %s\n", filename );
+	else ALERT( at_error, "R_WriteLoadTrace: couldn't write %s\n", filename );
+
+	Mem_Free( json );
+}
+
+static int R_LoadStageCompare( const void *a, const void *b )
+{
+	const loadstage_t *sa = (const loadstage_t *)a;
+	const loadstage_t *sb = (const loadstage_t *)b;
+
+	if( sa->total > sb->total ) return -1;
+	if( sa->total < sb->total ) return 1;
+	return 0;
+}
+
+/*
+===============
+R_ReportLoadProfile
+
+called once client is active: print per-stage
+summary and export the trace, then reset.
+reported only once per map load
+===============
+*/
+void R_ReportLoadProfile( void )
+{
+	loadstage_t	stages[MAX_LOAD_STAGES];
+	double		childtime[MAX_LOAD_ZONES];
+	int		parents[MAX_LOAD_DEPTH];
+	int		i, j, numstages = 0;
+
+	// still loading something
+	if( !r_loadpending || r_loaddepth > 0 )
+		return;
+
+	r_loadpending = false;
+
+	if( !r_numloadzones || !r_loadprofile || r_loadprofile->value <= 0.0f )
+	{
+		r_numloadzones = 0;
+		r_loadbytes = 0;
+		return;
+	}
+
+	// time of the direct children to get self time
+	for( i = 0; i < r_numloadzones; i++ )
+	{
+		loadzone_t *zone = &r_loadzones[i];
+
+		childtime[i] = 0.0;
+		parents[zone->depth] = i;
+
+		if( zone->depth > 0 )
+			childtime[parents[zone->depth - 1]] += zone->end - zone->start;
+	}
+
+	for( i = 0; i < r_numloadzones; i++ )
+	{
+		loadzone_t *zone = &r_loadzones[i];
+
+		for( j = 0; j < numstages; j++ )
+		{
+			if( !Q_strcmp( stages[j].name, zone->name ))
+				break;
+		}
+
+		if( j == numstages )
+		{
+			if( numstages == MAX_LOAD_STAGES )
+				continue;
+			memset( &stages[j], 0, sizeof( loadstage_t ));
+			stages[j].name = zone->name;
+			numstages++;
+		}
+
+		stages[j].count++;
+		stages[j].total += zone->end - zone->start;
+		stages[j].self += zone->end - zone->start - childtime[i];
+		stages[j].bytes += zone->bytes;
+	}
+
+	qsort( stages, numstages, sizeof( loadstage_t ), R_LoadStageCompare );
+
+	ALERT( at_console, "load profile: %i zones, %.1f Kb read from disk\n", r_numloadzones, r_loadbytes / 1024.0 );
+	ALERT( at_console, "%-32s %6s %10s %10s %10s\n", "stage", "count", "total ms", "self ms", "read Kb" );
+
+	for( i = 0; i < numstages; i++ )
+	{
+		ALERT( at_console, "%-32s %6i %10.2f %10.2f %10.1f\n", stages[i].name, stages[i].count,
+		stages[i].total * 1000.0, stages[i].self * 1000.0, stages[i].bytes / 1024.0 );
+	}
+
+	if( r_loadprofile->value >= 2.0f )
+		R_WriteLoadTrace();
+
+	r_numloadzones = 0;
+	r_loadbytes = 0;
+}
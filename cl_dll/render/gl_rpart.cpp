@@ -25,19 +25,164 @@ GNU General Public License for more details.
 #include "event_api.h"
 #include "triangleapi.h"
 #include "gl_sprite.h"
+#if defined( HAVE_SSE_MATH )
+#include <xmmintrin.h>
+#endif
 
 CQuakePartSystem	g_pParticles;
+extern playermove_t	*pmove;
+
+/*
+=================
+Integrate
 
-bool CQuakePart :: Evaluate( float gravity )
+compute current state for all the particles,
+four particles per iteration
+=================
+*/
+void CQuakePartSystem :: Integrate( float gravity )
 {
-	Vector org, org2, org3, vel;
+	quakeparts_t *p = &m_particles;
+	int count = ( m_iNumParticles + 3 ) & ~3; // arrays are padded
+	int i;
+#if defined( HAVE_SSE_MATH )
+	__m128 curtime = _mm_set1_ps( tr.time );
+	__m128 grav = _mm_set1_ps( gravity );
+
+	for( i = 0; i < count; i += 4 )
+	{
+		__m128 time = _mm_sub_ps( curtime, _mm_loadu_ps( &p->time[i] ));
+		__m128 time2 = _mm_mul_ps( time, time );
+
+		_mm_storeu_ps( &p->curAlpha[i], _mm_add_ps( _mm_loadu_ps( &p->alpha[i] ), _mm_mul_ps( _mm_loadu_ps( &p->alphaVel[i] ), time )));
+		_mm_storeu_ps( &p->curRadius[i], _mm_add_ps( _mm_loadu_ps( &p->radius[i] ), _mm_mul_ps( _mm_loadu_ps( &p->radiusVel[i] ), time )));
+		_mm_storeu_ps( &p->curLength[i], _mm_add_ps( _mm_loadu_ps( &p->length[i] ), _mm_mul_ps( _mm_loadu_ps( &p->lengthVel[i] ), time )));
+
+		for( int j = 0; j < 3; j++ )
+		{
+			__m128 accel = _mm_mul_ps( _mm_loadu_ps( &p->accel[j][i] ), time2 );
+			if( j == 2 ) accel = _mm_mul_ps( accel, grav );
+
+			__m128 org = _mm_add_ps( _mm_loadu_ps( &p->org[j][i] ), _mm_mul_ps( _mm_loadu_ps( &p->vel[j][i] ), time ));
+			_mm_storeu_ps( &p->curorg[j][i], _mm_add_ps( org, accel ));
+		}
+	}
+#else
+	for( i = 0; i < count; i++ )
+	{
+		float time = ( tr.time - p->time[i] );
+		float time2 = time * time;
+
+		p->curAlpha[i] = p->alpha[i] + p->alphaVel[i] * time;
+		p->curRadius[i] = p->radius[i] + p->radiusVel[i] * time;
+		p->curLength[i] = p->length[i] + p->lengthVel[i] * time;
+
+		p->curorg[0][i] = p->org[0][i] + p->vel[0][i] * time + p->accel[0][i] * time2;
+		p->curorg[1][i] = p->org[1][i] + p->vel[1][i] * time + p->accel[1][i] * time2;
+		p->curorg[2][i] = p->org[2][i] + p->vel[2][i] * time + p->accel[2][i] * time2 * gravity;
+	}
+#endif
+}
+
+/*
+=================
+BrushContentsPresent
+
+water brushes can override the world contents,
+leaf lookup is only valid when there are none
+=================
+*/
+static bool BrushContentsPresent( void )
+{
+	if( !pmove ) return true;
+
+	for( int i = 0; i < pmove->numphysent; i++ )
+	{
+		physent_t *pe = &pmove->physents[i];
+
+		if( pe->solid == SOLID_NOT && pe->model && pe->model->type == mod_brush )
+			return true;
+	}
+
+	for( int i = 0; i < pmove->nummoveent; i++ )
+	{
+		physent_t *pe = &pmove->moveents[i];
+
+		if( pe->solid == SOLID_NOT && pe->model && pe->model->type == mod_brush )
+			return true;
+	}
+
+	return false;
+}
+
+/*
+=================
+QueryContents
+
+batch contents queries for particles that want it
+=================
+*/
+void CQuakePartSystem :: QueryContents( void )
+{
+	quakeparts_t *p = &m_particles;
+
+	// checked once per frame, world leaf gives the same answer as POINT_CONTENTS
+	bool leafContents = ( worldmodel != NULL && !BrushContentsPresent( ));
+
+	for( int i = 0; i < m_iNumParticles; i++ )
+	{
+		if( !FBitSet( p->flags[i], FPART_UNDERWATER|FPART_FRICTION ))
+			continue;
+
+		Vector org( p->curorg[0][i], p->curorg[1][i], p->curorg[2][i] );
+
+		if( leafContents )
+		{
+			int contents = Mod_PointInLeaf( org, worldmodel->nodes )->contents;
+
+			// currents are water too, as POINT_CONTENTS does
+			if( contents <= CONTENTS_CURRENT_0 && contents >= CONTENTS_CURRENT_DOWN )
+				contents = CONTENTS_WATER;
+			p->contents[i] = contents;
+		}
+		else p->contents[i] = POINT_CONTENTS( org );
+	}
+}
+
+static void ScaleParticleVelocity( quakeparts_t *p, int index, float scale )
+{
+	for( int j = 0; j < 3; j++ )
+	{
+		p->vel[j][index] *= scale;
+		p->accel[j][index] *= scale;
+	}
+}
 
-	float time = ( tr.time - m_flTime );
-	float time2 = time * time;
+static void ResetParticle( quakeparts_t *p, int index, const Vector &org, const Vector &color, float alpha, float radius, float length )
+{
+	p->time[index] = tr.time;
+	p->color[index] = color;
+	p->alpha[index] = alpha;
+	p->radius[index] = radius;
+	p->org[0][index] = org.x;
+	p->org[1][index] = org.y;
+	p->org[2][index] = org.z;
+
+	// don't stretch
+	p->flags[index] &= ~FPART_STRETCH;
+	p->lengthVel[index] = 0.0f;
+	p->length[index] = length;
+}
+
+bool CQuakePartSystem :: EvaluateParticle( int index, float gravity )
+{
+	quakeparts_t *p = &m_particles;
+	Vector org, org2, org3, vel;
+	float time;
 
-	float curAlpha = m_flAlpha + m_flAlphaVelocity * time;
-	float curRadius = m_flRadius + m_flRadiusVelocity * time;
-	float curLength = m_flLength + m_flLengthVelocity * time;
+	float curAlpha = p->curAlpha[index];
+	float curRadius = p->curRadius[index];
+	float curLength = p->curLength[index];
 
 	if( curAlpha <= 0.0f || curRadius <= 0.0f || curLength <= 0.0f )
 	{
@@ -45,18 +190,18 @@ bool CQuakePart :: Evaluate( float gravity )
 		return false;
 	}
 
-	Vector curColor = m_vecColor + m_vecColorVelocity * time;
+	Vector curColor = p->color[index] + p->colorVel[index] * ( tr.time - p->time[index] );
 
-	org.x = m_vecOrigin.x + m_vecVelocity.x * time + m_vecAccel.x * time2;
-	org.y = m_vecOrigin.y + m_vecVelocity.y * time + m_vecAccel.y * time2;
-	org.z = m_vecOrigin.z + m_vecVelocity.z * time + m_vecAccel.z * time2 * gravity;
+	org.x = p->curorg[0][index];
+	org.y = p->curorg[1][index];
+	org.z = p->curorg[2][index];
 
-	if( FBitSet( m_iFlags, FPART_UNDERWATER ))
+	if( FBitSet( p->flags[index], FPART_UNDERWATER ))
 	{
 		// underwater particle
 		org2 = Vector( org.x, org.y, org.z + curRadius );
 
-		int contents = POINT_CONTENTS( org );
+		int contents = p->contents[index];
 
 		if( contents != CONTENTS_WATER && contents != CONTENTS_SLIME && contents != CONTENTS_LAVA )
 		{
@@ -65,10 +210,10 @@ bool CQuakePart :: Evaluate( float gravity )
 		}
 	}
 
-	if( FBitSet( m_iFlags, FPART_FRICTION ))
+	if( FBitSet( p->flags[index], FPART_FRICTION ))
 	{
 		// water friction affected particle
-		int contents = POINT_CONTENTS( org );
+		int contents = p->contents[index];
 
 		if( contents <= CONTENTS_WATER && contents >= CONTENTS_LAVA )
 		{
@@ -76,104 +221,92 @@ bool CQuakePart :: Evaluate( float gravity )
 			switch( contents )
 			{
 			case CONTENTS_WATER:
-				m_vecVelocity *= 0.25f;
-				m_vecAccel *= 0.25f;
+				ScaleParticleVelocity( p, index, 0.25f );
 				break;
 			case CONTENTS_SLIME:
-				m_vecVelocity *= 0.20f;
-				m_vecAccel *= 0.20f;
+				ScaleParticleVelocity( p, index, 0.20f );
 				break;
 			case CONTENTS_LAVA:
-				m_vecVelocity *= 0.10f;
-				m_vecAccel *= 0.10f;
+				ScaleParticleVelocity( p, index, 0.10f );
 				break;
 			}
 			
 			// don't add friction again
-			m_iFlags &= ~FPART_FRICTION;
+			p->flags[index] &= ~FPART_FRICTION;
 			curLength = 1.0f;
 				
 			// reset
-			m_flTime = tr.time;
-			m_vecColor = curColor;
-			m_flAlpha = curAlpha;
-			m_flRadius = curRadius;
-			m_vecOrigin = org;
-
-			// don't stretch
-			m_iFlags &= ~FPART_STRETCH;
-			m_flLengthVelocity = 0.0f;
-			m_flLength = curLength;
+			ResetParticle( p, index, org, curColor, curAlpha, curRadius, curLength );
 		}
 	}
 
-	if( FBitSet( m_iFlags, FPART_BOUNCE ))
+	if( FBitSet( p->flags[index], FPART_BOUNCE ))
 	{
 		// bouncy particle
 		pmtrace_t pmtrace;
 		gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
-		gEngfuncs.pEventAPI->EV_PlayerTrace( m_vecLastOrg, org, PM_STUDIO_IGNORE, -1, &pmtrace );
+		gEngfuncs.pEventAPI->EV_PlayerTrace( p->lastorg[index], org, PM_STUDIO_IGNORE, -1, &pmtrace );
 
 		if( pmtrace.fraction != 1.0f )
 		{
 			// reflect velocity
 			time = tr.time - (tr.frametime + tr.frametime * pmtrace.fraction);
-			time = (time - m_flTime);
+			time = (time - p->time[index]);
+
+			Vector velocity( p->vel[0][index], p->vel[1][index], p->vel[2][index] );
+			Vector accel( p->accel[0][index], p->accel[1][index], p->accel[2][index] );
 
-			vel.x = m_vecVelocity.x;
-			vel.y = m_vecVelocity.y;
-			vel.z = m_vecVelocity.z + m_vecAccel.z * gravity * time;
+			vel.x = velocity.x;
+			vel.y = velocity.y;
+			vel.z = velocity.z + accel.z * gravity * time;
 
 			float d = DotProduct( vel, pmtrace.plane.normal ) * 2.0f;
-			m_vecVelocity = vel - pmtrace.plane.normal * d;
-			m_vecVelocity *= bound( 0.0f, m_flBounceFactor, 1.0f );
+			velocity = vel - pmtrace.plane.normal * d;
+			velocity *= bound( 0.0f, p->bounce[index], 1.0f );
 
 			// check for stop or slide along the plane
-			if( pmtrace.plane.normal.z > 0.0f && m_vecVelocity.z < 1.0f )
+			if( pmtrace.plane.normal.z > 0.0f && velocity.z < 1.0f )
 			{
 				if( pmtrace.plane.normal.z >= 0.7f )
 				{
-					m_vecVelocity = g_vecZero;
-					m_vecAccel = g_vecZero;
-					m_iFlags &= ~FPART_BOUNCE;
+					velocity = g_vecZero;
+					accel = g_vecZero;
+					p->flags[index] &= ~FPART_BOUNCE;
 				}
 				else
 				{
 					// FIXME: check for new plane or free fall
-					float dot = DotProduct( m_vecVelocity, pmtrace.plane.normal );
-					m_vecVelocity += ( pmtrace.plane.normal * -dot );
+					float dot = DotProduct( velocity, pmtrace.plane.normal );
+					velocity += ( pmtrace.plane.normal * -dot );
 
-					dot = DotProduct( m_vecAccel, pmtrace.plane.normal );
-					m_vecAccel += ( pmtrace.plane.normal * -dot );
+					dot = DotProduct( accel, pmtrace.plane.normal );
+					accel += ( pmtrace.plane.normal * -dot );
 				}
 			}
 
+			for( int j = 0; j < 3; j++ )
+			{
+				p->vel[j][index] = velocity[j];
+				p->accel[j][index] = accel[j];
+			}
+
 			org = pmtrace.endpos;
 			curLength = 1.0f;
 
 			// reset
-			m_flTime = tr.time;
-			m_vecColor = curColor;
-			m_flAlpha = curAlpha;
-			m_flRadius = curRadius;
-			m_vecOrigin = org;
-
-			// don't stretch
-			m_iFlags &= ~FPART_STRETCH;
-			m_flLengthVelocity = 0.0f;
-			m_flLength = curLength;
+			ResetParticle( p, index, org, curColor, curAlpha, curRadius, curLength );
 		}
 	}
 	
 	// save current origin if needed
-	if( FBitSet( m_iFlags, ( FPART_BOUNCE|FPART_STRETCH )))
+	if( FBitSet( p->flags[index], ( FPART_BOUNCE|FPART_STRETCH )))
 	{
-		org2 = m_vecLastOrg;
-		m_vecLastOrg = org;
+		org2 = p->lastorg[index];
+		p->lastorg[index] = org;
 	}
 
 	// vertex lit particle
-	if( FBitSet( m_iFlags, FPART_VERTEXLIGHT ))
+	if( FBitSet( p->flags[index], FPART_VERTEXLIGHT ))
 	{
 		Vector light;
 		// gather static lighting
@@ -189,11 +322,11 @@ bool CQuakePart :: Evaluate( float gravity )
 		curColor *= light;	// multiply to diffuse
 	}
 
-	if( FBitSet( m_iFlags, FPART_INSTANT ))
+	if( FBitSet( p->flags[index], FPART_INSTANT ))
 	{
 		// instant particle
-		m_flAlphaVelocity = 0.0f;
-		m_flAlpha = 0.0f;
+		p->alphaVel[index] = 0.0f;
+		p->alpha[index] = 0.0f;
 	}
 
 	if( curRadius == 1.0f )
@@ -226,7 +359,7 @@ bool CQuakePart :: Evaluate( float gravity )
 		axis[0] = axis[0].Normalize();
 
 		org3 = org + ( axis[1] * -curLength );
-		axis[2] *= m_flRadius;
+		axis[2] *= p->radius[index];
 
 		// setup vertexes
 		verts[0] = org3 - axis[2];
@@ -236,10 +369,10 @@ bool CQuakePart :: Evaluate( float gravity )
 	}
 	else
 	{
-		if( m_flRotation )
+		if( p->rotation[index] )
 		{
 			// Rotate it around its normal
-			RotatePointAroundVector( axis[1], GetVForward(), GetVLeft(), m_flRotation );
+			RotatePointAroundVector( axis[1], GetVForward(), GetVLeft(), p->rotation[index] );
 			axis[2] = CrossProduct( GetVForward(), axis[1] );
 
 			// the normal should point at the viewer
@@ -271,16 +404,16 @@ bool CQuakePart :: Evaluate( float gravity )
 #if 0
 	GL_Blend( GL_TRUE );
 
-	if( FBitSet( m_iFlags, FPART_ADDITIVE ))
+	if( FBitSet( p->flags[index], FPART_ADDITIVE ))
 		pglBlendFunc( GL_SRC_ALPHA, GL_ONE );
 	else pglBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 
 	// draw the particle
-	GL_BindTexture( GL_TEXTURE0, m_hTexture );
+	GL_BindTexture( GL_TEXTURE0, p->texture[index] );
 
 	pglTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
 
-	if( FBitSet( m_iFlags, FPART_ADDITIVE ))
+	if( FBitSet( p->flags[index], FPART_ADDITIVE ))
 		pglColor4f( 1.0f, 1.0f, 1.0f, curAlpha );
 	else pglColor4f( curColor.x, curColor.y, curColor.z, curAlpha );
 
@@ -302,7 +435,7 @@ bool CQuakePart :: Evaluate( float gravity )
 	Vector4D partColor;
 	int rendermode;
 
-	if( FBitSet( m_iFlags, FPART_ADDITIVE ))
+	if( FBitSet( p->flags[index], FPART_ADDITIVE ))
 	{
 		partColor = Vector4D( 1.0f, 1.0f, 1.0f, curAlpha );
 		rendermode = kRenderTransAdd;
@@ -313,7 +446,7 @@ bool CQuakePart :: Evaluate( float gravity )
 		rendermode = kRenderTransTexture;
 	}
 
-	entry.SetRenderPrimitive( verts, partColor, m_hTexture, rendermode );
+	entry.SetRenderPrimitive( verts, partColor, p->texture[index], rendermode );
 	entry.ComputeViewDistance( absmin, absmax );
 	RI->frame.trans_list.AddToTail( entry );
 #endif
@@ -322,10 +455,8 @@ bool CQuakePart :: Evaluate( float gravity )
 
 CQuakePartSystem :: CQuakePartSystem( void )
 {
-	memset( m_pParticles, 0, sizeof( CQuakePart ) * MAX_PARTICLES );
-
-	m_pFreeParticles = m_pParticles;
-	m_pActiveParticles = NULL;
+	memset( &m_particles, 0, sizeof( m_particles ));
+	m_iNumParticles = 0;
 }
 
 CQuakePartSystem :: ~CQuakePartSystem( void )
@@ -334,13 +465,7 @@ CQuakePartSystem :: ~CQuakePartSystem( void )
 
 void CQuakePartSystem :: Clear( void )
 {
-	m_pFreeParticles = m_pParticles;
-	m_pActiveParticles = NULL;
-
-	for( int i = 0; i < MAX_PARTICLES; i++ )
-		m_pParticles[i].pNext = &m_pParticles[i+1];
-
-	m_pParticles[MAX_PARTICLES-1].pNext = NULL;
+	m_iNumParticles = 0;
 
 	m_pAllowParticles = CVAR_REGISTER( "cl_particles", "1", FCVAR_ARCHIVE );
 	m_pParticleLod = CVAR_REGISTER( "cl_particle_lod", "0", FCVAR_ARCHIVE );
@@ -360,7 +485,7 @@ void CQuakePartSystem :: ParsePartInfos( const char *filename )
 
 	ALERT( at_aiconsole, "loading %s\n", filename );
 
-	char *afile = (char *)gEngfuncs.COM_LoadFile( (char *)filename, 5, NULL );
+	char *afile = (char *)LOAD_FILE( filename, NULL );
 
 	if( !afile )
 	{
@@ -783,41 +908,77 @@ bool CQuakePartSystem :: ParsePartInfo( CQuakePartInfo *info, char *&pfile )
 	return true;
 }
 
-void CQuakePartSystem :: FreeParticle( CQuakePart *pCur )
-{
-	pCur->pNext = m_pFreeParticles;
-	m_pFreeParticles = pCur;
-}
+/*
+=================
+AllocParticle
 
-CQuakePart *CQuakePartSystem :: AllocParticle( void )
+returns index of new particle or -1
+=================
+*/
+int CQuakePartSystem :: AllocParticle( void )
 {
-	CQuakePart *pCur;
-
-	if( !m_pFreeParticles )
+	if( m_iNumParticles >= MAX_PARTICLES )
 	{
 		ALERT( at_console, "Overflow %d particles\n", MAX_PARTICLES );
-		return NULL;
+		return -1;
 	}
 
 	if( m_pParticleLod->value > 1.0f )
 	{
 		if( !( RANDOM_LONG( 0, 1 ) % (int)m_pParticleLod->value ))
-			return NULL;
+			return -1;
 	}
 
-	pCur = m_pFreeParticles;
-	m_pFreeParticles = pCur->pNext;
-	pCur->pNext = m_pActiveParticles;
-	m_pActiveParticles = pCur;
+	return m_iNumParticles++;
+}
+
+/*
+=================
+RemoveParticle
+
+move last particle into the hole to keep array dense
+=================
+*/
+void CQuakePartSystem :: RemoveParticle( int index )
+{
+	quakeparts_t *p = &m_particles;
+	int last = --m_iNumParticles;
+
+	if( index == last )
+		return;
 
-	return pCur;
+	p->time[index] = p->time[last];
+	p->alpha[index] = p->alpha[last];
+	p->alphaVel[index] = p->alphaVel[last];
+	p->radius[index] = p->radius[last];
+	p->radiusVel[index] = p->radiusVel[last];
+	p->length[index] = p->length[last];
+	p->lengthVel[index] = p->lengthVel[last];
+	p->lastorg[index] = p->lastorg[last];
+	p->color[index] = p->color[last];
+	p->colorVel[index] = p->colorVel[last];
+	p->rotation[index] = p->rotation[last];
+	p->bounce[index] = p->bounce[last];
+	p->texture[index] = p->texture[last];
+	p->flags[index] = p->flags[last];
+
+	// last particle is not evaluated yet so move the frame state too
+	p->curAlpha[index] = p->curAlpha[last];
+	p->curRadius[index] = p->curRadius[last];
+	p->curLength[index] = p->curLength[last];
+	p->contents[index] = p->contents[last];
+
+	for( int j = 0; j < 3; j++ )
+	{
+		p->org[j][index] = p->org[j][last];
+		p->vel[j][index] = p->vel[j][last];
+		p->accel[j][index] = p->accel[j][last];
+		p->curorg[j][index] = p->curorg[j][last];
+	}
 }
 	
 void CQuakePartSystem :: Update( void )
 {
-	CQuakePart *pCur, *pNext;
-	CQuakePart *pActive = NULL, *pTail = NULL;
-
 	if( !m_pAllowParticles->value )
 		return;
 
@@ -828,64 +989,58 @@ void CQuakePartSystem :: Update( void )
 
 	float gravity = tr.frametime * tr.gravity;
 
-	for( pCur = m_pActiveParticles; pCur != NULL; pCur = pNext )
-	{
-		// grab next now, so if the particle is freed we still have it
-		pNext = pCur->pNext;
+	Integrate( gravity );
+	QueryContents();
 
-		if( !pCur->Evaluate( gravity ))
+	for( int i = 0; i < m_iNumParticles; )
+	{
+		if( !EvaluateParticle( i, gravity ))
 		{
-			FreeParticle( pCur );
+			// last particle moved here, evaluate it now
+			RemoveParticle( i );
 			continue;
 		}
-
-		pCur->pNext = NULL;
-
-		if( !pTail )
-		{
-			pActive = pTail = pCur;
-		}
-		else
-		{
-			pTail->pNext = pCur;
-			pTail = pCur;
-		}
+		i++;
 	}
-
-	m_pActiveParticles = pActive;
 }
 
 bool CQuakePartSystem :: AddParticle( CQuakePart *src, int texture, int flags )
 {
 	if( !src ) return false;
 
-	CQuakePart *dst = AllocParticle();
+	int dst = AllocParticle();
+
+	if( dst == -1 ) return false;
 
-	if( !dst ) return false;
+	quakeparts_t *p = &m_particles;
 
-	if( texture ) dst->m_hTexture = texture;
-	else dst->m_hTexture = m_hDefaultParticle;
-	dst->m_flTime = tr.time;
-	dst->m_iFlags = flags;
+	if( texture ) p->texture[dst] = texture;
+	else p->texture[dst] = m_hDefaultParticle;
+	p->time[dst] = tr.time;
+	p->flags[dst] = flags;
+
+	for( int j = 0; j < 3; j++ )
+	{
+		p->org[j][dst] = src->m_vecOrigin[j];
+		p->vel[j][dst] = src->m_vecVelocity[j];
+		p->accel[j][dst] = src->m_vecAccel[j];
+	}
 
-	dst->m_vecOrigin = src->m_vecOrigin;
-	dst->m_vecVelocity = src->m_vecVelocity;
-	dst->m_vecAccel = src->m_vecAccel; 
-	dst->m_vecColor = src->m_vecColor;
-	dst->m_vecColorVelocity = src->m_vecColorVelocity;
-	dst->m_flAlpha = src->m_flAlpha;
+	p->color[dst] = src->m_vecColor;
+	p->colorVel[dst] = src->m_vecColorVelocity;
+	p->alpha[dst] = src->m_flAlpha;
 
-	dst->m_flRadius = src->m_flRadius;
-	dst->m_flLength = src->m_flLength;
-	dst->m_flRotation = src->m_flRotation;
-	dst->m_flAlphaVelocity = src->m_flAlphaVelocity;
-	dst->m_flRadiusVelocity = src->m_flRadiusVelocity;
-	dst->m_flLengthVelocity = src->m_flLengthVelocity;
-	dst->m_flBounceFactor = src->m_flBounceFactor;
+	p->radius[dst] = src->m_flRadius;
+	p->length[dst] = src->m_flLength;
+	p->rotation[dst] = src->m_flRotation;
+	p->alphaVel[dst] = src->m_flAlphaVelocity;
+	p->radiusVel[dst] = src->m_flRadiusVelocity;
+	p->lengthVel[dst] = src->m_flLengthVelocity;
+	p->bounce[dst] = src->m_flBounceFactor;
 
 	// needs to save old origin
 	if( FBitSet( flags, ( FPART_BOUNCE|FPART_FRICTION )))
-		dst->m_vecLastOrg = dst->m_vecOrigin;
+		p->lastorg[dst] = src->m_vecOrigin;
 
 	return true;
 }
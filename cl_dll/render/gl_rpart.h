@@ -19,7 +19,7 @@ GNU General Public License for more details.
 
 #include "randomrange.h"
 
-#define MAX_PARTICLES		8192
+#define MAX_PARTICLES		16384	// must be multiple of 4
 #define MAX_PARTINFOS		256	// various types of part-system
 
 // built-in particle-system flags
@@ -32,12 +32,11 @@ GNU General Public License for more details.
 #define FPART_ADDITIVE		(1<<6)
 #define FPART_NOTWATER		(1<<7)	// don't spawn in water
 
+// particle template to spawn
 class CQuakePart
 {
 public:
 	Vector		m_vecOrigin;	// position for current frame
-	Vector		m_vecLastOrg;	// position from previous frame
-
 	Vector		m_vecVelocity;	// linear velocity
 	Vector		m_vecAccel;
 	Vector		m_vecColor;
@@ -50,16 +49,41 @@ public:
 	float		m_flLengthVelocity;
 	float		m_flRotation;	// texture ROLL angle
 	float		m_flBounceFactor;
-
-	CQuakePart	*pNext;		// linked list
-	int		m_hTexture;
-
-	float		m_flTime;
-	int		m_iFlags;
-
-	bool		Evaluate( float gravity );
 };
 
+// active particles stored as structure of arrays
+// to integrate four of them at once
+typedef struct
+{
+	// kinematics
+	float		time[MAX_PARTICLES];	// spawn or last reset time
+	float		org[3][MAX_PARTICLES];
+	float		vel[3][MAX_PARTICLES];
+	float		accel[3][MAX_PARTICLES];
+	float		alpha[MAX_PARTICLES];
+	float		alphaVel[MAX_PARTICLES];
+	float		radius[MAX_PARTICLES];
+	float		radiusVel[MAX_PARTICLES];
+	float		length[MAX_PARTICLES];
+	float		lengthVel[MAX_PARTICLES];
+
+	// rarely used
+	Vector		lastorg[MAX_PARTICLES];
+	Vector		color[MAX_PARTICLES];
+	Vector		colorVel[MAX_PARTICLES];
+	float		rotation[MAX_PARTICLES];
+	float		bounce[MAX_PARTICLES];
+	int		texture[MAX_PARTICLES];
+	int		flags[MAX_PARTICLES];
+
+	// computed each frame by CQuakePartSystem::Integrate
+	float		curorg[3][MAX_PARTICLES];
+	float		curAlpha[MAX_PARTICLES];
+	float		curRadius[MAX_PARTICLES];
+	float		curLength[MAX_PARTICLES];
+	int		contents[MAX_PARTICLES];
+} quakeparts_t;
+
 typedef enum
 {
 	NORMAL_IGNORE = 0,
@@ -98,9 +122,8 @@ public:
 
 class CQuakePartSystem
 {
-	CQuakePart	*m_pActiveParticles;
-	CQuakePart	*m_pFreeParticles;
-	CQuakePart	m_pParticles[MAX_PARTICLES];
+	quakeparts_t	m_particles;
+	int		m_iNumParticles;
 
 	CQuakePartInfo	m_pPartInfo[MAX_PARTINFOS];
 	int		m_iNumPartInfo;
@@ -119,8 +142,11 @@ public:
 
 	void		Clear( void );
 	void		Update( void );
-	void		FreeParticle( CQuakePart *pCur );
-	CQuakePart	*AllocParticle( void );
+	int		AllocParticle( void );
+	void		RemoveParticle( int index );
+	void		Integrate( float gravity );
+	void		QueryContents( void );
+	bool		EvaluateParticle( int index, float gravity );
 	bool		AddParticle( CQuakePart *src, int texture = 0, int flags = 0 );
 	void		ParsePartInfos( const char *filename );
 	bool		ParsePartInfo( CQuakePartInfo *info, char *&pfile );
@@ -200,6 +200,7 @@ void R_CheckChanges( void )
 		{
 			for( int i = 0; i < worldmodel->numsurfaces; i++ )
 				SetBits( worldmodel->surfaces[i].flags, SURF_LM_UPDATE|SURF_GRASS_UPDATE );
+			R_InvalidateLightmapPages( LM_DIRTY_LIGHTMAP );
 		}
 		R_StudioClearLightCache();
 	}
@@ -37,6 +37,8 @@ glsl_program_t	*glsl_programsHashTable[SHADERS_HASH_SIZE];
 int		num_glsl_programs;
 static int	file_stack_pos;
 static bool	cache_needs_update = false;
+static int	shader_registration = 1;
+static bool	manifest_needs_update = false;
 
 typedef struct
 {
@@ -100,6 +102,45 @@ int uniform_t :: GetSizeInBytes( void )
 	return 0; // assume error
 }
 
+/*
+=================
+UpdateShadow
+
+compare the values with shadow copy, returns count
+of elements that should be uploaded (0 if nothing was changed)
+=================
+*/
+int uniform_t :: UpdateShadow( const void *pdata, int count )
+{
+	const byte	*src = (const byte *)pdata;
+	int		elemSize = GetSizeInBytes();
+	int		i;
+
+	if( elemSize <= 0 ) return count;
+
+	if( !shadow )
+	{
+		shadow = (byte *)Mem_Alloc( size * elemSize );
+		numShadow = 0;
+	}
+
+	count = Q_min( count, size );
+
+	// find the last changed element, the head of array is always uploaded
+	for( i = count - 1; i >= 0; i-- )
+	{
+		if( i >= numShadow || memcmp( shadow + i * elemSize, src + i * elemSize, elemSize ))
+			break;
+	}
+
+	if( i < 0 ) return 0; // unchanged
+
+	memcpy( shadow, src, ( i + 1 ) * elemSize );
+	numShadow = Q_max( numShadow, i + 1 );
+
+	return i + 1;
+}
+
 void uniform_t :: SetValue( const void *pdata, int count )
 {
 	unicache_t *check = (unicache_t *)pdata;
@@ -109,12 +150,20 @@ void uniform_t :: SetValue( const void *pdata, int count )
 	{
 		GL_BindTexture( unit, check->iValue[0] );
 	}
-	else if( size > 1 )
+	else if( size > 1 || format == GL_FLOAT_MAT3_ARB || format == GL_FLOAT_MAT4_ARB )
 	{
-		// handle arrays
+		// handle arrays and matrices
 		if( count == -1 )
 			count = size;
 
+		if(( count = UpdateShadow( pdata, count )) == 0 )
+		{
+			r_stats.num_uniform_skips++;
+			return;
+		}
+
+		r_stats.num_uniform_uploads++;
+
 		switch( format )
 		{
 		case GL_FLOAT:
@@ -146,7 +195,12 @@ void uniform_t :: SetValue( const void *pdata, int count )
 
 		// some values could be cached
 		if( testSize <= 16 && !memcmp( &cache, check, testSize ))
+		{
+			r_stats.num_uniform_skips++;
 			return;
+		}
+
+		r_stats.num_uniform_uploads++;
 
 		// single cached values
 		switch( format )
@@ -202,12 +256,6 @@ void uniform_t :: SetValue( const void *pdata, int count )
 			cache.fValue[2] = check->fValue[2];
 			cache.fValue[3] = check->fValue[3];
 			break;
-		case GL_FLOAT_MAT3_ARB:
-			pglUniformMatrix3fvARB( location, 1, GL_FALSE, (const float *)pdata );
-			break;
-		case GL_FLOAT_MAT4_ARB:
-			pglUniformMatrix4fvARB( location, 1, GL_FALSE, (const float *)pdata );
-			break;
 		}
 	}
 }
@@ -401,7 +449,7 @@ static bool GL_TestSource( const char *szFilename, const char *szCacheName, CVir
 	}
 
 	int size;
-	char *source = (char *)gEngfuncs.COM_LoadFile((char *)szFilename, 5, &size );
+	char *source = (char *)LOAD_FILE( szFilename, &size );
 	if( !source ) return false;
 
 	GL_PushFileStack( szFilename );
@@ -468,7 +516,7 @@ static bool GL_LoadSource( const char *filename, CVirtualFS *file )
 	}
 
 	int size;
-	char *source = (char *)gEngfuncs.COM_LoadFile((char *)filename, 5, &size );
+	char *source = (char *)LOAD_FILE( filename, &size );
 	if( !source )
 	{
 		ALERT( at_error, "couldn't load %s\n", filename );
@@ -1029,6 +1077,11 @@ static void GL_FreeGPUShader( glsl_program_t *shader )
 		find = va( "%s %s", shader->name, shader->options );
 		if( shader->uniforms != NULL )
 		{
+			for( int i = 0; i < shader->numUniforms; i++ )
+			{
+				if( shader->uniforms[i].shadow )
+					Mem_Free( shader->uniforms[i].shadow );
+			}
 			Mem_Free( shader->uniforms );
 			shader->uniforms = NULL;
 		}
@@ -1057,6 +1110,7 @@ static void GL_FreeGPUShader( glsl_program_t *shader )
 
 static glsl_program_t *GL_CreateUberShader( GLint slot, const char *glname, const char *vpname, const char *fpname, const char *options, uint checksum )
 {
+	LOAD_ZONE_DETAIL( "GL_CreateUberShader", glname );
 	if( !GL_Support( R_SHADER_GLSL100_EXT ))
 		return NULL;
 
@@ -1074,6 +1128,8 @@ static glsl_program_t *GL_CreateUberShader( GLint slot, const char *glname, cons
 
 	Q_strncpy( shader->name, glname, sizeof( shader->name ));
 	Q_strncpy( shader->options, options, sizeof( shader->options ));
+	if( vpname ) Q_strncpy( shader->vpname, vpname, sizeof( shader->vpname ));
+	if( fpname ) Q_strncpy( shader->fpname, fpname, sizeof( shader->fpname ));
 
 	if( !GL_LoadGPUBinaryShader( shader, vpname, fpname, checksum ))
 	{
@@ -1143,7 +1199,13 @@ word GL_FindUberShader( const char *glname, const char *options )
 	for( prog = glsl_programsHashTable[hash]; prog != NULL; prog = prog->nextHash )
 	{
 		if( !Q_strcmp( prog->name, glname ) && !Q_strcmp( prog->options, options ))
+		{
+			// reused from the previous map and not listed in the manifest
+			if( prog->registration != shader_registration )
+				manifest_needs_update = true;
+			prog->registration = shader_registration;
 			return (word)(prog - glsl_programs);
+		}
 	}
 
 	int i;
@@ -1165,6 +1227,8 @@ word GL_FindUberShader( const char *glname, const char *options )
 		// add to hash table
 		prog->nextHash = glsl_programsHashTable[hash];
 		glsl_programsHashTable[hash] = prog;
+		prog->registration = shader_registration;
+		manifest_needs_update = true;
 	}
 
 	return (word)(prog - glsl_programs);
@@ -1186,7 +1250,13 @@ word GL_FindShader( const char *glname, const char *vpname, const char *fpname,
 	for( prog = glsl_programsHashTable[hash]; prog != NULL; prog = prog->nextHash )
 	{
 		if( !Q_strcmp( prog->name, glname ) && !Q_strcmp( prog->options, options ))
+		{
+			// reused from the previous map and not listed in the manifest
+			if( prog->registration != shader_registration )
+				manifest_needs_update = true;
+			prog->registration = shader_registration;
 			return (word)(prog - glsl_programs);
+		}
 	}
 
 	int i;
@@ -1208,6 +1278,8 @@ word GL_FindShader( const char *glname, const char *vpname, const char *fpname,
 		// add to hash table
 		prog->nextHash = glsl_programsHashTable[hash];
 		glsl_programsHashTable[hash] = prog;
+		prog->registration = shader_registration;
+		manifest_needs_update = true;
 	}
 
 	return (word)(prog - glsl_programs);
@@ -1313,6 +1385,199 @@ void GL_ListGPUShaders( void )
 	Msg( "total %i shaders\n", count );
 }
 
+/*
+=================
+GL_WriteShaderManifest
+
+write all the shaders that was requested by
+current map into cache/glsl/maps/<mapname>.lst
+=================
+*/
+static bool GL_WriteShaderManifest( const char *mapname )
+{
+	char		szFilename[MAX_PATH];
+	char		directive[MAX_OPTIONS_LENGTH];
+	char		options[MAX_OPTIONS_LENGTH];
+	const char	*pstart, *pend;
+	CVirtualFS	file;
+	int		count = 0;
+
+	Q_snprintf( szFilename, sizeof( szFilename ), "cache/glsl/maps/%s.lst", mapname );
+	file.Printf( "// shader permutations used by %s\n", mapname );
+	file.Printf( "// <name> <vertex program> <fragment program> <numdirectives> [directives]\n\n" );
+
+	for( int i = 1; i < num_glsl_programs; i++ )
+	{
+		glsl_program_t *cur = &glsl_programs[i];
+
+		if( !cur->name[0] || cur->registration != shader_registration )
+			continue;
+
+		if( !FBitSet( cur->status, SHADER_PROGRAM_LINKED ))
+			continue; // don't cache broken shaders
+
+		CVirtualFS list;
+		int numdirectives = 0;
+
+		options[0] = '\0';
+		pstart = cur->options;
+
+		// split options back to the directives
+		while( *pstart )
+		{
+			if( Q_strncmp( pstart, "#define ", 8 ))
+				break;
+
+			pstart += 8;
+			pend = Q_strstr( pstart, "\n" );
+			if( !pend ) break;
+
+			Q_strncpy( directive, pstart, Q_min( (int)( pend - pstart ) + 1, (int)sizeof( directive )));
+			GL_AddShaderDirective( options, directive );
+			list.Printf( " \"%s\"", directive );
+			pstart = pend + 1;
+			numdirectives++;
+		}
+
+		// options that can't be restored by GL_AddShaderDirective
+		if( Q_strcmp( options, cur->options ))
+			continue;
+
+		file.Printf( "\"%s\" \"%s\" \"%s\" %i", cur->name, cur->vpname[0] ? cur->vpname : "*",
+		cur->fpname[0] ? cur->fpname : "*", numdirectives );
+		if( list.GetSize() > 0 )
+			file.Write( list.GetBuffer(), list.GetSize( ));
+		file.Printf( "\n" );
+		count++;
+	}
+
+	if( !count ) return false;
+
+	if( !SAVE_FILE( szFilename, file.GetBuffer(), file.GetSize( )))
+		return false;
+
+	ALERT( at_aiconsole, "write shader manifest: %s (%i shaders)\n", szFilename, count );
+
+	return true;
+}
+
+/*
+=================
+GL_PrecacheShaderManifest
+
+compile all the permutations that was used by
+this map last time to avoid freezes in-game.
+Program binaries are picked up from glsl cache
+=================
+*/
+void GL_PrecacheShaderManifest( const char *mapname )
+{
+	LOAD_ZONE( "GL_PrecacheShaderManifest" );
+	char	szFilename[MAX_PATH];
+	char	glname[64], vpname[64], fpname[64];
+	char	options[MAX_OPTIONS_LENGTH];
+	char	token[256];
+	int	i, numdirectives;
+	int	count = 0;
+	char	*afile, *pfile;
+
+	// begin a new map registration
+	shader_registration++;
+	manifest_needs_update = false;
+
+	if( !GL_Support( R_SHADER_GLSL100_EXT ))
+		return;
+
+	Q_snprintf( szFilename, sizeof( szFilename ), "cache/glsl/maps/%s.lst", mapname );
+	afile = (char *)LOAD_FILE( szFilename, NULL );
+
+	if( !afile )
+	{
+		manifest_needs_update = true; // create it
+		return;
+	}
+
+	double start = Sys_DoubleTime();
+	pfile = afile;
+
+	while(( pfile = COM_ParseFile( pfile, token )) != NULL )
+	{
+		Q_strncpy( glname, token, sizeof( glname ));
+		pfile = COM_ParseFile( pfile, token );
+		Q_strncpy( vpname, token, sizeof( vpname ));
+		pfile = COM_ParseFile( pfile, token );
+		Q_strncpy( fpname, token, sizeof( fpname ));
+		pfile = COM_ParseFile( pfile, token );
+		numdirectives = Q_atoi( token );
+
+		if( !pfile || !glname[0] )
+			break; // corrupted
+
+		options[0] = '\0';
+
+		for( i = 0; i < numdirectives; i++ )
+		{
+			pfile = COM_ParseFile( pfile, token );
+			if( !pfile ) break;
+			GL_AddShaderDirective( options, token );
+		}
+
+		if( i != numdirectives )
+			break; // corrupted
+
+		if( !Q_strcmp( glname, vpname ) && !Q_strcmp( glname, fpname ))
+			GL_FindUberShader( glname, options );
+		else GL_FindShader( glname, Q_strcmp( vpname, "*" ) ? vpname : NULL, Q_strcmp( fpname, "*" ) ? fpname : NULL, options );
+		count++;
+	}
+
+	FREE_FILE( afile );
+
+	// nothing was changed while loading it
+	manifest_needs_update = false;
+
+	ALERT( at_aiconsole, "precached %i shaders from %s (%g secs)\n", count, szFilename, Sys_DoubleTime() - start );
+}
+
+/*
+=================
+GL_SaveShaderManifest
+
+called on map unload
+=================
+*/
+void GL_SaveShaderManifest( const char *mapname )
+{
+	if( !GL_Support( R_SHADER_GLSL100_EXT ))
+		return;
+
+	if( !manifest_needs_update || !mapname || !*mapname )
+		return;
+
+	GL_WriteShaderManifest( mapname );
+	manifest_needs_update = false;
+}
+
+/*
+=================
+GL_ShaderManifest_f
+
+force to write manifest for current map
+=================
+*/
+void GL_ShaderManifest_f( void )
+{
+	if( !worldmodel || !world->name[0] )
+	{
+		Msg( "no map loaded\n" );
+		return;
+	}
+
+	if( !GL_WriteShaderManifest( world->name ))
+		Msg( "no shaders to write\n" );
+	else manifest_needs_update = false;
+}
+
 void GL_InitGPUShaders( void )
 {
 	char options[MAX_OPTIONS_LENGTH];
@@ -1324,6 +1589,7 @@ void GL_InitGPUShaders( void )
 		return;
 
 	ADD_COMMAND( "shaderlist", GL_ListGPUShaders );
+	ADD_COMMAND( "shadermanifest", GL_ShaderManifest_f );
 
 	// init sky shaders
 	GL_SetShaderDirective( options, "SKYBOX_DAYTIME" );
@@ -189,6 +189,8 @@ public:
 	int		unit;	// texture unit
 	int		flags;	// hints
 	unicache_t	cache;
+	byte		*shadow;	// last uploaded values for arrays and matrices
+	int		numShadow;	// count of valid elements in shadow
 
 	// helpers
 	void SetValue( float v0 )
@@ -242,12 +244,17 @@ public:
 	// passed any data here
 	void SetValue( const void *pdata, int count = -1 );
 	int GetSizeInBytes( void );
+private:
+	int UpdateShadow( const void *pdata, int count );
 };
 
 typedef struct glsl_prog_s
 {
 	char		name[64];
+	char		vpname[64];			// empty if not used
+	char		fpname[64];			// empty if not used
 	char		options[MAX_OPTIONS_LENGTH];	// UberShader preprocess agrs
+	int		registration;		// last map where shader was requested
 	GLhandleARB	handle;
 	unsigned short	status;
 	struct glsl_prog_s	*nextHash;
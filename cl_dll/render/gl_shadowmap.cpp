@@ -35,45 +35,19 @@ GNU General Public License for more details.
 static void SM_InitBlock( void )
 {
 	gl_shadowmap_t *sms = &tr.shadowmap;
-	memset( sms->allocated, 0, sizeof( sms->allocated ));
+	R_InitAtlas( &sms->atlas, SHADOW_SIZE, SHADOW_SIZE );
 	sms->shadowmap.Init( FBO_DEPTH, SHADOW_SIZE, SHADOW_SIZE );
 }
 
 static int SM_AllocBlock( unsigned short w, unsigned short h, unsigned short *x, unsigned short *y )
 {
 	gl_shadowmap_t	*sms = &tr.shadowmap;
-	unsigned short	i, j, best, best2;
 
-	best = SHADOW_SIZE;
+	// atlas is not initialized yet
+	if( !sms->atlas.numnodes )
+		R_InitAtlas( &sms->atlas, SHADOW_SIZE, SHADOW_SIZE );
 
-	for( i = 0; i < SHADOW_SIZE - w; i++ )
-	{
-		best2 = 0;
-
-		for( j = 0; j < w; j++ )
-		{
-			if( sms->allocated[i+j] >= best )
-				break;
-			if( sms->allocated[i+j] > best2 )
-				best2 = sms->allocated[i+j];
-		}
-
-		if( j == w )
-		{	
-			// this is a valid spot
-			*x = i;
-			*y = best = best2;
-		}
-	}
-
-	// atlas is full
-	if( best + h > SHADOW_SIZE )
-		return false;
-
-	for( i = 0; i < w; i++ )
-		sms->allocated[*x + i] = best + h;
-
-	return true;
+	return R_AllocAtlasBlock( &sms->atlas, w, h, x, y );
 }
 
 /*
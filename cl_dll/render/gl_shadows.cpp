@@ -396,6 +396,9 @@ static void R_ShadowPassSetupViewCache( CDynLight *pl, int split = 0 )
 		}
 	}
 
+	// frustum culling for world faces is batched
+	R_CullWorldFaces( &RI->view.frustum );
+
 	// create drawlist for faces, do additional culling for world faces
 	for( i = 0; i < world->numsortedfaces; i++ )
 	{
@@ -428,7 +431,7 @@ static void R_ShadowPassSetupViewCache( CDynLight *pl, int split = 0 )
 
 				R_AddGrassToDrawList( surf, DRAWLIST_SHADOW );
 
-				if( R_CullSurface( surf, GetVieworg(), &RI->view.frustum ))
+				if( R_CullSurface( surf, GetVieworg(), NULL ) || CHECKVISBIT( world->culledfaces, j ))
 				{
 					CLEARVISBIT( RI->view.visfaces, j ); // not visible
 					continue;
@@ -442,6 +445,10 @@ static void R_ShadowPassSetupViewCache( CDynLight *pl, int split = 0 )
 			}
 		}
 	}
+
+	// sorting list to reduce state switches
+	if( !CVAR_TO_BOOL( cv_nosort ))
+		R_SortDrawList( RI->frame.solid_faces );
 }
 
 /*
@@ -589,6 +596,7 @@ void R_RenderShadowCubeSide( CDynLight *pl, int side )
 void R_RenderShadowmaps( void )
 {
 	unsigned int	oldFBO;
+	PROF_SCOPE( "R_RenderShadowmaps" );
 
 	if( R_FullBright() || !CVAR_TO_BOOL( r_shadows ) || tr.fGamePaused )
 		return;
@@ -326,6 +326,7 @@ void R_DrawSkyBox( void )
 	float	fogDenstity = tr.fogDensity;
 	word	hSkyShader = 0;
 	int	i;
+	PROF_SCOPE( "R_DrawSkyBox" );
 
 	if( !FBitSet( RI->view.flags, RF_SKYVISIBLE ))
 		return;
@@ -29,6 +29,7 @@ GNU General Public License for more details.
 #include "ikcontext.h"
 #include "jigglebones.h"
 #include "tbnfile.h"
+#include "jobs.h"
 
 #define EVENT_CLIENT	5000		// less than this value it's a server-side studio events
 #define MAX_MODEL_MESHES	(MAXSTUDIOBODYPARTS * MAXSTUDIOMODELS)
@@ -111,6 +112,35 @@ typedef struct xvert_s
 	word		m_MeshVertexIndex;		// index into the mesh's vertex list (decals only)
 } svert_t;
 
+// triangle hierarchy node for decal projection
+typedef struct
+{
+	Vector		mins, maxs;		// bounds in the vertex space of bone
+	int		bone;			// all the triangles is rigidly attached to this bone, -1 if not
+	int		firstelem;		// leaf only
+	int		numelems;			// 0 for inner nodes
+	int		children[2];
+} mstudiodecalnode_t;
+
+typedef struct
+{
+	int		firstelem;
+	int		numelems;
+	int		rootnode;			// -1 for empty mesh
+} mstudiodecalmesh_t;
+
+// submodel vertices in bind pose, built once on first decal
+typedef struct mstudiodecalcache_s
+{
+	svert_t		*verts;			// vertex lighting is applied per instance
+	int		numverts;
+	unsigned int	*elems;			// triangles sorted by hierarchy leafs
+	int		numelems;
+	mstudiodecalmesh_t	*meshes;			// msubmodel_t->nummesh
+	mstudiodecalnode_t	*nodes;
+	int		numnodes;
+} mstudiodecalcache_t;
+
 typedef void (*pfnCreateStudioBuffer)( vbomesh_t *pOut, svert_t *arrayxvert );
 typedef void (*pfnBindStudioBuffer)( vbomesh_t *pOut, int attrFlags );
 
@@ -178,12 +208,27 @@ private:
 	// Set up model bone positions
 	void StudioSetupBones( void );	
 
+	// Split bone setup (main thread part and thread-safe part)
+	struct StudioBoneJob_t;
+	bool StudioPrepareBones( StudioBoneJob_t *job );
+	void StudioBuildBones( CStudioBoneSetup *boneSetup, const StudioBoneJob_t *job, CIKContext *pIK );
+	bool StudioAllowBoneJob( void );
+	static void StudioBoneJob( void *context, int current, int threadnum );
+	static void CullMeshesForLightJob( void *context, int current, int threadnum );
+	void StudioUpdateAnimCache( bool flush );
+	void FinishFollowEntities( void );
+
+	// Finalize bones for current frame
+	void StudioFinishBones( void );
+
+	void StudioAddMeshesToDrawList( bool update );
+
 	// Find final attachment points
 	void StudioCalcAttachments( matrix3x4 bones[] );
 
 	void AddBlendSequence( int oldseq, int newseq, float prevframe, bool gaitseq = false );
 
-	void BlendSequence( Vector pos[], Vector4D q[], mstudioblendseq_t *pseqblend );
+	void BlendSequence( CStudioBoneSetup *boneSetup, Vector pos[], Vector4D q[], mstudioblendseq_t *pseqblend, CIKContext *pIK );
 
 	void UpdateIKLocks( CIKContext *pIK );
 
@@ -325,6 +370,7 @@ private:
 		// Need to store off the model. When it changes, we lose all instance data..
 		model_t			*m_pModel;
 		StudioDecalList_t		m_DecalList;	// new decal list for each instance
+		studiodecalbuffer_t		m_DecalBuffers[MESHLOADER_COUNT];	// decals suballocated by vertex format
 		int			m_DecalCount;	// just used as timestamp for calculate decal depth
 		int			info_flags;
 
@@ -392,6 +438,24 @@ private:
 		unsigned int		visframe;				// model is visible this frame
 	};
 
+	// deferred bone setup, filled by main thread and computed by job system
+	struct StudioBoneJob_t
+	{
+		cl_entity_t		*entity;
+		int			modelhandle;	// instances may be reallocated until FinishBoneJobs
+		studiohdr_t		*header;
+		float			cycle;
+		float			gaitcycle;	// valid if gaitsequence != 0
+		bool			update;		// called from AddStudioModelToDrawList with update flag
+	};
+
+	// attached entity that waits for parent bones
+	struct StudioFollowEntity_t
+	{
+		cl_entity_t		*entity;
+		bool			update;
+	};
+
 	struct DecalBuildInfo_t
 	{
 		// this part is constant all time while decal is build
@@ -410,11 +474,16 @@ private:
 
 		// this part is changed for each mesh
 		vbomesh_t*		m_pModelMesh;
-		StudioMesh_t*		m_pDecalMesh;
+		mstudiodecalcache_t*	m_pDecalCache;
+		mstudiodecalmesh_t*		m_pDecalMesh;
 		dvertlight_t*		m_pVertexLight;
 		DecalVertexInfo_t*		m_pVertexInfo;
 		CUtlArray<svert_t>		m_Vertices;
 		CUtlArray<unsigned int>	m_Indices;
+
+		// search for clipped vertices
+		int			m_VertexHash[DECAL_VERTEX_HASH_SIZE];
+		CUtlArray<int>		m_VertexHashChain;
 	};
 
 	// keep model instances for each entity
@@ -425,7 +494,13 @@ private:
 	void AddDecalToModel( DecalBuildInfo_t& buildInfo );
 	void AddDecalToMesh( DecalBuildInfo_t& buildInfo );
 	void AllocDecalForMesh( DecalBuildInfo_t& build );
-	void ProjectDecalOntoMesh( DecalBuildInfo_t& build );
+	void ProjectDecalVertex( DecalBuildInfo_t& build, int vertIndex );
+	mstudiodecalcache_t *CreateDecalCache( void );
+	void AddDecalToNode( DecalBuildInfo_t& build, int nodenum );
+	bool DecalIntersectNode( DecalBuildInfo_t& build, const mstudiodecalnode_t *node );
+	bool AllocDecalSpace( studiodecal_t *pDecal, int type, unsigned int attribs );
+	void DeleteDecalMesh( studiodecal_t *pDecal );
+	void DrawDecalFromBuffer( const studiodecal_t *pDecal );
 	bool IsFrontFacing( const svert_t *vert );
 	void DecalCreateBuffer( DecalBuildInfo_t& build, studiodecal_t *pDecal );
 	bool TransformToDecalSpace( DecalBuildInfo_t& build, const svert_t *vert, Vector2D& uv );
@@ -508,17 +583,20 @@ private:
 	static void BindBufferGenericGL21( vbomesh_t *pOut, int attrFlags );
 	static void BindBufferGenericGL30( vbomesh_t *pOut, int attrFlags );
 
+	static void CreateVertexBuffer( vbomesh_t *pOut, const void *arraysvert );
 	static void CreateIndexBuffer( vbomesh_t *pOut, unsigned int *arrayelems );
 	static void BindIndexBuffer( vbomesh_t *pOut );
 
-	static int SortSolidMeshes( const CSolidEntry *a, const CSolidEntry *b );
-
 	unsigned int ComputeAttribFlags( int numbones, bool has_bumpmap, bool has_boneweights, bool has_vertexlight, bool has_lightmap );
 	unsigned int SelectMeshLoader( int numbones, bool has_bumpmap, bool has_boneweights, bool has_vertexlight, bool has_lightmap );
 
 	static mesh_loader_t	m_pfnMeshLoaderGL21[MESHLOADER_COUNT];
 	static mesh_loader_t	m_pfnMeshLoaderGL30[MESHLOADER_COUNT];
 
+	// target for decal that placed into shared buffer
+	static studiodecalbuffer_t	*m_pDecalBuffer;
+	static int		m_iDecalFirstVert;
+
 	bool			m_fShootDecal;	// disable all interpolations and bonecache
 	float			m_flViewmodelFov;	// custom fov for viewmodel
 	int			m_iDrawModelType;	// various modes of rendering
@@ -534,9 +612,22 @@ private:
 	cvar_t			*m_pCvarCompatible;
 	cvar_t			*m_pCvarLodScale;
 	cvar_t			*m_pCvarLodBias;
+	cvar_t			*m_pCvarBoneJobs;
+	cvar_t			*m_pCvarAnimCache;
 
 	CBaseBoneSetup		m_boneSetup;
 
+	// parallel bone setup
+	CUtlArray<StudioBoneJob_t>	m_BoneJobs;
+	CUtlArray<StudioFollowEntity_t>	m_FollowEntities;	// merged after deferred parents
+	CStudioBoneSetup		*m_pJobBoneSetup[MAX_JOB_THREADS];	// one per thread
+	bool			m_fDeferBones;
+
+	// parallel light lists culling
+	CDynLight			*m_pLightJobs[MAX_DLIGHTS];
+	CUtlArray<int>		m_LightMeshes[MAX_DLIGHTS];	// meshes that interact with each light
+	bool			m_fLightJobsSolid;
+
 	// current mesh material
 	mstudiomaterial_t		*m_pCurrentMaterial;
 
@@ -600,6 +691,10 @@ public:
 
 	void	AddStudioModelToDrawList( cl_entity_t *e, bool update = false );
 
+	// collect visible entities and compute their bones in parallel
+	void	BeginBoneJobs( void );
+	void	FinishBoneJobs( void );
+
 	void	StudioGetAttachment( const cl_entity_t *ent, int iAttachment, Vector *pos, Vector *ang, Vector *dir );
 
 	// Process viewmodel events (at start the frame so muzzleflashes will be correct added)
@@ -627,7 +722,7 @@ public:
 
 	void	RenderTransMesh( CTransEntry *entry );
 
-	void	BuildMeshListForLight( CDynLight *pl, bool solid );
+	void	BuildMeshListForLight( CDynLight *pl, bool solid, const CUtlArray<int> &meshes );
 
 	void	DrawLightForMeshList( CDynLight *pl );
 
@@ -703,6 +798,16 @@ inline void R_AddStudioToDrawList( cl_entity_t *e, bool update = false )
 	g_StudioRenderer.AddStudioModelToDrawList( e, update );
 }
 
+inline void R_BeginStudioBoneJobs( void )
+{
+	g_StudioRenderer.BeginBoneJobs();
+}
+
+inline void R_FinishStudioBoneJobs( void )
+{
+	g_StudioRenderer.FinishBoneJobs();
+}
+
 inline void R_StudioClearLightCache( void )
 {
 	g_StudioRenderer.ClearLightCache();
@@ -29,27 +29,11 @@ GNU General Public License for more details.
 #include "entity_types.h"
 #include "gl_shader.h"
 #include "gl_world.h"
+#include "jobs.h"
 
 #define LIGHT_INTERP_UPDATE	0.1f
 #define LIGHT_INTERP_FACTOR	(1.0f / LIGHT_INTERP_UPDATE)
 
-/*
-=================
-SortSolidMeshes
-
-sort by shaders to reduce state switches
-=================
-*/
-int CStudioModelRenderer :: SortSolidMeshes( const CSolidEntry *a, const CSolidEntry *b )
-{
-	if( a->m_hProgram > b->m_hProgram )
-		return -1;
-	if( a->m_hProgram < b->m_hProgram )
-		return 1;
-
-	return 0;
-}
-
 /*
 ================
 HeadShieldThink
@@ -765,19 +749,16 @@ void CStudioModelRenderer :: StudioFxTransform( cl_entity_t *ent, matrix3x4 &tra
 	}
 }
 
-void CStudioModelRenderer :: BlendSequence( Vector pos[], Vector4D q[], mstudioblendseq_t *pseqblend )
+void CStudioModelRenderer :: BlendSequence( CStudioBoneSetup *boneSetup, Vector pos[], Vector4D q[], mstudioblendseq_t *pseqblend, CIKContext *pIK )
 {
+	studiohdr_t *phdr = boneSetup->m_pStudioHeader;
 	float m_flGaitBoneWeights[MAXSTUDIOBONES];
-	CIKContext *pIK = NULL;
 
 	// to prevent division by zero
 	if( pseqblend->fadeout <= 0.0f )
 		pseqblend->fadeout = 0.2f;
 
-	if( m_boneSetup.GetNumIKChains( ))
-		pIK = &m_pModelInstance->m_ik;
-
-	if( pseqblend->blendtime && ( pseqblend->blendtime + pseqblend->fadeout > tr.time ) && ( pseqblend->sequence < m_pStudioHeader->numseq ))
+	if( pseqblend->blendtime && ( pseqblend->blendtime + pseqblend->fadeout > tr.time ) && ( pseqblend->sequence < phdr->numseq ))
 	{
 		float	s = 1.0f - (tr.time - pseqblend->blendtime) / pseqblend->fadeout;
 
@@ -794,10 +775,10 @@ void CStudioModelRenderer :: BlendSequence( Vector pos[], Vector4D q[], mstudiob
 
 		if( pseqblend->gaitseq )
 		{
-			mstudiobone_t *pbones = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
+			mstudiobone_t *pbones = (mstudiobone_t *)((byte *)phdr + phdr->boneindex);
 			bool copy = true;
 
-			for( int i = 0; i < m_pStudioHeader->numbones; i++)
+			for( int i = 0; i < phdr->numbones; i++)
 			{
 				if( !Q_strcmp( pbones[i].name, "Bip01 Spine" ))
 					copy = false;
@@ -806,11 +787,11 @@ void CStudioModelRenderer :: BlendSequence( Vector pos[], Vector4D q[], mstudiob
 				m_flGaitBoneWeights[i] = (copy) ? 1.0f : 0.0f;
 			}
 
-			m_boneSetup.SetBoneWeights( m_flGaitBoneWeights ); // install weightlist for gait sequence
+			boneSetup->SetBoneWeights( m_flGaitBoneWeights ); // install weightlist for gait sequence
 		}
 
-		m_boneSetup.AccumulatePose( pIK, pos, q, pseqblend->sequence, pseqblend->cycle, s );
-		m_boneSetup.SetBoneWeights( NULL ); // back to default rules
+		boneSetup->AccumulatePose( pIK, pos, q, pseqblend->sequence, pseqblend->cycle, s );
+		boneSetup->SetBoneWeights( NULL ); // back to default rules
 	}
 }
 
@@ -1103,6 +1084,10 @@ bool CStudioModelRenderer :: CheckBoneCache( float f )
 	if( RP_LOCALCLIENT( RI->currententity ) && !FBitSet( RI->params, RP_THIRDPERSON ))
 		return false;
 
+	// benchmark measures the bone setup
+	if( tr.fPrepBench )
+		return false;
+
 	bool pos_valid = (cache->transform == inst->m_protationmatrix) ? true : false;
 	bool param_valid = !memcmp( cache->poseparam, m_pModelInstance->m_poseparameter, sizeof( float ) * MAXSTUDIOPOSEPARAM );
 
@@ -1145,23 +1130,17 @@ bool CStudioModelRenderer :: CheckBoneCache( float f )
 
 /*
 ====================
-StudioSetupBones
+StudioPrepareBones
 
+main thread part of bone setup: interpolate
+all the entity params and validate the bonecache
+returns false if cached bones are still valid
 ====================
 */
-void CStudioModelRenderer :: StudioSetupBones( void )
+bool CStudioModelRenderer :: StudioPrepareBones( StudioBoneJob_t *job )
 {
-	float		adj[MAXSTUDIOCONTROLLERS];
 	cl_entity_t	*e = RI->currententity;	// for more readability
-	CIKContext	*pIK = NULL;
-	mstudioboneinfo_t	*pboneinfo;
 	mstudioseqdesc_t	*pseqdesc;
-	matrix3x4		bonematrix;
-	mstudiobone_t	*pbones;
-	int		i;
-
-	static Vector	pos[MAXSTUDIOBONES];
-	static Vector4D	q[MAXSTUDIOBONES];
 
 	if( e->curstate.sequence < 0 || e->curstate.sequence >= m_pStudioHeader->numseq ) 
 	{
@@ -1177,39 +1156,74 @@ void CStudioModelRenderer :: StudioSetupBones( void )
 	
 	StudioInterpolatePoseParams( e, dadt );
 
-	if( CheckBoneCache( f )) return; // using a cached bones no need transformations
+	if( CheckBoneCache( f )) return false; // using a cached bones no need transformations
 
-	if( m_boneSetup.GetNumIKChains( ))
-	{
-		if( FBitSet( e->curstate.effects, EF_NOINTERP ))
-			m_pModelInstance->m_ik.ClearTargets();
-		m_pModelInstance->m_ik.Init( &m_boneSetup, e->angles, e->origin, tr.time, tr.realframecount );
-		pIK = &m_pModelInstance->m_ik;
-	}
-
-	float cycle = f / m_boneSetup.LocalMaxFrame( e->curstate.sequence );
 	StudioInterpolateControllers( e, dadt );
 
-	m_boneSetup.InitPose( pos, q );
-	m_boneSetup.UpdateRealTime( tr.time );
-	if( CVAR_TO_BOOL( m_pCvarCompatible ))
-		m_boneSetup.CalcBoneAdj( adj, m_pModelInstance->m_controller, e->mouth.mouthopen );
-	m_boneSetup.AccumulatePose( pIK, pos, q, e->curstate.sequence, cycle, 1.0 );
+	job->entity = e;
+	job->modelhandle = e->modelhandle;
+	job->header = m_pStudioHeader;
+	job->cycle = f / m_boneSetup.LocalMaxFrame( e->curstate.sequence );
+	job->gaitcycle = 0.0f;
 	m_pModelInstance->lerp.frame = f;
 
-	pbones = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
-	pboneinfo = (mstudioboneinfo_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex + m_pStudioHeader->numbones * sizeof( mstudiobone_t ));
-
 	if( e->curstate.gaitsequence < 0 || e->curstate.gaitsequence >= m_pStudioHeader->numseq ) 
 		e->curstate.gaitsequence = 0;
 
+	// calc gait animation
+	if( e->curstate.gaitsequence != 0 )
+	{
+		pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + e->curstate.gaitsequence;
+		f = StudioEstimateGaitFrame( pseqdesc );
+
+		// convert gaitframe to cycle
+		job->gaitcycle = f / m_boneSetup.LocalMaxFrame( e->curstate.gaitsequence );
+		m_pModelInstance->lerp.gaitframe = f;
+	}
+
+	return true;
+}
+
+/*
+====================
+StudioBuildBones
+
+evaluate the pose and build bone matrices. Doesn't touch
+any renderer state except a given instance so it can
+be executed from worker threads (pIK must be NULL there)
+====================
+*/
+void CStudioModelRenderer :: StudioBuildBones( CStudioBoneSetup *boneSetup, const StudioBoneJob_t *job, CIKContext *pIK )
+{
+	float		adj[MAXSTUDIOCONTROLLERS];
+	ModelInstance_t	*inst = &m_ModelInstances[job->modelhandle];
+	studiohdr_t	*phdr = job->header;
+	cl_entity_t	*e = job->entity;
+	mstudioboneinfo_t	*pboneinfo;
+	matrix3x4		bonematrix;
+	mstudiobone_t	*pbones;
+	int		i;
+
+	// thread-local pose scratch
+	Vector		pos[MAXSTUDIOBONES];
+	Vector4D		q[MAXSTUDIOBONES];
+
+	boneSetup->InitPose( pos, q );
+	boneSetup->UpdateRealTime( tr.time );
+	if( CVAR_TO_BOOL( m_pCvarCompatible ))
+		boneSetup->CalcBoneAdj( adj, inst->m_controller, e->mouth.mouthopen );
+	boneSetup->AccumulatePose( pIK, pos, q, e->curstate.sequence, job->cycle, 1.0 );
+
+	pbones = (mstudiobone_t *)((byte *)phdr + phdr->boneindex);
+	pboneinfo = (mstudioboneinfo_t *)((byte *)phdr + phdr->boneindex + phdr->numbones * sizeof( mstudiobone_t ));
+
 	// calc gait animation
 	if( e->curstate.gaitsequence != 0 )
 	{
 		float m_flGaitBoneWeights[MAXSTUDIOBONES];
 		bool copy = true;
 
-		for( int i = 0; i < m_pStudioHeader->numbones; i++)
+		for( int i = 0; i < phdr->numbones; i++)
 		{
 			if( !Q_strcmp( pbones[i].name, "Bip01 Spine" ))
 				copy = false;
@@ -1218,27 +1232,20 @@ void CStudioModelRenderer :: StudioSetupBones( void )
 			m_flGaitBoneWeights[i] = (copy) ? 1.0f : 0.0f;
 		}
 
-		pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + e->curstate.gaitsequence;
-		f = StudioEstimateGaitFrame( pseqdesc );
-
-		// convert gaitframe to cycle
-		cycle = f / m_boneSetup.LocalMaxFrame( e->curstate.gaitsequence );
-
-		m_boneSetup.SetBoneWeights( m_flGaitBoneWeights ); // install weightlist for gait sequence
-		m_boneSetup.AccumulatePose( pIK, pos, q, e->curstate.gaitsequence, cycle, 1.0 );
-		m_boneSetup.SetBoneWeights( NULL ); // back to default rules
-		m_pModelInstance->lerp.gaitframe = f;
+		boneSetup->SetBoneWeights( m_flGaitBoneWeights ); // install weightlist for gait sequence
+		boneSetup->AccumulatePose( pIK, pos, q, e->curstate.gaitsequence, job->gaitcycle, 1.0 );
+		boneSetup->SetBoneWeights( NULL ); // back to default rules
 	}
 
 	// run blends from previous sequences
 	for( i = 0; i < MAX_SEQBLENDS; i++ )
-		BlendSequence( pos, q, &m_pModelInstance->m_seqblend[i] );
+		BlendSequence( boneSetup, pos, q, &inst->m_seqblend[i], pIK );
 
 	CIKContext auto_ik;
-	auto_ik.Init( &m_boneSetup, e->angles, e->origin, 0.0f, 0 );
-	m_boneSetup.CalcAutoplaySequences( &auto_ik, pos, q );
+	auto_ik.Init( boneSetup, e->angles, e->origin, 0.0f, 0 );
+	boneSetup->CalcAutoplaySequences( &auto_ik, pos, q );
 	if( !CVAR_TO_BOOL( m_pCvarCompatible ))
-		m_boneSetup.CalcBoneAdj( pos, q, m_pModelInstance->m_controller, e->mouth.mouthopen );
+		boneSetup->CalcBoneAdj( pos, q, inst->m_controller, e->mouth.mouthopen );
 
 	byte	boneComputed[MAXSTUDIOBONES];
 
@@ -1248,21 +1255,25 @@ void CStudioModelRenderer :: StudioSetupBones( void )
 	if( pIK != NULL )
 	{
 		UpdateIKLocks( pIK );
-		pIK->UpdateTargets( pos, q, m_pModelInstance->m_pbones, boneComputed );
+		pIK->UpdateTargets( pos, q, inst->m_pbones, boneComputed );
 		CalculateIKLocks( pIK );
-		pIK->SolveDependencies( pos, q, m_pModelInstance->m_pbones, boneComputed );
+		pIK->SolveDependencies( pos, q, inst->m_pbones, boneComputed );
 	}
 
-	for( i = 0; i < m_pStudioHeader->numbones; i++ ) 
+	// convert all the local transforms at once
+	matrix3x4	localbones[MAXSTUDIOBONES];
+	QuaternionMatrixBatch( q, pos, localbones, phdr->numbones );
+
+	for( i = 0; i < phdr->numbones; i++ ) 
 	{
 		// animate all non-simulated bones
-		if( CalcProceduralBone( m_pStudioHeader, i, m_pModelInstance->m_pbones ))
+		if( CalcProceduralBone( phdr, i, inst->m_pbones ))
 			continue;
 
 		// initialize bonematrix
-		bonematrix = matrix3x4( pos[i], q[i] );
+		bonematrix = localbones[i];
 
-		if( FBitSet( pbones[i].flags, BONE_JIGGLE_PROCEDURAL ) && FBitSet( m_pStudioHeader->flags, STUDIO_HAS_BONEINFO ))
+		if( FBitSet( pbones[i].flags, BONE_JIGGLE_PROCEDURAL ) && FBitSet( phdr->flags, STUDIO_HAS_BONEINFO ))
 		{
 			// Physics-based "jiggle" bone
 			// Bone is assumed to be along the Z axis
@@ -1271,47 +1282,245 @@ void CStudioModelRenderer :: StudioSetupBones( void )
 			// compute desired bone orientation
 			matrix3x4 goalMX;
 
-			if( pbones[i].parent == -1 ) goalMX = m_pModelInstance->m_protationmatrix.ConcatTransforms( bonematrix );
-			else goalMX = m_pModelInstance->m_pbones[pbones[i].parent].ConcatTransforms( bonematrix );
+			if( pbones[i].parent == -1 ) goalMX = inst->m_protationmatrix.ConcatTransforms( bonematrix );
+			else goalMX = inst->m_pbones[pbones[i].parent].ConcatTransforms( bonematrix );
 
 			// get jiggle properties from QC data
-			mstudiojigglebone_t *jiggleInfo = (mstudiojigglebone_t *)((byte *)m_pStudioHeader + pboneinfo[i].procindex);
-			if( !m_pModelInstance->m_pJiggleBones ) m_pModelInstance->m_pJiggleBones = new CJiggleBones;
+			mstudiojigglebone_t *jiggleInfo = (mstudiojigglebone_t *)((byte *)phdr + pboneinfo[i].procindex);
+			if( !inst->m_pJiggleBones ) inst->m_pJiggleBones = new CJiggleBones;
 
 			// do jiggle physics
 			if( pboneinfo[i].proctype == STUDIO_PROC_JIGGLE )
-				m_pModelInstance->m_pJiggleBones->BuildJiggleTransformations( i, tr.time, jiggleInfo, goalMX, m_pModelInstance->m_pbones[i] );
-			else m_pModelInstance->m_pbones[i] = goalMX; // fallback
+				inst->m_pJiggleBones->BuildJiggleTransformations( i, tr.time, jiggleInfo, goalMX, inst->m_pbones[i] );
+			else inst->m_pbones[i] = goalMX; // fallback
 		}
 		else
 		{
-			if( pbones[i].parent == -1 ) m_pModelInstance->m_pbones[i] = m_pModelInstance->m_protationmatrix.ConcatTransforms( bonematrix );
-			else m_pModelInstance->m_pbones[i] = m_pModelInstance->m_pbones[pbones[i].parent].ConcatTransforms( bonematrix );
+			if( pbones[i].parent == -1 ) inst->m_pbones[i] = inst->m_protationmatrix.ConcatTransforms( bonematrix );
+			else inst->m_pbones[i] = inst->m_pbones[pbones[i].parent].ConcatTransforms( bonematrix );
 		}
 	}
 
-	mposetobone_t *m = m_pModelInstance->m_pModel->poseToBone;
+	mposetobone_t *m = inst->m_pModel->poseToBone;
 
 	// convert bones into compacted GLSL array
 	if( m != NULL )
 	{
-		for( int i = 0; i < m_pStudioHeader->numbones; i++ )
+		for( int i = 0; i < phdr->numbones; i++ )
 		{
-			matrix3x4 out = m_pModelInstance->m_pbones[i].ConcatTransforms( m->posetobone[i] );
-			out.CopyToArray4x3( &m_pModelInstance->m_glstudiobones[i*3] );
-			m_pModelInstance->m_studioquat[i] = out.GetQuaternion();
-			m_pModelInstance->m_studiopos[i] = out.GetOrigin();
+			matrix3x4 out = inst->m_pbones[i].ConcatTransforms( m->posetobone[i] );
+			out.CopyToArray4x3( &inst->m_glstudiobones[i*3] );
+			inst->m_studioquat[i] = out.GetQuaternion();
+			inst->m_studiopos[i] = out.GetOrigin();
 		}
 	}
 	else
 	{
-		for( int i = 0; i < m_pStudioHeader->numbones; i++ )
+		for( int i = 0; i < phdr->numbones; i++ )
+		{
+			inst->m_pbones[i].CopyToArray4x3( &inst->m_glstudiobones[i*3] );
+			inst->m_studioquat[i] = inst->m_pbones[i].GetQuaternion();
+			inst->m_studiopos[i] = inst->m_pbones[i].GetOrigin();
+		}
+	}
+}
+
+/*
+====================
+StudioSetupBones
+
+====================
+*/
+void CStudioModelRenderer :: StudioSetupBones( void )
+{
+	CIKContext	*pIK = NULL;
+	StudioBoneJob_t	job;
+	PROF_SCOPE( "StudioSetupBones" );
+
+	if( !StudioPrepareBones( &job ))
+		return; // using a cached bones
+
+	if( m_boneSetup.GetNumIKChains( ))
+	{
+		if( FBitSet( RI->currententity->curstate.effects, EF_NOINTERP ))
+			m_pModelInstance->m_ik.ClearTargets();
+		m_pModelInstance->m_ik.Init( &m_boneSetup, RI->currententity->angles, RI->currententity->origin, tr.time, tr.realframecount );
+		pIK = &m_pModelInstance->m_ik;
+	}
+
+	StudioBuildBones( &m_boneSetup, &job, pIK );
+}
+
+/*
+====================
+StudioAllowBoneJob
+
+check if bones for current entity can be
+computed in parallel with other entities
+====================
+*/
+bool CStudioModelRenderer :: StudioAllowBoneJob( void )
+{
+	cl_entity_t *e = RI->currententity;
+
+	if( m_iDrawModelType != DRAWSTUDIO_NORMAL || m_fShootDecal )
+		return false;
+
+	// local player may be drawn as legs
+	if( RP_LOCALCLIENT( e ))
+		return false;
+
+	// merged with parent bones
+	if( e->curstate.movetype == MOVETYPE_FOLLOW && e->curstate.aiment > 0 )
+		return false;
+
+	// IK reads the world and other entities
+	if( m_boneSetup.GetNumIKChains( ))
+		return false;
+
+	// sequence groups are loaded through the engine cache
+	if( m_pStudioHeader->numseqgroups > 1 )
+		return false;
+
+	return true;
+}
+
+/*
+====================
+StudioBoneJob
+
+job system callback
+====================
+*/
+void CStudioModelRenderer :: StudioBoneJob( void *context, int current, int threadnum )
+{
+	CStudioModelRenderer *pThis = (CStudioModelRenderer *)context;
+	const StudioBoneJob_t *job = &pThis->m_BoneJobs[current];
+	CStudioBoneSetup *boneSetup = pThis->m_pJobBoneSetup[threadnum];
+	PROF_SCOPE_THREAD( "StudioBoneJob", threadnum );
+
+	boneSetup->SetStudioPointers( job->header, pThis->m_ModelInstances[job->modelhandle].m_poseparameter );
+	pThis->StudioBuildBones( boneSetup, job, NULL );
+}
+
+/*
+====================
+StudioUpdateAnimCache
+
+apply cache size and collect the stats
+from all the bone setups
+====================
+*/
+void CStudioModelRenderer :: StudioUpdateAnimCache( bool flush )
+{
+	int	cachesize = m_pCvarAnimCache ? (int)m_pCvarAnimCache->value : 0;
+	int	hits, misses;
+
+	for( int i = -1; i < MAX_JOB_THREADS; i++ )
+	{
+		CStudioBoneSetup *boneSetup = ( i < 0 ) ? &m_boneSetup : m_pJobBoneSetup[i];
+
+		if( !boneSetup ) continue;
+
+		if( flush ) boneSetup->FlushAnimCache();
+		boneSetup->SetAnimCacheSize( cachesize );
+		boneSetup->AnimCacheStats( &hits, &misses, true );
+		r_stats.c_anim_cache_hits += hits;
+		r_stats.c_anim_cache_misses += misses;
+	}
+}
+
+/*
+====================
+BeginBoneJobs
+
+start to collect the entities
+for parallel bone setup
+====================
+*/
+void CStudioModelRenderer :: BeginBoneJobs( void )
+{
+	m_BoneJobs.RemoveAll();
+	m_FollowEntities.RemoveAll();
+	m_fDeferBones = ( CVAR_TO_BOOL( m_pCvarBoneJobs ) && JOB_NumThreads() > 1 );
+	StudioUpdateAnimCache( false );
+}
+
+/*
+====================
+FinishBoneJobs
+
+compute bones for all the deferred entities
+and finalize them in the main thread
+====================
+*/
+void CStudioModelRenderer :: FinishBoneJobs( void )
+{
+	int	i;
+	PROF_SCOPE( "FinishBoneJobs" );
+
+	m_fDeferBones = false;
+
+	if( !m_BoneJobs.Count( ))
+	{
+		StudioUpdateAnimCache( false );
+		FinishFollowEntities();
+		return;
+	}
+
+	for( i = 0; i < JOB_NumThreads(); i++ )
+	{
+		if( !m_pJobBoneSetup[i] )
 		{
-			m_pModelInstance->m_pbones[i].CopyToArray4x3( &m_pModelInstance->m_glstudiobones[i*3] );
-			m_pModelInstance->m_studioquat[i] = m_pModelInstance->m_pbones[i].GetQuaternion();
-			m_pModelInstance->m_studiopos[i] = m_pModelInstance->m_pbones[i].GetOrigin();
+			m_pJobBoneSetup[i] = new CStudioBoneSetup;
+			m_pJobBoneSetup[i]->SetAnimCacheSize( (int)m_pCvarAnimCache->value );
 		}
 	}
+
+	JOB_RunOnIndividual( m_BoneJobs.Count(), this, StudioBoneJob );
+
+	for( i = 0; i < m_BoneJobs.Count(); i++ )
+	{
+		StudioBoneJob_t *job = &m_BoneJobs[i];
+
+		// restore the entity state
+		if( !StudioSetEntity( job->entity ))
+			continue;
+
+		StudioFinishBones();
+
+		if(( m_iDrawModelType == DRAWSTUDIO_RUNEVENTS ) || r_drawentities->value == 2.0f )
+			continue;
+
+		StudioAddMeshesToDrawList( job->update );
+	}
+
+	r_stats.c_bone_jobs += m_BoneJobs.Count();
+	StudioUpdateAnimCache( false );
+	m_pModelInstance = NULL;
+	m_BoneJobs.RemoveAll();
+
+	// parents are ready now
+	FinishFollowEntities();
+}
+
+/*
+====================
+FinishFollowEntities
+
+attached entities are merged with parent
+bones so they waits until parents is done
+====================
+*/
+void CStudioModelRenderer :: FinishFollowEntities( void )
+{
+	for( int i = 0; i < m_FollowEntities.Count(); i++ )
+	{
+		StudioFollowEntity_t *follow = &m_FollowEntities[i];
+		AddStudioModelToDrawList( follow->entity, follow->update );
+	}
+
+	m_FollowEntities.RemoveAll();
 }
 
 /*
@@ -2272,12 +2481,37 @@ void CStudioModelRenderer :: AddStudioModelToDrawList( cl_entity_t *e, bool upda
 
 	m_pModelInstance->visframe = tr.realframecount; // visible	
 
-	if( m_pModelInstance->cached_frame != tr.realframecount )
+	if( m_pModelInstance->cached_frame != tr.realframecount || tr.fPrepBench )
 	{
 		StudioSetUpTransform( );
 
-		if( RI->currententity->curstate.movetype == MOVETYPE_FOLLOW && RI->currententity->curstate.aiment > 0 )
+		if( m_fDeferBones && StudioAllowBoneJob( ))
 		{
+			StudioBoneJob_t	job;
+
+			// bones will be computed by job system, finish the entity later
+			if( StudioPrepareBones( &job ))
+			{
+				job.update = update;
+				m_BoneJobs.AddToTail( job );
+				m_pModelInstance = NULL;
+				return;
+			}
+		}
+		else if( RI->currententity->curstate.movetype == MOVETYPE_FOLLOW && RI->currententity->curstate.aiment > 0 )
+		{
+			if( m_fDeferBones )
+			{
+				StudioFollowEntity_t follow;
+
+				// parent bones may be computed by job system, merge after them
+				follow.entity = RI->currententity;
+				follow.update = update;
+				m_FollowEntities.AddToTail( follow );
+				m_pModelInstance = NULL;
+				return;
+			}
+
 			cl_entity_t *parent = gEngfuncs.GetEntityByIndex( RI->currententity->curstate.aiment );
 			if( parent != NULL && parent->modelhandle != INVALID_HANDLE )
 			{
@@ -2316,68 +2550,93 @@ void CStudioModelRenderer :: AddStudioModelToDrawList( cl_entity_t *e, bool upda
 		}
 		else StudioSetupBones( );
 
-		// calc attachments only once per frame
-		StudioCalcAttachments( m_pModelInstance->m_pbones );
-		StudioClientEvents( );
+		StudioFinishBones();
+	}
 
-		if( RI->currententity->index > 0 )
-		{
-			// because RI->currententity may be not equal his index e.g. for viewmodel
-			cl_entity_t *ent = GET_ENTITY( RI->currententity->index );
-			memcpy( ent->attachment, RI->currententity->attachment, sizeof( Vector ) * 4 );
-		}
+	if(( m_iDrawModelType == DRAWSTUDIO_RUNEVENTS ) || r_drawentities->value == 2.0f )
+		return;
 
-		// grab the static lighting from world
-		StudioStaticLight( RI->currententity, &m_pModelInstance->light );
+	StudioAddMeshesToDrawList( update );
+}
 
-		model_t *pweaponmodel = NULL;
+/*
+=================
+StudioFinishBones
 
-		if( RI->currententity->curstate.weaponmodel )
-			pweaponmodel = IEngineStudio.GetModelByIndex( RI->currententity->curstate.weaponmodel );
+attachments, events and lighting that
+depends on a computed bones
+=================
+*/
+void CStudioModelRenderer :: StudioFinishBones( void )
+{
+	// calc attachments only once per frame
+	StudioCalcAttachments( m_pModelInstance->m_pbones );
+	if( !tr.fPrepBench ) StudioClientEvents( );
 
-		// don't draw p_model for firstperson legs
-		if( pweaponmodel && ( RI->currentmodel != m_pPlayerLegsModel ))
-		{
-			m_pStudioHeader = (studiohdr_t *)IEngineStudio.Mod_Extradata( pweaponmodel );
+	if( RI->currententity->index > 0 )
+	{
+		// because RI->currententity may be not equal his index e.g. for viewmodel
+		cl_entity_t *ent = GET_ENTITY( RI->currententity->index );
+		memcpy( ent->attachment, RI->currententity->attachment, sizeof( Vector ) * 4 );
+	}
+
+	// grab the static lighting from world
+	StudioStaticLight( RI->currententity, &m_pModelInstance->light );
+
+	model_t *pweaponmodel = NULL;
+
+	if( RI->currententity->curstate.weaponmodel )
+		pweaponmodel = IEngineStudio.GetModelByIndex( RI->currententity->curstate.weaponmodel );
+
+	// don't draw p_model for firstperson legs
+	if( pweaponmodel && ( RI->currentmodel != m_pPlayerLegsModel ))
+	{
+		m_pStudioHeader = (studiohdr_t *)IEngineStudio.Mod_Extradata( pweaponmodel );
 
-			StudioMergeBones( m_pModelInstance->m_protationmatrix, m_pModelInstance->m_pwpnbones, m_pModelInstance->m_pbones, pweaponmodel, RI->currentmodel );
+		StudioMergeBones( m_pModelInstance->m_protationmatrix, m_pModelInstance->m_pwpnbones, m_pModelInstance->m_pbones, pweaponmodel, RI->currentmodel );
 
-			mposetobone_t *m = pweaponmodel->poseToBone;
+		mposetobone_t *m = pweaponmodel->poseToBone;
 
-			// convert bones into compacted GLSL array
-			if( m != NULL )
+		// convert bones into compacted GLSL array
+		if( m != NULL )
+		{
+			for( int i = 0; i < m_pStudioHeader->numbones; i++ )
 			{
-				for( int i = 0; i < m_pStudioHeader->numbones; i++ )
-				{
-					matrix3x4 out = m_pModelInstance->m_pwpnbones[i].ConcatTransforms( m->posetobone[i] );
-					out.CopyToArray4x3( &m_pModelInstance->m_glweaponbones[i*3] );
-					m_pModelInstance->m_weaponquat[i] = out.GetQuaternion();
-					m_pModelInstance->m_weaponpos[i] = out.GetOrigin();
-				}
+				matrix3x4 out = m_pModelInstance->m_pwpnbones[i].ConcatTransforms( m->posetobone[i] );
+				out.CopyToArray4x3( &m_pModelInstance->m_glweaponbones[i*3] );
+				m_pModelInstance->m_weaponquat[i] = out.GetQuaternion();
+				m_pModelInstance->m_weaponpos[i] = out.GetOrigin();
 			}
-			else
+		}
+		else
+		{
+			for( int i = 0; i < m_pStudioHeader->numbones; i++ )
 			{
-				for( int i = 0; i < m_pStudioHeader->numbones; i++ )
-				{
-					m_pModelInstance->m_pwpnbones[i].CopyToArray4x3( &m_pModelInstance->m_glweaponbones[i*3] );
-					m_pModelInstance->m_weaponquat[i] = m_pModelInstance->m_pwpnbones[i].GetQuaternion();
-					m_pModelInstance->m_weaponpos[i] = m_pModelInstance->m_pwpnbones[i].GetOrigin();
-				}
+				m_pModelInstance->m_pwpnbones[i].CopyToArray4x3( &m_pModelInstance->m_glweaponbones[i*3] );
+				m_pModelInstance->m_weaponquat[i] = m_pModelInstance->m_pwpnbones[i].GetQuaternion();
+				m_pModelInstance->m_weaponpos[i] = m_pModelInstance->m_pwpnbones[i].GetOrigin();
 			}
-
-			m_pStudioHeader = (studiohdr_t *)IEngineStudio.Mod_Extradata( RI->currentmodel );
 		}
 
-		// add visible lights to vislight matrix
-		R_MarkVisibleLights( m_pModelInstance->lights );
-
-		// now this frame cached
-		m_pModelInstance->cached_frame = tr.realframecount;
+		m_pStudioHeader = (studiohdr_t *)IEngineStudio.Mod_Extradata( RI->currentmodel );
 	}
 
-	if(( m_iDrawModelType == DRAWSTUDIO_RUNEVENTS ) || r_drawentities->value == 2.0f )
-		return;
+	// add visible lights to vislight matrix
+	R_MarkVisibleLights( m_pModelInstance->lights );
+
+	// now this frame cached
+	m_pModelInstance->cached_frame = tr.realframecount;
+}
 
+/*
+=================
+StudioAddMeshesToDrawList
+
+add model meshes to list
+=================
+*/
+void CStudioModelRenderer :: StudioAddMeshesToDrawList( bool update )
+{
 	model_t *pweaponmodel = NULL;
 	mbodypart_t *pbodyparts = NULL;
 
@@ -2423,7 +2682,7 @@ RunViewModelEvents
 */
 void CStudioModelRenderer :: RunViewModelEvents( void )
 {
-	if( !CVAR_TO_BOOL( m_pCvarDrawViewModel ))
+	if( !CVAR_TO_BOOL( m_pCvarDrawViewModel ) || tr.fPrepBench )
 		return;
 
 	// ignore in thirdperson, camera view or client is died
@@ -2693,61 +2952,71 @@ void CStudioModelRenderer :: DrawMeshFromBuffer( const vbomesh_t *mesh )
 	r_stats.num_flushes++;
 }
 
-void CStudioModelRenderer :: BuildMeshListForLight( CDynLight *pl, bool solid )
+/*
+================
+CullMeshesForLight
+
+thread-safe part of the light list building
+================
+*/
+template< class T >
+static void CullMeshesForLight( const CUtlArray<T> &list, CDynLight *pl, CUtlArray<int> &out, bool meshesOnly )
 {
-	RI->frame.light_meshes.Purge();
 	Vector bounds[2];
 
-	if( solid )
+	out.RemoveAll();
+
+	for( int i = 0; i < list.Count(); i++ )
 	{
-		// check solid meshes for light intersection
-		for( int i = 0; i < RI->frame.solid_meshes.Count(); i++ )
-		{
-			CSolidEntry *entry = &RI->frame.solid_meshes[i];
-			StudioGetBounds( entry, bounds );
+		T *entry = (T *)&list[i];
 
-			if( pl->frustum.CullBox( bounds[0], bounds[1] ))
-				continue;	// no interaction
+		if( meshesOnly && entry->m_bDrawType != DRAWTYPE_MESH )
+			continue;
 
-			// setup the global pointers
-			if( !StudioSetEntity( entry ))
-				continue;
+		// entries without bounds are kept, BuildMeshListForLight applies the other rejects
+		if( R_StudioGetBounds( entry, bounds ) && pl->frustum.CullBox( bounds[0], bounds[1] ))
+			continue;	// no interaction
 
-			if( RI->currententity->curstate.renderfx == SKYBOX_ENTITY )
-				continue; // fast reject
+		out.AddToTail( i );
+	}
+}
 
-			if( FBitSet( RI->currententity->curstate.effects, EF_FULLBRIGHT ))
-				continue;
+/*
+================
+CullMeshesForLightJob
 
-			AddMeshToDrawList( m_pStudioHeader, entry->m_pMesh, true );
-		}
-	}
-	else
-	{
-		// check trans meshes for light intersection
-		for( int i = 0; i < RI->frame.trans_list.Count(); i++ )
-		{
-			CTransEntry *entry = &RI->frame.trans_list[i];
+job system callback
+================
+*/
+void CStudioModelRenderer :: CullMeshesForLightJob( void *context, int current, int threadnum )
+{
+	CStudioModelRenderer *pThis = (CStudioModelRenderer *)context;
+	CDynLight *pl = pThis->m_pLightJobs[current];
 
-			if( entry->m_bDrawType != DRAWTYPE_MESH )
-				continue;
+	if( pThis->m_fLightJobsSolid )
+		CullMeshesForLight( RI->frame.solid_meshes, pl, pThis->m_LightMeshes[current], false );
+	else CullMeshesForLight( RI->frame.trans_list, pl, pThis->m_LightMeshes[current], true );
+}
 
-			StudioGetBounds( entry, bounds );
-			if( pl->frustum.CullBox( bounds[0], bounds[1] ))
-				continue;	// no interaction
+void CStudioModelRenderer :: BuildMeshListForLight( CDynLight *pl, bool solid, const CUtlArray<int> &meshes )
+{
+	RI->frame.light_meshes.Purge();
 
-			// setup the global pointers
-			if( !StudioSetEntity( entry ))
-				continue;
+	for( int i = 0; i < meshes.Count(); i++ )
+	{
+		CSolidEntry *entry = (solid) ? &RI->frame.solid_meshes[meshes[i]] : &RI->frame.trans_list[meshes[i]];
 
-			if( RI->currententity->curstate.renderfx == SKYBOX_ENTITY )
-				continue; // fast reject
+		// setup the global pointers
+		if( !StudioSetEntity( entry ))
+			continue;
 
-			if( FBitSet( RI->currententity->curstate.effects, EF_FULLBRIGHT ))
-				continue;
+		if( RI->currententity->curstate.renderfx == SKYBOX_ENTITY )
+			continue; // fast reject
 
-			AddMeshToDrawList( m_pStudioHeader, entry->m_pMesh, true );
-		}
+		if( FBitSet( RI->currententity->curstate.effects, EF_FULLBRIGHT ))
+			continue;
+
+		AddMeshToDrawList( m_pStudioHeader, entry->m_pMesh, true );
 	}
 }
 
@@ -2759,7 +3028,7 @@ void CStudioModelRenderer :: DrawLightForMeshList( CDynLight *pl )
 
 	// sorting list to reduce shader switches
 	if( !CVAR_TO_BOOL( cv_nosort ))
-		RI->frame.light_meshes.Sort( SortSolidMeshes );
+		R_SortDrawList( RI->frame.light_meshes );
 
 	pglAlphaFunc( GL_GEQUAL, 0.5f );
 	RI->currententity = NULL;
@@ -2789,22 +3058,17 @@ void CStudioModelRenderer :: RenderDynLightList( bool solid )
 	GL_AlphaTest( GL_FALSE );
 	GL_DepthMask( GL_FALSE );
 
-	CDynLight *pl = tr.dlights;
+	// cull the meshes for all the lights at once
+	int numlights = R_GatherVisibleLights( m_pLightJobs );
+	m_fLightJobsSolid = solid;
+	JOB_RunOnIndividual( numlights, this, CullMeshesForLightJob );
 
-	for( int i = 0; i < MAX_DLIGHTS; i++, pl++ )
+	for( int i = 0; i < numlights; i++ )
 	{
-		if( pl->Expired( )) continue;
+		CDynLight *pl = m_pLightJobs[i];
 
 		if( pl->type == LIGHT_SPOT || pl->type == LIGHT_OMNI )
 		{
-			if( !pl->Active( )) continue;
-
-			if( !Mod_CheckBoxVisible( pl->absmin, pl->absmax ))
-				continue;
-
-			if( R_CullFrustum( &pl->frustum ))
-				continue;
-
 			pglEnable( GL_SCISSOR_TEST );
 		}
 		else
@@ -2816,7 +3080,7 @@ void CStudioModelRenderer :: RenderDynLightList( bool solid )
 		RI->currentlight = pl;
 
 		// draw world from light position
-		BuildMeshListForLight( pl, solid );
+		BuildMeshListForLight( pl, solid, m_LightMeshes[i] );
 
 		if( !RI->frame.light_meshes.Count( ))
 			continue;	// no interaction with this light?
@@ -2832,6 +3096,8 @@ void CStudioModelRenderer :: RenderDynLightList( bool solid )
 
 void CStudioModelRenderer :: RenderDeferredStudioList( void )
 {
+	PROF_SCOPE( "RenderDeferredStudioList" );
+
 	if( !RI->frame.solid_meshes.Count() )
 		return;
 
@@ -2845,7 +3111,7 @@ void CStudioModelRenderer :: RenderDeferredStudioList( void )
 
 	// sorting list to reduce shader switches
 	if( !CVAR_TO_BOOL( cv_nosort ))
-		RI->frame.solid_meshes.Sort( SortSolidMeshes );
+		R_SortDrawList( RI->frame.solid_meshes );
 
 	RI->currententity = NULL;
 	RI->currentmodel = NULL;
@@ -3716,6 +3982,8 @@ void CStudioModelRenderer :: DrawSingleMesh( CSolidEntry *entry, bool force )
 
 void CStudioModelRenderer :: RenderSolidStudioList( void )
 {
+	PROF_SCOPE( "RenderSolidStudioList" );
+
 	if( !RI->frame.solid_meshes.Count() )
 		return;
 
@@ -3729,7 +3997,7 @@ void CStudioModelRenderer :: RenderSolidStudioList( void )
 
 	// sorting list to reduce shader switches
 	if( !CVAR_TO_BOOL( cv_nosort ))
-		RI->frame.solid_meshes.Sort( SortSolidMeshes );
+		R_SortDrawList( RI->frame.solid_meshes );
 
 	RI->currententity = NULL;
 	RI->currentmodel = NULL;
@@ -3775,6 +4043,8 @@ void CStudioModelRenderer :: RenderSolidStudioList( void )
 	GL_CleanupDrawState();
 
 	// now draw studio decals (unsorted)
+	PROF_SCOPE( "StudioDecals" );
+
 	for( i = 0; i < RI->frame.solid_meshes.Count(); i++ )
 	{
 		DrawDecal( &RI->frame.solid_meshes[i] );
@@ -117,6 +117,8 @@ void CStudioModelRenderer :: Init( void )
 	m_pCvarCompatible		= CVAR_REGISTER( "r_studio_compatible", "1", FCVAR_ARCHIVE );
 	m_pCvarLodScale		= CVAR_REGISTER( "cl_lod_scale", "5.0", FCVAR_ARCHIVE );
 	m_pCvarLodBias		= CVAR_REGISTER( "cl_lod_bias", "0", FCVAR_ARCHIVE );
+	m_pCvarBoneJobs		= CVAR_REGISTER( "r_studio_bonejobs", "1", FCVAR_ARCHIVE );
+	m_pCvarAnimCache		= CVAR_REGISTER( "r_studio_animcache", "256", FCVAR_ARCHIVE );
 }
 
 /*
@@ -129,6 +131,9 @@ void CStudioModelRenderer :: VidInit( void )
 {
 	// tell the engine what models is used
 	m_pPlayerLegsModel = IEngineStudio.Mod_ForName( "models/player_legs.mdl", false );
+
+	// models may be reloaded at another address
+	StudioUpdateAnimCache( true );
 }
 
 /*
@@ -148,6 +153,9 @@ CStudioModelRenderer :: CStudioModelRenderer( void )
 	m_pVboModel	= NULL;
 	m_pSubModel	= NULL;
 	m_pModelInstance	= NULL;
+	m_pCvarAnimCache	= NULL;
+	m_fDeferBones	= false;
+	memset( m_pJobBoneSetup, 0, sizeof( m_pJobBoneSetup ));
 }
 
 /*
@@ -158,6 +166,8 @@ CStudioModelRenderer :: CStudioModelRenderer( void )
 */
 CStudioModelRenderer :: ~CStudioModelRenderer( void )
 {
+	for( int i = 0; i < MAX_JOB_THREADS; i++ )
+		delete m_pJobBoneSetup[i];
 }
 
 /*
@@ -348,6 +358,10 @@ void CStudioModelRenderer :: DeleteStudioCache( mstudiocache_t **ppstudiocache )
 
 				DeleteVBOMesh( pMesh );
 			}
+
+			if( pSubModel->decalcache != NULL )
+				Mem_Free( pSubModel->decalcache );
+			pSubModel->decalcache = NULL;
 		}
 	}
 
@@ -426,6 +440,7 @@ void CStudioModelRenderer :: ClearInstanceData( bool create )
 	if( create )
 	{
 		m_pModelInstance->m_DecalList.Purge();
+		memset( m_pModelInstance->m_DecalBuffers, 0, sizeof( m_pModelInstance->m_DecalBuffers ));
 		m_pModelInstance->m_pJiggleBones = NULL;
 		m_pModelInstance->materials = NULL;
 	}
@@ -518,6 +533,7 @@ void CStudioModelRenderer :: PrecacheStudioShaders( void )
 #include "material.h"
 void CStudioModelRenderer :: LoadStudioMaterials( void )
 {
+	LOAD_ZONE( "LoadStudioMaterials" );
 	// first we need alloc copy of all the materials to prevent modify mstudiotexture_t
 	RI->currentmodel->materials = (mstudiomaterial_t *)Mem_Alloc( sizeof( mstudiomaterial_t ) * m_pStudioHeader->numtextures );
 
@@ -1648,6 +1664,7 @@ void CStudioModelRenderer :: MeshCreateBuffer( vbomesh_t *pOut, const mstudiomes
 
 mstudiocache_t *CStudioModelRenderer :: CreateStudioCache( void *srclight, int lightmode )
 {
+	LOAD_ZONE( "CreateStudioCache" );
 	float		start_time = Sys_DoubleTime();
 	bool		unique_model = (srclight == NULL);	// just for more readable code
 	TmpModel_t	submodel[MAXSTUDIOMODELS];	// list of unique models
@@ -1827,6 +1844,7 @@ mstudiocache_t *CStudioModelRenderer :: CreateStudioCache( void *srclight, int l
 		pModel = (msubmodel_t *)buffer;
 		buffer += sizeof( msubmodel_t );
 		pModel->nummesh = psubmodel->nummesh;
+		pModel->decalcache = NULL;
 
 		// setup meshes
 		pModel->meshes = (vbomesh_t *)buffer;
@@ -2141,9 +2159,12 @@ void CStudioModelRenderer :: ProcessUserData( model_t *mod, qboolean create, con
 
 	if( create )
 	{
+		LOAD_ZONE_DETAIL( "ProcessUserData", mod->name );
+
 		// compute model CRC to verify vertexlighting data
 		// NOTE: source buffer is not equal to Mod_Extradata!
 		studiohdr_t *src = (studiohdr_t *)buffer;
+		R_CountLoadBytes( src->length ); // MDL was read by engine
 		RI->currentmodel->modelCRC = FILE_CRC32( buffer, src->length );
 		double start = Sys_DoubleTime();
 		RI->currentmodel->studiocache = CreateStudioCache();
@@ -16,6 +16,11 @@ GNU General Public License for more details.
 #ifndef GL_STUDIODECAL_H
 #define GL_STUDIODECAL_H
 
+#define DECAL_VERTEX_HASH_SIZE	256	// must be power of two
+#define DECAL_NODE_TRIS		16	// triangles per leaf of decal hierarchy
+#define MAX_DECAL_BUFFER_VERTS	4096	// shared decal vertices per instance for each vertex format
+#define MAX_DECAL_BUFFER_ELEMS	(MAX_DECAL_BUFFER_VERTS * 3)
+
 enum
 {
 	DECAL_CLIP_MINUSU	= 0x1,
@@ -28,10 +33,20 @@ typedef struct
 {
 	Vector2D		m_UV;
 	word		m_VertexIndex;		// index into the DecalVertex_t list
+	bool		m_Projected;		// vertex is projected on demand
 	bool		m_FrontFacing;
 	bool		m_InValidArea;
 } DecalVertexInfo_t;
 
+// shared storage for all the instance decals with same vertex format
+typedef struct
+{
+	unsigned int	vbo, vao, ibo;
+	int		stride;			// vertex size of this format
+	unsigned int	attribs;			// arrays enabled in the shared VAO
+	unsigned int	cacheSize;
+} studiodecalbuffer_t;
+
 // decal entry
 typedef struct studiodecal_s
 {
@@ -46,7 +61,10 @@ typedef struct studiodecal_s
 	int			depth;		// equal for all the decal fragments (used to remove all frgaments)
 
 	// VBO cache
-	vbomesh_t			mesh;		// decal private mesh
+	vbomesh_t			mesh;		// decal mesh (private or shared)
+	int			bufferType;	// m_DecalBuffers[bufferType], -1 if decal has private buffer
+	int			firstvert;	// position in the shared buffer
+	int			firstelem;
 
 	// shader cache
 	vbomesh_t*		modelmesh;	// pointer to studio mesh who owned decal
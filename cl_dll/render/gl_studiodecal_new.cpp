@@ -119,11 +119,24 @@ void CStudioModelRenderer :: PurgeDecals( ModelInstance_t *inst )
 	for( int i = 0; i < inst->m_DecalList.Count(); i++ )
 	{
 		studiodecal_t *pDecal = &inst->m_DecalList[i];
-		DeleteVBOMesh( &pDecal->mesh );
+		DeleteDecalMesh( pDecal );
 	}
 
 	// release himself
 	inst->m_DecalList.Purge();
+
+	// release shared buffers
+	for( int j = 0; j < MESHLOADER_COUNT; j++ )
+	{
+		studiodecalbuffer_t *pBuffer = &inst->m_DecalBuffers[j];
+
+		if( pBuffer->vao ) pglDeleteVertexArrays( 1, &pBuffer->vao );
+		if( pBuffer->vbo ) pglDeleteBuffersARB( 1, &pBuffer->vbo );
+		if( pBuffer->ibo ) pglDeleteBuffersARB( 1, &pBuffer->ibo );
+		tr.total_vbo_memory -= pBuffer->cacheSize;
+	}
+
+	memset( inst->m_DecalBuffers, 0, sizeof( inst->m_DecalBuffers ));
 }
 
 void CStudioModelRenderer :: PurgeDecals( cl_entity_t *e )
@@ -401,36 +414,35 @@ _forceinline bool CStudioModelRenderer :: TransformToDecalSpace( DecalBuildInfo_
 
 /*
 ====================
-ProjectDecalOntoMesh
+ProjectDecalVertex
 
+vertices is projected on demand so
+culled parts of model are never touched
 ====================
 */
-void CStudioModelRenderer :: ProjectDecalOntoMesh( DecalBuildInfo_t& build )
+void CStudioModelRenderer :: ProjectDecalVertex( DecalBuildInfo_t& build, int vertIndex )
 {
-	float invRadius = (build.m_Radius != 0.0f) ? 1.0f / build.m_Radius : 1.0f;
+	DecalVertexInfo_t *info = &build.m_pVertexInfo[vertIndex];
+	svert_t *vert = &build.m_pDecalCache->verts[vertIndex];
 
 	// for this to work, the plane and intercept must have been transformed
 	// into pose space. Also, we'll not be bothering with flexes.
-	for( int j = 0; j < m_nNumArrayVerts; j++ )
-	{
-		// just walk by unique verts
-		svert_t *vert = &m_arrayxvert[j];
+	info->m_Projected = true;
 
-		// No decal vertex yet...
-		build.m_pVertexInfo[j].m_VertexIndex = INVALID_HANDLE;
+	// No decal vertex yet...
+	info->m_VertexIndex = INVALID_HANDLE;
 
-		// We need to know if the normal is pointing in the negative direction
-		// if so, blow off all triangles connected to that vertex.
-		build.m_pVertexInfo[j].m_FrontFacing = IsFrontFacing( vert );
+	// We need to know if the normal is pointing in the negative direction
+	// if so, blow off all triangles connected to that vertex.
+	info->m_FrontFacing = IsFrontFacing( vert );
 
-		if( !build.m_pVertexInfo[j].m_FrontFacing )
-			continue;
+	if( !info->m_FrontFacing )
+		return;
 
-		build.m_pVertexInfo[j].m_InValidArea = TransformToDecalSpace( build, vert, build.m_pVertexInfo[j].m_UV );
-		build.m_pVertexInfo[j].m_UV *= build.vecDecalScale * 0.5f;
-		build.m_pVertexInfo[j].m_UV[0] += 0.5f;
-		build.m_pVertexInfo[j].m_UV[1] += 0.5f;
-	}
+	info->m_InValidArea = TransformToDecalSpace( build, vert, info->m_UV );
+	info->m_UV *= build.vecDecalScale * 0.5f;
+	info->m_UV[0] += 0.5f;
+	info->m_UV[1] += 0.5f;
 }
 
 /*
@@ -467,7 +479,19 @@ Converts a mesh index to a svert_t
 void CStudioModelRenderer :: ConvertMeshVertexToDecalVertex( DecalBuildInfo_t& build, int vertIndex, svert_t *out )
 {
 	// copy over the data (we use through access for all submodel verts)
-	*out = m_arrayxvert[vertIndex];
+	*out = build.m_pDecalCache->verts[vertIndex];
+
+	// cached vertices are shared between instances
+	if( build.m_pVertexLight != NULL )
+	{
+		dvertlight_t *vl = &build.m_pVertexLight[vertIndex];
+
+		for( int map = 0; map < MAXLIGHTMAPS; map++ )
+		{
+			out->light[map] = PackColor( vl->light[map] );
+			out->deluxe[map] = PackColor( vl->deluxe[map] );
+		}
+	}
 
 	// get the texture coords from the decal planar projection
 	out->stcoord[0] = build.m_pVertexInfo[vertIndex].m_UV.x;
@@ -511,6 +535,28 @@ word CStudioModelRenderer :: AddVertexToDecal( DecalBuildInfo_t& build, int vert
 	return pVertexInfo[vertIndex].m_VertexIndex;
 }
 
+/*
+====================
+DecalVertexHashKey
+
+quarter unit cells, equal vertices is almost always
+fall into the same cell. The rare miss is only
+produces the duplicated vertex
+====================
+*/
+static uint DecalVertexHashKey( const Vector &point )
+{
+	uint	hashKey = 0;
+
+	hashKey ^= (uint)int( floor( point.x * 4.0f )) * 73856093;
+	hashKey ^= (uint)int( floor( point.y * 4.0f )) * 19349663;
+	hashKey ^= (uint)int( floor( point.z * 4.0f )) * 83492791;
+
+	hashKey &= (DECAL_VERTEX_HASH_SIZE - 1);
+
+	return hashKey;
+}
+
 /*
 ====================
 AddVertexToDecal
@@ -520,16 +566,14 @@ This creates a unique vertex
 */
 word CStudioModelRenderer :: AddVertexToDecal( DecalBuildInfo_t& build, svert_t *vert )
 {
+	uint hashKey = DecalVertexHashKey( vert->vertex );
+
 	// Try to see if the clipped vertex already exists in our decal list...
-	// Only search for matches with verts appearing in the current decal
-	for( int i = 0; i < build.m_Vertices.Count(); i++ )
+	// Only clipped vertices are linked into hash
+	for( int i = build.m_VertexHash[hashKey]; i != -1; i = build.m_VertexHashChain[i] )
 	{
 		svert_t *test = &build.m_Vertices[i];
 
-		// Only bother to check against clipped vertices
-		if( test->m_MeshVertexIndex != INVALID_HANDLE )
-			continue;
-
 		if( !VectorCompareEpsilon( test->vertex, vert->vertex, 1e-3 ))
 			continue;
 
@@ -544,7 +588,13 @@ word CStudioModelRenderer :: AddVertexToDecal( DecalBuildInfo_t& build, svert_t
 	ASSERT(( vert->stcoord[1] >= -1e-3 ) && ( vert->stcoord[1] - 1.0f < 1e-3 ));
 
 	// must create a new vertex...
-	return build.m_Vertices.AddToTail( *vert );
+	int v = build.m_Vertices.AddToTail( *vert );
+
+	build.m_VertexHashChain.EnsureCount( v + 1 );
+	build.m_VertexHashChain[v] = build.m_VertexHash[hashKey];
+	build.m_VertexHash[hashKey] = v;
+
+	return v;
 }
 
 //-----------------------------------------------------------------------------
@@ -770,6 +820,10 @@ void CStudioModelRenderer :: AddTriangleToDecal( DecalBuildInfo_t& build, int i1
 {
 	DecalVertexInfo_t* pVertexInfo = build.m_pVertexInfo;
 
+	if( !pVertexInfo[i1].m_Projected ) ProjectDecalVertex( build, i1 );
+	if( !pVertexInfo[i2].m_Projected ) ProjectDecalVertex( build, i2 );
+	if( !pVertexInfo[i3].m_Projected ) ProjectDecalVertex( build, i3 );
+
 	// All must be front-facing for a decal to be added
 	if(( !pVertexInfo[i1].m_FrontFacing ) || ( !pVertexInfo[i2].m_FrontFacing ) || ( !pVertexInfo[i3].m_FrontFacing ))
 		return;
@@ -1001,6 +1055,7 @@ void CStudioModelRenderer :: DecalCreateBuffer( DecalBuildInfo_t& build, studiod
 
 	pOut->numVerts = build.m_Vertices.Count();
 	pOut->numElems = build.m_Indices.Count();
+	pDecal->bufferType = -1;
 
 	GL_CheckVertexArrayBinding();
 
@@ -1008,6 +1063,56 @@ void CStudioModelRenderer :: DecalCreateBuffer( DecalBuildInfo_t& build, studiod
 	uint attribs = ComputeAttribFlags( m_pStudioHeader->numbones, has_bumpmap, has_boneweights, has_vertexlight, has_lightmap );
 	uint type = SelectMeshLoader( m_pStudioHeader->numbones, has_bumpmap, has_boneweights, has_vertexlight, has_lightmap );
 
+	if( AllocDecalSpace( pDecal, type, attribs ))
+	{
+		studiodecalbuffer_t *pBuffer = &m_pModelInstance->m_DecalBuffers[type];
+		unsigned int *elems = build.m_Indices.Base();
+
+		// move vertices into shared buffer
+		m_pDecalBuffer = pBuffer;
+		m_iDecalFirstVert = pDecal->firstvert;
+		if( glConfig.version < ACTUAL_GL_VERSION )
+			m_pfnMeshLoaderGL21[type].CreateBuffer( pOut, build.m_Vertices.Base() );
+		else m_pfnMeshLoaderGL30[type].CreateBuffer( pOut, build.m_Vertices.Base() );
+		m_pDecalBuffer = NULL;
+
+		// rebase indices to the decal vertices
+		for( unsigned int i = 0; i < pOut->numElems; i++ )
+			elems[i] += pDecal->firstvert;
+
+		if( !pBuffer->ibo )
+		{
+			pglGenBuffersARB( 1, &pBuffer->ibo );
+			pglBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, pBuffer->ibo );
+			pglBufferDataARB( GL_ELEMENT_ARRAY_BUFFER_ARB, MAX_DECAL_BUFFER_ELEMS * sizeof( unsigned int ), NULL, GL_DYNAMIC_DRAW_ARB );
+			pBuffer->cacheSize += MAX_DECAL_BUFFER_ELEMS * sizeof( unsigned int );
+			tr.total_vbo_memory += MAX_DECAL_BUFFER_ELEMS * sizeof( unsigned int );
+		}
+		else pglBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, pBuffer->ibo );
+
+		pglBufferSubDataARB( GL_ELEMENT_ARRAY_BUFFER_ARB, pDecal->firstelem * sizeof( unsigned int ), pOut->numElems * sizeof( unsigned int ), elems );
+		pglBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, 0 );
+		pOut->ibo = pBuffer->ibo;
+
+		// all the decals of this format are shares the single VAO
+		if( !pBuffer->vao )
+		{
+			pglGenVertexArrays( 1, &pBuffer->vao );
+			pglBindVertexArray( pBuffer->vao );
+			pBuffer->attribs = attribs;
+			if( glConfig.version < ACTUAL_GL_VERSION )
+				m_pfnMeshLoaderGL21[type].BindBuffer( pOut, attribs );
+			else m_pfnMeshLoaderGL30[type].BindBuffer( pOut, attribs );
+			BindIndexBuffer( pOut );
+			pglBindVertexArray( GL_FALSE );
+		}
+
+		pOut->vao = pBuffer->vao;
+		return;
+	}
+
+	// shared buffer is full or has another attribs, create private
+
 	// move data to video memory
 	if( glConfig.version < ACTUAL_GL_VERSION )
 		m_pfnMeshLoaderGL21[type].CreateBuffer( pOut, build.m_Vertices.Base() );
@@ -1027,6 +1132,82 @@ void CStudioModelRenderer :: DecalCreateBuffer( DecalBuildInfo_t& build, studiod
 	tr.total_vbo_memory += pOut->cacheSize;
 }
 
+/*
+====================
+FindDecalRange
+
+first fit search between decals that
+already placed into the shared buffer
+====================
+*/
+static int FindDecalRange( const studiodecal_t *list, int count, int type, bool elems, int size, int limit )
+{
+	int	start = 0;
+
+	while( start + size <= limit )
+	{
+		int	next = start;
+
+		for( int i = 0; i < count; i++ )
+		{
+			const studiodecal_t *pDecal = &list[i];
+
+			if( pDecal->bufferType != type )
+				continue;
+
+			int first = elems ? pDecal->firstelem : pDecal->firstvert;
+			int num = elems ? pDecal->mesh.numElems : pDecal->mesh.numVerts;
+
+			if( first < start + size && first + num > start )
+				next = Q_max( next, first + num );
+		}
+
+		if( next == start )
+			return start; // no overlaps
+		start = next;
+	}
+
+	return -1;
+}
+
+/*
+====================
+AllocDecalSpace
+
+space is released with decal itself so
+fragmentation is limited by r_studio_decals
+====================
+*/
+bool CStudioModelRenderer :: AllocDecalSpace( studiodecal_t *pDecal, int type, unsigned int attribs )
+{
+	const studiodecal_t *list = m_pModelInstance->m_DecalList.Base();
+	int count = m_pModelInstance->m_DecalList.Count();
+	const studiodecalbuffer_t *pBuffer = &m_pModelInstance->m_DecalBuffers[type];
+
+	// same mesh loader can enable the different arrays (e.g. bump and non-bump decals)
+	if( pBuffer->vao && pBuffer->attribs != attribs )
+		return false;
+
+	int firstvert = FindDecalRange( list, count, type, false, pDecal->mesh.numVerts, MAX_DECAL_BUFFER_VERTS );
+	if( firstvert == -1 ) return false;
+
+	int firstelem = FindDecalRange( list, count, type, true, pDecal->mesh.numElems, MAX_DECAL_BUFFER_ELEMS );
+	if( firstelem == -1 ) return false;
+
+	pDecal->bufferType = type;
+	pDecal->firstvert = firstvert;
+	pDecal->firstelem = firstelem;
+
+	return true;
+}
+
+void CStudioModelRenderer :: DeleteDecalMesh( studiodecal_t *pDecal )
+{
+	// shared buffer is released with instance
+	if( pDecal->bufferType == -1 )
+		DeleteVBOMesh( &pDecal->mesh );
+}
+
 void CStudioModelRenderer :: AllocDecalForMesh( DecalBuildInfo_t& build )
 {
 	if( build.m_Vertices.Count() <= 0 || build.m_Indices.Count() <= 0 )
@@ -1035,7 +1216,7 @@ void CStudioModelRenderer :: AllocDecalForMesh( DecalBuildInfo_t& build )
 	int index = m_pModelInstance->m_DecalList.AddToTail();
 	studiodecal_t *pDecal = &m_pModelInstance->m_DecalList[index];
 
-	memset( pDecal, 0, sizeof( studiodecal_t ));
+	*pDecal = studiodecal_t();
 
 	// copy settings
 	pDecal->normal = build.vecLocalNormal;
@@ -1067,6 +1248,9 @@ void CStudioModelRenderer :: AddDecalToMesh( DecalBuildInfo_t& build )
 	const vbomesh_t *mesh = build.m_pModelMesh;
 	Vector absmin, absmax;
 
+	if( build.m_pDecalMesh->rootnode == -1 )
+		return; // empty mesh
+
 	// setup mesh bounds
 	TransformAABB( m_pModelInstance->m_pbones[mesh->parentbone], mesh->mins, mesh->maxs, absmin, absmax );
 
@@ -1075,50 +1259,212 @@ void CStudioModelRenderer :: AddDecalToMesh( DecalBuildInfo_t& build )
 
 	build.m_Vertices.Purge();
 	build.m_Indices.Purge();
+	build.m_VertexHashChain.RemoveAll();
+	memset( build.m_VertexHash, 0xFF, sizeof( build.m_VertexHash ));
 
-	for( int j = 0; j < build.m_pDecalMesh->numindices; j += 3 )
-	{
-		int starttri = build.m_pDecalMesh->firstindex + j;
-		AddTriangleToDecal( build, m_arrayelems[starttri+0], m_arrayelems[starttri+1], m_arrayelems[starttri+2] );
-	}
+	AddDecalToNode( build, build.m_pDecalMesh->rootnode );
 
 	// allocate decal for mesh
 	AllocDecalForMesh( build );
 }
 
-void CStudioModelRenderer :: AddDecalToModel( DecalBuildInfo_t& buildInfo )
+/*
+====================
+DecalIntersectNode
+
+decal is projected along the normal so only
+U and V axes of decal space can reject the node
+====================
+*/
+bool CStudioModelRenderer :: DecalIntersectNode( DecalBuildInfo_t& build, const mstudiodecalnode_t *node )
 {
-	Vector *pstudioverts = (Vector *)((byte *)m_pStudioHeader + m_pSubModel->vertindex);
-	Vector *pstudionorms = (Vector *)((byte *)m_pStudioHeader + m_pSubModel->normindex);
-	byte *pvertbone = ((byte *)m_pStudioHeader + m_pSubModel->vertinfoindex);
-	short *pskinref;
-	int i, numVerts;
+	matrix3x4 &decalMat = m_pdecaltransform[node->bone];
+	Vector center = ( node->mins + node->maxs ) * 0.5f;
+	Vector extents = node->maxs - center;
 
-	// if weights was missed their offsets just equal to 0
-	mstudioboneweight_t	*pvertweight = (mstudioboneweight_t *)((byte *)m_pStudioHeader + m_pSubModel->blendvertinfoindex);
-	StudioMesh_t *pDecalMesh = (StudioMesh_t *)stackalloc( m_pSubModel->nummesh * sizeof( StudioMesh_t ));
-	pskinref = (short *)((byte *)m_pStudioHeader + m_pStudioHeader->skinindex);
-	if( !pDecalMesh ) return; // empty mesh?
+	for( int i = 0; i < 2; i++ )
+	{
+		float dist = center.x * decalMat[0][i] + center.y * decalMat[1][i] + center.z * decalMat[2][i] + decalMat[3][i];
+		float radius = extents.x * fabs( decalMat[0][i] ) + extents.y * fabs( decalMat[1][i] ) + extents.z * fabs( decalMat[2][i] );
+		float scale = ( i == 0 ) ? build.vecDecalScale.x : build.vecDecalScale.y;
 
-	buildInfo.m_pVertexLight = NULL;
+		// all the vertices are outside the same clip plane
+		if( fabs( dist ) - radius > 1.0f / scale )
+			return false;
+	}
 
-	if( buildInfo.modelLight != NULL )
+	return true;
+}
+
+void CStudioModelRenderer :: AddDecalToNode( DecalBuildInfo_t& build, int nodenum )
+{
+	const mstudiodecalnode_t *node = &build.m_pDecalCache->nodes[nodenum];
+
+	// rigid parts can be rejected in their bone space
+	if( node->bone != -1 && !DecalIntersectNode( build, node ))
+		return;
+
+	if( node->numelems > 0 )
 	{
-		int offset = (byte *)m_pSubModel - (byte *)m_pStudioHeader; // search for submodel offset
+		const unsigned int *elems = &build.m_pDecalCache->elems[node->firstelem];
 
-		for( i = 0; i < MAXSTUDIOMODELS; i++ )
+		for( int j = 0; j < node->numelems; j += 3 )
+			AddTriangleToDecal( build, elems[j+0], elems[j+1], elems[j+2] );
+		return;
+	}
+
+	AddDecalToNode( build, node->children[0] );
+	AddDecalToNode( build, node->children[1] );
+}
+
+/*
+=============================================================
+
+	DECAL TRIANGLE HIERARCHY
+
+=============================================================
+*/
+typedef struct
+{
+	unsigned int	elems[3];
+	int		bone;		// -1 if triangle is skinned by multiple bones
+	Vector		center;
+} decaltri_t;
+
+static mstudiodecalnode_t	*g_decalNodes;
+static int		g_numDecalNodes;
+static decaltri_t		*g_decalTris;
+static const svert_t	*g_decalVerts;
+static int		g_decalSortAxis;
+
+static int DecalTriangleBone( const unsigned int *elems )
+{
+	int	bone = g_decalVerts[elems[0]].boneid[0];
+
+	for( int i = 0; i < 3; i++ )
+	{
+		const svert_t *vert = &g_decalVerts[elems[i]];
+
+		if( vert->weight[0] != 255 || vert->boneid[0] != bone )
+			return -1;
+	}
+
+	return bone;
+}
+
+static int SortDecalTrisByBone( const void *a, const void *b )
+{
+	return ((const decaltri_t *)a)->bone - ((const decaltri_t *)b)->bone;
+}
+
+static int SortDecalTrisByAxis( const void *a, const void *b )
+{
+	float d = ((const decaltri_t *)a)->center[g_decalSortAxis] - ((const decaltri_t *)b)->center[g_decalSortAxis];
+
+	if( d < 0.0f ) return -1;
+	if( d > 0.0f ) return 1;
+	return 0;
+}
+
+/*
+====================
+BuildDecalNode
+
+triangles are grouped by bone first because vertices
+of different bones are may be placed in different spaces
+====================
+*/
+static int BuildDecalNode( decaltri_t *tris, int numtris )
+{
+	int nodenum = g_numDecalNodes++;
+	mstudiodecalnode_t *node = &g_decalNodes[nodenum];
+	bool samebones = true;
+	Vector cmins, cmaxs;
+	int i, j, split;
+
+	ClearBounds( node->mins, node->maxs );
+	ClearBounds( cmins, cmaxs );
+	node->bone = tris[0].bone;
+
+	for( i = 0; i < numtris; i++ )
+	{
+		for( j = 0; j < 3; j++ )
+			AddPointToBounds( g_decalVerts[tris[i].elems[j]].vertex, node->mins, node->maxs );
+		AddPointToBounds( tris[i].center, cmins, cmaxs );
+
+		if( tris[i].bone != tris[0].bone )
+			samebones = false;
+	}
+
+	if( !samebones )
+		node->bone = -1;
+
+	if( numtris <= DECAL_NODE_TRIS )
+	{
+		node->firstelem = ( tris - g_decalTris ) * 3;
+		node->numelems = numtris * 3;
+		node->children[0] = node->children[1] = -1;
+		return nodenum;
+	}
+
+	if( !samebones )
+	{
+		qsort( tris, numtris, sizeof( decaltri_t ), SortDecalTrisByBone );
+
+		// bone boundary closest to the middle
+		for( i = 1, split = -1; i < numtris; i++ )
 		{
-			if( buildInfo.modelLight->submodels[i].submodel_offset == offset )
-				break;			
+			if( tris[i].bone == tris[i-1].bone )
+				continue;
+
+			if( split == -1 || abs( i - numtris / 2 ) < abs( split - numtris / 2 ))
+				split = i;
 		}
+	}
+	else
+	{
+		Vector size = cmaxs - cmins;
 
-		// has vertexlighting for this submodel
-		if( i != MAXSTUDIOMODELS )
-			buildInfo.m_pVertexLight = &buildInfo.modelLight->verts[buildInfo.modelLight->submodels[i].vertex_offset];
+		if( size.x >= size.y && size.x >= size.z )
+			g_decalSortAxis = 0;
+		else if( size.y >= size.z )
+			g_decalSortAxis = 1;
+		else g_decalSortAxis = 2;
+
+		qsort( tris, numtris, sizeof( decaltri_t ), SortDecalTrisByAxis );
+		split = numtris / 2;
 	}
 
+	node->firstelem = node->numelems = 0;
+	node->children[0] = BuildDecalNode( tris, split );
+	node->children[1] = BuildDecalNode( tris + split, numtris - split );
+
+	return nodenum;
+}
+
+/*
+====================
+CreateDecalCache
+
+unpack submodel triangles and build the hierarchy,
+it's shared by all the instances of this model
+====================
+*/
+mstudiodecalcache_t *CStudioModelRenderer :: CreateDecalCache( void )
+{
+	Vector *pstudioverts = (Vector *)((byte *)m_pStudioHeader + m_pSubModel->vertindex);
+	Vector *pstudionorms = (Vector *)((byte *)m_pStudioHeader + m_pSubModel->normindex);
+	byte *pvertbone = ((byte *)m_pStudioHeader + m_pSubModel->vertinfoindex);
+	short *pskinref;
+	int i, numVerts;
+
+	// if weights was missed their offsets just equal to 0
+	mstudioboneweight_t	*pvertweight = (mstudioboneweight_t *)((byte *)m_pStudioHeader + m_pSubModel->blendvertinfoindex);
+	StudioMesh_t *pMeshes = (StudioMesh_t *)stackalloc( m_pSubModel->nummesh * sizeof( StudioMesh_t ));
+	pskinref = (short *)((byte *)m_pStudioHeader + m_pStudioHeader->skinindex);
+	if( !pMeshes ) return NULL; // empty mesh?
+
 	m_nNumArrayVerts = m_nNumArrayElems = 0;
-	m_nNumLightVerts = 0;
 
 	// build all the data for current submodel
 	for( i = 0; i < m_pSubModel->nummesh; i++ ) 
@@ -1126,7 +1472,7 @@ void CStudioModelRenderer :: AddDecalToModel( DecalBuildInfo_t& buildInfo )
 		mstudiomesh_t *pmesh = (mstudiomesh_t *)((byte *)m_pStudioHeader + m_pSubModel->meshindex) + i;
 		mstudiomaterial_t *pmaterial = &RI->currentmodel->materials[pskinref[pmesh->skinref]];
 		short *ptricmds = (short *)((byte *)m_pStudioHeader + pmesh->triindex);
-		StudioMesh_t *pCurMesh = pDecalMesh + i;
+		StudioMesh_t *pCurMesh = &pMeshes[i];
 
 		pCurMesh->firstvertex = m_nNumArrayVerts;
 		pCurMesh->firstindex = m_nNumArrayElems;
@@ -1229,18 +1575,9 @@ void CStudioModelRenderer :: AddDecalToModel( DecalBuildInfo_t& buildInfo )
 					out->stcoord[3] = ptricmds[3] * t;
 				}
 
-				// accumulate vertex lighting too
-				if( buildInfo.m_pVertexLight != NULL )
-				{
-					dvertlight_t *vl = &buildInfo.m_pVertexLight[m_nNumLightVerts++];
-
-					// now setup light and deluxe vector
-					for( int map = 0; map < MAXLIGHTMAPS; map++ )
-					{
-						out->light[map] = PackColor( vl->light[map] );
-						out->deluxe[map] = PackColor( vl->deluxe[map] );
-					}
-				}
+				// vertex lighting is applied per instance
+				memset( out->light, 0, sizeof( out->light ));
+				memset( out->deluxe, 0, sizeof( out->deluxe ));
 				m_nNumArrayVerts++;
 			}
 		}
@@ -1249,13 +1586,120 @@ void CStudioModelRenderer :: AddDecalToModel( DecalBuildInfo_t& buildInfo )
 		pCurMesh->numindices = m_nNumArrayElems - pCurMesh->firstindex;
 	}
 
-	// should keep all the verts of this submodel, because we use direct access by vertex number
-	buildInfo.m_pVertexInfo = (DecalVertexInfo_t *)stackalloc( m_nNumArrayVerts * sizeof( DecalVertexInfo_t ));
+	int numtris = m_nNumArrayElems / 3;
+	if( numtris <= 0 ) return NULL;
+
+	g_decalTris = (decaltri_t *)Mem_Alloc( numtris * sizeof( decaltri_t ));
+	g_decalNodes = (mstudiodecalnode_t *)Mem_Alloc( numtris * 2 * sizeof( mstudiodecalnode_t ));
+	g_decalVerts = m_arrayxvert;
+	g_numDecalNodes = 0;
+
+	for( i = 0; i < numtris; i++ )
+	{
+		decaltri_t *tri = &g_decalTris[i];
+
+		tri->elems[0] = m_arrayelems[i*3+0];
+		tri->elems[1] = m_arrayelems[i*3+1];
+		tri->elems[2] = m_arrayelems[i*3+2];
+		tri->bone = DecalTriangleBone( tri->elems );
+		tri->center = ( m_arrayxvert[tri->elems[0]].vertex + m_arrayxvert[tri->elems[1]].vertex + m_arrayxvert[tri->elems[2]].vertex ) * (1.0f / 3.0f);
+	}
+
+	mstudiodecalmesh_t *pDecalMeshes = (mstudiodecalmesh_t *)stackalloc( m_pSubModel->nummesh * sizeof( mstudiodecalmesh_t ));
+
+	// meshes are sorted independently to keep the triangles in their meshes
+	for( i = 0; i < m_pSubModel->nummesh; i++ )
+	{
+		pDecalMeshes[i].firstelem = pMeshes[i].firstindex;
+		pDecalMeshes[i].numelems = pMeshes[i].numindices;
+
+		if( pMeshes[i].numindices >= 3 )
+			pDecalMeshes[i].rootnode = BuildDecalNode( &g_decalTris[pMeshes[i].firstindex / 3], pMeshes[i].numindices / 3 );
+		else pDecalMeshes[i].rootnode = -1;
+	}
+
+	// copy everything into single block
+	size_t cacheSize = sizeof( mstudiodecalcache_t );
+	cacheSize += m_nNumArrayVerts * sizeof( svert_t );
+	cacheSize += g_numDecalNodes * sizeof( mstudiodecalnode_t );
+	cacheSize += m_pSubModel->nummesh * sizeof( mstudiodecalmesh_t );
+	cacheSize += m_nNumArrayElems * sizeof( unsigned int );
+
+	byte *buffer = (byte *)Mem_Alloc( cacheSize );
+	mstudiodecalcache_t *cache = (mstudiodecalcache_t *)buffer;
+	buffer += sizeof( mstudiodecalcache_t );
+
+	cache->verts = (svert_t *)buffer;
+	cache->numverts = m_nNumArrayVerts;
+	for( i = 0; i < cache->numverts; i++ )
+		cache->verts[i] = m_arrayxvert[i];
+	buffer += m_nNumArrayVerts * sizeof( svert_t );
+
+	cache->nodes = (mstudiodecalnode_t *)buffer;
+	cache->numnodes = g_numDecalNodes;
+	for( i = 0; i < g_numDecalNodes; i++ )
+		cache->nodes[i] = g_decalNodes[i];
+	buffer += g_numDecalNodes * sizeof( mstudiodecalnode_t );
+
+	cache->meshes = (mstudiodecalmesh_t *)buffer;
+	memcpy( cache->meshes, pDecalMeshes, m_pSubModel->nummesh * sizeof( mstudiodecalmesh_t ));
+	buffer += m_pSubModel->nummesh * sizeof( mstudiodecalmesh_t );
+
+	cache->elems = (unsigned int *)buffer;
+	cache->numelems = m_nNumArrayElems;
+
+	for( i = 0; i < numtris; i++ )
+	{
+		cache->elems[i*3+0] = g_decalTris[i].elems[0];
+		cache->elems[i*3+1] = g_decalTris[i].elems[1];
+		cache->elems[i*3+2] = g_decalTris[i].elems[2];
+	}
+
+	Mem_Free( g_decalTris );
+	Mem_Free( g_decalNodes );
+	g_decalTris = NULL;
+	g_decalNodes = NULL;
+	g_decalVerts = NULL;
+
+	return cache;
+}
+
+void CStudioModelRenderer :: AddDecalToModel( DecalBuildInfo_t& buildInfo )
+{
+	int i;
+
+	if( !m_pVboModel || m_pSubModel->nummesh <= 0 )
+		return; // blank submodel
 
-	// project all vertices for this group into decal space
-	// Note we do this work at a mesh level instead of a model level
-	// because vertices are not shared across mesh boundaries
-	ProjectDecalOntoMesh( buildInfo );
+	// bind pose triangles is built once for all the decals
+	if( !m_pVboModel->decalcache )
+		m_pVboModel->decalcache = CreateDecalCache();
+
+	mstudiodecalcache_t *cache = m_pVboModel->decalcache;
+	if( !cache ) return; // empty mesh?
+
+	buildInfo.m_pVertexLight = NULL;
+
+	if( buildInfo.modelLight != NULL )
+	{
+		int offset = (byte *)m_pSubModel - (byte *)m_pStudioHeader; // search for submodel offset
+
+		for( i = 0; i < MAXSTUDIOMODELS; i++ )
+		{
+			if( buildInfo.modelLight->submodels[i].submodel_offset == offset )
+				break;			
+		}
+
+		// has vertexlighting for this submodel
+		if( i != MAXSTUDIOMODELS )
+			buildInfo.m_pVertexLight = &buildInfo.modelLight->verts[buildInfo.modelLight->submodels[i].vertex_offset];
+	}
+
+	// should keep all the verts of this submodel, because we use direct access by vertex number
+	buildInfo.m_pVertexInfo = (DecalVertexInfo_t *)stackalloc( cache->numverts * sizeof( DecalVertexInfo_t ));
+	for( i = 0; i < cache->numverts; i++ )
+		buildInfo.m_pVertexInfo[i] = DecalVertexInfo_t();
+	buildInfo.m_pDecalCache = cache;
 
 	// NOTE: we should add the individual decals for each mesh
 	// to effectively sorting while renderer translucent meshes
@@ -1263,7 +1707,7 @@ void CStudioModelRenderer :: AddDecalToModel( DecalBuildInfo_t& buildInfo )
 	{
 		// setup mesh pointers
 		buildInfo.m_pModelMesh = &m_pVboModel->meshes[i];
-		buildInfo.m_pDecalMesh = pDecalMesh + i;
+		buildInfo.m_pDecalMesh = &cache->meshes[i];
 		AddDecalToMesh( buildInfo );
 	}
 }
@@ -1360,6 +1804,8 @@ void CStudioModelRenderer :: StudioDecalShoot( const Vector &vecNormal, const Ve
 	if( !g_fRenderInitialized )
 		return;
 
+	PROF_SCOPE( "StudioDecalShoot" );
+
 	// setup studio pointers
 	if( !StudioSetEntity( ent ))
 		return;
@@ -1457,8 +1903,8 @@ check_decals:
 
 			if( pDecal->depth == depth )
 			{
-				DeleteVBOMesh( &pDecal->mesh );
-				memset( pDecal, 0 , sizeof( *pDecal ));
+				DeleteDecalMesh( pDecal );
+				*pDecal = studiodecal_t();
 				m_pModelInstance->m_DecalList.Remove( i );
 				goto check_decals;
 			}
@@ -1711,6 +2157,28 @@ void CStudioModelRenderer :: SetDecalUniforms( studiodecal_t *pDecal )
 	}
 }
 
+void CStudioModelRenderer :: DrawDecalFromBuffer( const studiodecal_t *pDecal )
+{
+	const vbomesh_t *mesh = &pDecal->mesh;
+
+	if( pDecal->bufferType == -1 )
+	{
+		DrawMeshFromBuffer( mesh );
+		return;
+	}
+
+	// draw the range of shared buffer
+	const void *offset = (const void *)( pDecal->firstelem * sizeof( unsigned int ));
+	pglBindVertexArray( mesh->vao );
+
+	if( GL_Support( R_DRAW_RANGEELEMENTS_EXT ))
+		pglDrawRangeElementsEXT( GL_TRIANGLES, pDecal->firstvert, pDecal->firstvert + mesh->numVerts - 1, mesh->numElems, GL_UNSIGNED_INT, offset );
+	else pglDrawElements( GL_TRIANGLES, mesh->numElems, GL_UNSIGNED_INT, offset );
+
+	r_stats.c_total_tris += (mesh->numElems / 3);
+	r_stats.num_flushes++;
+}
+
 //-----------------------------------------------------------------------------
 // Draws all the decals on a particular model
 //-----------------------------------------------------------------------------
@@ -1751,7 +2219,7 @@ void CStudioModelRenderer :: DrawDecal( CSolidEntry *entry, GLenum cull_mode )
 			if( pDecal->texinfo->opaque )
 				pglBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 			else pglBlendFunc( GL_DST_COLOR, GL_SRC_COLOR );
-			DrawMeshFromBuffer( &pDecal->mesh );
+			DrawDecalFromBuffer( pDecal );
 		}
 	}
 	else
@@ -1768,7 +2236,7 @@ void CStudioModelRenderer :: DrawDecal( CSolidEntry *entry, GLenum cull_mode )
 			if( pDecal->texinfo->opaque )
 				pglBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 			else pglBlendFunc( GL_DST_COLOR, GL_SRC_COLOR );
-			DrawMeshFromBuffer( &pDecal->mesh );
+			DrawDecalFromBuffer( pDecal );
 		}
 	}
 
@@ -57,6 +57,52 @@ mesh_loader_t CStudioModelRenderer :: m_pfnMeshLoaderGL30[MESHLOADER_COUNT] =
 { CreateBufferGenericGL30, BindBufferGenericGL30, "GenericBuffer" },
 };
 
+studiodecalbuffer_t *CStudioModelRenderer :: m_pDecalBuffer = NULL;
+int CStudioModelRenderer :: m_iDecalFirstVert = 0;
+
+/*
+====================
+CreateVertexBuffer
+
+move converted vertices to video memory,
+decal may be placed into shared instance buffer
+====================
+*/
+void CStudioModelRenderer :: CreateVertexBuffer( vbomesh_t *pOut, const void *arraysvert )
+{
+	studiodecalbuffer_t *pBuffer = m_pDecalBuffer;
+
+	if( pBuffer != NULL )
+	{
+		int stride = pOut->cacheSize / pOut->numVerts;
+
+		if( !pBuffer->vbo )
+		{
+			pBuffer->stride = stride;
+			pglGenBuffersARB( 1, &pBuffer->vbo );
+			pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pBuffer->vbo );
+			pglBufferDataARB( GL_ARRAY_BUFFER_ARB, stride * MAX_DECAL_BUFFER_VERTS, NULL, GL_DYNAMIC_DRAW_ARB );
+			pBuffer->cacheSize += stride * MAX_DECAL_BUFFER_VERTS;
+			tr.total_vbo_memory += stride * MAX_DECAL_BUFFER_VERTS;
+		}
+		else pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pBuffer->vbo );
+
+		ASSERT( pBuffer->stride == stride );
+		pglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, m_iDecalFirstVert * stride, pOut->cacheSize, arraysvert );
+		pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+
+		// memory is owned by instance
+		pOut->vbo = pBuffer->vbo;
+		pOut->cacheSize = 0;
+		return;
+	}
+
+	pglGenBuffersARB( 1, &pOut->vbo );
+	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
+	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, arraysvert, GL_STATIC_DRAW_ARB );
+	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+}
+
 void CStudioModelRenderer :: CreateBufferBaseGL21( vbomesh_t *pOut, svert_t *arrayxvert )
 {
 	static svert_v0_gl21_t	arraysvert[MAXARRAYVERTS];
@@ -79,10 +125,7 @@ void CStudioModelRenderer :: CreateBufferBaseGL21( vbomesh_t *pOut, svert_t *arr
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v0_gl21_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferBaseGL21( vbomesh_t *pOut, int attrFlags )
@@ -122,10 +165,7 @@ void CStudioModelRenderer :: CreateBufferBaseGL30( vbomesh_t *pOut, svert_t *arr
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v0_gl30_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferBaseGL30( vbomesh_t *pOut, int attrFlags )
@@ -173,10 +213,7 @@ void CStudioModelRenderer :: CreateBufferBaseBumpGL21( vbomesh_t *pOut, svert_t
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v1_gl21_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferBaseBumpGL21( vbomesh_t *pOut, int attrFlags )
@@ -224,10 +261,7 @@ void CStudioModelRenderer :: CreateBufferBaseBumpGL30( vbomesh_t *pOut, svert_t
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v1_gl30_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferBaseBumpGL30( vbomesh_t *pOut, int attrFlags )
@@ -278,10 +312,7 @@ void CStudioModelRenderer :: CreateBufferVLightGL21( vbomesh_t *pOut, svert_t *a
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v2_gl21_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferVLightGL21( vbomesh_t *pOut, int attrFlags )
@@ -324,10 +355,7 @@ void CStudioModelRenderer :: CreateBufferVLightGL30( vbomesh_t *pOut, svert_t *a
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v2_gl30_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferVLightGL30( vbomesh_t *pOut, int attrFlags )
@@ -382,10 +410,7 @@ void CStudioModelRenderer :: CreateBufferVLightBumpGL21( vbomesh_t *pOut, svert_
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v3_gl21_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferVLightBumpGL21( vbomesh_t *pOut, int attrFlags )
@@ -443,10 +468,7 @@ void CStudioModelRenderer :: CreateBufferVLightBumpGL30( vbomesh_t *pOut, svert_
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v3_gl30_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferVLightBumpGL30( vbomesh_t *pOut, int attrFlags )
@@ -504,10 +526,7 @@ void CStudioModelRenderer :: CreateBufferWeightGL21( vbomesh_t *pOut, svert_t *a
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v4_gl21_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferWeightGL21( vbomesh_t *pOut, int attrFlags )
@@ -557,10 +576,7 @@ void CStudioModelRenderer :: CreateBufferWeightGL30( vbomesh_t *pOut, svert_t *a
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v4_gl30_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferWeightGL30( vbomesh_t *pOut, int attrFlags )
@@ -618,10 +634,7 @@ void CStudioModelRenderer :: CreateBufferWeightBumpGL21( vbomesh_t *pOut, svert_
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v5_gl21_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferWeightBumpGL21( vbomesh_t *pOut, int attrFlags )
@@ -679,10 +692,7 @@ void CStudioModelRenderer :: CreateBufferWeightBumpGL30( vbomesh_t *pOut, svert_
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v5_gl30_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferWeightBumpGL30( vbomesh_t *pOut, int attrFlags )
@@ -744,10 +754,7 @@ void CStudioModelRenderer :: CreateBufferLightMapGL21( vbomesh_t *pOut, svert_t
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v6_gl21_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferLightMapGL21( vbomesh_t *pOut, int attrFlags )
@@ -804,10 +811,7 @@ void CStudioModelRenderer :: CreateBufferLightMapGL30( vbomesh_t *pOut, svert_t
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v6_gl30_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferLightMapGL30( vbomesh_t *pOut, int attrFlags )
@@ -872,10 +876,7 @@ void CStudioModelRenderer :: CreateBufferLightMapBumpGL21( vbomesh_t *pOut, sver
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v7_gl21_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferLightMapBumpGL21( vbomesh_t *pOut, int attrFlags )
@@ -940,10 +941,7 @@ void CStudioModelRenderer :: CreateBufferLightMapBumpGL30( vbomesh_t *pOut, sver
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v7_gl30_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferLightMapBumpGL30( vbomesh_t *pOut, int attrFlags )
@@ -1030,10 +1028,7 @@ void CStudioModelRenderer :: CreateBufferGenericGL21( vbomesh_t *pOut, svert_t *
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v8_gl21_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferGenericGL21( vbomesh_t *pOut, int attrFlags )
@@ -1162,10 +1157,7 @@ void CStudioModelRenderer :: CreateBufferGenericGL30( vbomesh_t *pOut, svert_t *
 
 	pOut->cacheSize = pOut->numVerts * sizeof( svert_v8_gl30_t );
 
-	pglGenBuffersARB( 1, &pOut->vbo );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, pOut->vbo );
-	pglBufferDataARB( GL_ARRAY_BUFFER_ARB, pOut->cacheSize, &arraysvert[0], GL_STATIC_DRAW_ARB );
-	pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+	CreateVertexBuffer( pOut, &arraysvert[0] );
 }
 
 void CStudioModelRenderer :: BindBufferGenericGL30( vbomesh_t *pOut, int attrFlags )
@@ -279,6 +279,7 @@ void R_RenderSubview( void )
 	ref_instance_t	*prevRI;
 	unsigned int	oldFBO;
 	ref_viewpass_t	rvp;
+	PROF_SCOPE( "R_RenderSubview" );
 
 	// player is outside world. Don't draw subview for speedup reasons
 	if( R_CheckOutside( ))
@@ -30,6 +30,10 @@ GNU General Public License for more details.
 
 #define MAX_MAP_ELEMS	MAX_MAP_VERTS * 5	// should be enough
 #define SHADOW_ZBUF_RES	8		// 6 * 8 * 8 * 2 * 4 = 3k bytes per light
+#define LIGHTGRID_CELL_SIZE	256.0f		// initial size, will be grow up for huge maps
+#define LIGHTGRID_MAX_CELLS	32768
+#define LIGHTGRID_MAX_SPAN	512		// lights that covers more cells are global
+#define MAX_LIGHT_CANDIDATES	1024		// worldlights that gathered by single query
 
 // rebuilding cubemap states
 #define CMREBUILD_INACTIVE	0
@@ -80,6 +84,43 @@ typedef struct mworldlight_s
 	unsigned short	shadow_h;		// 0 is uninitialized
 } mworldlight_t;
 
+// k-d tree node over cubemap origins
+typedef struct
+{
+	short		cubemap;		// index into world->cubemaps
+	short		axis;		// split axis
+	short		children[2];	// -1 is no child, children[0] is on negative side
+} mcubenode_t;
+
+// uniform grid of worldlights for fast lookup
+typedef struct
+{
+	vec3_t		mins;
+	float		cellsize;
+	int		size[3];
+	int		*cells;		// [numcells + 1] offsets into lightnums
+	int		*lightnums;
+	int		*global;		// lights that can't be bounded (skylight etc)
+	int		numglobal;
+	int		*stamps;		// [numworldlights] avoid to check same light twice
+	int		stampcount;
+	bool		overflowed;	// candidate list overflow was reported
+} mlightgrid_t;
+
+typedef struct
+{
+	float		weight;
+	int		lightnum;
+} lightweight_t;
+
+// bounded top-k selection of the strongest lights
+typedef struct
+{
+	lightweight_t	heap[MAXDYNLIGHTS];	// min-heap, weakest light at root
+	int		count;
+	int		maxcount;
+} lightselect_t;
+
 // leaf extradata
 typedef struct mextraleaf_s
 {
@@ -135,6 +176,7 @@ typedef struct
 
 	int		numworldlights;
 	mworldlight_t	*worldlights;
+	mlightgrid_t	lightgrid;
 
 	dvertnorm_t	*surfnormals;	// is not NULL here a indexed normals
 	dnormal_t		*normals;
@@ -143,6 +185,8 @@ typedef struct
 	mcubemap_t	cubemaps[MAX_MAP_CUBEMAPS];
 	mcubemap_t	defaultCubemap;
 	int		num_cubemaps;
+	mcubenode_t	cubemap_tree[MAX_MAP_CUBEMAPS];
+	int		cubemap_root;	// -1 if tree is empty
 
 	terrain_t		*terrains;
 	unsigned int	num_terrains;
@@ -162,10 +206,18 @@ typedef struct
 	// single buffer for all the models
 	uint		vertex_buffer_object;
 	uint		vertex_array_object;
+	uint		element_buffer_object;	// static triangle fans, for multi-draw
+	uint		*firstelems;	// [worldmodel->numsurfaces] offsets into element buffer
 	uint		cacheSize;
 
 	unsigned short	*sortedfaces;	// surfaces sorted through all models
 	unsigned short	numsortedfaces;
+	unsigned short	*lightmapfaces;	// world faces grouped by lightmap page
+
+	// bounds packed by four for CullBoxes
+	float		*packedleafs;	// [world->numleafs]
+	float		*packedsurfs;	// [worldmodel->numsurfaces]
+	byte		*culledfaces;	// frustum culled world faces for current view
 
 	// misc info
 	Vector2D		orthocenter;	// overview stuff
@@ -180,4 +232,8 @@ typedef struct
 
 extern gl_world_t	*world;
 
+void Mod_InitLightSelect( lightselect_t *ls, int maxcount );
+void Mod_AddLightToSelect( lightselect_t *ls, int lightnum, float weight );
+int Mod_FinishLightSelect( lightselect_t *ls, byte lights[MAXDYNLIGHTS] );
+
 #endif//GL_WORLD_H
\ No newline at end of file
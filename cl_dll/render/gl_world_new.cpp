@@ -25,6 +25,8 @@ GNU General Public License for more details.
 #include "gl_grass.h"
 #include "gl_occlusion.h"
 #include "vertex_fmt.h"
+#include "jobs.h"
+#include "tbnfile.h"
 
 static gl_world_t	worlddata;
 gl_world_t *world = &worlddata;
@@ -135,6 +137,7 @@ static void Mod_FreeCubemaps( void )
 	world->loading_cubemaps = false;
 	world->cubemap_build_number = 0;
 	world->num_cubemaps = 0;
+	world->cubemap_root = -1;
 }
 
 /*
@@ -235,6 +238,8 @@ void GL_LoadAndRebuildCubemaps( int refParams )
 	if( FBitSet( refParams, RP_ENVVIEW|RP_SKYVIEW ))
 		return;
 
+	LOAD_ZONE( "GL_LoadAndRebuildCubemaps" );
+
 	if( world->rebuilding_cubemaps != CMREBUILD_INACTIVE )
 	{
 		if( world->build_default_cubemap )
@@ -359,6 +364,7 @@ Mod_LoadCubemaps
 */
 static void Mod_LoadCubemaps( const byte *base, const dlump_t *l )
 {
+	LOAD_ZONE( "Mod_LoadCubemaps" );
 	dcubemap_t	*in;
 	mcubemap_t	*out;
 	int		i, count;
@@ -421,6 +427,9 @@ static void Mod_LoadCubemaps( const byte *base, const dlump_t *l )
 		out->size = bound( 1, out->size, 512 );
 	}
 
+	// acceleration structure for nearest cubemap search
+	CL_BuildCubemapTree();
+
 	// user request for disable autorebuild
 	if( gEngfuncs.CheckParm( "-noautorebuildcubemaps", NULL ))
 	{ 
@@ -458,6 +467,7 @@ build a material for each world texture
 */
 static void Mod_LoadWorldMaterials( void )
 {
+	LOAD_ZONE( "Mod_LoadWorldMaterials" );
 	char	diffuse[128], bumpmap[128];
 	char	glossmap[128], glowmap[128];
 	char	heightmap[128];
@@ -657,6 +667,317 @@ static void Mod_SetupLeafLights( void )
 	}	
 }
 
+/*
+=================
+Mod_LightGridBounds
+
+cells that can be lit by the light
+returns false for unbounded lights
+=================
+*/
+static bool Mod_LightGridBounds( const mworldlight_t *wl, int cmin[3], int cmax[3] )
+{
+	mlightgrid_t *grid = &world->lightgrid;
+	int span = 1;
+
+	if( wl->emittype == emit_skylight || wl->radius <= 0.0f )
+		return false;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		cmin[i] = (int)floor(( wl->origin[i] - wl->radius - grid->mins[i] ) / grid->cellsize );
+		cmax[i] = (int)floor(( wl->origin[i] + wl->radius - grid->mins[i] ) / grid->cellsize );
+		cmin[i] = bound( 0, cmin[i], grid->size[i] - 1 );
+		cmax[i] = bound( 0, cmax[i], grid->size[i] - 1 );
+		span *= ( cmax[i] - cmin[i] + 1 );
+	}
+
+	// too huge light, keep it in global list
+	return ( span <= LIGHTGRID_MAX_SPAN );
+}
+
+/*
+=================
+Mod_BuildLightGrid
+
+link worldlights into uniform grid
+=================
+*/
+static void Mod_BuildLightGrid( void )
+{
+	LOAD_ZONE( "Mod_BuildLightGrid" );
+	mlightgrid_t *grid = &world->lightgrid;
+	int cmin[3], cmax[3];
+	int i, x, y, z, numcells;
+	mworldlight_t *wl;
+	int total = 0;
+
+	if( world->numworldlights <= 0 )
+		return;
+
+	grid->cellsize = LIGHTGRID_CELL_SIZE;
+	VectorCopy( worldmodel->mins, grid->mins );
+
+	// grow cells for huge maps
+	while( 1 )
+	{
+		for( i = 0; i < 3; i++ )
+		{
+			grid->size[i] = (int)ceil(( worldmodel->maxs[i] - worldmodel->mins[i] ) / grid->cellsize );
+			grid->size[i] = Q_max( grid->size[i], 1 );
+		}
+
+		numcells = grid->size[0] * grid->size[1] * grid->size[2];
+		if( numcells <= LIGHTGRID_MAX_CELLS ) break;
+		grid->cellsize *= 2.0f;
+	}
+
+	grid->cells = (int *)Mem_Alloc( sizeof( int ) * ( numcells + 1 ));
+	grid->global = (int *)Mem_Alloc( sizeof( int ) * world->numworldlights );
+	grid->stamps = (int *)Mem_Alloc( sizeof( int ) * world->numworldlights );
+
+	// count lights per cell
+	for( i = 0, wl = world->worldlights; i < world->numworldlights; i++, wl++ )
+	{
+		if( wl->emittype == emit_ignored )
+			continue;
+
+		if( !Mod_LightGridBounds( wl, cmin, cmax ))
+		{
+			grid->global[grid->numglobal++] = i;
+			continue;
+		}
+
+		for( z = cmin[2]; z <= cmax[2]; z++ )
+			for( y = cmin[1]; y <= cmax[1]; y++ )
+				for( x = cmin[0]; x <= cmax[0]; x++ )
+					grid->cells[(z * grid->size[1] + y) * grid->size[0] + x + 1]++;
+	}
+
+	// turn counts into offsets
+	for( i = 0; i < numcells; i++ )
+		grid->cells[i + 1] += grid->cells[i];
+	total = grid->cells[numcells];
+
+	if( total > 0 )
+		grid->lightnums = (int *)Mem_Alloc( sizeof( int ) * total );
+
+	// fill the cells
+	int *cursor = (int *)Mem_Alloc( sizeof( int ) * numcells );
+	memcpy( cursor, grid->cells, sizeof( int ) * numcells );
+
+	for( i = 0, wl = world->worldlights; i < world->numworldlights; i++, wl++ )
+	{
+		if( wl->emittype == emit_ignored )
+			continue;
+
+		if( !Mod_LightGridBounds( wl, cmin, cmax ))
+			continue;
+
+		for( z = cmin[2]; z <= cmax[2]; z++ )
+			for( y = cmin[1]; y <= cmax[1]; y++ )
+				for( x = cmin[0]; x <= cmax[0]; x++ )
+					grid->lightnums[cursor[(z * grid->size[1] + y) * grid->size[0] + x]++] = i;
+	}
+
+	Mem_Free( cursor );
+
+	ALERT( at_aiconsole, "light grid %i x %i x %i (cell %g), %i links, %i global lights\n",
+	grid->size[0], grid->size[1], grid->size[2], grid->cellsize, total, grid->numglobal );
+}
+
+static void Mod_FreeLightGrid( void )
+{
+	mlightgrid_t *grid = &world->lightgrid;
+
+	if( grid->cells ) Mem_Free( grid->cells );
+	if( grid->lightnums ) Mem_Free( grid->lightnums );
+	if( grid->global ) Mem_Free( grid->global );
+	if( grid->stamps ) Mem_Free( grid->stamps );
+
+	grid->mins = g_vecZero;
+	grid->cellsize = 0.0f;
+	grid->size[0] = grid->size[1] = grid->size[2] = 0;
+	grid->cells = grid->lightnums = grid->global = grid->stamps = NULL;
+	grid->numglobal = 0;
+	grid->stampcount = 0;
+	grid->overflowed = false;
+}
+
+static int Mod_LightCandidatesOverflow( mlightgrid_t *grid, int count )
+{
+	// report once per map, the rest of lights is dropped
+	if( !grid->overflowed )
+		ALERT( at_aiconsole, "Mod_GatherWorldLights: too many light candidates (%i max)\n", count );
+	grid->overflowed = true;
+
+	return count;
+}
+
+/*
+=================
+Mod_GatherWorldLights
+
+collect lights that potentially can lit bbox
+NOTE: main thread only, the cell stamps are shared
+=================
+*/
+int Mod_GatherWorldLights( const Vector &absmin, const Vector &absmax, int *list, int maxlist )
+{
+	mlightgrid_t *grid = &world->lightgrid;
+	int cmin[3], cmax[3];
+	int i, j, x, y, z;
+	int count = 0;
+
+	if( !grid->cells ) return 0;
+
+	ASSERT( !JOB_InProgress( ));
+
+	grid->stampcount++;
+
+	for( i = 0; i < grid->numglobal; i++ )
+	{
+		if( count >= maxlist )
+			return Mod_LightCandidatesOverflow( grid, count );
+		list[count++] = grid->global[i];
+	}
+
+	for( i = 0; i < 3; i++ )
+	{
+		cmin[i] = (int)floor(( absmin[i] - grid->mins[i] ) / grid->cellsize );
+		cmax[i] = (int)floor(( absmax[i] - grid->mins[i] ) / grid->cellsize );
+		cmin[i] = bound( 0, cmin[i], grid->size[i] - 1 );
+		cmax[i] = bound( 0, cmax[i], grid->size[i] - 1 );
+	}
+
+	for( z = cmin[2]; z <= cmax[2]; z++ )
+	{
+		for( y = cmin[1]; y <= cmax[1]; y++ )
+		{
+			for( x = cmin[0]; x <= cmax[0]; x++ )
+			{
+				int cell = (z * grid->size[1] + y) * grid->size[0] + x;
+
+				for( j = grid->cells[cell]; j < grid->cells[cell + 1]; j++ )
+				{
+					int lightnum = grid->lightnums[j];
+
+					if( grid->stamps[lightnum] == grid->stampcount )
+						continue; // already added from another cell
+
+					if( count >= maxlist )
+						return Mod_LightCandidatesOverflow( grid, count );
+
+					grid->stamps[lightnum] = grid->stampcount;
+					list[count++] = lightnum;
+				}
+			}
+		}
+	}
+
+	return count;
+}
+
+/*
+=================
+Mod_InitLightSelect
+
+bounded selection of strongest lights
+=================
+*/
+void Mod_InitLightSelect( lightselect_t *ls, int maxcount )
+{
+	ls->maxcount = bound( 0, maxcount, MAXDYNLIGHTS );	// 0 disables the lights
+	ls->count = 0;
+}
+
+// light with lower index wins for equal weights
+static inline bool Mod_LightWeaker( const lightweight_t *a, const lightweight_t *b )
+{
+	if( a->weight != b->weight )
+		return ( a->weight < b->weight );
+	return ( a->lightnum > b->lightnum );
+}
+
+static void Mod_LightSelectSiftDown( lightselect_t *ls, int i )
+{
+	while( 1 )
+	{
+		int child = i * 2 + 1;
+
+		if( child >= ls->count )
+			break;
+
+		if(( child + 1 ) < ls->count && Mod_LightWeaker( &ls->heap[child + 1], &ls->heap[child] ))
+			child++;
+
+		if( !Mod_LightWeaker( &ls->heap[child], &ls->heap[i] ))
+			break;
+
+		lightweight_t tmp = ls->heap[i];
+		ls->heap[i] = ls->heap[child];
+		ls->heap[child] = tmp;
+		i = child;
+	}
+}
+
+void Mod_AddLightToSelect( lightselect_t *ls, int lightnum, float weight )
+{
+	lightweight_t lw;
+
+	if( weight <= 0.0f )
+		return;
+
+	lw.weight = weight;
+	lw.lightnum = lightnum;
+
+	if( ls->count < ls->maxcount )
+	{
+		int i = ls->count++;
+
+		// sift up
+		while( i > 0 )
+		{
+			int parent = ( i - 1 ) / 2;
+
+			if( !Mod_LightWeaker( &lw, &ls->heap[parent] ))
+				break;
+			ls->heap[i] = ls->heap[parent];
+			i = parent;
+		}
+		ls->heap[i] = lw;
+	}
+	else if( ls->count > 0 && Mod_LightWeaker( &ls->heap[0], &lw ))
+	{
+		// replace the weakest light
+		ls->heap[0] = lw;
+		Mod_LightSelectSiftDown( ls, 0 );
+	}
+}
+
+/*
+=================
+Mod_FinishLightSelect
+
+store lights from strongest to weakest
+=================
+*/
+int Mod_FinishLightSelect( lightselect_t *ls, byte lights[MAXDYNLIGHTS] )
+{
+	int count = ls->count;
+
+	memset( lights, 255, sizeof( byte ) * MAXDYNLIGHTS );
+
+	while( ls->count > 0 )
+	{
+		lights[ls->count - 1] = ls->heap[0].lightnum;
+		ls->heap[0] = ls->heap[--ls->count];
+		Mod_LightSelectSiftDown( ls, 0 );
+	}
+
+	return count;
+}
+
 /*
 =================
 Mod_LoadVertNormals
@@ -664,6 +985,7 @@ Mod_LoadVertNormals
 */
 static void Mod_LoadVertNormals( const byte *base, const dlump_t *l )
 {
+	LOAD_ZONE( "Mod_LoadVertNormals" );
 	dnormallump_t	*nhdr;
 	byte		*data;
 
@@ -764,6 +1086,7 @@ Mod_LoadWorldLights
 */
 static void Mod_LoadWorldLights( const byte *base, const dlump_t *l )
 {
+	LOAD_ZONE( "Mod_LoadWorldLights" );
 	dworldlight_t	*in;
 	mworldlight_t	*out, *out2;
 	int		i, count, dup = 0;
@@ -1043,6 +1366,39 @@ static int Mod_SurfaceCompareInGame( const unsigned short *a, const unsigned sho
 	return 0;
 }
 
+/*
+=================
+Mod_PackWorldBounds
+
+store leaf and surface bounds
+in SIMD-friendly layout
+=================
+*/
+static void Mod_PackWorldBounds( void )
+{
+	int	i, numgroups;
+
+	numgroups = (world->numleafs + PACKED_BOXES - 1) / PACKED_BOXES;
+	world->packedleafs = (float *)Mem_Alloc( numgroups * PACKED_BOX_FLOATS * sizeof( float ));
+
+	for( i = 0; i < world->numleafs; i++ )
+	{
+		float *packed = &world->packedleafs[(i / PACKED_BOXES) * PACKED_BOX_FLOATS];
+		PackBoxBounds( packed, i % PACKED_BOXES, world->leafs[i].mins, world->leafs[i].maxs );
+	}
+
+	numgroups = (worldmodel->numsurfaces + PACKED_BOXES - 1) / PACKED_BOXES;
+	world->packedsurfs = (float *)Mem_Alloc( numgroups * PACKED_BOX_FLOATS * sizeof( float ));
+	world->culledfaces = (byte *)Mem_Alloc( (worldmodel->numsurfaces + 7) >> 3 );
+
+	for( i = 0; i < worldmodel->numsurfaces; i++ )
+	{
+		mextrasurf_t *esrf = worldmodel->surfaces[i].info;
+		float *packed = &world->packedsurfs[(i / PACKED_BOXES) * PACKED_BOX_FLOATS];
+		PackBoxBounds( packed, i % PACKED_BOXES, esrf->mins, esrf->maxs );
+	}
+}
+
 /*
 =================
 Mod_FinalizeWorld
@@ -1054,6 +1410,7 @@ then alloc lightmaps
 */
 static void Mod_FinalizeWorld( void )
 {
+	LOAD_ZONE( "Mod_FinalizeWorld" );
 	int	i;
 
 	world->sortedfaces = (unsigned short *)Mem_Alloc( worldmodel->numsurfaces * sizeof( unsigned short ));
@@ -1065,14 +1422,8 @@ static void Mod_FinalizeWorld( void )
 
 	qsort( world->sortedfaces, worldmodel->numsurfaces, sizeof( unsigned short ), (cmpfunc)Mod_SurfaceCompareBuild );
 
-	// alloc surface lightmaps and compute lm coords (for sorted list)
-	for( i = 0; i < worldmodel->numsurfaces; i++ )
-	{
-		msurface_t *surf = &worldmodel->surfaces[world->sortedfaces[i]];
-
-		// allocate the lightmap coords, create lightmap textures (empty at this moment)
-		GL_AllocLightmapForFace( surf );
-	}
+	// alloc surface lightmaps and compute lm coords
+	GL_AllocLightmapsForWorld();
 }
 
 /*
@@ -1541,6 +1892,7 @@ precache shaders to reduce freezes in-game
 */
 static void Mod_PrecacheShaders( void )
 {
+	LOAD_ZONE( "Mod_PrecacheShaders" );
 	msurface_t	*surf;
 	int		i;
 
@@ -1876,78 +2228,56 @@ Mod_FindStaticLights
 find a mark lights that affected to this face
 =================
 */
-void Mod_FindStaticLights( byte *vislight, byte lights[MAXDYNLIGHTS], const Vector &origin )
+static int Mod_SelectStaticLights( byte *vislight, byte lights[MAXDYNLIGHTS], const Vector &origin )
 {
-	mworldlight_t	*wl = world->worldlights;
-	int		indexes[32];
-	int		i, count;
+	int		i, visbytes, count = 0;
+	lightselect_t	select;
 
 	memset( lights, 255, sizeof( byte ) * MAXDYNLIGHTS );
-	count = 0;
 
 	// failed to vislightdata...
-	if( !vislight ) return;
+	if( !vislight ) return 0;
 
-	// mark all the lights that can lit this face
-	for( i = 0; i < world->numworldlights; i++, wl++ )
-	{
-		if( wl->emittype == emit_ignored )
-			continue;	// bad light?
+	Mod_InitLightSelect( &select, (int)cv_deferred_maxlights->value );
+	visbytes = (world->numworldlights + 7) >> 3;
 
-		// this face is invisible for this light
-		if( !CHECKVISBIT( vislight, i ))
-			continue;
+	// vislight is a precomputed per-face light index, skip empty bytes
+	for( int b = 0; b < visbytes; b++ )
+	{
+		if( !vislight[b] ) continue;
 
-		if( count >= ARRAYSIZE( indexes ))
+		for( i = b << 3; i < (( b + 1 ) << 3 ) && i < world->numworldlights; i++ )
 		{
-			ALERT( at_aiconsole, "too many lights on a face\n" );
-			break;
-		}
+			mworldlight_t *wl = world->worldlights + i;
 
-		indexes[count++] = i;// member this light
-	}
+			if( wl->emittype == emit_ignored )
+				continue;	// bad light?
 
-get_next_light:
-	float maxPhotons = 0.0;
-	int ignored = -1;
-	int light = 255;
-
-	for( i = 0; i < count; i++ )
-	{
-		if( indexes[i] == -1 )
-			continue;
+			// this face is invisible for this light
+			if( !CHECKVISBIT( vislight, i ))
+				continue;
 
-		wl = world->worldlights + indexes[i];
-		Vector delta = (wl->origin - origin);
-		float dist = Q_max( delta.Length(), 1.0 );
-		delta = delta.Normalize();
-		float ratio = 1.0 / (dist * dist);
-		Vector add = wl->intensity * ratio;
-		float photons = VectorMax( add );
+			Vector delta = (wl->origin - origin);
+			float dist = Q_max( delta.Length(), 1.0 );
+			float ratio = 1.0 / (dist * dist);
+			Vector add = wl->intensity * ratio;
 
-		// skylight has a maximum priority
-		if( photons > maxPhotons )
-		{
-			maxPhotons = photons;
-			light = indexes[i];
-			ignored = i;
+			Mod_AddLightToSelect( &select, i, VectorMax( add ));
+			count++;
 		}
 	}
 
-	if( ignored == -1 )
-	{
-		if( count > (int)cv_deferred_maxlights->value )
-			ALERT( at_aiconsole, "total %i lights affected to face\n", count );
-		return;
-	}
-	for( i = 0; i < (int)cv_deferred_maxlights->value && lights[i] != 255; i++ );
-	if( i < (int)cv_deferred_maxlights->value )
-		lights[i] = light;	// nearest light for surf
-	indexes[ignored] = -1;		// this light is handled
+	Mod_FinishLightSelect( &select, lights );
 
-//	if( count > (int)cv_deferred_maxlights->value && i == (int)cv_deferred_maxlights->value )
-//		Msg( "skipped light %i intensity %g, type %d\n", light, maxPhotons, world->worldlights[light].emittype );
-	goto get_next_light;
+	return count;
+}
+
+void Mod_FindStaticLights( byte *vislight, byte lights[MAXDYNLIGHTS], const Vector &origin )
+{
+	int count = Mod_SelectStaticLights( vislight, lights, origin );
+
+	if( count > bound( 0, (int)cv_deferred_maxlights->value, MAXDYNLIGHTS ))
+		ALERT( at_aiconsole, "total %i lights affected to face\n", count );
 }
 
 /*
@@ -1957,6 +2287,7 @@ Mod_InitLightTexture
 */
 static void Mod_InitLightTexture( void )
 {
+	LOAD_ZONE( "Mod_InitLightTexture" );
 	mworldlight_t	*wl = world->worldlights;
 	int		height = ((world->numworldlights / 256) + 1) * 3;
 	int		lightnum = 0;
@@ -1994,6 +2325,7 @@ Mod_InitBSPTreeTexture
 */
 static void Mod_InitBSPTreeTexture( void )
 {
+	LOAD_ZONE( "Mod_InitBSPTreeTexture" );
 	int		planenum = 0;
 	int		height = 256;
 	int		width = 256;
@@ -2290,73 +2622,297 @@ static void BindBufferBaseGL30( void )
 	pglEnableVertexAttribArrayARB( ATTR_INDEX_LIGHT_NUMS1 );
 }
 
+/*
+=================
+Mod_CreateElementBuffer
+
+store triangle fans of all the surfaces
+so the batches can be drawn without index copying
+=================
+*/
+static void Mod_CreateElementBuffer( void )
+{
+	int	i, j, numelems = 0;
+	uint	*elems, *out;
+
+	world->firstelems = (uint *)Mem_Alloc( worldmodel->numsurfaces * sizeof( uint ));
+
+	for( i = 0; i < worldmodel->numsurfaces; i++ )
+	{
+		mextrasurf_t *es = worldmodel->surfaces[i].info;
+
+		world->firstelems[i] = numelems;
+		if( es->numverts >= 3 )
+			numelems += ( es->numverts - 2 ) * 3;
+	}
+
+	if( !numelems ) return;
+
+	out = elems = (uint *)Mem_Alloc( numelems * sizeof( uint ));
+
+	for( i = 0; i < worldmodel->numsurfaces; i++ )
+	{
+		mextrasurf_t *es = worldmodel->surfaces[i].info;
+
+		// same as R_DrawSurface does
+		for( j = 0; j < es->numverts - 2; j++ )
+		{
+			*out++ = es->firstvertex;
+			*out++ = es->firstvertex + j + 1;
+			*out++ = es->firstvertex + j + 2;
+		}
+	}
+
+	pglGenBuffersARB( 1, &world->element_buffer_object );
+	pglBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, world->element_buffer_object );
+	pglBufferDataARB( GL_ELEMENT_ARRAY_BUFFER_ARB, numelems * sizeof( uint ), elems, GL_STATIC_DRAW_ARB );
+	world->cacheSize += numelems * sizeof( uint );
+
+	Mem_Free( elems );
+}
+
+/*
+=================
+Mod_VertexCacheCRC
+
+checksum of the lumps that world vertex array is built from
+=================
+*/
+static unsigned int Mod_VertexCacheCRC( const byte *buf )
+{
+	static const int	lumps[] = { LUMP_PLANES, LUMP_TEXTURES, LUMP_TEXINFO, LUMP_VERTEXES, LUMP_FACES, LUMP_EDGES, LUMP_SURFEDGES, LUMP_MODELS };
+	static const int	extralumps[] = { LUMP_FACEINFO, LUMP_VERTNORMALS, LUMP_WORLDLIGHTS, LUMP_VISLIGHTDATA };
+	const dheader_t	*header = (const dheader_t *)buf;
+	const dextrahdr_t	*extrahdr = (const dextrahdr_t *)(buf + sizeof( dheader_t ));
+	unsigned int	crc = 0;
+	const dlump_t	*l;
+	size_t		i;
+
+	for( i = 0; i < ARRAYSIZE( lumps ); i++ )
+	{
+		l = &header->lumps[lumps[i]];
+		crc = crc * 31 + (unsigned int)FILE_CRC32( buf + l->fileofs, l->filelen );
+	}
+
+	// stcoords are scaled by the texture size, that may come from WAD
+	for( i = 0; i < (size_t)worldmodel->numtextures; i++ )
+	{
+		texture_t *tx = worldmodel->textures[i];
+
+		if( !tx ) continue;
+		crc = crc * 31 + tx->width;
+		crc = crc * 31 + tx->height;
+	}
+
+	// lightmap allocation skips unlit faces
+	crc = crc * 31 + header->lumps[LUMP_LIGHTING].filelen;
+
+	if( extrahdr->id == IDEXTRAHEADER && extrahdr->version == EXTRA_VERSION )
+	{
+		for( i = 0; i < ARRAYSIZE( extralumps ); i++ )
+		{
+			l = &extrahdr->lumps[extralumps[i]];
+			crc = crc * 31 + (unsigned int)FILE_CRC32( buf + l->fileofs, l->filelen );
+		}
+		crc = crc * 31 + extrahdr->lumps[LUMP_LIGHTVECS].filelen;
+	}
+
+	return crc;
+}
+
+static void Mod_VertexCacheName( char *name, size_t size )
+{
+	Q_snprintf( name, size, "cache/maps/%s.wvc", world->name );
+}
+
+/*
+=================
+Mod_LoadVertexCache
+
+restore world->vertexes from disk
+=================
+*/
+static bool Mod_LoadVertexCache( unsigned int crc )
+{
+	char		szFilename[MAX_PATH];
+	dworldverts_t	*hdr;
+	int		length, iCompare;
+	size_t		filesize;
+
+	Mod_VertexCacheName( szFilename, sizeof( szFilename ));
+
+	// BSP file is newer
+	if( !COMPARE_FILE_TIME( worldmodel->name, szFilename, &iCompare ) || iCompare > 0 )
+		return false;
+
+	byte *aMemFile = LOAD_FILE( szFilename, &length );
+	if( !aMemFile ) return false;
+
+	hdr = (dworldverts_t *)aMemFile;
+	filesize = ( length > 0 ) ? (size_t)length : 0;
+
+	if( filesize < sizeof( dworldverts_t ))
+	{
+		ALERT( at_warning, "%s is too short\n", szFilename );
+		FREE_FILE( aMemFile );
+		return false;
+	}
+
+	if( hdr->ident != IDWORLDVERTHEADER )
+	{
+		ALERT( at_warning, "%s has wrong id (%x should be %x)\n", szFilename, hdr->ident, IDWORLDVERTHEADER );
+		FREE_FILE( aMemFile );
+		return false;
+	}
+
+	if( hdr->version != WORLDVERT_VERSION || hdr->vertexsize != sizeof( bvert_t ))
+	{
+		ALERT( at_warning, "%s has wrong version (%i should be %i)\n", szFilename, hdr->version, WORLDVERT_VERSION );
+		FREE_FILE( aMemFile );
+		return false;
+	}
+
+	if( hdr->mapCRC != crc || hdr->numverts != world->numvertexes || hdr->blocksize != BLOCK_SIZE
+	|| hdr->maxlights != (int)cv_deferred_maxlights->value || filesize < sizeof( dworldverts_t ) + hdr->numverts * sizeof( bvert_t ))
+	{
+		ALERT( at_console, "%s was changed, vertex cache will be updated\n", szFilename );
+		FREE_FILE( aMemFile );
+		return false;
+	}
+
+	memcpy( (byte *)world->vertexes, aMemFile + sizeof( dworldverts_t ), world->numvertexes * sizeof( bvert_t ));
+	FREE_FILE( aMemFile );
+
+	return true;
+}
+
+static void Mod_SaveVertexCache( unsigned int crc )
+{
+	char		szFilename[MAX_PATH];
+	size_t		size = sizeof( dworldverts_t ) + world->numvertexes * sizeof( bvert_t );
+	dworldverts_t	*hdr = (dworldverts_t *)Mem_Alloc( size );
+
+	hdr->ident = IDWORLDVERTHEADER;
+	hdr->version = WORLDVERT_VERSION;
+	hdr->mapCRC = crc;
+	hdr->vertexsize = sizeof( bvert_t );
+	hdr->blocksize = BLOCK_SIZE;
+	hdr->maxlights = (int)cv_deferred_maxlights->value;
+	hdr->numverts = world->numvertexes;
+	memcpy( (byte *)hdr + sizeof( dworldverts_t ), world->vertexes, world->numvertexes * sizeof( bvert_t ));
+
+	Mod_VertexCacheName( szFilename, sizeof( szFilename ));
+
+	if( !SAVE_FILE( szFilename, hdr, size ))
+		ALERT( at_error, "Mod_SaveVertexCache: couldn't store %s\n", szFilename );
+
+	Mem_Free( hdr );
+}
+
+/*
+=================
+Mod_BuildSurfaceVerts
+
+job: fill the surface vertexes, static lights and TBN
+=================
+*/
+static void Mod_BuildSurfaceVerts( void *context, int current, int threadnum )
+{
+	msurface_t	*surf = &worldmodel->surfaces[current];
+	int		*lightcounts = (int *)context;
+	byte		*vislight = NULL;
+	bvert_t		*mv;
+
+	if( FBitSet( surf->flags, SURF_DRAWSKY ))
+		return;	// ignore sky polys it was never be drawed
+
+	mv = &world->vertexes[surf->info->firstvertex];
+
+	// request vislightdata for this surface
+	if( world->vislightdata ) vislight = world->vislightdata + current * ((world->numworldlights + 7) / 8);
+	lightcounts[current] = Mod_SelectStaticLights( vislight, surf->info->lights, surf->info->origin );
+
+	// NOTE: all polygons stored as source (no tesselation anyway)
+	for( int j = 0; j < surf->numedges; j++, mv++ )
+	{
+		int l = worldmodel->surfedges[surf->firstedge + j];
+		int vert = worldmodel->edges[abs(l)].v[(l > 0) ? 0 : 1];
+		memcpy( mv->styles, surf->styles, sizeof( surf->styles ));
+		memcpy( mv->lights0, surf->info->lights, sizeof( surf->info->lights ));
+		mv->vertex = worldmodel->vertexes[vert].position;
+
+		R_TextureCoords( surf, mv->vertex, mv->stcoord0 );
+		R_LightmapCoords( surf, mv->vertex, mv->lmcoord0, 0 );	// styles 0-1
+		R_LightmapCoords( surf, mv->vertex, mv->lmcoord1, 2 );	// styles 2-3
+	}
+
+	Mod_ComputeFaceTBN( surf, surf->info );
+}
+
 /*
 =================
 Mod_CreateBufferObject
 =================
 */
-static void Mod_CreateBufferObject( void )
+static void Mod_CreateBufferObject( const byte *buf )
 {
+	LOAD_ZONE( "Mod_CreateBufferObject" );
 	if( world->vertex_buffer_object )
 		return; // already created
 
 	// calculate number of used faces and vertexes
 	msurface_t *surf = worldmodel->surfaces;
+	unsigned int crc = Mod_VertexCacheCRC( buf );
 	int i, j, curVert = 0;
-	byte *vislight = NULL;
-	mvertex_t *dv;
 	bvert_t *mv;
 
 	world->numvertexes = 0;
 
-	// compute totalvertex count for VBO but ignore sky polys
+	// NOTE: now firstvertex are handled in world->vertexes[] array, not in world->tbn_vectors[] !!!
 	for( i = 0; i < worldmodel->numsurfaces; i++, surf++ )
 	{
 		if( FBitSet( surf->flags, SURF_DRAWSKY ))
-			continue;
-		world->numvertexes += surf->numedges;
+			continue;	// ignore sky polys it was never be drawed
+
+		surf->info->firstvertex = curVert;
+		surf->info->numverts = surf->numedges;
+		curVert += surf->numedges;
 	}
 
+	world->numvertexes = curVert;
+
 	// temporary array will be removed at end of this function
 	// g-cont. i'm leave local copy of vertexes for some debug purpoces
 	world->vertexes = (bvert_t *)Mem_Alloc( sizeof( bvert_t ) * world->numvertexes );
-	surf = worldmodel->surfaces;
 
-	// create VBO-optimized vertex array (single for world and all brush-models)
-	for( i = 0; i < worldmodel->numsurfaces; i++, surf++ )
+	if( Mod_LoadVertexCache( crc ))
 	{
-		Vector t, b, n;
-
-		if( FBitSet( surf->flags, SURF_DRAWSKY ))
-			continue;	// ignore sky polys it was never be drawed
-
-		mv = &world->vertexes[curVert];
+		// static lights are packed into every vertex of the face
+		for( i = 0, surf = worldmodel->surfaces; i < worldmodel->numsurfaces; i++, surf++ )
+		{
+			if( FBitSet( surf->flags, SURF_DRAWSKY ) || surf->info->numverts <= 0 )
+				continue;
+			memcpy( surf->info->lights, world->vertexes[surf->info->firstvertex].lights0, sizeof( surf->info->lights ));
+		}
+	}
+	else
+	{
+		double start_time = Sys_DoubleTime();
+		int maxlights = bound( 1, (int)cv_deferred_maxlights->value, MAXDYNLIGHTS );
+		int *lightcounts = (int *)Mem_Alloc( worldmodel->numsurfaces * sizeof( int ));
 
-		// request vislightdata for this surface
-		if( world->vislightdata ) vislight = world->vislightdata + i * ((world->numworldlights + 7) / 8);
-		Mod_FindStaticLights( vislight, surf->info->lights, surf->info->origin );
+		// create VBO-optimized vertex array (single for world and all brush-models)
+		JOB_RunOnIndividual( worldmodel->numsurfaces, lightcounts, Mod_BuildSurfaceVerts );
 
-		// NOTE: all polygons stored as source (no tesselation anyway)
-		for( j = 0; j < surf->numedges; j++, mv++ )
+		for( i = 0; i < worldmodel->numsurfaces; i++ )
 		{
-			int l = worldmodel->surfedges[surf->firstedge + j];
-			int vert = worldmodel->edges[abs(l)].v[(l > 0) ? 0 : 1];
-			memcpy( mv->styles, surf->styles, sizeof( surf->styles ));
-			memcpy( mv->lights0, surf->info->lights, sizeof( surf->info->lights ));
-			dv = &worldmodel->vertexes[vert];
-			mv->vertex = dv->position;
-
-			R_TextureCoords( surf, mv->vertex, mv->stcoord0 );
-			R_LightmapCoords( surf, mv->vertex, mv->lmcoord0, 0 );	// styles 0-1
-			R_LightmapCoords( surf, mv->vertex, mv->lmcoord1, 2 );	// styles 2-3
+			if( lightcounts[i] > maxlights )
+				ALERT( at_aiconsole, "total %i lights affected to face\n", lightcounts[i] );
 		}
 
-		// NOTE: now firstvertex are handled in world->vertexes[] array, not in world->tbn_vectors[] !!!
-		surf->info->firstvertex = curVert;
-		surf->info->numverts = surf->numedges;
-		curVert += surf->numedges;
-
-		Mod_ComputeFaceTBN( surf, surf->info );
+		Mem_Free( lightcounts );
+		Mod_SaveVertexCache( crc );
+		ALERT( at_console, "%s: vertex cache build time %g secs\n", world->name, Sys_DoubleTime() - start_time );
 	}
 
 	// compute water global coords
@@ -2430,6 +2986,10 @@ static void Mod_CreateBufferObject( void )
 		BindBufferBaseGL21();
 	else BindBufferBaseGL30();
 
+	// static element buffer is a part of vertex array state
+	if( GL_Support( R_MULTI_DRAW_EXT ))
+		Mod_CreateElementBuffer();
+
 	pglBindVertexArray( GL_FALSE );
 
 	// update stats
@@ -2445,9 +3005,15 @@ static void Mod_DeleteBufferObject( void )
 {
 	if( world->vertex_array_object ) pglDeleteVertexArrays( 1, &world->vertex_array_object );
 	if( world->vertex_buffer_object ) pglDeleteBuffersARB( 1, &world->vertex_buffer_object );
+	if( world->element_buffer_object ) pglDeleteBuffersARB( 1, &world->element_buffer_object );
+
+	if( world->firstelems )
+		Mem_Free( world->firstelems );
+	world->firstelems = NULL;
 
 	tr.total_vbo_memory -= world->cacheSize;
 	world->vertex_array_object = world->vertex_buffer_object = 0;
+	world->element_buffer_object = 0;
 	world->cacheSize = 0;
 }
 
@@ -2625,17 +3191,27 @@ static void Mod_LoadWorld( model_t *mod, const byte *buf )
 	world->shadowdata = (byte *)RENDER_GET_PARM( PARM_SHADOWDATA, 0 );
 
 	Mod_FinalizeWorld();
-	Mod_CreateBufferObject();
+	Mod_PackWorldBounds();
+	Mod_BuildLightGrid();
+	Mod_CreateBufferObject( buf );
 
 	// helper to precache shaders
 	R_InitDefaultLights();
 
 	// time to place grass
+	R_BeginLoadZone( "R_GrassInitForSurface" );
 	for( i = 0; i < worldmodel->numsurfaces; i++ )
 	{
 		// place to initialize our grass
 		R_GrassInitForSurface( &worldmodel->surfaces[i] );
 	}
+	R_EndLoadZone();
+
+	// collect surfaces for grass prefetching
+	R_GrassSetupWorld();
+
+	// warmup shaders that was used by this map last time
+	GL_PrecacheShaderManifest( world->name );
 
 	// precache world shaders
 	Mod_PrecacheShaders();
@@ -2649,6 +3225,9 @@ static void Mod_LoadWorld( model_t *mod, const byte *buf )
 
 static void Mod_FreeWorld( model_t *mod )
 {
+	// remember shaders that was used on this map
+	GL_SaveShaderManifest( world->name );
+
 	Mod_FreeCubemaps();
 
 	// destroy VBO & VAO
@@ -2662,6 +3241,20 @@ static void Mod_FreeWorld( model_t *mod )
 		Mem_Free( world->vertexes );
 	world->vertexes = NULL;
 
+	if( world->packedleafs )
+		Mem_Free( world->packedleafs );
+	world->packedleafs = NULL;
+
+	Mod_FreeLightGrid();
+
+	if( world->packedsurfs )
+		Mem_Free( world->packedsurfs );
+	world->packedsurfs = NULL;
+
+	if( world->culledfaces )
+		Mem_Free( world->culledfaces );
+	world->culledfaces = NULL;
+
 	if( world->vertex_lighting )
 		Mem_Free( world->vertex_lighting );
 	world->vertex_lighting = NULL;
@@ -2670,6 +3263,10 @@ static void Mod_FreeWorld( model_t *mod )
 		Mem_Free( world->surface_lighting );
 	world->surface_lighting = NULL;
 
+	if( world->lightmapfaces )
+		Mem_Free( world->lightmapfaces );
+	world->lightmapfaces = NULL;
+
 	// free old cinematics
 	R_FreeCinematics();
 
@@ -2733,12 +3330,8 @@ static void Mod_FreeWorld( model_t *mod )
 	for( int i = 0; i < worldmodel->numsurfaces; i++ )
 		GL_DeleteOcclusionQuery( &worldmodel->surfaces[i] );
 
-	if( FBitSet( world->features, WORLD_HAS_GRASS ))
-	{
-		// throw grass vbo's
-		for( int i = 0; i < worldmodel->numsurfaces; i++ )
-			R_RemoveGrassForSurface( worldmodel->surfaces[i].info );
-	}
+	// throw grass vbo's
+	R_GrassFreeWorld();
 
 	memset( world, 0, sizeof( gl_world_t ));
 }
@@ -2773,6 +3366,22 @@ void R_ProcessWorldData( model_t *mod, qboolean create, const byte *buffer )
 
 	if( create )
 	{
+		LOAD_ZONE_DETAIL( "Mod_LoadWorld", mod->name );
+		const dheader_t *header = (const dheader_t *)buffer;
+		const dextrahdr_t *extrahdr = (const dextrahdr_t *)(buffer + sizeof( dheader_t ));
+		size_t filelen = 0;
+
+		// BSP was read by engine, find the end of the last lump
+		for( int i = 0; i < HEADER_LUMPS; i++ )
+			filelen = Q_max( filelen, (size_t)( header->lumps[i].fileofs + header->lumps[i].filelen ));
+
+		if( extrahdr->id == IDEXTRAHEADER )
+		{
+			for( int i = 0; i < EXTRA_LUMPS; i++ )
+				filelen = Q_max( filelen, (size_t)( extrahdr->lumps[i].fileofs + extrahdr->lumps[i].filelen ));
+		}
+		R_CountLoadBytes( filelen );
+
 		double start = Sys_DoubleTime();
 		Mod_LoadWorld( mod, buffer );
 		double end = Sys_DoubleTime();
@@ -2792,6 +3401,13 @@ void R_ProcessWorldData( model_t *mod, qboolean create, const byte *buffer )
 static unsigned int tempElems[MAX_MAP_ELEMS];
 static unsigned int numTempElems;
 
+// multi-draw batch for static element buffer
+#define MAX_SURF_DRAWS	4096
+
+static GLsizei surfDrawCounts[MAX_SURF_DRAWS];
+static const GLvoid *surfDrawOffsets[MAX_SURF_DRAWS];
+static int numSurfDraws;
+
 /*
 =================
 R_MarkSubmodelVisibleFaces
@@ -2919,8 +3535,62 @@ void R_UpdateSubmodelParams( void )
 	}
 }
 
-_forceinline void R_DrawSurface( mextrasurf_t *es )
+/*
+=================
+R_FlushSurfaceElems
+
+draw accumulated surfaces
+=================
+*/
+static void R_FlushSurfaceElems( int startv, int endv )
 {
+	if( !world->element_buffer_object )
+	{
+		pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, numTempElems, GL_UNSIGNED_INT, tempElems );
+		return;
+	}
+
+	if( numSurfDraws == 1 )
+		pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, surfDrawCounts[0], GL_UNSIGNED_INT, surfDrawOffsets[0] );
+	else if( numSurfDraws > 1 )
+		pglMultiDrawElementsEXT( GL_TRIANGLES, surfDrawCounts, GL_UNSIGNED_INT, surfDrawOffsets, numSurfDraws );
+	numSurfDraws = 0;
+}
+
+_forceinline void R_DrawSurface( msurface_t *surf )
+{
+	mextrasurf_t *es = surf->info;
+
+	if( world->element_buffer_object )
+	{
+		GLsizei count = Q_max( es->numverts - 2, 0 ) * 3;
+		size_t offset = world->firstelems[surf - worldmodel->surfaces] * sizeof( uint );
+
+		if( !count ) return;
+
+		// merge with previous range if it's adjacent
+		if( numSurfDraws > 0 && (size_t)surfDrawOffsets[numSurfDraws-1] + surfDrawCounts[numSurfDraws-1] * sizeof( uint ) == offset )
+		{
+			surfDrawCounts[numSurfDraws-1] += count;
+		}
+		else
+		{
+			if( numSurfDraws == MAX_SURF_DRAWS )
+			{
+				pglMultiDrawElementsEXT( GL_TRIANGLES, surfDrawCounts, GL_UNSIGNED_INT, surfDrawOffsets, numSurfDraws );
+				r_stats.num_flushes++;
+				numSurfDraws = 0;
+			}
+
+			surfDrawCounts[numSurfDraws] = count;
+			surfDrawOffsets[numSurfDraws] = (const GLvoid *)offset;
+			numSurfDraws++;
+		}
+
+		numTempElems += count;
+		return;
+	}
+
 	// accumulate the indices
 	for( int j = 0; j < es->numverts - 2; j++ )
 	{
@@ -3387,91 +4057,103 @@ void R_SetSurfaceUniforms( word hProgram, msurface_t *surface, bool force )
 	}
 }
 
+#define LIGHTFACE_GRASS	BIT( 0 )		// surface has grass, check it for light
+#define LIGHTFACE_SURF	BIT( 1 )		// surface passed the light culling
+#define LIGHTFACE_SHIFT	2
+
+// drawlist entries that interact with each light
+static CUtlArray<int>	r_lightfaces[MAX_DLIGHTS];
+
+typedef struct
+{
+	CDynLight		**lights;
+	bool		solid;
+} lightfacejob_t;
+
 /*
 ================
-R_RenderDynLightList
+R_CullFacesForLight
 
+thread-safe part of the light list building
 ================
 */
-void R_BuildFaceListForLight( CDynLight *pl, bool solid )
+template< class T >
+static void R_CullFacesForLight( const CUtlArray<T> &list, CDynLight *pl, CUtlArray<int> &out )
 {
-	int	i;
-
-	RI->currententity = GET_ENTITY( 0 );
-	RI->currentmodel = RI->currententity->model;
-	RI->frame.light_faces.Purge();
-	RI->frame.light_grass.Purge();
-	tr.modelorg = pl->origin;
+	out.RemoveAll();
 
-	if( solid )
+	for( int i = 0; i < list.Count(); i++ )
 	{
-		// only visible polys passed through the light list
-		for( i = 0; i < RI->frame.solid_faces.Count(); i++ )
-		{
-			CSolidEntry *entry = &RI->frame.solid_faces[i];
+		const T *entry = &list[i];
 
-			if( entry->m_bDrawType != DRAWTYPE_SURFACE )
-				continue;
+		if( entry->m_bDrawType != DRAWTYPE_SURFACE )
+			continue;
 
-			mextrasurf_t *es = entry->m_pSurf->info;
-			gl_state_t *glm = GL_GetCache( es->parent->hCachedMatrix );
+		mextrasurf_t *es = entry->m_pSurf->info;
+		cl_entity_t *e = es->parent;
 
-			RI->currententity = es->parent;
-			RI->currentmodel = RI->currententity->model;
+		if( e->curstate.renderfx == SKYBOX_ENTITY )
+			continue; // fast reject
 
-			if( RI->currententity->curstate.renderfx == SKYBOX_ENTITY )
-				continue; // fast reject
+		if( FBitSet( e->curstate.effects, EF_FULLBRIGHT ))
+			continue;
 
-			if( FBitSet( RI->currententity->curstate.effects, EF_FULLBRIGHT ))
-				continue;
+		bool worldpos = R_StaticEntity( e ) ? true : false;
+		CFrustum	*frustum = (worldpos) ? &pl->frustum : NULL;
+		gl_state_t *glm = GL_GetCache( e->hCachedMatrix );
+		int flags = 0;
 
-			bool worldpos = R_StaticEntity( es->parent ) ? true : false;
-			CFrustum	*frustum = (worldpos) ? &pl->frustum : NULL;
-			tr.modelorg = glm->GetModelOrigin();
+		if( es->grasscount > 0 )
+			SetBits( flags, LIGHTFACE_GRASS );
 
-			R_AddGrassToDrawList( entry->m_pSurf, DRAWLIST_LIGHT );
+		if( !R_CullSurfaceExt( entry->m_pSurf, glm->GetModelOrigin(), frustum, 0, e, pl ))
+			SetBits( flags, LIGHTFACE_SURF );
 
-			if( R_CullSurface( entry->m_pSurf, tr.modelorg, frustum ))
-				continue;
-
-			// move from main list into light list
-			R_AddSurfaceToDrawList( entry->m_pSurf, DRAWLIST_LIGHT );
-		}
+		if( flags ) out.AddToTail(( i << LIGHTFACE_SHIFT ) | flags );
 	}
-	else
-	{
-		// only visible polys passed through the light list
-		for( i = 0; i < RI->frame.trans_list.Count(); i++ )
-		{
-			CTransEntry *entry = &RI->frame.trans_list[i];
+}
 
-			if( entry->m_bDrawType != DRAWTYPE_SURFACE )
-				continue;
+static void R_CullFacesForLightJob( void *context, int current, int threadnum )
+{
+	lightfacejob_t *job = (lightfacejob_t *)context;
 
-			mextrasurf_t *es = entry->m_pSurf->info;
-			gl_state_t *glm = GL_GetCache( es->parent->hCachedMatrix );
+	if( job->solid )
+		R_CullFacesForLight( RI->frame.solid_faces, job->lights[current], r_lightfaces[current] );
+	else R_CullFacesForLight( RI->frame.trans_list, job->lights[current], r_lightfaces[current] );
+}
 
-			RI->currententity = es->parent;
-			RI->currentmodel = RI->currententity->model;
+/*
+================
+R_BuildFaceListForLight
 
-			if( RI->currententity->curstate.renderfx == SKYBOX_ENTITY )
-				continue; // fast reject
+move the culled faces into light list
+================
+*/
+void R_BuildFaceListForLight( CDynLight *pl, bool solid, const CUtlArray<int> &faces )
+{
+	RI->currententity = GET_ENTITY( 0 );
+	RI->currentmodel = RI->currententity->model;
+	RI->frame.light_faces.Purge();
+	RI->frame.light_grass.Purge();
+	tr.modelorg = pl->origin;
 
-			if( FBitSet( RI->currententity->curstate.effects, EF_FULLBRIGHT ))
-				continue;
+	for( int i = 0; i < faces.Count(); i++ )
+	{
+		int index = faces[i] >> LIGHTFACE_SHIFT;
+		CSolidEntry *entry = (solid) ? &RI->frame.solid_faces[index] : &RI->frame.trans_list[index];
+		mextrasurf_t *es = entry->m_pSurf->info;
+		gl_state_t *glm = GL_GetCache( es->parent->hCachedMatrix );
 
-			bool worldpos = R_StaticEntity( es->parent ) ? true : false;
-			CFrustum	*frustum = (worldpos) ? &pl->frustum : NULL;
-			tr.modelorg = glm->GetModelOrigin();
+		RI->currententity = es->parent;
+		RI->currentmodel = RI->currententity->model;
+		tr.modelorg = glm->GetModelOrigin();
 
+		if( FBitSet( faces[i], LIGHTFACE_GRASS ))
 			R_AddGrassToDrawList( entry->m_pSurf, DRAWLIST_LIGHT );
 
-			if( R_CullSurface( entry->m_pSurf, tr.modelorg, frustum ))
-				continue;
-
-			// move from main list into light list
+		// move from main list into light list
+		if( FBitSet( faces[i], LIGHTFACE_SURF ))
 			R_AddSurfaceToDrawList( entry->m_pSurf, DRAWLIST_LIGHT );
-		}
 	}
 }
 
@@ -3495,6 +4177,10 @@ void R_DrawLightForSurfList( CDynLight *pl )
 	pglScissor( pl->x, y2, pl->w, pl->h );
 	numTempElems = 0;
 
+	// sorting list to reduce shader switches
+	if( !CVAR_TO_BOOL( cv_nosort ))
+		R_SortDrawList( RI->frame.light_faces );
+
 	for( int i = 0; i < RI->frame.light_faces.Count(); i++ )
 	{
 		CSolidEntry *entry = &RI->frame.light_faces[i];
@@ -3524,7 +4210,7 @@ void R_DrawLightForSurfList( CDynLight *pl )
 		{
 			if( numTempElems )
 			{
-				pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, numTempElems, GL_UNSIGNED_INT, tempElems );
+				R_FlushSurfaceElems( startv, endv );
 				r_stats.c_total_tris += (numTempElems / 3);
 				r_stats.num_flushes++;
 				numTempElems = 0;
@@ -3544,12 +4230,12 @@ void R_DrawLightForSurfList( CDynLight *pl )
 		startv = Q_min( startv, es->firstvertex );
 		endv = Q_max( es->firstvertex + es->numverts, endv );
 
-		R_DrawSurface( es );
+		R_DrawSurface( entry->m_pSurf );
 	}
 
 	if( numTempElems )
 	{
-		pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, numTempElems, GL_UNSIGNED_INT, tempElems );
+		R_FlushSurfaceElems( startv, endv );
 		r_stats.c_total_tris += (numTempElems / 3);
 		r_stats.num_flushes++;
 		startv = MAX_MAP_ELEMS;
@@ -3581,22 +4267,22 @@ void R_RenderDynLightList( bool solid )
 	GL_AlphaTest( GL_FALSE );
 	GL_DepthMask( GL_FALSE );
 
-	CDynLight *pl = tr.dlights;
+	CDynLight *lights[MAX_DLIGHTS];
+	lightfacejob_t job;
+
+	job.lights = lights;
+	job.solid = solid;
+
+	// cull the faces for all the lights at once
+	int numlights = R_GatherVisibleLights( lights );
+	JOB_RunOnIndividual( numlights, &job, R_CullFacesForLightJob );
 
-	for( int i = 0; i < MAX_DLIGHTS; i++, pl++ )
+	for( int i = 0; i < numlights; i++ )
 	{
-		if( pl->Expired( )) continue;
+		CDynLight *pl = lights[i];
 
 		if( pl->type == LIGHT_SPOT || pl->type == LIGHT_OMNI )
 		{
-			if( !pl->Active( )) continue;
-
-			if( !Mod_CheckBoxVisible( pl->absmin, pl->absmax ))
-				continue;
-
-			if( R_CullFrustum( &pl->frustum ))
-				continue;
-
 			pglEnable( GL_SCISSOR_TEST );
 		}
 		else
@@ -3608,7 +4294,7 @@ void R_RenderDynLightList( bool solid )
 		RI->currentlight = pl;
 
 		// draw world from light position
-		R_BuildFaceListForLight( pl, solid );
+		R_BuildFaceListForLight( pl, solid, r_lightfaces[i] );
 
 		if( !RI->frame.light_faces.Count() && !RI->frame.light_grass.Count() )
 			continue;	// no interaction with this light?
@@ -3633,6 +4319,7 @@ void R_RenderDeferredBrushList( void )
 	mcubemap_t	*cached_cubemap[2];
 	bool		flush_buffer = false;
 	int		startv, endv;
+	PROF_SCOPE( "R_RenderDeferredBrushList" );
 
 	if( !RI->frame.solid_faces.Count() )
 		return;
@@ -3688,7 +4375,7 @@ void R_RenderDeferredBrushList( void )
 		{
 			if( numTempElems )
 			{
-				pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, numTempElems, GL_UNSIGNED_INT, tempElems );
+				R_FlushSurfaceElems( startv, endv );
 				r_stats.c_total_tris += (numTempElems / 3);
 				r_stats.num_flushes++;
 				numTempElems = 0;
@@ -3711,12 +4398,12 @@ void R_RenderDeferredBrushList( void )
 		startv = Q_min( startv, es->firstvertex );
 		endv = Q_max( es->firstvertex + es->numverts, endv );
 
-		R_DrawSurface( es );
+		R_DrawSurface( entry->m_pSurf );
 	}
 
 	if( numTempElems )
 	{
-		pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, numTempElems, GL_UNSIGNED_INT, tempElems );
+		R_FlushSurfaceElems( startv, endv );
 		r_stats.c_total_tris += (numTempElems / 3);
 		r_stats.num_flushes++;
 		startv = MAX_MAP_ELEMS;
@@ -3761,6 +4448,7 @@ void R_RenderSolidBrushList( void )
 	qboolean		flush_buffer = false;
 	mcubemap_t	*cached_cubemap[2];
 	int		startv, endv;
+	PROF_SCOPE( "R_RenderSolidBrushList" );
 
 	if( !RI->frame.solid_faces.Count() )
 		return;
@@ -3816,7 +4504,7 @@ void R_RenderSolidBrushList( void )
 		{
 			if( numTempElems )
 			{
-				pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, numTempElems, GL_UNSIGNED_INT, tempElems );
+				R_FlushSurfaceElems( startv, endv );
 				r_stats.c_total_tris += (numTempElems / 3);
 				r_stats.num_flushes++;
 				numTempElems = 0;
@@ -3841,12 +4529,12 @@ void R_RenderSolidBrushList( void )
 		startv = Q_min( startv, es->firstvertex );
 		endv = Q_max( es->firstvertex + es->numverts, endv );
 
-		R_DrawSurface( es );
+		R_DrawSurface( entry->m_pSurf );
 	}
 
 	if( numTempElems )
 	{
-		pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, numTempElems, GL_UNSIGNED_INT, tempElems );
+		R_FlushSurfaceElems( startv, endv );
 		r_stats.c_total_tris += (numTempElems / 3);
 		r_stats.num_flushes++;
 		startv = MAX_MAP_ELEMS;
@@ -3922,11 +4610,11 @@ void R_RenderTransSurface( CTransEntry *entry )
 		GL_DepthMask( GL_TRUE );
 		GL_Blend( GL_FALSE );
 	}
-	R_DrawSurface( es );
+	R_DrawSurface( entry->m_pSurf );
 
 	if( numTempElems )
 	{
-		pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, numTempElems, GL_UNSIGNED_INT, tempElems );
+		R_FlushSurfaceElems( startv, endv );
 		r_stats.c_total_tris += (numTempElems / 3);
 		r_stats.num_flushes++;
 		numTempElems = 0;
@@ -3987,7 +4675,7 @@ void R_RenderShadowBrushList( void )
 		{
 			if( numTempElems )
 			{
-				pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, numTempElems, GL_UNSIGNED_INT, tempElems );
+				R_FlushSurfaceElems( startv, endv );
 				r_stats.c_total_tris += (numTempElems / 3);
 				r_stats.num_flushes++;
 				numTempElems = 0;
@@ -4007,12 +4695,12 @@ void R_RenderShadowBrushList( void )
 		startv = Q_min( startv, es->firstvertex );
 		endv = Q_max( es->firstvertex + es->numverts, endv );
 
-		R_DrawSurface( es );
+		R_DrawSurface( entry->m_pSurf );
 	}
 
 	if( numTempElems )
 	{
-		pglDrawRangeElementsEXT( GL_TRIANGLES, startv, endv - 1, numTempElems, GL_UNSIGNED_INT, tempElems );
+		R_FlushSurfaceElems( startv, endv );
 		r_stats.c_total_tris += (numTempElems / 3);
 		r_stats.num_flushes++;
 		startv = MAX_MAP_ELEMS;
@@ -12,7 +12,6 @@
 #include "cdll_int.h"
 #include "pm_defs.h"
 #include "event_api.h"
-#include "custom_alloc.h"
 #include "triangleapi.h"
 #include "gl_local.h"
 
@@ -21,7 +20,6 @@
 #define SNOWFADEDIST		80
 
 #define MAX_RAIN_VERTICES		65536	// snowflakes and waterrings draw as quads
-#define MAX_RAIN_INDICES		MAX_RAIN_VERTICES * 4
 
 #define MAXDRIPS			40000	// лимит капель (можно увеличить при необходимости)
 #define MAXFX			20000	// лимит дополнительных частиц (круги по воде и т.п.)
@@ -34,6 +32,14 @@
 #define SNOW_SPRITE_HALFSIZE		3
 #define MAX_RING_HALFSIZE		25	// "радиус" круга на воде, до которого он разрастается за секунду	
 
+#define RAIN_COLUMN_SIZE		32	// size of heightfield cell
+#define RAIN_COLUMN_HASH		8192	// must be power of two
+#define RAIN_COLUMN_LIFETIME		2.0f	// retrace column to catch moving brushes
+
+#define COLUMN_GROUND		0
+#define COLUMN_WATER		1
+#define COLUMN_BLOCKED		2	// sky is not visible here
+
 typedef struct
 {
 	int		dripsPerSecond;
@@ -44,15 +50,25 @@ typedef struct
 	float		globalHeight;
 } rain_properties;
 
+// cached result of vertical trace from the rain height
+typedef struct
+{
+	int		cell[2];
+	float		traceTime;	// 0 is unused
+	float		height;		// капля будет уничтожена на этой высоте.
+	int		waterEntity;
+	int		type;
+	bool		warned;		// bad water was reported for this cell
+} rain_column_t;
+
 typedef struct cl_drip
 {
 	float		birthTime;
-	float		minHeight;	// капля будет уничтожена на этой высоте.
 	Vector		origin;
 	float		alpha;
 	float		xDelta;		// side speed
 	float		yDelta;
-	int		landInWater;
+	rain_column_t	column;		// copy of the column under the drip
 } cl_drip_t;
 
 typedef struct cl_rainfx
@@ -63,12 +79,15 @@ typedef struct cl_rainfx
 	float		alpha;
 } cl_rainfx_t;
 
-void WaterLandingEffect(cl_drip *drip);
+void WaterLandingEffect( cl_drip *drip, float height );
 
 
 rain_properties     Rain;
-MemBlock<cl_drip>	g_dripsArray( MAXDRIPS );
-MemBlock<cl_rainfx>	g_fxArray( MAXFX );
+static cl_drip_t	g_drips[MAXDRIPS];
+static cl_rainfx_t	g_fx[MAXFX];
+static rain_column_t	g_columns[RAIN_COLUMN_HASH];
+static int	columns_traced;
+static GLuint	rain_vbo;
 
 cvar_t		*cl_draw_rain = NULL;
 cvar_t		*cl_debug_rain = NULL;
@@ -84,8 +103,101 @@ static Vector	rain_mins, rain_maxs; // for vis culling
 static Vector	m_vertexarray[MAX_RAIN_VERTICES];
 static byte	m_colorarray[MAX_RAIN_VERTICES][4];
 static Vector2D	m_coordsarray[MAX_RAIN_VERTICES];
-static word	m_indexarray[MAX_RAIN_INDICES];
-static int	m_iNumVerts, m_iNumIndex;
+static int	m_iNumVerts;
+
+static void RainColumnCell( float x, float y, int cell[2] )
+{
+	cell[0] = (int)floor( x * ( 1.0f / RAIN_COLUMN_SIZE ));
+	cell[1] = (int)floor( y * ( 1.0f / RAIN_COLUMN_SIZE ));
+}
+
+static bool RainColumnValid( const rain_column_t *col, const int cell[2] )
+{
+	if( col->traceTime == 0.0f || col->cell[0] != cell[0] || col->cell[1] != cell[1] )
+		return false;
+
+	return (( rain_curtime - col->traceTime ) < RAIN_COLUMN_LIFETIME && col->traceTime <= rain_curtime );
+}
+
+/*
+=================================
+GetRainColumn
+
+returns the cached heightfield column for given point.
+Traces the column when it's missing or outdated
+=================================
+*/
+static rain_column_t *GetRainColumn( float x, float y )
+{
+	int cell[2];
+
+	RainColumnCell( x, y, cell );
+
+	uint hash = ((uint)cell[0] * 73856093U) ^ ((uint)cell[1] * 19349663U);
+	rain_column_t *col = &g_columns[hash & (RAIN_COLUMN_HASH - 1)];
+
+	if( RainColumnValid( col, cell ))
+		return col;
+
+	// keep the warning state while the same cell is retraced
+	bool warned = ( col->traceTime != 0.0f && col->cell[0] == cell[0] && col->cell[1] == cell[1] && col->warned );
+	vec3_t vecStart, vecEnd;
+
+	vecStart[0] = ( cell[0] + 0.5f ) * RAIN_COLUMN_SIZE;
+	vecStart[1] = ( cell[1] + 0.5f ) * RAIN_COLUMN_SIZE;
+	vecStart[2] = Rain.globalHeight;
+	vecEnd = vecStart;
+	vecEnd[2] = -4096;
+
+	pmtrace_t pmtrace;
+	gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
+	gEngfuncs.pEventAPI->EV_PlayerTrace( vecStart, vecEnd, PM_STUDIO_IGNORE|PM_CUSTOM_IGNORE, -1, &pmtrace );
+
+	col->cell[0] = cell[0];
+	col->cell[1] = cell[1];
+	col->traceTime = rain_curtime;
+	col->waterEntity = 0;
+	col->type = COLUMN_GROUND;
+	col->height = pmtrace.endpos.z;
+	col->warned = warned;
+	columns_traced++;
+
+	if( pmtrace.startsolid || pmtrace.allsolid )
+	{
+		col->type = COLUMN_BLOCKED;
+		return col;
+	}
+
+	// falling to water?
+	if( gEngfuncs.PM_PointContents( pmtrace.endpos, NULL ) == CONTENTS_WATER )
+	{
+		int waterEntity = WATER_ENTITY( pmtrace.endpos );
+		cl_entity_t *pwater = NULL;
+
+		if( waterEntity > 0 )
+			pwater = gEngfuncs.GetEntityByIndex( waterEntity );
+
+		if( pwater && ( pwater->model != NULL ))
+		{
+			col->height = pwater->curstate.maxs.z - 1.0f;
+			col->waterEntity = waterEntity;
+			col->type = COLUMN_WATER;
+		}
+		else
+		{
+			if( !col->warned )
+				ALERT( at_error, "rain: water is not func_water entity\n" );
+			col->type = COLUMN_BLOCKED;
+			col->warned = true;
+		}
+	}
+
+	// just in case..
+	if( col->height > vecStart.z )
+		col->type = COLUMN_BLOCKED;
+
+	return col;
+}
 
 /*
 =================================
@@ -110,7 +222,7 @@ void ProcessRain( void )
 		return;
 	}
 
-	if(( Rain.dripsPerSecond == 0 && g_dripsArray.IsClear( )) || rain_timedelta > 0.1f )
+	if(( Rain.dripsPerSecond == 0 && !dripcounter ) || rain_timedelta > 0.1f )
 	{
 		rain_timedelta = min( rain_timedelta, 0.1f );
 
@@ -123,31 +235,28 @@ void ProcessRain( void )
 
 	double timeBetweenDrips = 1.0 / (double)Rain.dripsPerSecond;
 
-	if( !g_dripsArray.StartPass( ))
-	{
-		Rain.dripsPerSecond = 0; // disable rain
-		ALERT( at_error, "rain: failed to allocate memory block!\n" );
-		return;
-	}
-
-	cl_drip *curDrip = g_dripsArray.GetCurrent();	
-
 	// хранение отладочной информации
 	float debug_lifetime = 0;
 	int debug_howmany = 0;
 	int debug_attempted = 0;
 	int debug_dropped = 0;
 
+	columns_traced = 0;
 	ClearBounds( rain_mins, rain_maxs );
 
-	while( curDrip != NULL ) // go through list
+	float fallspeed;
+
+	if( Rain.weatherMode == MODE_RAIN )
+		fallspeed = DRIPSPEED;
+	else if( Rain.weatherMode == MODE_SNOW )
+		fallspeed = SNOWSPEED;
+	else return;
+
+	for( int i = 0; i < dripcounter; )
 	{
-		if( Rain.weatherMode == MODE_RAIN )
-			curDrip->origin.z -= rain_timedelta * DRIPSPEED;
-		else if( Rain.weatherMode == MODE_SNOW )
-			curDrip->origin.z -= rain_timedelta * SNOWSPEED;
-		else return;
+		cl_drip *curDrip = &g_drips[i];
 
+		curDrip->origin.z -= rain_timedelta * fallspeed;
 		curDrip->origin.x += rain_timedelta * curDrip->xDelta;
 		curDrip->origin.y += rain_timedelta * curDrip->yDelta;
 #if 1
@@ -160,12 +269,26 @@ void ProcessRain( void )
 		if( curDrip->origin[2] > rain_maxs[2] ) rain_maxs[2] = curDrip->origin[2];
 #else
 		AddPointToBounds( curDrip->origin, rain_mins, rain_maxs );
-#endif		
-		// remove drip if its origin lower than minHeight
-		if( curDrip->origin.z < curDrip->minHeight ) 
+#endif
+		rain_column_t *col = &curDrip->column;
+		int cell[2];
+
+		// query the shared cache only when drip moves to another cell
+		RainColumnCell( curDrip->origin.x, curDrip->origin.y, cell );
+		if( !RainColumnValid( col, cell ))
+			*col = *GetRainColumn( curDrip->origin.x, curDrip->origin.y );
+
+		// remove drip if its origin lower than column height
+		if( curDrip->origin.z < col->height || col->type == COLUMN_BLOCKED ) 
 		{
-			if( curDrip->landInWater )
-				WaterLandingEffect( curDrip ); // create water rings
+			if( col->type == COLUMN_WATER )
+			{
+				cl_entity_t *pwater = gEngfuncs.GetEntityByIndex( col->waterEntity );
+
+				// not error, just water out of PVS
+				if( pwater && Mod_BoxVisible( pwater->curstate.mins, pwater->curstate.maxs, Mod_GetCurrentVis( )))
+					WaterLandingEffect( curDrip, col->height ); // create water rings
+			}
 
 			if( cl_debug_rain->value )
 			{
@@ -173,28 +296,13 @@ void ProcessRain( void )
 				debug_howmany++;
 			}
 
-			g_dripsArray.DeleteCurrent();
-			dripcounter--;
+			// move last drip into the hole
+			g_drips[i] = g_drips[--dripcounter];
 		}
-		else
-			g_dripsArray.MoveNext();
-
-		curDrip = g_dripsArray.GetCurrent();
+		else i++;
 	}
 
-	int maxDelta; // maximum height randomize distance
-	float falltime;
-
-	if( Rain.weatherMode == MODE_RAIN )
-	{
-		maxDelta = DRIPSPEED * rain_timedelta; // for rain
-		falltime = (Rain.globalHeight + 4096) / DRIPSPEED;
-	}
-	else
-	{
-		maxDelta = SNOWSPEED * rain_timedelta; // for snow
-		falltime = (Rain.globalHeight + 4096) / SNOWSPEED;
-	}
+	int maxDelta = fallspeed * rain_timedelta; // maximum height randomize distance
 
 	while( rain_nextspawntime < rain_curtime )
 	{
@@ -206,8 +314,7 @@ void ProcessRain( void )
 		// check for overflow
 		if( dripcounter < MAXDRIPS )
 		{
-			float deathHeight;
-			vec3_t vecStart, vecEnd;
+			vec3_t vecStart;
 
 			vecStart[0] = RANDOM_FLOAT( GetVieworg().x - Rain.distFromPlayer, GetVieworg().x + Rain.distFromPlayer );
 			vecStart[1] = RANDOM_FLOAT( GetVieworg().y - Rain.distFromPlayer, GetVieworg().y + Rain.distFromPlayer );
@@ -216,73 +323,16 @@ void ProcessRain( void )
 			float xDelta = Rain.windX + RANDOM_FLOAT( Rain.randX * -1, Rain.randX );
 			float yDelta = Rain.windY + RANDOM_FLOAT( Rain.randY * -1, Rain.randY );
 
-			// find a point at bottom of map
-			vecEnd[0] = falltime * xDelta;
-			vecEnd[1] = falltime * yDelta;
-			vecEnd[2] = -4096;
+			rain_column_t *col = GetRainColumn( vecStart.x, vecStart.y );
 
-			pmtrace_t pmtrace;
-			gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
-			gEngfuncs.pEventAPI->EV_PlayerTrace( vecStart, vecStart + vecEnd, PM_STUDIO_IGNORE|PM_CUSTOM_IGNORE, -1, &pmtrace );
-
-			if( pmtrace.startsolid || pmtrace.allsolid )
+			if( col->type == COLUMN_BLOCKED )
 			{
 				if( cl_debug_rain->value )
 					debug_dropped++;
 				continue; // drip cannot be placed
 			}
 
-			// falling to water?
-			int contents = gEngfuncs.PM_PointContents( pmtrace.endpos, NULL );
-
-			if( contents == CONTENTS_WATER )
-			{
-				int waterEntity = WATER_ENTITY( pmtrace.endpos );
-
-				if( waterEntity > 0 )
-				{
-					cl_entity_t *pwater = gEngfuncs.GetEntityByIndex( waterEntity );
-
-					if( pwater && ( pwater->model != NULL ))
-					{
-						deathHeight = pwater->curstate.maxs.z - 1.0f;
-
-						if( !Mod_BoxVisible( pwater->curstate.mins, pwater->curstate.maxs, Mod_GetCurrentVis( )))
-							contents = CONTENTS_EMPTY; // not error, just water out of PVS
-					}
-					else
-					{
-						ALERT( at_error, "rain: can't get water entity\n" );
-						continue;
-					}
-				}
-				else
-				{
-					ALERT( at_error, "rain: water is not func_water entity\n" );
-					continue;
-				}
-			}
-			else
-			{
-				deathHeight = pmtrace.endpos.z;
-			}
-
-			// just in case..
-			if( deathHeight > vecStart.z )
-			{
-				ALERT( at_error, "rain: can't create drip in water\n");
-				continue;
-			}
-
-
-			cl_drip *newClDrip = g_dripsArray.Allocate();
-
-			if( !newClDrip )
-			{
-				Rain.dripsPerSecond = 0; // disable rain
-				ALERT( at_error, "rain: failed to allocate object!\n" );
-				return;
-			}
+			cl_drip *newClDrip = &g_drips[dripcounter++];
 
 			vecStart.z -= RANDOM_FLOAT( 0, maxDelta ); // randomize a bit
 
@@ -293,15 +343,7 @@ void ProcessRain( void )
 			newClDrip->yDelta = yDelta;
 
 			newClDrip->birthTime = rain_curtime; // store time when it was spawned
-			newClDrip->minHeight = deathHeight;
-
-			if( contents == CONTENTS_WATER )
-				newClDrip->landInWater = 1;
-			else
-				newClDrip->landInWater = 0;
-
-			// add to first place in chain
-			dripcounter++;
+			newClDrip->column = *col;
 		}
 		else
 		{
@@ -316,6 +358,7 @@ void ProcessRain( void )
 		gEngfuncs.Con_NPrintf( 1, "rain info: Drips exist: %i\n", dripcounter );
 		gEngfuncs.Con_NPrintf( 2, "rain info: FX's exist: %i\n", fxcounter );
 		gEngfuncs.Con_NPrintf( 3, "rain info: Attempted/Dropped: %i, %i\n", debug_attempted, debug_dropped );
+		gEngfuncs.Con_NPrintf( 5, "rain info: Columns traced: %i\n", columns_traced );
 
 		if( debug_howmany )
 		{
@@ -333,7 +376,7 @@ WaterLandingEffect
 создает круг на водной поверхности
 =================================
 */
-void WaterLandingEffect( cl_drip *drip )
+void WaterLandingEffect( cl_drip *drip, float height )
 {
 	if( fxcounter >= MAXFX )
 	{
@@ -341,16 +384,11 @@ void WaterLandingEffect( cl_drip *drip )
 		return;
 	}
 	
-	cl_rainfx *newFX = g_fxArray.Allocate();
-	if( !newFX )
-	{
-		ALERT( at_error, "rain: failed to allocate FX object!\n" );
-		return;
-	}
+	cl_rainfx *newFX = &g_fx[fxcounter];
 
 	newFX->alpha = RANDOM_FLOAT( 0.6f, 0.9f );
 	newFX->origin = drip->origin; 
-	newFX->origin.z = drip->minHeight - 1; // correct position
+	newFX->origin.z = height - 1; // correct position
 
 	newFX->birthTime = GET_CLIENT_TIME();
 	newFX->life = RANDOM_FLOAT( 0.7f, 1.0f );
@@ -369,27 +407,14 @@ ProcessFXObjects
 */
 void ProcessFXObjects( void )
 {
-	if( !g_fxArray.StartPass( ))
+	for( int i = 0; i < fxcounter; )
 	{
-		Rain.dripsPerSecond = 0; // disable rain
-		ALERT( at_error, "rain: failed to allocate FX object!\n" );
-		return;
-	}
-
-	cl_rainfx* curFX = g_fxArray.GetCurrent();
+		cl_rainfx *curFX = &g_fx[i];
 
-	while( curFX != NULL ) // go through FX objects list
-	{
 		// delete current?
 		if(( curFX->birthTime + curFX->life ) < rain_curtime )
-		{
-			g_fxArray.DeleteCurrent();
-			fxcounter--;
-		}
-		else
-			g_fxArray.MoveNext();
-
-		curFX = g_fxArray.GetCurrent();
+			g_fx[i] = g_fx[--fxcounter];
+		else i++;
 	}
 }
 
@@ -402,8 +427,7 @@ ResetRain
 void ResetRain( void )
 {
 	// delete all drips
-	g_dripsArray.Clear();
-	g_fxArray.Clear();
+	memset( g_columns, 0, sizeof( g_columns ));
 	
 	dripcounter = 0;
 	fxcounter = 0;
@@ -411,6 +435,61 @@ void ResetRain( void )
 	InitRain();
 }
 
+/*
+=================================
+DrawRainArrays
+
+upload all the vertices with single call
+and draw them
+=================================
+*/
+static void DrawRainArrays( GLenum mode )
+{
+	if( !m_iNumVerts ) return;
+
+	const size_t vertsSize = m_iNumVerts * sizeof( Vector );
+	const size_t colorsSize = m_iNumVerts * sizeof( m_colorarray[0] );
+	const size_t coordsSize = m_iNumVerts * sizeof( Vector2D );
+	const byte *vertsPtr = (byte *)m_vertexarray;
+	const byte *colorsPtr = (byte *)m_colorarray;
+	const byte *coordsPtr = (byte *)m_coordsarray;
+
+	if( GL_Support( R_ARB_VERTEX_BUFFER_OBJECT_EXT ))
+	{
+		if( !rain_vbo ) pglGenBuffersARB( 1, &rain_vbo );
+
+		pglBindBufferARB( GL_ARRAY_BUFFER_ARB, rain_vbo );
+
+		// orphan the previous storage so driver don't wait for it
+		pglBufferDataARB( GL_ARRAY_BUFFER_ARB, vertsSize + colorsSize + coordsSize, NULL, GL_STREAM_DRAW_ARB );
+		pglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, 0, vertsSize, m_vertexarray );
+		pglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, vertsSize, colorsSize, m_colorarray );
+		pglBufferSubDataARB( GL_ARRAY_BUFFER_ARB, vertsSize + colorsSize, coordsSize, m_coordsarray );
+
+		vertsPtr = (byte *)0;
+		colorsPtr = (byte *)vertsSize;
+		coordsPtr = (byte *)(vertsSize + colorsSize);
+	}
+
+	pglEnableClientState( GL_VERTEX_ARRAY );
+	pglVertexPointer( 3, GL_FLOAT, 0, vertsPtr );
+
+	pglEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	pglTexCoordPointer( 2, GL_FLOAT, 0, coordsPtr );
+
+	pglEnableClientState( GL_COLOR_ARRAY );
+	pglColorPointer( 4, GL_UNSIGNED_BYTE, 0, colorsPtr );
+
+	pglDrawArrays( mode, 0, m_iNumVerts );
+
+	pglDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	pglDisableClientState( GL_VERTEX_ARRAY );
+	pglDisableClientState( GL_COLOR_ARRAY );
+
+	if( GL_Support( R_ARB_VERTEX_BUFFER_OBJECT_EXT ))
+		pglBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+}
+
 /*
 =================================
 DrawRain
@@ -420,7 +499,7 @@ DrawRain
 */
 void DrawRain( void )
 {
-	if( g_dripsArray.IsClear( ))
+	if( !dripcounter )
 		return; // no drips to draw
 
 	if( !Mod_BoxVisible( rain_mins, rain_maxs, Mod_GetCurrentVis( )))
@@ -447,23 +526,17 @@ void DrawRain( void )
 
 	float visibleHeight = Rain.globalHeight - SNOWFADEDIST;
 
-	m_iNumVerts = m_iNumIndex = 0;
-	
-	// go through drips list
-	g_dripsArray.StartPass();
-	cl_drip *Drip = g_dripsArray.GetCurrent();
+	m_iNumVerts = 0;
 
 	if( Rain.weatherMode == MODE_RAIN )
 	{
-		while( Drip != NULL )
+		for( int i = 0; i < dripcounter; i++ )
 		{
+			cl_drip *Drip = &g_drips[i];
+
 			// cull invisible drips
 			if( R_CullSphere( Drip->origin, SNOW_SPRITE_HALFSIZE + 1 ))
-			{
-				g_dripsArray.MoveNext();
-				Drip = g_dripsArray.GetCurrent();
 				continue;
-			}
 
 			if(( m_iNumVerts + 3 ) >= MAX_RAIN_VERTICES )
 			{
@@ -492,7 +565,7 @@ void DrawRain( void )
 			m_colorarray[m_iNumVerts][2] = 255;
 			m_colorarray[m_iNumVerts][3] = alpha;
 			m_vertexarray[m_iNumVerts] = Vector( Drip->origin.x - toPlayer.y - shiftX, Drip->origin.y + toPlayer.x - shiftY, Drip->origin.z + DRIP_SPRITE_HALFHEIGHT );
-			m_indexarray[m_iNumIndex++] = m_iNumVerts++;
+			m_iNumVerts++;
 
 			m_coordsarray[m_iNumVerts].x = 0.5f;
 			m_coordsarray[m_iNumVerts].y = 1.0f;
@@ -501,7 +574,7 @@ void DrawRain( void )
 			m_colorarray[m_iNumVerts][2] = 255;
 			m_colorarray[m_iNumVerts][3] = alpha;
 			m_vertexarray[m_iNumVerts] = Vector( Drip->origin.x + shiftX, Drip->origin.y + shiftY, Drip->origin.z - DRIP_SPRITE_HALFHEIGHT );
-			m_indexarray[m_iNumIndex++] = m_iNumVerts++;
+			m_iNumVerts++;
 
 			// set right top corner
 			m_coordsarray[m_iNumVerts].x = 1.0f;
@@ -511,41 +584,21 @@ void DrawRain( void )
 			m_colorarray[m_iNumVerts][2] = 255;
 			m_colorarray[m_iNumVerts][3] = alpha;
 			m_vertexarray[m_iNumVerts] = Vector( Drip->origin.x + toPlayer.y - shiftX, Drip->origin.y - toPlayer.x - shiftY, Drip->origin.z + DRIP_SPRITE_HALFHEIGHT );
-			m_indexarray[m_iNumIndex++] = m_iNumVerts++;
-
-			g_dripsArray.MoveNext();
-			Drip = g_dripsArray.GetCurrent();
+			m_iNumVerts++;
 		}
 
-		pglEnableClientState( GL_VERTEX_ARRAY );
-		pglVertexPointer( 3, GL_FLOAT, 0, m_vertexarray );
-
-		pglEnableClientState( GL_TEXTURE_COORD_ARRAY );
-		pglTexCoordPointer( 2, GL_FLOAT, 0, m_coordsarray );
-
-		pglEnableClientState( GL_COLOR_ARRAY );
-		pglColorPointer( 4, GL_UNSIGNED_BYTE, 0, m_colorarray );
-
-		if( GL_Support( R_DRAW_RANGEELEMENTS_EXT ))
-			pglDrawRangeElementsEXT( GL_TRIANGLES, 0, m_iNumVerts - 1, m_iNumIndex, GL_UNSIGNED_SHORT, m_indexarray );
-		else pglDrawElements( GL_TRIANGLES, m_iNumIndex, GL_UNSIGNED_SHORT, m_indexarray );
-
-		r_stats.c_total_tris += (m_iNumIndex / 3);
-		pglDisableClientState( GL_TEXTURE_COORD_ARRAY );
-		pglDisableClientState( GL_VERTEX_ARRAY );
-		pglDisableClientState( GL_COLOR_ARRAY );
+		DrawRainArrays( GL_TRIANGLES );
+		r_stats.c_total_tris += (m_iNumVerts / 3);
 	}
 	else if( Rain.weatherMode == MODE_SNOW )
 	{
-		while( Drip != NULL )
+		for( int i = 0; i < dripcounter; i++ )
 		{
+			cl_drip *Drip = &g_drips[i];
+
 			// cull invisible flakes
 			if( R_CullSphere( Drip->origin, SNOW_SPRITE_HALFSIZE + 1 ))
-			{
-				g_dripsArray.MoveNext();
-				Drip = g_dripsArray.GetCurrent();
 				continue;
-			}
 
 			if(( m_iNumVerts + 4 ) >= MAX_RAIN_VERTICES )
 			{
@@ -568,7 +621,7 @@ void DrawRain( void )
 			m_colorarray[m_iNumVerts][2] = 255;
 			m_colorarray[m_iNumVerts][3] = alpha;
 			m_vertexarray[m_iNumVerts] = Drip->origin + GetVLeft() * -SNOW_SPRITE_HALFSIZE + GetVUp() * -SNOW_SPRITE_HALFSIZE;
-			m_indexarray[m_iNumIndex++] = m_iNumVerts++;
+			m_iNumVerts++;
 
 			// set left top corner
 			m_coordsarray[m_iNumVerts].x = 0.0f;
@@ -578,7 +631,7 @@ void DrawRain( void )
 			m_colorarray[m_iNumVerts][2] = 255;
 			m_colorarray[m_iNumVerts][3] = alpha;
 			m_vertexarray[m_iNumVerts] = Drip->origin + GetVLeft() * -SNOW_SPRITE_HALFSIZE + GetVUp() * SNOW_SPRITE_HALFSIZE;
-			m_indexarray[m_iNumIndex++] = m_iNumVerts++;
+			m_iNumVerts++;
 
 			// set right top corner
 			m_coordsarray[m_iNumVerts].x = 1.0f;
@@ -588,7 +641,7 @@ void DrawRain( void )
 			m_colorarray[m_iNumVerts][2] = 255;
 			m_colorarray[m_iNumVerts][3] = alpha;
 			m_vertexarray[m_iNumVerts] = Drip->origin + GetVLeft() * SNOW_SPRITE_HALFSIZE + GetVUp() * SNOW_SPRITE_HALFSIZE;
-			m_indexarray[m_iNumIndex++] = m_iNumVerts++;
+			m_iNumVerts++;
 
 			// set right bottom corner
 			m_coordsarray[m_iNumVerts].x = 1.0f;
@@ -598,29 +651,11 @@ void DrawRain( void )
 			m_colorarray[m_iNumVerts][2] = 255;
 			m_colorarray[m_iNumVerts][3] = alpha;
 			m_vertexarray[m_iNumVerts] = Drip->origin + GetVLeft() * SNOW_SPRITE_HALFSIZE + GetVUp() * -SNOW_SPRITE_HALFSIZE;
-			m_indexarray[m_iNumIndex++] = m_iNumVerts++;
-
-			g_dripsArray.MoveNext();
-			Drip = g_dripsArray.GetCurrent();
+			m_iNumVerts++;
 		}
 
-		pglEnableClientState( GL_VERTEX_ARRAY );
-		pglVertexPointer( 3, GL_FLOAT, 0, m_vertexarray );
-
-		pglEnableClientState( GL_TEXTURE_COORD_ARRAY );
-		pglTexCoordPointer( 2, GL_FLOAT, 0, m_coordsarray );
-
-		pglEnableClientState( GL_COLOR_ARRAY );
-		pglColorPointer( 4, GL_UNSIGNED_BYTE, 0, m_colorarray );
-
-		if( GL_Support( R_DRAW_RANGEELEMENTS_EXT ))
-			pglDrawRangeElementsEXT( GL_QUADS, 0, m_iNumVerts - 1, m_iNumIndex, GL_UNSIGNED_SHORT, m_indexarray );
-		else pglDrawElements( GL_QUADS, m_iNumIndex, GL_UNSIGNED_SHORT, m_indexarray );
-
-		r_stats.c_total_tris += (m_iNumIndex / 4); // FIXME: this is correct?
-		pglDisableClientState( GL_TEXTURE_COORD_ARRAY );
-		pglDisableClientState( GL_VERTEX_ARRAY );
-		pglDisableClientState( GL_COLOR_ARRAY );
+		DrawRainArrays( GL_QUADS );
+		r_stats.c_total_tris += (m_iNumVerts / 2);
 	}
 }
 
@@ -633,7 +668,7 @@ DrawFXObjects
 */
 void DrawFXObjects( void )
 {
-	if( g_fxArray.IsClear( ))
+	if( !fxcounter )
 		return; // no objects to draw
 
 	HSPRITE hsprTexture;
@@ -648,14 +683,13 @@ void DrawFXObjects( void )
 	gEngfuncs.pTriAPI->RenderMode( kRenderTransAdd );
 	gEngfuncs.pTriAPI->CullFace( TRI_NONE ); // because we also want to view water rings underwater
 
-	// go through objects list
-	g_fxArray.StartPass();
-	cl_rainfx *curFX = g_fxArray.GetCurrent();
-
-	m_iNumVerts = m_iNumIndex = 0;
+	m_iNumVerts = 0;
 
-	while( curFX != NULL )
+	// go through objects list
+	for( int i = 0; i < fxcounter; i++ )
 	{
+		cl_rainfx *curFX = &g_fx[i];
+
 		if(( m_iNumVerts + 4 ) >= MAX_RAIN_VERTICES )
 		{
 			ALERT( at_error, "Too many water rings\n" );
@@ -664,11 +698,7 @@ void DrawFXObjects( void )
 
 		// cull invisible rings
 		if( R_CullSphere( curFX->origin, MAX_RING_HALFSIZE + 1 ))
-		{
-			g_fxArray.MoveNext();
-			curFX = g_fxArray.GetCurrent();
 			continue;
-		}
 
 		// fadeout
 		byte alpha = (((curFX->birthTime + curFX->life - rain_curtime) / curFX->life) * curFX->alpha) * 255;
@@ -681,7 +711,7 @@ void DrawFXObjects( void )
 		m_colorarray[m_iNumVerts][2] = 255;
 		m_colorarray[m_iNumVerts][3] = alpha;
 		m_vertexarray[m_iNumVerts] = Vector( curFX->origin.x - size, curFX->origin.y - size, curFX->origin.z );
-		m_indexarray[m_iNumIndex++] = m_iNumVerts++;
+		m_iNumVerts++;
 
 		m_coordsarray[m_iNumVerts].x = 0.0f;
 		m_coordsarray[m_iNumVerts].y = 1.0f;
@@ -690,7 +720,7 @@ void DrawFXObjects( void )
 		m_colorarray[m_iNumVerts][2] = 255;
 		m_colorarray[m_iNumVerts][3] = alpha;
 		m_vertexarray[m_iNumVerts] = Vector( curFX->origin.x - size, curFX->origin.y + size, curFX->origin.z );
-		m_indexarray[m_iNumIndex++] = m_iNumVerts++;
+		m_iNumVerts++;
 
 		m_coordsarray[m_iNumVerts].x = 1.0f;
 		m_coordsarray[m_iNumVerts].y = 1.0f;
@@ -699,7 +729,7 @@ void DrawFXObjects( void )
 		m_colorarray[m_iNumVerts][2] = 255;
 		m_colorarray[m_iNumVerts][3] = alpha;
 		m_vertexarray[m_iNumVerts] = Vector( curFX->origin.x + size, curFX->origin.y + size, curFX->origin.z );
-		m_indexarray[m_iNumIndex++] = m_iNumVerts++;
+		m_iNumVerts++;
 
 		m_coordsarray[m_iNumVerts].x = 1.0f;
 		m_coordsarray[m_iNumVerts].y = 0.0f;
@@ -708,29 +738,11 @@ void DrawFXObjects( void )
 		m_colorarray[m_iNumVerts][2] = 255;
 		m_colorarray[m_iNumVerts][3] = alpha;
 		m_vertexarray[m_iNumVerts] = Vector( curFX->origin.x + size, curFX->origin.y - size, curFX->origin.z );
-		m_indexarray[m_iNumIndex++] = m_iNumVerts++;
-
-		g_fxArray.MoveNext();
-		curFX = g_fxArray.GetCurrent();
+		m_iNumVerts++;
 	}
 
-	pglEnableClientState( GL_VERTEX_ARRAY );
-	pglVertexPointer( 3, GL_FLOAT, 0, m_vertexarray );
-
-	pglEnableClientState( GL_TEXTURE_COORD_ARRAY );
-	pglTexCoordPointer( 2, GL_FLOAT, 0, m_coordsarray );
-
-	pglEnableClientState( GL_COLOR_ARRAY );
-	pglColorPointer( 4, GL_UNSIGNED_BYTE, 0, m_colorarray );
-
-	if( GL_Support( R_DRAW_RANGEELEMENTS_EXT ))
-		pglDrawRangeElementsEXT( GL_QUADS, 0, m_iNumVerts - 1, m_iNumIndex, GL_UNSIGNED_SHORT, m_indexarray );
-	else pglDrawElements( GL_QUADS, m_iNumIndex, GL_UNSIGNED_SHORT, m_indexarray );
-
-	r_stats.c_total_tris += (m_iNumIndex / 4); // FIXME: this is correct?
-	pglDisableClientState( GL_TEXTURE_COORD_ARRAY );
-	pglDisableClientState( GL_VERTEX_ARRAY );
-	pglDisableClientState( GL_COLOR_ARRAY );
+	DrawRainArrays( GL_QUADS );
+	r_stats.c_total_tris += (m_iNumVerts / 2);
 
 	gEngfuncs.pTriAPI->CullFace( TRI_FRONT );
 }
@@ -752,6 +764,17 @@ void InitRain( void )
 	rain_nextspawntime = 0;
 }
 
+/*
+=================================
+ShutdownRain
+=================================
+*/
+void ShutdownRain( void )
+{
+	if( rain_vbo ) pglDeleteBuffersARB( 1, &rain_vbo );
+	rain_vbo = 0;
+}
+
 /*
 =================================
 ParseRain
@@ -767,6 +790,9 @@ void ParseRain( void )
 	Rain.randY =		READ_COORD();
 	Rain.weatherMode =		READ_SHORT();
 	Rain.globalHeight =		READ_COORD();
+
+	// columns was traced from the old height
+	memset( g_columns, 0, sizeof( g_columns ));
 }
 
 /*
@@ -776,6 +802,8 @@ R_DrawWeather
 */
 void R_DrawWeather( void )
 {
+	PROF_SCOPE( "R_DrawWeather" );
+
 	if( !CVAR_TO_BOOL( cl_draw_rain ))
 		return;
 
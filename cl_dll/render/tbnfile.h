@@ -51,4 +51,28 @@ typedef struct
 	dvertmatrix_t	verts[1];		// variable sized
 } dmodeltbn_t;
 
+/*
+==============================================================================
+
+WORLD VERTEX CACHE
+
+.wvc contain the world vertex array with precomputed TBN and lmcoords
+==============================================================================
+*/
+
+#define IDWORLDVERTHEADER	(('C'<<24)+('V'<<16)+('W'<<8)+'B') // little-endian "BWVC"
+#define WORLDVERT_VERSION	1
+
+typedef struct
+{
+	int		ident;
+	int		version;
+	unsigned int	mapCRC;		// catch for geometry and lighting changes
+	int		vertexsize;	// sizeof( bvert_t )
+	int		blocksize;	// lightmap page size, lmcoords are depends on it
+	int		maxlights;	// r_deferred_maxlights, packed light numbers are depends on it
+	int		numverts;
+	// followed by bvert_t verts[numverts]
+} dworldverts_t;
+
 #endif//TBNFILE_H
\ No newline at end of file
@@ -86,6 +86,9 @@ cvar_t	*r_lightmap;
 cvar_t	*r_speeds;
 cvar_t	*r_decals;
 cvar_t	*r_studio_decals;
+cvar_t	*r_threads;
+cvar_t	*r_loadprofile;
+cvar_t	*r_profile;
 cvar_t	*r_clear;
 cvar_t	*r_finish;
 cvar_t	*r_sunshadows;
@@ -1882,6 +1885,12 @@ void V_Init (void)
 	gEngfuncs.pfnAddCommand ("centerview", V_StartPitchDrift );
 	gEngfuncs.pfnAddCommand ("buildcubemaps", CL_BuildCubemaps_f );
 	ADD_COMMAND( "gpu_mem_usage", GL_GpuMemUsage_f );
+	ADD_COMMAND( "bonemath_check", GL_BoneMathCheck_f );
+	ADD_COMMAND( "tracemesh_bench", GL_TraceMeshBench_f );
+	ADD_COMMAND( "prepframe_bench", R_PrepFrameBench_f );
+	ADD_COMMAND( "prepframe_record", R_PrepFrameRecord_f );
+	ADD_COMMAND( "r_profile_dump", R_ProfileDump_f );
+	ADD_COMMAND( "r_profile_capture", R_ProfileCapture_f );
 
 	scr_ofsx			= CVAR_REGISTER( "scr_ofsx","0", 0 );
 	scr_ofsy			= CVAR_REGISTER( "scr_ofsy","0", 0 );
@@ -1967,6 +1976,9 @@ void V_Init (void)
 	r_lightstyles	= CVAR_REGISTER( "gl_lightstyles", "1", FCVAR_ARCHIVE );
 	r_allow_mirrors	= CVAR_REGISTER( "gl_allow_mirrors", "1", FCVAR_ARCHIVE );
 	r_studio_decals	= CVAR_REGISTER( "r_studio_decals", "32", FCVAR_ARCHIVE );
+	r_threads		= CVAR_REGISTER( "r_threads", "0", FCVAR_ARCHIVE );	// 0 - autodetect
+	r_loadprofile	= CVAR_REGISTER( "r_loadprofile", "0", FCVAR_ARCHIVE );	// 1 - summary, 2 - also write chrome trace
+	r_profile		= CVAR_REGISTER( "r_profile", "0", 0 );	// 1 - frame profile overlay, 2 - show all the scopes
 	cv_show_tbn	= CVAR_REGISTER( "gl_show_basis", "0", FCVAR_ARCHIVE );
 	cv_brdf		= CVAR_REGISTER( "r_lighting_brdf", "1", FCVAR_ARCHIVE );
 
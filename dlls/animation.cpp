@@ -33,6 +33,7 @@
 #endif
 
 #include "cbase.h"
+#include "game.h"
 
 // Global engine <-> studio model rendering code interface
 float m_poseparameter[MAXSTUDIOPOSEPARAM]; // stub
@@ -115,6 +116,13 @@ int Server_GetBlendingInterface( int version, sv_blending_interface_t **ppinterf
 	return 1;
 }
 
+void ResetAnimationCache( void )
+{
+	// models will be reloaded at the new level
+	g_boneSetup.FlushAnimCache();
+	g_boneSetup.SetAnimCacheSize( (int)sv_animcache.value );
+}
+
 void SetupModelBones( studiohdr_t *header )
 {
 	g_boneSetup.SetStudioPointers( header, m_poseparameter );
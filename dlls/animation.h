@@ -51,6 +51,7 @@ void SetPoseParameter( void *pmodel, int iParameter, float flValue, float *posep
 float GetPoseParameter( void *pmodel, int iParameter, float *poseparams );
 int FindHitboxSetByName( void *pmodel, const char *name );
 CStudioBoneSetup *GetBaseBoneSetup( int modelindex, float *poseparams );
+void ResetAnimationCache( void );
 
 // paranoia 2 added
 float GetControllerBound2( void *pmodel, int iController );
@@ -22,6 +22,7 @@
 #include	"game.h"
 #include	"movewith.h"
 #include	"skill.h"
+#include	"profiler.h"
 
 void EntvarsKeyvalue( entvars_t *pev, KeyValueData *pkvd );
 
@@ -303,6 +304,7 @@ void DispatchUse( edict_t *pentUsed, edict_t *pentOther )
 void DispatchThink( edict_t *pent )
 {
 	CBaseEntity *pEntity = (CBaseEntity *)GET_PRIVATE(pent);
+	PROF_SCOPE( "DispatchThink" );
 
 	if (pEntity)
 	{
@@ -42,6 +42,7 @@
 #include "netadr.h"
 #include "movewith.h"
 #include "material.h"
+#include "profiler.h"
 #include	"skill.h" // buz
 
 extern DLL_GLOBAL ULONG		g_ulModelIndexPlayer;
@@ -767,6 +768,11 @@ void ParmsChangeLevel( void )
 //
 void StartFrame( void )
 {
+	PROF_EndFrame();
+	PROF_BeginFrame( sv_profile.value > 0.0f );
+
+	PROF_SCOPE( "StartFrame" );
+
 	if ( g_pGameRules )
 		g_pGameRules->Think();
 
@@ -780,6 +786,60 @@ void StartFrame( void )
 	CheckAssistList(); //LRC
 }
 
+/*
+================
+SV_ProfileDump_f
+
+print the server frame profile into console
+================
+*/
+void SV_ProfileDump_f( void )
+{
+	static char	text[16384];
+	char		*line, *next;
+
+	if( !PROF_Summary( text, sizeof( text ), false ))
+	{
+		ALERT( at_console, "profiler is not active, set sv_profile 1 first\n" );
+		return;
+	}
+
+	// engine has a limited print buffer
+	for( line = text; *line; line = next )
+	{
+		if(( next = Q_strchr( line, '\n' )) != NULL )
+			*next++ = '\0';
+		else next = line + Q_strlen( line );
+
+		ALERT( at_console, "%s\n", line );
+	}
+}
+
+/*
+================
+SV_ProfileCapture_f
+
+write next server frames as a chrome trace
+================
+*/
+void SV_ProfileCapture_f( void )
+{
+	char	filename[256];
+	int	numframes = 60;
+
+	if( !g_fPhysicInitialized )
+	{
+		ALERT( at_console, "sv_profile_capture: not supported by this engine\n" );
+		return;
+	}
+
+	if( CMD_ARGC() > 1 )
+		numframes = Q_atoi( CMD_ARGV( 1 ));
+
+	Q_snprintf( filename, sizeof( filename ), "profile/frames_sv_%s.json", STRING( gpGlobals->mapname )[0] ? STRING( gpGlobals->mapname ) : "nomap" );
+	PROF_StartCapture( numframes, filename );
+}
+
 void PrecacheMaterialSounds( void )
 {
 	ALERT( at_aiconsole, "loading materials.def\n" );
@@ -25,6 +25,8 @@ extern void ClientUserInfoChanged( edict_t *pEntity, char *infobuffer );
 extern void ServerActivate( edict_t *pEdictList, int edictCount, int clientMax );
 extern void ServerDeactivate( void );
 extern void StartFrame( void );
+extern void SV_ProfileDump_f( void );
+extern void SV_ProfileCapture_f( void );
 extern void PlayerPostThink( edict_t *pEntity );
 extern void PlayerPreThink( edict_t *pEntity );
 extern void ParmsNewLevel( void );
@@ -115,6 +115,7 @@ inline void *GET_PRIVATE( edict_t *pent )
 #define CMD_ARGS					(*g_engfuncs.pfnCmd_Args)
 #define CMD_ARGC					(*g_engfuncs.pfnCmd_Argc)
 #define CMD_ARGV					(*g_engfuncs.pfnCmd_Argv)
+#define ADD_SERVER_COMMAND			(*g_engfuncs.pfnAddServerCommand)
 #define GET_ATTACHMENT			(*g_engfuncs.pfnGetAttachment)
 #define SET_VIEW				(*g_engfuncs.pfnSetView)
 #define SET_CROSSHAIRANGLE		(*g_engfuncs.pfnCrosshairAngle)
@@ -16,6 +16,8 @@
 #include "eiface.h"
 #include "util.h"
 #include "game.h"
+#include "jobs.h"
+#include "client.h"
 
 cvar_t	displaysoundlist = {"displaysoundlist","0"};
 
@@ -44,6 +46,10 @@ cvar_t	mw_debug={"sohl_mwdebug","0", FCVAR_SERVER }; //LRC - debug info. for Mov
 
 cvar_t  mp_chattime = {"mp_chattime","10", FCVAR_SERVER };
 
+cvar_t	sv_profile = {"sv_profile","0" };	// collect per-frame CPU profile, see sv_profile_dump
+cvar_t	sv_animcache = {"sv_animcache","128" };	// animation cache entries, applied on level change
+cvar_t	sv_threads = {"sv_threads","0" };	// worker threads for mesh building, 0 - autodetect, 1 - disable
+
 // Engine Cvars
 cvar_t 	*g_psv_gravity = NULL;
 cvar_t	*g_psv_aim = NULL;
@@ -558,6 +564,12 @@ void GameDLLInit( void )
 	g_footsteps = CVAR_GET_POINTER( "mp_footsteps" );
 	g_precache_meshes = CVAR_GET_POINTER( "sv_precache_meshes" );
 
+	CVAR_REGISTER (&sv_threads);
+	CVAR_REGISTER (&sv_animcache);
+
+	// worker threads for collision mesh building
+	JOB_Init( (int)sv_threads.value );
+
 	CVAR_REGISTER (&displaysoundlist);
 
 	CVAR_REGISTER (&weapon_x);
@@ -587,6 +599,10 @@ void GameDLLInit( void )
 
 	CVAR_REGISTER (&mp_chattime);
 
+	CVAR_REGISTER (&sv_profile);
+	ADD_SERVER_COMMAND( "sv_profile_dump", SV_ProfileDump_f );
+	ADD_SERVER_COMMAND( "sv_profile_capture", SV_ProfileCapture_f );
+
 // REGISTER CVARS FOR SKILL LEVEL STUFF
 	// Agrunt
 	CVAR_REGISTER ( &sk_agrunt_health1 );// {"sk_agrunt_health1","0"};
@@ -1084,4 +1100,5 @@ void GameDLLInit( void )
 
 void GameDLLShutdown( void )
 {
+	JOB_Shutdown();
 }
\ No newline at end of file
@@ -47,6 +47,10 @@ extern cvar_t	weapon_x;
 extern cvar_t	weapon_y;
 extern cvar_t	weapon_z;
 
+extern cvar_t	sv_profile;
+extern cvar_t	sv_animcache;
+extern cvar_t	sv_threads;
+
 void LinkUserMessages( void );
 
 #endif		// GAME_H
\ No newline at end of file
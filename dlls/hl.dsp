@@ -319,6 +319,10 @@ SOURCE=.\items.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\game_shared\jobs.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\leech.cpp
 # End Source File
 # Begin Source File
@@ -427,6 +431,10 @@ SOURCE=..\pm_shared\pm_shared.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\game_shared\profiler.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\roach.cpp
 # End Source File
 # Begin Source File
@@ -35,6 +35,7 @@
 #include "gamerules.h"
 #include "player.h" // buz
 #include "material.h" // g-cont
+#include "profiler.h"
 
 #define MONSTER_CUT_CORNER_DIST		8 // 8 means the monster's bounding box is contained without the box of the node in WC
 
@@ -589,6 +590,8 @@ void CBaseMonster :: RunAnimation( void )
 //=========================================================
 void CBaseMonster :: MonsterThink ( void )
 {
+	PROF_SCOPE( "MonsterThink" );
+
 	SetNextThink( 0.1 );// keep monster thinking.
 
 	RunAI();
@@ -34,6 +34,7 @@
 #include "gamerules.h"
 #include "teamplay_gamerules.h"
 #include "movewith.h" //LRC
+#include "animation.h"
 
 extern CGraph WorldGraph;
 extern CSoundEnt *pSoundEnt;
@@ -504,6 +505,8 @@ void CWorld :: Precache( void )
 
 	g_pGameRules = InstallGameRules( );
 
+	ResetAnimationCache();
+
 	//!!!UNDONE why is there so much Spawn code in the Precache function? I'll just keep it here 
 
 	///!!!LATER - do we want a sound ent in deathmatch? (sjb)
@@ -766,6 +766,7 @@ typedef struct
 {
 	vbomesh_t		*meshes;			// meshes per submodel
 	int		nummesh;			// mstudiomodel_t->nummesh
+	struct mstudiodecalcache_s	*decalcache;		// bind pose triangles for decal projection (built on demand)
 } msubmodel_t;
 
 // triangles
@@ -152,7 +152,38 @@ void CStudioBoneSetup :: AdjustBoneOrigin( mstudiobone_t *pbone, Vector &origin
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: decompress all the dofs of a single bone
+//-----------------------------------------------------------------------------
+void CStudioBoneSetup :: ExtractBoneValues( int frame, float s, int firstdof, int numdofs, mstudiobone_t *pbone, mstudioanim_t *panim, float *values )
+{
+	for( int j = firstdof; j < firstdof + numdofs; j++ )
+	{
+		if( s > 0.001f )
+		{
+			ExtractAnimValue( frame, pAnimvalue( panim, j ), pbone->scale[j], values[j*2+0], values[j*2+1] );
+		}
+		else
+		{
+			ExtractAnimValue( frame, pAnimvalue( panim, j ), pbone->scale[j], values[j*2+0] );
+			values[j*2+1] = values[j*2+0];
+		}
+	}
+}
+
 Vector4D CStudioBoneSetup :: CalcBoneQuaternion( int frame, float s, int flags, mstudiobone_t *pbone, mstudioboneinfo_t *pinfo, mstudioanim_t *panim )
+{
+	float	values[ANIMCACHE_VALUES];
+
+	ExtractBoneValues( frame, s, 3, 3, pbone, panim, values );
+
+	return CalcBoneQuaternion( values, s, flags, pbone, pinfo );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: return a sub frame rotation from decompressed values
+//-----------------------------------------------------------------------------
+Vector4D CStudioBoneSetup :: CalcBoneQuaternion( const float *values, float s, int flags, mstudiobone_t *pbone, mstudioboneinfo_t *pinfo )
 {
 	Radian	angles1, angles2;
 	Vector4D	q1, q2, q;
@@ -162,9 +193,8 @@ Vector4D CStudioBoneSetup :: CalcBoneQuaternion( int frame, float s, int flags,
 
 	if( s > 0.001f )
 	{
-		ExtractAnimValue( frame, pAnimvalue( panim, 3 ), pbone->scale[3], angles1.x, angles2.x );
-		ExtractAnimValue( frame, pAnimvalue( panim, 4 ), pbone->scale[4], angles1.y, angles2.y );
-		ExtractAnimValue( frame, pAnimvalue( panim, 5 ), pbone->scale[5], angles1.z, angles2.z );
+		angles1 = Radian( values[6], values[8], values[10] );
+		angles2 = Radian( values[7], values[9], values[11] );
 
 		if( !FBitSet( flags, STUDIO_DELTA ))
 		{
@@ -188,9 +218,7 @@ Vector4D CStudioBoneSetup :: CalcBoneQuaternion( int frame, float s, int flags,
 	}
 	else
 	{
-		ExtractAnimValue( frame, pAnimvalue( panim, 3 ), pbone->scale[3], angles1.x );
-		ExtractAnimValue( frame, pAnimvalue( panim, 4 ), pbone->scale[4], angles1.y );
-		ExtractAnimValue( frame, pAnimvalue( panim, 5 ), pbone->scale[5], angles1.z );
+		angles1 = Radian( values[6], values[8], values[10] );
 		angles2 = g_radZero; // dummy
 
 		if( !FBitSet( flags, STUDIO_DELTA ))
@@ -218,15 +246,26 @@ Vector4D CStudioBoneSetup :: CalcBoneQuaternion( int frame, float s, int flags,
 // Purpose: return a sub frame position for a single bone
 //-----------------------------------------------------------------------------
 Vector CStudioBoneSetup :: CalcBonePosition( int frame, float s, int flags, mstudiobone_t *pbone, mstudioanim_t *panim )
+{
+	float	values[ANIMCACHE_VALUES];
+
+	ExtractBoneValues( frame, s, 0, 3, pbone, panim, values );
+
+	return CalcBonePosition( values, s, flags, pbone );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: return a sub frame position from decompressed values
+//-----------------------------------------------------------------------------
+Vector CStudioBoneSetup :: CalcBonePosition( const float *values, float s, int flags, mstudiobone_t *pbone )
 {
 	Vector	origin1, origin2;
 	Vector	pos;
 
 	if( s > 0.001f )
 	{
-		ExtractAnimValue( frame, pAnimvalue( panim, 0 ), pbone->scale[0], origin1.x, origin2.x );
-		ExtractAnimValue( frame, pAnimvalue( panim, 1 ), pbone->scale[1], origin1.y, origin2.y );
-		ExtractAnimValue( frame, pAnimvalue( panim, 2 ), pbone->scale[2], origin1.z, origin2.z );
+		origin1 = Vector( values[0], values[2], values[4] );
+		origin2 = Vector( values[1], values[3], values[5] );
 
 		if( origin1 != origin2 )
 		{
@@ -236,11 +275,7 @@ Vector CStudioBoneSetup :: CalcBonePosition( int frame, float s, int flags, mstu
 	}
 	else
 	{
-		ExtractAnimValue( frame, pAnimvalue( panim, 0 ), pbone->scale[0], origin1.x );
-		ExtractAnimValue( frame, pAnimvalue( panim, 1 ), pbone->scale[1], origin1.y );
-		ExtractAnimValue( frame, pAnimvalue( panim, 2 ), pbone->scale[2], origin1.z );
-
-		pos = origin1;
+		pos = Vector( values[0], values[2], values[4] );
 	}
 
 	if( !FBitSet( flags, STUDIO_DELTA ))
@@ -255,6 +290,133 @@ Vector CStudioBoneSetup :: CalcBonePosition( int frame, float s, int flags, mstu
 	return pos;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: resize the cache of decompressed animation frames
+//-----------------------------------------------------------------------------
+void CStudioBoneSetup :: SetAnimCacheSize( int numFrames )
+{
+	numFrames = bound( 0, numFrames, ANIMCACHE_MAX_SIZE );
+
+	if( numFrames == m_iAnimCacheSize )
+		return;
+
+	FlushAnimCache();
+	delete [] m_pAnimCache;
+	m_pAnimCache = NULL;
+	m_iAnimCacheSize = numFrames;
+
+	if( m_iAnimCacheSize > 0 )
+	{
+		m_pAnimCache = new animcache_t[m_iAnimCacheSize];
+		memset( m_pAnimCache, 0, sizeof( animcache_t ) * m_iAnimCacheSize );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: throw away all the decompressed frames (model pointers are changed)
+//-----------------------------------------------------------------------------
+void CStudioBoneSetup :: FlushAnimCache( void )
+{
+	for( int i = 0; i < m_iAnimCacheUsed; i++ )
+	{
+		delete [] m_pAnimCache[i].values;
+		memset( &m_pAnimCache[i], 0, sizeof( animcache_t ));
+	}
+
+	for( int j = 0; j < ANIMCACHE_HASH_SIZE; j++ )
+		m_iAnimCacheHash[j] = -1;
+
+	m_iAnimCacheUsed = 0;
+	m_iAnimCacheCounter = 0;
+}
+
+void CStudioBoneSetup :: AnimCacheStats( int *hits, int *misses, bool reset )
+{
+	if( hits ) *hits = m_iAnimCacheHits;
+	if( misses ) *misses = m_iAnimCacheMisses;
+
+	if( reset ) m_iAnimCacheHits = m_iAnimCacheMisses = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: return decompressed values for all the bones in specified frame
+//-----------------------------------------------------------------------------
+const float *CStudioBoneSetup :: FetchAnimFrame( mstudioanim_t *panim, int frame )
+{
+	int		hash = ((int)(((size_t)panim) >> 4 ) + frame * 31 ) & ( ANIMCACHE_HASH_SIZE - 1 );
+	int		numbones = m_pStudioHeader->numbones;
+	mstudiobone_t	*pbone;
+	animcache_t	*entry;
+	int		i, *link;
+
+	if( m_iAnimCacheSize <= 0 )
+		return NULL;
+
+	for( i = m_iAnimCacheHash[hash]; i != -1; i = entry->hashnext )
+	{
+		entry = &m_pAnimCache[i];
+
+		if( entry->panim == panim && entry->frame == frame && entry->numbones == numbones )
+		{
+			entry->lastused = ++m_iAnimCacheCounter;
+			m_iAnimCacheHits++;
+			return entry->values;
+		}
+	}
+
+	m_iAnimCacheMisses++;
+
+	if( m_iAnimCacheUsed < m_iAnimCacheSize )
+	{
+		entry = &m_pAnimCache[m_iAnimCacheUsed++];
+	}
+	else
+	{
+		int	oldest = 0;
+
+		// evict least recently used frame
+		for( i = 1; i < m_iAnimCacheSize; i++ )
+		{
+			if( m_pAnimCache[i].lastused < m_pAnimCache[oldest].lastused )
+				oldest = i;
+		}
+
+		entry = &m_pAnimCache[oldest];
+		int oldhash = ((int)(((size_t)entry->panim) >> 4 ) + entry->frame * 31 ) & ( ANIMCACHE_HASH_SIZE - 1 );
+
+		// unlink from the hash chain
+		for( link = &m_iAnimCacheHash[oldhash]; *link != -1; link = &m_pAnimCache[*link].hashnext )
+		{
+			if( *link == oldest )
+			{
+				*link = entry->hashnext;
+				break;
+			}
+		}
+	}
+
+	if( !entry->values || entry->numbones < numbones )
+	{
+		delete [] entry->values;
+		entry->values = new float[numbones * ANIMCACHE_VALUES];
+	}
+
+	entry->panim = panim;
+	entry->frame = frame;
+	entry->numbones = numbones;
+	entry->lastused = ++m_iAnimCacheCounter;
+	entry->hashnext = m_iAnimCacheHash[hash];
+	m_iAnimCacheHash[hash] = entry - m_pAnimCache;
+
+	// decompress the whole frame once
+	pbone = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
+
+	for( i = 0; i < numbones; i++, pbone++, panim++ )
+		ExtractBoneValues( frame, 1.0f, 0, 6, pbone, panim, entry->values + i * ANIMCACHE_VALUES );
+
+	return entry->values;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -337,16 +499,14 @@ mstudioanim_t *CStudioBoneSetup :: FetchAnimation( mstudioseqdesc_t *pseqdesc, i
 //-----------------------------------------------------------------------------
 mstudioanimdesc_t *CStudioBoneSetup :: FetchAnimDesc( mstudioseqdesc_t *pseqdesc, int animation )
 {
-	static mstudioanimdesc_t baseDesc; // for backward compatibility
-
 	if( pseqdesc->animdescindex <= 0 || pseqdesc->animdescindex >= m_pStudioHeader->length )
 	{
-		Q_strncpy( baseDesc.label, pseqdesc->label, sizeof( baseDesc.label ));
-		baseDesc.numframes = pseqdesc->numframes;
-		baseDesc.flags = pseqdesc->flags;
-		baseDesc.fps = pseqdesc->fps;
+		Q_strncpy( m_baseDesc.label, pseqdesc->label, sizeof( m_baseDesc.label ));
+		m_baseDesc.numframes = pseqdesc->numframes;
+		m_baseDesc.flags = pseqdesc->flags;
+		m_baseDesc.fps = pseqdesc->fps;
 
-		return &baseDesc;
+		return &m_baseDesc;
 	}
 
 	mstudioanimdesc_t *panimdesc = (mstudioanimdesc_t *)((byte *)m_pStudioHeader + pseqdesc->animdescindex);
@@ -377,6 +537,11 @@ void CStudioBoneSetup :: CalcAnimation( Vector pos[], Vector4D q[], mstudioseqde
 	float s = (fFrame - iFrame); // cut fractional part
 
 	const float *pweight = pBoneweight( pseqdesc );
+	const float *values = NULL;
+
+	// sequence groups may be unloaded at any time, so cache only the base model animations
+	if( pseqdesc->seqgroup == 0 )
+		values = FetchAnimFrame( panim, iFrame );
 
 	// BUGBUG: the sequence, the anim, and the model can have all different bone mappings.
 	for( int i = 0; i < m_pStudioHeader->numbones; i++, pbone++, pboneinfo++, panim++ )
@@ -384,8 +549,16 @@ void CStudioBoneSetup :: CalcAnimation( Vector pos[], Vector4D q[], mstudioseqde
 		if( pweight[i] <= 0.0f || !IsBoneUsed( pbone ))
 			continue;
 
-		q[i] = CalcBoneQuaternion( iFrame, s, animdesc->flags, pbone, pboneinfo, panim );
-		pos[i] = CalcBonePosition( iFrame, s, animdesc->flags, pbone, panim );
+		if( values != NULL )
+		{
+			q[i] = CalcBoneQuaternion( values + i * ANIMCACHE_VALUES, s, animdesc->flags, pbone, pboneinfo );
+			pos[i] = CalcBonePosition( values + i * ANIMCACHE_VALUES, s, animdesc->flags, pbone );
+		}
+		else
+		{
+			q[i] = CalcBoneQuaternion( iFrame, s, animdesc->flags, pbone, pboneinfo, panim );
+			pos[i] = CalcBonePosition( iFrame, s, animdesc->flags, pbone, panim );
+		}
 	}
 }
 
@@ -417,16 +590,36 @@ void CStudioBoneSetup :: BlendBones( Vector4D q1[], Vector pos1[], mstudioseqdes
 		return;
 	}
 
+	// batch treats zero weight as unused bone and skips the normalize,
+	// so denormal fractions (flushed to zero by SSE) take the reference path
+	if( s < FLT_MIN )
+	{
+		for( i = 0; i < m_pStudioHeader->numbones; i++ )
+		{
+			if( pweight[i] > 0.0f )
+			{
+				if( FBitSet( pbone[i].flags, BONE_FIXED_ALIGNMENT ))
+					QuaternionBlendNoAlign( q1[i], q2[i], s, q1[i] );
+				else QuaternionBlend( q1[i], q2[i], s, q1[i] );
+				InterpolateOrigin( pos1[i], pos2[i], pos1[i], s );
+			}
+		}
+		return;
+	}
+
+	float	weights[MAXSTUDIOBONES];
+	byte	noalign[MAXSTUDIOBONES];
+
 	for( i = 0; i < m_pStudioHeader->numbones; i++ )
 	{
+		weights[i] = ( pweight[i] > 0.0f ) ? s : 0.0f;
+		noalign[i] = FBitSet( pbone[i].flags, BONE_FIXED_ALIGNMENT ) ? 1 : 0;
+
 		if( pweight[i] > 0.0f )
-		{
-			if( FBitSet( pbone[i].flags, BONE_FIXED_ALIGNMENT ))
-				QuaternionBlendNoAlign( q1[i], q2[i], s, q1[i] );
-			else QuaternionBlend( q1[i], q2[i], s, q1[i] );
 			InterpolateOrigin( pos1[i], pos2[i], pos1[i], s );
-		}
 	}
+
+	QuaternionBlendBatch( q1, q2, weights, noalign, m_pStudioHeader->numbones );
 }
 
 //-----------------------------------------------------------------------------
@@ -481,8 +674,14 @@ void CStudioBoneSetup :: SlerpBones( Vector4D q1[], Vector pos1[], mstudioseqdes
 	}
 	else
 	{
+		float	weights[MAXSTUDIOBONES];
+		byte	noalign[MAXSTUDIOBONES];
+
 		for( int i = 0; i < m_pStudioHeader->numbones; i++ )
 		{
+			weights[i] = 0.0f;
+			noalign[i] = FBitSet( pbone[i].flags, BONE_FIXED_ALIGNMENT ) ? 1 : 0;
+
 			// skip unused bones
 			if( !IsBoneUsed( pbone + i ))
 				continue;
@@ -490,11 +689,12 @@ void CStudioBoneSetup :: SlerpBones( Vector4D q1[], Vector pos1[], mstudioseqdes
 			s2 = s * pweight[i];	// blend in based on this bones weight
 			if( s2 <= 0.0f ) continue;
 
-			if( FBitSet( pbone[i].flags, BONE_FIXED_ALIGNMENT ))
-				QuaternionSlerpNoAlign( q1[i], q2[i], s2, q1[i] );
-			else QuaternionSlerp( q1[i], q2[i], s2, q1[i] );
+			weights[i] = s2;
 			InterpolateOrigin( pos1[i], pos2[i], pos1[i], s2 );
 		}
+
+		// rotations are blended at once
+		QuaternionSlerpBatch( q1, q2, weights, noalign, m_pStudioHeader->numbones );
 	}
 }
 
@@ -1828,12 +2028,12 @@ bool CStudioBoneSetup :: IKSequenceError( int iSeq, float flCycle, int iRule, ms
 //-----------------------------------------------------------------------------
 void CStudioBoneSetup :: CalcPoseSingle( Vector pos[], Vector4D q[], int sequence, float cycle )
 {
-	static Vector	pos2[MAXSTUDIOBONES];
-	static Vector4D	q2[MAXSTUDIOBONES];
-	static Vector	pos3[MAXSTUDIOBONES];
-	static Vector4D	q3[MAXSTUDIOBONES];
-	static Vector	pos4[MAXSTUDIOBONES];
-	static Vector4D	q4[MAXSTUDIOBONES];
+	Vector		*pos2 = m_pos2;
+	Vector4D		*q2 = m_q2;
+	Vector		*pos3 = m_pos3;
+	Vector4D		*q3 = m_q3;
+	Vector		*pos4 = m_pos4;
+	Vector4D		*q4 = m_q4;
 	bool		anim_4wayblend = true;	// FIXME: get 9-way for gold-source
 	mstudioseqdesc_t	*pseqdesc;
 
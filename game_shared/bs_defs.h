@@ -21,6 +21,21 @@ GNU General Public License for more details.
 struct ikcontextikrule_t;
 class CIKContext;
 
+#define ANIMCACHE_HASH_SIZE	256	// must be power of two
+#define ANIMCACHE_MAX_SIZE	4096	// decoded frames per bone setup
+#define ANIMCACHE_VALUES	12	// 6 dofs * 2 frames
+
+// decoded animation frame for all the bones
+typedef struct
+{
+	const mstudioanim_t	*panim;		// key: animation bones
+	int		frame;		// key: frame number
+	int		numbones;
+	float		*values;		// numbones * ANIMCACHE_VALUES, scaled but without bone offsets
+	int		lastused;		// LRU counter
+	int		hashnext;
+} animcache_t;
+
 /*
 ====================
 CStudioBoneSetup
@@ -37,7 +52,14 @@ public:
 		m_flBoneControllers = NULL;
 		m_flPoseParams = NULL;
 		m_iBoneMask = 0;
+		memset( &m_baseDesc, 0, sizeof( m_baseDesc ));
+		m_pAnimCache = NULL;
+		m_iAnimCacheSize = 0;
+		m_iAnimCacheUsed = 0;
+		m_iAnimCacheCounter = 0;
+		m_iAnimCacheHits = m_iAnimCacheMisses = 0;
 	} 
+	virtual ~CStudioBoneSetup() { SetAnimCacheSize( 0 ); }
 //protected:
 	const mstudioanimvalue_t *pAnimvalue( const mstudioanim_t *panim, int dof )
 	{
@@ -290,8 +312,12 @@ private:
 	void InitBoneWeights( void ) { for( int i = 0; i < MAXSTUDIOBONES; i++ ) m_flDefaultBoneWeight[i] = 1.0f; }
 	void ExtractAnimValue( int frame, const mstudioanimvalue_t *panimvalue, float scale, float &v1, float &v2 );
 	void ExtractAnimValue( int frame, const mstudioanimvalue_t *panimvalue, float scale, float &v1 );
+	void ExtractBoneValues( int frame, float s, int firstdof, int numdofs, mstudiobone_t *pbone, mstudioanim_t *panim, float *values );
 	Vector4D CalcBoneQuaternion( int frame, float s, int flags, mstudiobone_t *pbone, mstudioboneinfo_t *pboneinfo, mstudioanim_t *panim );
 	Vector CalcBonePosition( int frame, float s, int flags, mstudiobone_t *pbone, mstudioanim_t *panim );
+	Vector4D CalcBoneQuaternion( const float *values, float s, int flags, mstudiobone_t *pbone, mstudioboneinfo_t *pboneinfo );
+	Vector CalcBonePosition( const float *values, float s, int flags, mstudiobone_t *pbone );
+	const float *FetchAnimFrame( mstudioanim_t *panim, int frame );
 	void AdjustBoneAngles( mstudiobone_t *pbone, Radian &angles1, Radian &angles2 );
 	void AdjustBoneOrigin( mstudiobone_t *pbone, Vector &origin );
 	void CalcIKError( const mstudioikerror_t *pIKError, int frame, float s, Vector &pos, Vector4D &q );
@@ -332,6 +358,24 @@ private:
 	matrix3x4		srcBoneToWorld[MAXSTUDIOBONES];
 	matrix3x4		dstBoneToWorld[MAXSTUDIOBONES];
 	matrix3x4		targetBoneToWorld[MAXSTUDIOBONES];
+
+	// intermediate poses for blending (per-instance, so different setups can run in parallel)
+	Vector		m_pos2[MAXSTUDIOBONES];
+	Vector4D		m_q2[MAXSTUDIOBONES];
+	Vector		m_pos3[MAXSTUDIOBONES];
+	Vector4D		m_q3[MAXSTUDIOBONES];
+	Vector		m_pos4[MAXSTUDIOBONES];
+	Vector4D		m_q4[MAXSTUDIOBONES];
+	mstudioanimdesc_t	m_baseDesc;	// for backward compatibility
+
+	// decompressed frames, see FetchAnimFrame
+	animcache_t	*m_pAnimCache;
+	int		m_iAnimCacheHash[ANIMCACHE_HASH_SIZE];
+	int		m_iAnimCacheSize;
+	int		m_iAnimCacheUsed;
+	int		m_iAnimCacheCounter;
+	int		m_iAnimCacheHits;
+	int		m_iAnimCacheMisses;
 public:
 	// import table
 	virtual void debugMsg( char *szFmt, ... ) {}
@@ -351,6 +395,11 @@ public:
 	void UpdateRealTime( float flTime ) { m_flTime = flTime; }
 	void CalcDefaultPoseParameters( float flPoseParams[] );
 
+	// animation cache (size 0 disables it)
+	void SetAnimCacheSize( int numFrames );
+	void FlushAnimCache( void );
+	void AnimCacheStats( int *hits, int *misses, bool reset );
+
 	// shared routines
 	float GetController( int iController, float ctlValue );
 	float SetController( int iController, float flValue, float &ctlValue );
@@ -0,0 +1,303 @@
+/*
+jobs.cpp - tiny persistent worker pool for per-frame jobs
+Copyright (C) 2024 Paranoia2 Team
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "build.h"
+#include "jobs.h"
+
+#if XASH_WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+typedef struct
+{
+	int		number;		// threadnum (1..numthreads-1)
+#if XASH_WIN32
+	HANDLE		handle;
+#else
+	pthread_t		handle;
+	int		generation;	// last processed job
+#endif
+} jobthread_t;
+
+static jobthread_t		g_jobthreads[MAX_JOB_THREADS];
+static int		g_numjobthreads = 1;	// include main thread
+static volatile int		g_jobquit;
+
+// current job
+static pfnJobWork		g_jobfunc;
+static void		*g_jobcontext;
+static volatile long	g_jobdispatch;
+static int		g_jobcount;
+static volatile int		g_jobrunning;	// inside JOB_RunOnIndividual
+
+#if XASH_WIN32
+static HANDLE		g_jobstart;	// semaphore
+static HANDLE		g_jobdone;	// auto-reset event
+static volatile long	g_jobactive;
+
+#define JOB_Increment( x )	( InterlockedIncrement( x ) - 1 )
+#else
+static pthread_mutex_t	g_jobmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	g_jobstart = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	g_jobdone = PTHREAD_COND_INITIALIZER;
+static int		g_jobgeneration;
+static int		g_jobactive;
+
+#define JOB_Increment( x )	__sync_fetch_and_add( x, 1 )
+#endif
+
+/*
+=============
+JOB_RunWork
+
+grab items until the list is exhausted
+=============
+*/
+static void JOB_RunWork( int threadnum )
+{
+	int	work;
+
+	while( 1 )
+	{
+		work = (int)JOB_Increment( &g_jobdispatch );
+		if( work >= g_jobcount ) break;
+		g_jobfunc( g_jobcontext, work, threadnum );
+	}
+}
+
+#if XASH_WIN32
+static DWORD WINAPI JOB_ThreadFunc( LPVOID pData )
+{
+	jobthread_t *pThread = (jobthread_t *)pData;
+
+	while( 1 )
+	{
+		WaitForSingleObject( g_jobstart, INFINITE );
+
+		if( g_jobquit ) break;
+
+		JOB_RunWork( pThread->number );
+
+		if( InterlockedDecrement( &g_jobactive ) == 0 )
+			SetEvent( g_jobdone );
+	}
+
+	return 0;
+}
+#else
+static void *JOB_ThreadFunc( void *pData )
+{
+	jobthread_t *pThread = (jobthread_t *)pData;
+
+	while( 1 )
+	{
+		pthread_mutex_lock( &g_jobmutex );
+		while( pThread->generation == g_jobgeneration && !g_jobquit )
+			pthread_cond_wait( &g_jobstart, &g_jobmutex );
+		pThread->generation = g_jobgeneration;
+		pthread_mutex_unlock( &g_jobmutex );
+
+		if( g_jobquit ) break;
+
+		JOB_RunWork( pThread->number );
+
+		pthread_mutex_lock( &g_jobmutex );
+		if( --g_jobactive == 0 )
+			pthread_cond_signal( &g_jobdone );
+		pthread_mutex_unlock( &g_jobmutex );
+	}
+
+	return NULL;
+}
+#endif
+
+/*
+=============
+JOB_DetectThreads
+
+returns count of logical processors
+=============
+*/
+int JOB_DetectThreads( void )
+{
+	int	numcpus = 1;
+#if XASH_WIN32
+	SYSTEM_INFO	info;
+
+	GetSystemInfo( &info );
+	numcpus = info.dwNumberOfProcessors;
+#elif defined( _SC_NPROCESSORS_ONLN )
+	numcpus = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	if( numcpus < 1 ) numcpus = 1;
+	if( numcpus > MAX_JOB_THREADS )
+		numcpus = MAX_JOB_THREADS;
+
+	return numcpus;
+}
+
+/*
+=============
+JOB_Init
+
+spawn the worker threads
+=============
+*/
+void JOB_Init( int numthreads )
+{
+	int	i;
+
+	if( g_numjobthreads > 1 )
+		JOB_Shutdown();
+
+	if( numthreads <= 0 )
+		numthreads = JOB_DetectThreads();
+	if( numthreads > MAX_JOB_THREADS )
+		numthreads = MAX_JOB_THREADS;
+
+	g_numjobthreads = 1;
+	g_jobquit = false;
+
+	if( numthreads <= 1 )
+		return; // single-threaded
+#if XASH_WIN32
+	g_jobstart = CreateSemaphore( NULL, 0, MAX_JOB_THREADS, NULL );
+	g_jobdone = CreateEvent( NULL, FALSE, FALSE, NULL );
+#endif
+	for( i = 1; i < numthreads; i++ )
+	{
+		jobthread_t *pThread = &g_jobthreads[i];
+
+		pThread->number = i;
+#if XASH_WIN32
+		pThread->handle = CreateThread( NULL, 0, JOB_ThreadFunc, pThread, 0, NULL );
+		if( !pThread->handle ) break;
+#else
+		pThread->generation = g_jobgeneration;
+		if( pthread_create( &pThread->handle, NULL, JOB_ThreadFunc, pThread ) != 0 )
+			break;
+#endif
+		g_numjobthreads++;
+	}
+}
+
+/*
+=============
+JOB_Shutdown
+
+stop and release the worker threads
+=============
+*/
+void JOB_Shutdown( void )
+{
+	int	i;
+
+	if( g_numjobthreads <= 1 )
+		return;
+#if XASH_WIN32
+	g_jobquit = true;
+	ReleaseSemaphore( g_jobstart, g_numjobthreads - 1, NULL );
+
+	for( i = 1; i < g_numjobthreads; i++ )
+	{
+		WaitForSingleObject( g_jobthreads[i].handle, INFINITE );
+		CloseHandle( g_jobthreads[i].handle );
+	}
+
+	CloseHandle( g_jobstart );
+	CloseHandle( g_jobdone );
+#else
+	pthread_mutex_lock( &g_jobmutex );
+	g_jobquit = true;
+	pthread_cond_broadcast( &g_jobstart );
+	pthread_mutex_unlock( &g_jobmutex );
+
+	for( i = 1; i < g_numjobthreads; i++ )
+		pthread_join( g_jobthreads[i].handle, NULL );
+#endif
+	g_numjobthreads = 1;
+}
+
+int JOB_NumThreads( void )
+{
+	return g_numjobthreads;
+}
+
+/*
+=============
+JOB_RunOnIndividual
+
+main thread is participate as threadnum 0
+=============
+*/
+void JOB_RunOnIndividual( int workcnt, void *context, pfnJobWork func )
+{
+	if( workcnt <= 0 || !func )
+		return;
+
+	g_jobfunc = func;
+	g_jobcontext = context;
+	g_jobcount = workcnt;
+	g_jobdispatch = 0;
+	g_jobrunning = true;
+
+	// too small work or no workers, run it in place
+	if( g_numjobthreads <= 1 || workcnt == 1 )
+	{
+		JOB_RunWork( 0 );
+		g_jobrunning = false;
+		return;
+	}
+#if XASH_WIN32
+	g_jobactive = g_numjobthreads - 1;
+	ReleaseSemaphore( g_jobstart, g_numjobthreads - 1, NULL );
+
+	JOB_RunWork( 0 );
+
+	WaitForSingleObject( g_jobdone, INFINITE );
+#else
+	pthread_mutex_lock( &g_jobmutex );
+	g_jobactive = g_numjobthreads - 1;
+	g_jobgeneration++;
+	pthread_cond_broadcast( &g_jobstart );
+	pthread_mutex_unlock( &g_jobmutex );
+
+	JOB_RunWork( 0 );
+
+	pthread_mutex_lock( &g_jobmutex );
+	while( g_jobactive > 0 )
+		pthread_cond_wait( &g_jobdone, &g_jobmutex );
+	pthread_mutex_unlock( &g_jobmutex );
+#endif
+	g_jobrunning = false;
+}
+
+/*
+=============
+JOB_InProgress
+
+true while the job callbacks are running,
+used to catch main-thread only code called from a job
+=============
+*/
+bool JOB_InProgress( void )
+{
+	return g_jobrunning ? true : false;
+}
@@ -0,0 +1,35 @@
+/*
+jobs.h - tiny persistent worker pool for per-frame jobs
+Copyright (C) 2024 Paranoia2 Team
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#define MAX_JOB_THREADS	16
+
+// current is a work index in range [0..workcnt), threadnum is in range [0..JOB_NumThreads())
+// threadnum 0 is always a caller thread so it's safe to touch non-shared data here
+typedef void (*pfnJobWork)( void *context, int current, int threadnum );
+
+void JOB_Init( int numthreads );	// numthreads <= 0 means autodetect
+void JOB_Shutdown( void );
+int JOB_NumThreads( void );
+int JOB_DetectThreads( void );
+
+// dispatch workcnt items across the pool and wait for completion
+// NOTE: not reentrant, must be called from main thread only
+void JOB_RunOnIndividual( int workcnt, void *context, pfnJobWork func );
+bool JOB_InProgress( void );
+
+#endif//JOBS_H
@@ -7,6 +7,9 @@
 #include "const.h"
 #include "com_model.h"
 #include <math.h>
+#ifdef HAVE_SSE_MATH
+#include <xmmintrin.h>
+#endif
 
 const Vector g_vecZero( 0, 0, 0 );
 const Radian g_radZero( 0, 0, 0 );
@@ -992,6 +995,264 @@ void QuaternionAccumulate( const Vector4D &p, float s, const Vector4D &q, Vector
 	qt[3] = p[3] + s * q2[3];
 }
 
+/*
+====================
+MathLib_HaveSSE
+
+report about batch kernels
+====================
+*/
+bool MathLib_HaveSSE( void )
+{
+#ifdef HAVE_SSE_MATH
+	return true;
+#else
+	return false;
+#endif
+}
+
+#ifdef HAVE_SSE_MATH
+// load four quaternions and convert them into SoA form
+static _forceinline void QuaternionLoad4( const Vector4D *q, __m128 &x, __m128 &y, __m128 &z, __m128 &w )
+{
+	x = _mm_loadu_ps( &q[0].x );
+	y = _mm_loadu_ps( &q[1].x );
+	z = _mm_loadu_ps( &q[2].x );
+	w = _mm_loadu_ps( &q[3].x );
+	_MM_TRANSPOSE4_PS( x, y, z, w );
+}
+
+// store SoA quaternions back, only lanes with mask bit will be written
+static _forceinline void QuaternionStore4( Vector4D *q, __m128 x, __m128 y, __m128 z, __m128 w, int mask )
+{
+	_MM_TRANSPOSE4_PS( x, y, z, w );
+	if( mask & 1 ) _mm_storeu_ps( &q[0].x, x );
+	if( mask & 2 ) _mm_storeu_ps( &q[1].x, y );
+	if( mask & 4 ) _mm_storeu_ps( &q[2].x, z );
+	if( mask & 8 ) _mm_storeu_ps( &q[3].x, w );
+}
+
+// same as QuaternionAlign but for four quaternions
+static _forceinline void QuaternionAlign4( __m128 px, __m128 py, __m128 pz, __m128 pw, __m128 &qx, __m128 &qy, __m128 &qz, __m128 &qw, __m128 allow )
+{
+	__m128 d0 = _mm_sub_ps( px, qx ), s0 = _mm_add_ps( px, qx );
+	__m128 d1 = _mm_sub_ps( py, qy ), s1 = _mm_add_ps( py, qy );
+	__m128 d2 = _mm_sub_ps( pz, qz ), s2 = _mm_add_ps( pz, qz );
+	__m128 d3 = _mm_sub_ps( pw, qw ), s3 = _mm_add_ps( pw, qw );
+	__m128 a = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( d0, d0 ), _mm_mul_ps( d1, d1 )), _mm_mul_ps( d2, d2 )), _mm_mul_ps( d3, d3 ));
+	__m128 b = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( s0, s0 ), _mm_mul_ps( s1, s1 )), _mm_mul_ps( s2, s2 )), _mm_mul_ps( s3, s3 ));
+	__m128 flip = _mm_and_ps( _mm_and_ps( _mm_cmpgt_ps( a, b ), allow ), _mm_set1_ps( -0.0f ));
+
+	qx = _mm_xor_ps( qx, flip );
+	qy = _mm_xor_ps( qy, flip );
+	qz = _mm_xor_ps( qz, flip );
+	qw = _mm_xor_ps( qw, flip );
+}
+
+static _forceinline __m128 NoAlignMask4( const byte *noalign )
+{
+	__m128 zero = _mm_setzero_ps();
+
+	if( !noalign ) return _mm_cmpeq_ps( zero, zero );
+	return _mm_cmpeq_ps( _mm_set_ps( noalign[3], noalign[2], noalign[1], noalign[0] ), zero );
+}
+#endif
+
+/*
+====================
+QuaternionSlerpBatch
+
+q1[i] = slerp( q1[i], q2[i], t[i] )
+reference is QuaternionSlerp\QuaternionSlerpNoAlign
+====================
+*/
+void QuaternionSlerpBatch( Vector4D q1[], const Vector4D q2[], const float t[], const byte noalign[], int count )
+{
+	int	i = 0;
+#ifdef HAVE_SSE_MATH
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128	px, py, pz, pw, qx, qy, qz, qw;
+		float	cosom[4], sclp[4], sclq[4];
+		__m128	tt = _mm_loadu_ps( t + i );
+		int	active = _mm_movemask_ps( _mm_cmpgt_ps( tt, _mm_setzero_ps( )));
+		int	fallback = 0;
+
+		if( !active ) continue;
+
+		QuaternionLoad4( q1 + i, px, py, pz, pw );
+		QuaternionLoad4( q2 + i, qx, qy, qz, qw );
+		QuaternionAlign4( px, py, pz, pw, qx, qy, qz, qw, NoAlignMask4( noalign ? noalign + i : NULL ));
+
+		__m128 dot = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( px, qx ), _mm_mul_ps( py, qy )), _mm_mul_ps( pz, qz )), _mm_mul_ps( pw, qw ));
+		_mm_storeu_ps( cosom, dot );
+
+		// trigonometry is per lane
+		for( int j = 0; j < 4; j++ )
+		{
+			float	omega, sinom;
+
+			sclp[j] = 1.0f;
+			sclq[j] = 0.0f;
+
+			if( !( active & BIT( j )))
+				continue;
+
+			if(( 1.0f + cosom[j] ) > 0.000001f )
+			{
+				if(( 1.0f - cosom[j] ) > 0.000001f )
+				{
+					omega = acos( cosom[j] );
+					sinom = sin( omega );
+					sclp[j] = sin( (1.0f - t[i+j]) * omega) / sinom;
+					sclq[j] = sin( t[i+j] * omega ) / sinom;
+				}
+				else
+				{
+					sclp[j] = 1.0f - t[i+j];
+					sclq[j] = t[i+j];
+				}
+			}
+			else fallback |= BIT( j ); // opposite quaternions
+		}
+
+		__m128 sp = _mm_loadu_ps( sclp );
+		__m128 sq = _mm_loadu_ps( sclq );
+
+		px = _mm_add_ps( _mm_mul_ps( sp, px ), _mm_mul_ps( sq, qx ));
+		py = _mm_add_ps( _mm_mul_ps( sp, py ), _mm_mul_ps( sq, qy ));
+		pz = _mm_add_ps( _mm_mul_ps( sp, pz ), _mm_mul_ps( sq, qz ));
+		pw = _mm_add_ps( _mm_mul_ps( sp, pw ), _mm_mul_ps( sq, qw ));
+
+		QuaternionStore4( q1 + i, px, py, pz, pw, active & ~fallback );
+
+		// rare case, use the reference code
+		for( int j = 0; fallback && j < 4; j++ )
+		{
+			if( !( fallback & BIT( j )))
+				continue;
+
+			if( noalign && noalign[i+j] )
+				QuaternionSlerpNoAlign( q1[i+j], q2[i+j], t[i+j], q1[i+j] );
+			else QuaternionSlerp( q1[i+j], q2[i+j], t[i+j], q1[i+j] );
+		}
+	}
+#endif
+	for( ; i < count; i++ )
+	{
+		if( t[i] <= 0.0f )
+			continue;
+
+		if( noalign && noalign[i] )
+			QuaternionSlerpNoAlign( q1[i], q2[i], t[i], q1[i] );
+		else QuaternionSlerp( q1[i], q2[i], t[i], q1[i] );
+	}
+}
+
+/*
+====================
+QuaternionBlendBatch
+
+q1[i] = nlerp( q1[i], q2[i], t[i] )
+reference is QuaternionBlend\QuaternionBlendNoAlign
+====================
+*/
+void QuaternionBlendBatch( Vector4D q1[], const Vector4D q2[], const float t[], const byte noalign[], int count )
+{
+	int	i = 0;
+#ifdef HAVE_SSE_MATH
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128	px, py, pz, pw, qx, qy, qz, qw;
+		__m128	tt = _mm_loadu_ps( t + i );
+		int	active = _mm_movemask_ps( _mm_cmpgt_ps( tt, _mm_setzero_ps( )));
+
+		if( !active ) continue;
+
+		QuaternionLoad4( q1 + i, px, py, pz, pw );
+		QuaternionLoad4( q2 + i, qx, qy, qz, qw );
+		QuaternionAlign4( px, py, pz, pw, qx, qy, qz, qw, NoAlignMask4( noalign ? noalign + i : NULL ));
+
+		__m128 sp = _mm_sub_ps( _mm_set1_ps( 1.0f ), tt );
+
+		px = _mm_add_ps( _mm_mul_ps( sp, px ), _mm_mul_ps( tt, qx ));
+		py = _mm_add_ps( _mm_mul_ps( sp, py ), _mm_mul_ps( tt, qy ));
+		pz = _mm_add_ps( _mm_mul_ps( sp, pz ), _mm_mul_ps( tt, qz ));
+		pw = _mm_add_ps( _mm_mul_ps( sp, pw ), _mm_mul_ps( tt, qw ));
+
+		// normalize
+		__m128 len = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( px, px ), _mm_mul_ps( py, py )), _mm_mul_ps( pz, pz )), _mm_mul_ps( pw, pw )));
+		__m128 valid = _mm_cmpneq_ps( len, _mm_setzero_ps( ));
+		__m128 ilen = _mm_or_ps( _mm_and_ps( valid, _mm_div_ps( _mm_set1_ps( 1.0f ), len )), _mm_andnot_ps( valid, _mm_set1_ps( 1.0f )));
+
+		px = _mm_mul_ps( px, ilen );
+		py = _mm_mul_ps( py, ilen );
+		pz = _mm_mul_ps( pz, ilen );
+		pw = _mm_mul_ps( pw, ilen );
+
+		QuaternionStore4( q1 + i, px, py, pz, pw, active );
+	}
+#endif
+	for( ; i < count; i++ )
+	{
+		if( t[i] <= 0.0f )
+			continue;
+
+		if( noalign && noalign[i] )
+			QuaternionBlendNoAlign( q1[i], q2[i], t[i], q1[i] );
+		else QuaternionBlend( q1[i], q2[i], t[i], q1[i] );
+	}
+}
+
+/*
+====================
+QuaternionMatrixBatch
+
+out[i] = matrix3x4( pos[i], q[i] )
+====================
+*/
+void QuaternionMatrixBatch( const Vector4D q[], const Vector pos[], matrix3x4 out[], int count )
+{
+	int	i = 0;
+#ifdef HAVE_SSE_MATH
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128	x, y, z, w;
+		float	m[9][4];
+
+		QuaternionLoad4( q + i, x, y, z, w );
+
+		__m128 one = _mm_set1_ps( 1.0f );
+		__m128 two = _mm_set1_ps( 2.0f );
+		__m128 xx = _mm_mul_ps( x, x ), yy = _mm_mul_ps( y, y ), zz = _mm_mul_ps( z, z );
+		__m128 xy = _mm_mul_ps( x, y ), xz = _mm_mul_ps( x, z ), yz = _mm_mul_ps( y, z );
+		__m128 xw = _mm_mul_ps( x, w ), yw = _mm_mul_ps( y, w ), zw = _mm_mul_ps( z, w );
+
+		_mm_storeu_ps( m[0], _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( yy, zz ))));	// [0][0]
+		_mm_storeu_ps( m[1], _mm_mul_ps( two, _mm_add_ps( xy, zw )));			// [0][1]
+		_mm_storeu_ps( m[2], _mm_mul_ps( two, _mm_sub_ps( xz, yw )));			// [0][2]
+		_mm_storeu_ps( m[3], _mm_mul_ps( two, _mm_sub_ps( xy, zw )));			// [1][0]
+		_mm_storeu_ps( m[4], _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( xx, zz ))));	// [1][1]
+		_mm_storeu_ps( m[5], _mm_mul_ps( two, _mm_add_ps( yz, xw )));			// [1][2]
+		_mm_storeu_ps( m[6], _mm_mul_ps( two, _mm_add_ps( xz, yw )));			// [2][0]
+		_mm_storeu_ps( m[7], _mm_mul_ps( two, _mm_sub_ps( yz, xw )));			// [2][1]
+		_mm_storeu_ps( m[8], _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( xx, yy ))));	// [2][2]
+
+		for( int j = 0; j < 4; j++ )
+		{
+			matrix3x4 &mat = out[i+j];
+
+			mat[0][0] = m[0][j]; mat[0][1] = m[1][j]; mat[0][2] = m[2][j];
+			mat[1][0] = m[3][j]; mat[1][1] = m[4][j]; mat[1][2] = m[5][j];
+			mat[2][0] = m[6][j]; mat[2][1] = m[7][j]; mat[2][2] = m[8][j];
+			mat[3][0] = pos[i+j].x; mat[3][1] = pos[i+j].y; mat[3][2] = pos[i+j].z;
+		}
+	}
+#endif
+	for( ; i < count; i++ )
+		out[i] = matrix3x4( pos[i], q[i] );
+}
+
 //
 // lerping stuff
 //
@@ -25,6 +25,10 @@ typedef float vec_t;
 #include <vector.h>
 #include "matrix.h"
 
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#define HAVE_SSE_MATH	1	// compiler is allowed to emit SSE
+#endif
+
 // NOTE: PhysX mathlib is conflicted with standard min\max
 #define Q_min( a, b )		(((a) < (b)) ? (a) : (b))
 #define Q_max( a, b )		(((a) > (b)) ? (a) : (b))
@@ -182,6 +186,15 @@ void QuaternionMult( const Vector4D &p, const Vector4D &q, Vector4D &qt );
 void QuaternionAdd( const Vector4D &p, const Vector4D &q, Vector4D &qt );
 void QuaternionScale( const Vector4D &p, float t, Vector4D &q );
 
+//
+// batch quaternion operations for bone arrays (SSE if available)
+// elements with t[i] <= 0 are skipped, noalign may be NULL
+//
+void QuaternionSlerpBatch( Vector4D q1[], const Vector4D q2[], const float t[], const byte noalign[], int count );
+void QuaternionBlendBatch( Vector4D q1[], const Vector4D q2[], const float t[], const byte noalign[], int count );
+void QuaternionMatrixBatch( const Vector4D q[], const Vector pos[], matrix3x4 out[], int count );
+bool MathLib_HaveSSE( void );
+
 //
 // lerping stuff
 //
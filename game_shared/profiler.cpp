@@ -0,0 +1,520 @@
+/*
+profiler.cpp - per-frame hierarchical CPU profiler
+Copyright (C) 2024 Paranoia2 Team
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef CLIENT_DLL
+#include "extdll.h"
+#include "util.h"
+#else
+#include "hud.h"
+#include "cl_util.h"
+#endif
+
+#include <stdarg.h>
+#include "build.h"
+#include "stringlib.h"
+#include "profiler.h"
+
+#if XASH_WIN32
+#include <windows.h>	// already included by engine headers
+#else
+#include <time.h>
+#endif
+
+typedef struct
+{
+	const char	*name;
+	double		start;
+	double		end;		// 0.0 while scope is open
+	int		depth;
+} profevent_t;
+
+typedef struct
+{
+	profevent_t	events[MAX_PROF_EVENTS];
+	int		head;		// events pushed this frame
+	int		depth;
+} profthread_t;
+
+typedef struct
+{
+	const char	*name;
+	int		parent;		// -1 for root
+	int		depth;
+	bool		worker;		// scopes from job threads are kept in separate tree
+	double		frametime;
+	int		framecalls;
+	int		calls;		// last frame
+	float		history[PROF_HISTORY];	// ms
+} profnode_t;
+
+typedef struct
+{
+	const char	*name;
+	double		start;
+	double		end;
+	int		thread;
+} profcapture_t;
+
+bool			g_fProfEnabled;
+
+static profthread_t		prof_threads[MAX_PROF_THREADS];
+static profnode_t		prof_nodes[MAX_PROF_NODES];
+static int		prof_numnodes;
+static float		prof_frames[PROF_HISTORY];	// frame time, ms
+static int		prof_numframes;
+static double		prof_framestart;
+static int		prof_dropped;		// events lost due to ring overflow
+
+static profcapture_t	*prof_capture;
+static int		prof_numcapture;
+static int		prof_maxcapture;
+static int		prof_captureframes;	// frames left to record
+static double		prof_capturebase;
+static char		prof_capturename[256];
+
+/*
+=============
+PROF_Time
+
+engine time is a float on the server side, so use own timer
+=============
+*/
+static double PROF_Time( void )
+{
+#if XASH_WIN32
+	static LARGE_INTEGER	freq;
+	LARGE_INTEGER		counter;
+
+	if( !freq.QuadPart )
+		QueryPerformanceFrequency( &freq );
+	QueryPerformanceCounter( &counter );
+
+	return (double)counter.QuadPart / (double)freq.QuadPart;
+#else
+	struct timespec	ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 0.000000001;
+#endif
+}
+
+/*
+=============
+PROF_Push
+
+open a scope, returns the event slot
+=============
+*/
+int PROF_Push( const char *name, int threadnum )
+{
+	profthread_t	*t = &prof_threads[threadnum];
+	int		slot = t->head++;
+	profevent_t	*e = &t->events[slot & (MAX_PROF_EVENTS - 1)];
+
+	e->name = name;
+	e->depth = t->depth++;
+	e->end = 0.0;
+	e->start = PROF_Time();
+
+	return slot;
+}
+
+/*
+=============
+PROF_Pop
+
+close the scope
+=============
+*/
+void PROF_Pop( int slot, int threadnum )
+{
+	profthread_t	*t = &prof_threads[threadnum];
+	double		time = PROF_Time();
+
+	t->depth--;
+
+	// overwritten by the ring
+	if( t->head - slot > MAX_PROF_EVENTS )
+		return;
+
+	t->events[slot & (MAX_PROF_EVENTS - 1)].end = time;
+}
+
+/*
+=============
+PROF_Reset
+
+drop all the accumulated stats
+=============
+*/
+void PROF_Reset( void )
+{
+	for( int i = 0; i < MAX_PROF_THREADS; i++ )
+		prof_threads[i].head = prof_threads[i].depth = 0;
+
+	prof_numnodes = 0;
+	prof_numframes = 0;
+	prof_dropped = 0;
+}
+
+/*
+=============
+PROF_FindNode
+
+find or create the node for a call path
+=============
+*/
+static int PROF_FindNode( const char *name, int parent, bool worker )
+{
+	profnode_t	*node;
+	int		i;
+
+	for( i = 0, node = prof_nodes; i < prof_numnodes; i++, node++ )
+	{
+		if( node->parent != parent || node->worker != worker )
+			continue;
+
+		// same literal may have a different address in another module
+		if( node->name == name || !Q_strcmp( node->name, name ))
+			return i;
+	}
+
+	if( prof_numnodes == MAX_PROF_NODES )
+		return -1;
+
+	node = &prof_nodes[prof_numnodes];
+	memset( node, 0, sizeof( *node ));
+	node->name = name;
+	node->parent = parent;
+	node->depth = ( parent != -1 ) ? prof_nodes[parent].depth + 1 : 0;
+	node->worker = worker;
+
+	return prof_numnodes++;
+}
+
+/*
+=============
+PROF_CaptureEvent
+
+append event into capture buffer
+=============
+*/
+static void PROF_CaptureEvent( const char *name, double start, double end, int thread )
+{
+	profcapture_t	*ev;
+
+	if( prof_numcapture == prof_maxcapture )
+	{
+		int		newmax = Q_max( prof_maxcapture * 2, 8192 );
+		profcapture_t	*newbuf = (profcapture_t *)Mem_Alloc( newmax * sizeof( profcapture_t ));
+
+		if( prof_capture )
+		{
+			memcpy( newbuf, prof_capture, prof_numcapture * sizeof( profcapture_t ));
+			Mem_Free( prof_capture );
+		}
+
+		prof_capture = newbuf;
+		prof_maxcapture = newmax;
+	}
+
+	ev = &prof_capture[prof_numcapture++];
+	ev->name = name;
+	ev->start = start;
+	ev->end = end;
+	ev->thread = thread;
+}
+
+/*
+=============
+PROF_WriteCapture
+
+export captured frames as trace-event JSON
+=============
+*/
+static void PROF_WriteCapture( void )
+{
+	size_t	size = 64;
+	size_t	len;
+	char	*json;
+	int	i;
+
+	for( i = 0; i < prof_numcapture; i++ )
+		size += Q_strlen( prof_capture[i].name ) + 128;
+
+	json = (char *)Mem_Alloc( size );
+	len = Q_snprintf( json, size, "{\"traceEvents\":[\n" );
+
+	for( i = 0; i < prof_numcapture; i++ )
+	{
+		profcapture_t *ev = &prof_capture[i];
+
+		len += Q_snprintf( json + len, size - len, "{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,"
+		"\"ts\":%.1f,\"dur\":%.1f}%s\n", ev->name, ev->thread, ( ev->start - prof_capturebase ) * 1000000.0,
+		( ev->end - ev->start ) * 1000000.0, ( i == prof_numcapture - 1 ) ? "" : "," );
+	}
+
+	len += Q_snprintf( json + len, size - len, "]}\n" );
+
+	if( SAVE_FILE( prof_capturename, json, len ))
+		ALERT( at_console, "frame capture written to %s (%i events)\n", prof_capturename, prof_numcapture );
+	else ALERT( at_error, "PROF_WriteCapture: couldn't write %s\n", prof_capturename );
+
+	Mem_Free( json );
+	Mem_Free( prof_capture );
+	prof_capture = NULL;
+	prof_numcapture = prof_maxcapture = 0;
+}
+
+/*
+=============
+PROF_StartCapture
+
+collect next numframes even if profiler is disabled
+=============
+*/
+void PROF_StartCapture( int numframes, const char *filename )
+{
+	if( prof_captureframes > 0 )
+	{
+		ALERT( at_console, "frame capture already in progress\n" );
+		return;
+	}
+
+	prof_captureframes = bound( 1, numframes, MAX_PROF_CAPTURE );
+	Q_strncpy( prof_capturename, filename, sizeof( prof_capturename ));
+	prof_capturebase = 0.0;
+}
+
+bool PROF_Capturing( void )
+{
+	return ( prof_captureframes > 0 );
+}
+
+/*
+=============
+PROF_BeginFrame
+
+=============
+*/
+void PROF_BeginFrame( bool enable )
+{
+	enable = enable || PROF_Capturing();
+
+	// start from the scratch
+	if( enable && !g_fProfEnabled )
+		PROF_Reset();
+
+	g_fProfEnabled = enable;
+	prof_framestart = PROF_Time();
+}
+
+/*
+=============
+PROF_EndFrame
+
+fold the events recorded by all the threads
+into the call tree and advance the history
+=============
+*/
+void PROF_EndFrame( void )
+{
+	int	stack[MAX_PROF_DEPTH];
+	double	now = PROF_Time();
+	int	i, j, current;
+
+	if( !g_fProfEnabled )
+		return;
+
+	if( PROF_Capturing( ))
+	{
+		if( prof_capturebase == 0.0 )
+			prof_capturebase = prof_framestart;
+		PROF_CaptureEvent( "frame", prof_framestart, now, 0 );
+	}
+
+	for( i = 0; i < MAX_PROF_THREADS; i++ )
+	{
+		profthread_t	*t = &prof_threads[i];
+		int		first = 0;
+
+		if( !t->head ) continue;
+
+		if( t->head > MAX_PROF_EVENTS )
+		{
+			first = t->head - MAX_PROF_EVENTS;
+			prof_dropped += first;
+		}
+
+		for( j = 0; j < MAX_PROF_DEPTH; j++ )
+			stack[j] = -1;
+
+		for( j = first; j < t->head; j++ )
+		{
+			profevent_t	*e = &t->events[j & (MAX_PROF_EVENTS - 1)];
+			int		depth = Q_min( e->depth, MAX_PROF_DEPTH - 1 );
+			int		parent = ( depth > 0 ) ? stack[depth - 1] : -1;
+			double		end = ( e->end != 0.0 ) ? e->end : now;
+			int		node;
+
+			if(( node = PROF_FindNode( e->name, parent, ( i != 0 ))) == -1 )
+			{
+				stack[depth] = parent;
+				continue;
+			}
+
+			prof_nodes[node].frametime += end - e->start;
+			prof_nodes[node].framecalls++;
+			stack[depth] = node;
+
+			if( PROF_Capturing( ))
+				PROF_CaptureEvent( e->name, e->start, end, i );
+		}
+
+		t->head = 0;
+	}
+
+	current = prof_numframes % PROF_HISTORY;
+
+	for( i = 0; i < prof_numnodes; i++ )
+	{
+		profnode_t *node = &prof_nodes[i];
+
+		node->history[current] = node->frametime * 1000.0;
+		node->calls = node->framecalls;
+		node->frametime = 0.0;
+		node->framecalls = 0;
+	}
+
+	prof_frames[current] = ( now - prof_framestart ) * 1000.0;
+	prof_numframes++;
+
+	if( PROF_Capturing( ) && --prof_captureframes == 0 )
+		PROF_WriteCapture();
+}
+
+/*
+=============
+PROF_History
+
+returns last, average and peak time
+=============
+*/
+static void PROF_History( const float *history, float *last, float *avg, float *peak )
+{
+	int	count = Q_min( prof_numframes, PROF_HISTORY );
+	float	total = 0.0f;
+
+	*peak = 0.0f;
+
+	for( int i = 0; i < count; i++ )
+	{
+		total += history[i];
+		*peak = Q_max( *peak, history[i] );
+	}
+
+	*last = history[(prof_numframes - 1) % PROF_HISTORY];
+	*avg = total / count;
+}
+
+/*
+=============
+PROF_Printf
+
+append the text, clamp the length on overflow
+=============
+*/
+static int PROF_Printf( char *out, int size, int len, const char *fmt, ... )
+{
+	va_list	argptr;
+	int	result;
+
+	if( len >= size - 1 )
+		return len;
+
+	va_start( argptr, fmt );
+	result = Q_vsnprintf( out + len, size - len, fmt, argptr );
+	va_end( argptr );
+
+	return ( result < 0 ) ? size - 1 : len + result;
+}
+
+static int PROF_PrintNode( char *out, int size, int len, int parent, bool worker, bool brief )
+{
+	float	last, avg, peak;
+
+	for( int i = 0; i < prof_numnodes && len < size - 1; i++ )
+	{
+		profnode_t *node = &prof_nodes[i];
+
+		if( node->parent != parent || node->worker != worker )
+			continue;
+
+		PROF_History( node->history, &last, &avg, &peak );
+
+		if( brief && avg < 0.05f )
+			continue;
+
+		len = PROF_Printf( out, size, len, "%*s%s %.2f / %.2f / %.2f ms (%i)\n",
+		node->depth * 2, "", node->name, last, avg, peak, node->calls );
+		len = PROF_PrintNode( out, size, len, i, worker, brief );
+	}
+
+	return len;
+}
+
+/*
+=============
+PROF_Summary
+
+=============
+*/
+int PROF_Summary( char *out, int size, bool brief )
+{
+	float	last, avg, peak;
+	int	i, len;
+
+	if( !out || size <= 0 )
+		return 0;
+
+	out[0] = '\0';
+
+	if( !prof_numframes )
+		return 0;
+
+	PROF_History( prof_frames, &last, &avg, &peak );
+
+	len = PROF_Printf( out, size, 0, "frame %.2f / %.2f / %.2f ms (last / avg / max of %i)\n",
+	last, avg, peak, Q_min( prof_numframes, PROF_HISTORY ));
+	len = PROF_PrintNode( out, size, len, -1, false, brief );
+
+	for( i = 0; i < prof_numnodes; i++ )
+	{
+		if( prof_nodes[i].worker )
+			break;
+	}
+
+	if( i != prof_numnodes )
+	{
+		len = PROF_Printf( out, size, len, "job threads (sum of %i):\n", JOB_NumThreads() - 1 );
+		len = PROF_PrintNode( out, size, len, -1, true, brief );
+	}
+
+	if( prof_dropped )
+		len = PROF_Printf( out, size, len, "%i events dropped\n", prof_dropped );
+
+	return len;
+}
@@ -0,0 +1,71 @@
+/*
+profiler.h - per-frame hierarchical CPU profiler
+Copyright (C) 2024 Paranoia2 Team
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "jobs.h"
+
+#define MAX_PROF_THREADS	MAX_JOB_THREADS
+#define MAX_PROF_EVENTS	2048	// per-thread ring for a single frame, must be power of two
+#define MAX_PROF_NODES	256	// unique call paths
+#define MAX_PROF_DEPTH	32
+#define PROF_HISTORY	64	// frames to average
+#define MAX_PROF_CAPTURE	300	// frames
+
+extern bool	g_fProfEnabled;
+
+// scope name must be a string literal (only pointer is stored)
+// threadnum is the job thread number, 0 for main thread
+int PROF_Push( const char *name, int threadnum );
+void PROF_Pop( int slot, int threadnum );
+
+// frame boundaries, called from main thread outside of any scope
+// NOTE: scopes is not allowed to span a frame boundary
+void PROF_BeginFrame( bool enable );
+void PROF_EndFrame( void );
+void PROF_Reset( void );
+
+// print the call tree, return the text length
+// brief version skip the nodes that takes less than 0.05 ms
+int PROF_Summary( char *out, int size, bool brief );
+
+// record next numframes into Chrome trace-event JSON (chrome://tracing, perfetto)
+void PROF_StartCapture( int numframes, const char *filename );
+bool PROF_Capturing( void );
+
+class CProfScope
+{
+public:
+	CProfScope( const char *name, int threadnum = 0 ) : m_iThread( threadnum )
+	{
+		m_iSlot = g_fProfEnabled ? PROF_Push( name, threadnum ) : -1;
+	}
+	~CProfScope()
+	{
+		if( m_iSlot >= 0 ) PROF_Pop( m_iSlot, m_iThread );
+	}
+private:
+	int	m_iSlot;
+	int	m_iThread;
+};
+
+// scope lasts until the end of enclosing block
+#define PROF_CONCAT2( a, b )			a##b
+#define PROF_CONCAT( a, b )			PROF_CONCAT2( a, b )
+#define PROF_SCOPE( name )			CProfScope PROF_CONCAT( _profScope, __LINE__ )( name )
+#define PROF_SCOPE_THREAD( name, threadnum )	CProfScope PROF_CONCAT( _profScope, __LINE__ )( name, threadnum )
+
+#endif//PROFILER_H
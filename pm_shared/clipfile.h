@@ -26,7 +26,7 @@ CLIP FILES
 */
 
 #define IDCLIPHEADER		(('P'<<24)+('I'<<16)+('L'<<8)+'C') // little-endian "CLIP"
-#define CLIP_VERSION		1
+#define CLIP_VERSION		2
 
 // quake lump ordering
 #define LUMP_CLIP_FACETS		0
@@ -47,8 +47,20 @@ typedef struct
 	int		version;
 	unsigned int	modelCRC;		// catch for model changes
 	dcachelump_t	lumps[LUMP_COUNT];	
+	int		modelLength;	// studiohdr->length
+	unsigned int	checksum;		// all the data after header
 } dcachehdr_t;
 
+// same layout as mplane_t so lump can be copied as is
+typedef struct
+{
+	vec3_t		normal;
+	float		dist;
+	byte		type;
+	byte		signbits;
+	byte		pad[2];
+} dclipplane_t;
+
 typedef struct
 {
 	short		skinref;		// pointer to texture for special effects
@@ -25,6 +25,7 @@ GNU General Public License for more details.
 #include "stringlib.h"
 #include "virtualfs.h"
 #include "clipfile.h"
+#include "jobs.h"
 
 #ifdef CLIENT_DLL
 #include "cl_dll.h"
@@ -210,6 +211,9 @@ void CMeshDesc :: FreeMesh( void )
 	// single memory block
 	Mem_Free( m_mesh.planes );
 
+	if( m_mesh.nodes )
+		Mem_Free( m_mesh.nodes );
+
 	FreeMeshBuild();
 
 	memset( &m_mesh, 0, sizeof( m_mesh ));
@@ -436,46 +440,44 @@ void CMeshDesc :: StudioCalcBoneTransform( int frame, mstudiobone_t *pbone, mstu
 	VectorCopy( origin, pos );
 }
 
-bool CMeshDesc :: AddMeshTrinagle( const mvert_t triangle[3], int skinref )
-{
-	int	i, planenum;
-
-	if( m_iNumTris <= 0 )
-		return false; // were not in a build mode!
+/*
+================
+CalcFacetPlanes
 
-	if( m_mesh.numfacets >= m_iNumTris )
-		return false; // not possible?
+build the facet bevels, doesn't touch the shared plane pool
+================
+*/
+bool CMeshDesc :: CalcFacetPlanes( const mvert_t triangle[3], mfacetbevel_t *bevel )
+{
+	mplane_t	*planes = bevel->planes;
+	Vector	normal, mins, maxs;
+	int	i, numplanes;
+	float	dist;
 
-	mfacet_t *facet = &m_srcFacets[m_mesh.numfacets];
-	mplane_t *mainplane;
+	bevel->numplanes = numplanes = 0;
 
 	// calculate plane for this triangle
-	if(( planenum = PlaneFromPoints( triangle[0].point, triangle[1].point, triangle[2].point )) == -1 )
+	normal = CrossProduct( triangle[0].point - triangle[1].point, triangle[2].point - triangle[1].point );
+
+	if( !normal.NormalizeLength())
 		return false; // bad plane
 
-	mplane_t planes[MAX_FACET_PLANES];
-	Vector normal;
-	int numplanes;
-	float dist;
+	// snap it the same way as CreateNewFloatPlane does
+	dist = DotProduct( normal, triangle[0].point );
+	SnapNormal( normal );
 
-	mainplane = &m_srcPlanePool[planenum].pl;
-	facet->numplanes = numplanes = 0;
+	if( VectorIsOnAxis( normal ) && fabs( dist - Q_rint( dist )) < PLANE_DIST_EPSILON )
+		dist = Q_rint( dist );
 
-	planes[numplanes].normal = mainplane->normal;
-	planes[numplanes].dist = mainplane->dist;
+	planes[numplanes].normal = normal;
+	planes[numplanes].dist = dist;
 	numplanes++;
 
 	// calculate mins & maxs
-	ClearBounds( facet->mins, facet->maxs );
+	ClearBounds( mins, maxs );
 
 	for( i = 0; i < 3; i++ )
-	{
-		AddPointToBounds( triangle[i].point, facet->mins, facet->maxs );
-		facet->triangle[i] = triangle[i];
-	}
-
-	facet->edge1 = facet->triangle[1].point - facet->triangle[0].point;
-	facet->edge2 = facet->triangle[2].point - facet->triangle[0].point;
+		AddPointToBounds( triangle[i].point, mins, maxs );
 
 	// add the axial planes
 	for( int axis = 0; axis < 3; axis++ )
@@ -493,8 +495,8 @@ bool CMeshDesc :: AddMeshTrinagle( const mvert_t triangle[3], int skinref )
 				normal = g_vecZero;
 				normal[axis] = dir;
 				if( dir == 1 )
-					dist = facet->maxs[axis];
-				else dist = -facet->mins[axis];
+					dist = maxs[axis];
+				else dist = -mins[axis];
 
 				planes[numplanes].normal = normal;
 				planes[numplanes].dist = dist;
@@ -510,7 +512,6 @@ bool CMeshDesc :: AddMeshTrinagle( const mvert_t triangle[3], int skinref )
 	for( i = 0; i < 3; i++ )
 	{
 		int j = (i + 1) % 3;
-		int k = (i + 2) % 3;
 
 		Vector vec = triangle[i].point - triangle[j].point;
 		if( vec.Length() < 0.5f ) continue;
@@ -575,19 +576,58 @@ bool CMeshDesc :: AddMeshTrinagle( const mvert_t triangle[3], int skinref )
 		}
 	}
 
+	bevel->numplanes = numplanes;
+
+	return true;
+}
+
+/*
+================
+AddMeshFacet
+
+merge facet planes into the shared pool
+================
+*/
+bool CMeshDesc :: AddMeshFacet( const mvert_t triangle[3], int skinref, const mfacetbevel_t *bevel )
+{
+	int	i;
+
+	if( m_iNumTris <= 0 )
+		return false; // were not in a build mode!
+
+	if( m_mesh.numfacets >= m_iNumTris )
+		return false; // not possible?
+
+	if( bevel->numplanes <= 0 )
+		return false; // bad triangle
+
+	mfacet_t *facet = &m_srcFacets[m_mesh.numfacets];
+
+	// calculate mins & maxs
+	ClearBounds( facet->mins, facet->maxs );
+
+	for( i = 0; i < 3; i++ )
+	{
+		AddPointToBounds( triangle[i].point, facet->mins, facet->maxs );
+		facet->triangle[i] = triangle[i];
+	}
+
+	facet->edge1 = facet->triangle[1].point - facet->triangle[0].point;
+	facet->edge2 = facet->triangle[2].point - facet->triangle[0].point;
+
 	// add triangle to bounds
 	for( i = 0; i < 3; i++ )
 		AddPointToBounds( triangle[i].point, m_mesh.mins, m_mesh.maxs );
 
 	facet->indices = m_curPlaneElems;
-	m_curPlaneElems += numplanes;
-	facet->numplanes = numplanes;
+	m_curPlaneElems += bevel->numplanes;
+	facet->numplanes = bevel->numplanes;
 	facet->skinref = skinref;
 
 	for( i = 0; i < facet->numplanes; i++ )
 	{
 		// add plane to global pool
-		facet->indices[i] = FindFloatPlane( planes[i].normal, planes[i].dist );
+		facet->indices[i] = FindFloatPlane( bevel->planes[i].normal, bevel->planes[i].dist );
 	}
 
 	for( i = 0; i < 3; i++ )
@@ -598,11 +638,21 @@ bool CMeshDesc :: AddMeshTrinagle( const mvert_t triangle[3], int skinref )
 	}
 
 	// added
-	m_iTotalPlanes += numplanes;
+	m_iTotalPlanes += facet->numplanes;
 	m_mesh.numfacets++;
 	return true;
 }
 
+bool CMeshDesc :: AddMeshTrinagle( const mvert_t triangle[3], int skinref )
+{
+	mfacetbevel_t	bevel;
+
+	if( !CalcFacetPlanes( triangle, &bevel ))
+		return false;
+
+	return AddMeshFacet( triangle, skinref, &bevel );
+}
+
 void CMeshDesc :: RelinkFacet( mfacet_t *facet )
 {
 	// find the first node that the facet box crosses
@@ -622,11 +672,47 @@ void CMeshDesc :: RelinkFacet( mfacet_t *facet )
 	InsertLinkBefore( &facet->area, &node->solid_edicts );
 }
 
+/*
+================
+ClipChecksum
+
+FNV-1a hash to validate cache contents
+================
+*/
+static unsigned int ClipChecksum( const byte *data, size_t size )
+{
+	unsigned int	hash = 2166136261U;
+
+	for( size_t i = 0; i < size; i++ )
+	{
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/*
+================
+StudioLoadCache
+
+file layout is matched with runtime arrays so
+the mesh is filled with a single allocation
+================
+*/
 bool CMeshDesc :: StudioLoadCache( const char *pszModelName )
 {
 	char	szFilename[MAX_PATH];
 	char	szModelname[MAX_PATH];
-	int	i, length, iCompare;
+	int	i, j, length, iCompare;
+	studiohdr_t *phdr = (studiohdr_t *)m_pModel->cache.data;
+	const dcachelump_t *lump;
+	const dfacet_t *in_facets;
+	const uint *in_indices;
+	int numindices;
+	dcachehdr_t *hdr;
+	uint curIndex;
+	byte *buffer;
 
 	Q_strncpy( szModelname, pszModelName + Q_strlen( "models/" ), sizeof( szModelname ));
 	COM_StripExtension( szModelname );
@@ -646,39 +732,52 @@ bool CMeshDesc :: StudioLoadCache( const char *pszModelName )
 	byte *aMemFile = LOAD_FILE( szFilename, &length );
 	if( !aMemFile ) return false;
 
-	CVirtualFS file( aMemFile, length );
-	dcachelump_t *lump;
-	dcachehdr_t hdr;
-	dfacet_t facet;
-	dplane_t plane;
+	hdr = (dcachehdr_t *)aMemFile;
 
-	file.Read( &hdr, sizeof( hdr ));
+	if( length < (int)sizeof( dcachehdr_t ))
+	{
+		ALERT( at_warning, "%s is too short\n", szFilename );
+		goto cleanup;
+	}
 
-	if( hdr.id != IDCLIPHEADER )
+	if( hdr->id != IDCLIPHEADER )
 	{
-		ALERT( at_warning, "%s has wrong id (%p should be %p)\n", szFilename, hdr.id, IDCLIPHEADER );
+		ALERT( at_warning, "%s has wrong id (%p should be %p)\n", szFilename, hdr->id, IDCLIPHEADER );
 		goto cleanup;
 	}
 
-	if( hdr.version != CLIP_VERSION )
+	if( hdr->version != CLIP_VERSION )
 	{
-		ALERT( at_warning, "%s has wrong version (%i should be %i)\n", szFilename, hdr.version, CLIP_VERSION );
+		ALERT( at_console, "%s has old version (%i should be %i), CLIP cache will be updated\n", szFilename, hdr->version, CLIP_VERSION );
 		goto cleanup;
 	}
 
-	if( hdr.modelCRC != m_pModel->modelCRC )
+	if( hdr->modelCRC != m_pModel->modelCRC || hdr->modelLength != phdr->length )
 	{
 		ALERT( at_console, "%s was changed, CLIP cache will be updated\n", szFilename );
 		goto cleanup;
 	}
 
-	ClearBounds( m_mesh.mins, m_mesh.maxs );
-	memset( areanodes, 0, sizeof( areanodes ));
-	numareanodes = 0;
+	if( hdr->checksum != ClipChecksum( aMemFile + sizeof( dcachehdr_t ), length - sizeof( dcachehdr_t )))
+	{
+		ALERT( at_warning, "%s is corrupted, CLIP cache will be updated\n", szFilename );
+		goto cleanup;
+	}
 
-	// read plane representation table
-	lump = &hdr.lumps[LUMP_CLIP_PLANE_INDEXES];
-	m_iAllocPlanes = m_iTotalPlanes = lump->filelen / sizeof( uint );
+	for( i = 0; i < LUMP_COUNT; i++ )
+	{
+		lump = &hdr->lumps[i];
+
+		if( lump->fileofs < 0 || lump->filelen < 0 || ( lump->fileofs + lump->filelen ) > length || ( lump->fileofs & 3 ))
+		{
+			ALERT( at_warning, "%s has bad lump %i\n", szFilename, i );
+			goto cleanup;
+		}
+	}
+
+	lump = &hdr->lumps[LUMP_CLIP_PLANE_INDEXES];
+	numindices = lump->filelen / sizeof( uint );
+	in_indices = (const uint *)(aMemFile + lump->fileofs);
 
 	if( lump->filelen <= 0 || lump->filelen % sizeof( uint ))
 	{
@@ -686,89 +785,116 @@ bool CMeshDesc :: StudioLoadCache( const char *pszModelName )
 		goto cleanup;
 	}
 
-	m_srcPlaneElems = (uint *)calloc( sizeof( uint ), m_iAllocPlanes );
-	m_curPlaneElems = m_srcPlaneElems;
-	file.Seek( lump->fileofs, SEEK_SET );
+	lump = &hdr->lumps[LUMP_CLIP_PLANES];
+	m_mesh.numplanes = lump->filelen / sizeof( dclipplane_t );
 
-	// fill in plane indexes
-	file.Read( m_srcPlaneElems, lump->filelen );
+	if( lump->filelen <= 0 || lump->filelen % sizeof( dclipplane_t ))
+	{
+		ALERT( at_warning, "%s has funny size of LUMP_CLIP_PLANES\n", szFilename );
+		goto cleanup;
+	}
 
-	// read unique planes array (hash is unused)
-	lump = &hdr.lumps[LUMP_CLIP_PLANES];
-	m_mesh.numplanes = lump->filelen / sizeof( dplane_t );
+	lump = &hdr->lumps[LUMP_CLIP_FACETS];
+	m_mesh.numfacets = lump->filelen / sizeof( dfacet_t );
+	in_facets = (const dfacet_t *)(aMemFile + lump->fileofs);
 
-	if( lump->filelen <= 0 || lump->filelen % sizeof( dplane_t ))
+	if( lump->filelen <= 0 || lump->filelen % sizeof( dfacet_t ))
 	{
-		ALERT( at_warning, "%s has funny size of LUMP_CLIP_PLANES\n", szFilename );
+		ALERT( at_warning, "%s has funny size of LUMP_CLIP_FACETS\n", szFilename );
 		goto cleanup;
 	}
 
-	m_srcPlanePool = (hashplane_t *)calloc( sizeof( hashplane_t ), m_mesh.numplanes );
-	file.Seek( lump->fileofs, SEEK_SET );
+	// validate indexes before allocate anything
+	for( i = 0, curIndex = 0; i < m_mesh.numfacets; i++ )
+	{
+		if( in_facets[i].firstindex != curIndex || in_facets[i].numplanes > MAX_FACET_PLANES )
+			break;
+		curIndex += in_facets[i].numplanes;
+	}
 
-	for( i = 0; i < m_mesh.numplanes; i++ )
+	if( i != m_mesh.numfacets || curIndex != (uint)numindices )
 	{
-		file.Read( &plane, sizeof( plane ));
-		m_srcPlanePool[i].pl.normal = plane.normal;
-		m_srcPlanePool[i].pl.dist = plane.dist;
-		m_srcPlanePool[i].pl.type = plane.type;
-		// categorize it
-		CategorizePlane( &m_srcPlanePool[i].pl );
+		ALERT( at_warning, "%s has bad facets\n", szFilename );
+		goto cleanup;
 	}
 
-	lump = &hdr.lumps[LUMP_CLIP_FACETS];
-	m_mesh.numfacets = m_iNumTris = lump->filelen / sizeof( dfacet_t );
+	for( i = 0; i < numindices; i++ )
+	{
+		if( in_indices[i] >= (uint)m_mesh.numplanes )
+			break;
+	}
 
-	if( lump->filelen <= 0 || lump->filelen % sizeof( dfacet_t ))
+	if( i != numindices )
 	{
-		ALERT( at_warning, "%s has funny size of LUMP_CLIP_FACETS\n", szFilename );
+		ALERT( at_warning, "%s has bad plane indexes\n", szFilename );
 		goto cleanup;
 	}
 
-	m_srcFacets = (mfacet_t *)calloc( sizeof( mfacet_t ), m_iNumTris );
-	file.Seek( lump->fileofs, SEEK_SET );
+	m_iAllocPlanes = m_iTotalPlanes = numindices;
+	m_iNumTris = m_mesh.numfacets;
+	has_tree = ( m_iNumTris >= 256 ) ? true : false; // too many triangles invoke to build AABB tree
+
+	ClearBounds( m_mesh.mins, m_mesh.maxs );
+	memset( areanodes, 0, sizeof( areanodes ));
+	numareanodes = 0;
+
+	// same layout as FinishMeshBuild: planes, facets, indexes
+	mesh_size = (sizeof( mplane_t ) * m_mesh.numplanes) + (sizeof( mfacet_t ) * m_mesh.numfacets) + (sizeof( uint ) * numindices);
+	buffer = (byte *)Mem_Alloc( mesh_size );
+	mesh_size += sizeof( m_mesh );
+
+	m_mesh.planes = (mplane_t *)buffer;
+	memcpy( m_mesh.planes, aMemFile + hdr->lumps[LUMP_CLIP_PLANES].fileofs, sizeof( mplane_t ) * m_mesh.numplanes );
+	buffer += (sizeof( mplane_t ) * m_mesh.numplanes);
+
+	m_mesh.facets = (mfacet_t *)buffer;
+	buffer += (sizeof( mfacet_t ) * m_mesh.numfacets);
+	memcpy( buffer, in_indices, sizeof( uint ) * numindices );
 
-	for( i = 0; i < m_iNumTris; i++ )
+	for( i = 0; i < m_mesh.numfacets; i++ )
 	{
-		file.Read( &facet, sizeof( facet ));
-		m_srcFacets[i].skinref = facet.skinref;
-		m_srcFacets[i].mins = facet.mins;
-		m_srcFacets[i].maxs = facet.maxs;
-		m_srcFacets[i].edge1 = facet.edge1;
-		m_srcFacets[i].edge2 = facet.edge2;
-		m_srcFacets[i].numplanes = facet.numplanes;
-
-		// bounds checking
-		if( m_curPlaneElems != &m_srcPlaneElems[facet.firstindex] )
-			Msg( "bad mem %p != %p\n", m_curPlaneElems, &m_srcPlaneElems[facet.firstindex] );
-
-		// just setup pointer to index array
-		m_srcFacets[i].indices = m_curPlaneElems;
-		m_curPlaneElems += m_srcFacets[i].numplanes;
+		mfacet_t *out = &m_mesh.facets[i];
+		const dfacet_t *in = &in_facets[i];
+
+		out->area.next = out->area.prev = NULL;
+		out->skinref = in->skinref;
+		out->mins = in->mins;
+		out->maxs = in->maxs;
+		out->edge1 = in->edge1;
+		out->edge2 = in->edge2;
+		out->numplanes = in->numplanes;
+		out->indices = (uint *)buffer + in->firstindex;
 
-		for( int k = 0; k < 3; k++ )
+		for( j = 0; j < 3; j++ )
 		{
-			m_srcFacets[i].triangle[k] = facet.triangle[k];
-			AddPointToBounds( facet.triangle[k].point, m_mesh.mins, m_mesh.maxs );
+			out->triangle[j] = in->triangle[j];
+			AddPointToBounds( in->triangle[j].point, m_mesh.mins, m_mesh.maxs );
 		}
 	}
 
-	if( m_iNumTris >= 256 )
-		has_tree = true;	// too many triangles invoke to build AABB tree
-	else has_tree = false;
+	for( i = 0; i < 3; i++ )
+	{
+		// spread the mins / maxs by a pixel
+		m_mesh.mins[i] -= 1.0f;
+		m_mesh.maxs[i] += 1.0f;
+	}
+
+	LinkMeshFacets();
+	BuildMeshBVH();
 
 	// all done
 	FREE_FILE( aMemFile );
 	return true;
 cleanup:
 	FREE_FILE( aMemFile );
-	FreeMeshBuild();
+	memset( &m_mesh, 0, sizeof( m_mesh ));
 
 	return false;
 }
 
 bool CMeshDesc :: StudioSaveCache( const char *pszModelName )
 {
+	studiohdr_t *phdr = (studiohdr_t *)m_pModel->cache.data;
 	char szFilename[MAX_PATH];
 	char szModelname[MAX_PATH];
 	dcachelump_t *lump;
@@ -784,11 +910,12 @@ bool CMeshDesc :: StudioSaveCache( const char *pszModelName )
 	hdr.id = IDCLIPHEADER;
 	hdr.version = CLIP_VERSION;
 	hdr.modelCRC = m_pModel->modelCRC;
+	hdr.modelLength = phdr->length;
 
 	file.Write( &hdr, sizeof( hdr ));
 
 	dfacet_t *out_facets = (dfacet_t *)Mem_Alloc( sizeof( dfacet_t ) * m_mesh.numfacets );
-	dplane_t *out_planes = (dplane_t *)Mem_Alloc( sizeof( dplane_t ) * m_mesh.numplanes );
+	dclipplane_t *out_planes = (dclipplane_t *)Mem_Alloc( sizeof( dclipplane_t ) * m_mesh.numplanes );
 
 	// copy planes into mesh array (probably aligned block)
 	for( i = 0, curIndex = 0; i < m_mesh.numfacets; i++ )
@@ -809,15 +936,9 @@ bool CMeshDesc :: StudioSaveCache( const char *pszModelName )
 	if( curIndex != m_iTotalPlanes )
 		ALERT( at_error, "StudioSaveCache: invalid planecount! %d != %d\n", curIndex, m_iTotalPlanes );
 
+	// already categorized
 	for( i = 0; i < m_mesh.numplanes; i++ )
-	{
-		VectorCopy( m_srcPlanePool[i].pl.normal, out_planes[i].normal );
-		out_planes[i].dist = m_srcPlanePool[i].pl.dist;
-		out_planes[i].type = m_srcPlanePool[i].pl.type;
-	}
-
-	if( curIndex != m_iTotalPlanes )
-		ALERT( at_error, "StudioSaveCache: invalid planecount! %d != %d\n", curIndex, m_iTotalPlanes );
+		memcpy( &out_planes[i], &m_mesh.planes[i], sizeof( dclipplane_t ));
 
 	lump = &hdr.lumps[LUMP_CLIP_FACETS];
 	lump->fileofs = file.Tell();
@@ -826,7 +947,7 @@ bool CMeshDesc :: StudioSaveCache( const char *pszModelName )
 
 	lump = &hdr.lumps[LUMP_CLIP_PLANES];
 	lump->fileofs = file.Tell();
-	lump->filelen = sizeof( dplane_t ) * m_mesh.numplanes;
+	lump->filelen = sizeof( dclipplane_t ) * m_mesh.numplanes;
 	file.Write( out_planes, (lump->filelen + 3) & ~3 );
 
 	lump = &hdr.lumps[LUMP_CLIP_PLANE_INDEXES];
@@ -835,6 +956,7 @@ bool CMeshDesc :: StudioSaveCache( const char *pszModelName )
 	file.Write( m_srcPlaneElems, (lump->filelen + 3) & ~3 );
 
 	// update header
+	hdr.checksum = ClipChecksum( (const byte *)file.GetBuffer() + sizeof( hdr ), file.GetSize() - sizeof( hdr ));
 	file.Seek( 0, SEEK_SET );
 	file.Write( &hdr, sizeof( hdr ));
 
@@ -896,6 +1018,41 @@ bool CMeshDesc :: InitMeshBuild( int numTriangles )
 	return true;
 }
 
+#define MESH_BATCH_FACETS	4096	// triangles per job dispatch
+
+typedef struct
+{
+	CMeshDesc		*mesh;
+	const Vector	*verts;
+	const float	*coords;
+	const uint	*indices;
+	mfacetbevel_t	*bevels;
+	int		firstTri;
+} meshbuild_t;
+
+static void FillTriangle( const meshbuild_t *build, int elem, mvert_t triangle[3] )
+{
+	for( int k = 0; k < 3; k++ )
+	{
+		uint index = build->indices[elem+k];
+
+		triangle[k].point = build->verts[index];
+		triangle[k].st[0] = build->coords[index*2+0];
+		triangle[k].st[1] = build->coords[index*2+1];
+	}
+}
+
+static void MeshBevelJob( void *context, int current, int threadnum )
+{
+	meshbuild_t	*build = (meshbuild_t *)context;
+	mvert_t		triangle[3];
+
+	FillTriangle( build, ( build->firstTri + current ) * 3, triangle );
+
+	if( !build->mesh->CalcFacetPlanes( triangle, &build->bevels[current] ))
+		build->bevels[current].numplanes = 0;
+}
+
 bool CMeshDesc :: StudioConstructMesh( void )
 {
 	float start_time = Sys_DoubleTime();
@@ -910,10 +1067,6 @@ bool CMeshDesc :: StudioConstructMesh( void )
 
 	if( StudioLoadCache( m_pModel->name ))
 	{
-		if( !FinishMeshBuild( ))
-			return false;
-
-		FreeMeshBuild();
 		ALERT( at_aiconsole, "%s: load  time %g secs, size %s\n", m_debugName, Sys_DoubleTime() - start_time, Q_memprint( mesh_size ));
 		PrintMeshInfo();
 
@@ -1092,22 +1245,30 @@ bool CMeshDesc :: StudioConstructMesh( void )
 		StartPacifier();
 	}
 
-	for( i = 0; i < numElems; i += 3 )
+	meshbuild_t	build;
+
+	build.mesh = this;
+	build.verts = verts;
+	build.coords = coords;
+	build.indices = indices;
+	build.bevels = new mfacetbevel_t[Q_min( numTris, MESH_BATCH_FACETS )];
+
+	// bevels are computed in parallel, then merged into the plane pool in original order
+	for( build.firstTri = 0; build.firstTri < numTris; build.firstTri += MESH_BATCH_FACETS )
 	{
-		// fill the triangle
-		triangle[0].point = verts[indices[i+0]];
-		triangle[1].point = verts[indices[i+1]];
-		triangle[2].point = verts[indices[i+2]];
+		int count = Q_min( numTris - build.firstTri, MESH_BATCH_FACETS );
 
-		triangle[0].st[0] = coords[indices[i+0]*2+0];
-		triangle[0].st[1] = coords[indices[i+0]*2+1];
-		triangle[1].st[0] = coords[indices[i+1]*2+0];
-		triangle[1].st[1] = coords[indices[i+1]*2+1];
-		triangle[2].st[0] = coords[indices[i+2]*2+0];
-		triangle[2].st[1] = coords[indices[i+2]*2+1];
+		JOB_RunOnIndividual( count, &build, MeshBevelJob );
+
+		for( i = 0; i < count; i++ )
+		{
+			int elem = ( build.firstTri + i ) * 3;
 
-		// add it to mesh
-		AddMeshTrinagle( triangle, skinrefs[indices[i]] );
+			FillTriangle( &build, elem, triangle );
+
+			// add it to mesh
+			AddMeshFacet( triangle, skinrefs[indices[elem]], &build.bevels[i] );
+		}
 
 		if( m_bShowPacifier )
 		{
@@ -1115,6 +1276,8 @@ bool CMeshDesc :: StudioConstructMesh( void )
 		}
 	}
 
+	delete [] build.bevels;
+
 	if( m_bShowPacifier )
 	{
 		float end_time = Sys_DoubleTime();
@@ -1209,16 +1372,152 @@ bool CMeshDesc :: FinishMeshBuild( void )
 			m_mesh.facets[i].triangle[k] = m_srcFacets[i].triangle[k];
 	}
 
-	if( has_tree )
+	LinkMeshFacets();
+	BuildMeshBVH();
+
+	return true;
+}
+
+/*
+================
+BuildBVHNode
+
+split facets by the middle of the longest axis
+================
+*/
+int CMeshDesc :: BuildBVHNode( int *facetnums, const Vector *centers, int numfacets, int depth )
+{
+	int		nodenum = m_mesh.numnodes++;
+	mbvhnode_t	*node = &m_mesh.nodes[nodenum];
+	Vector		cmins, cmaxs;
+	int		i, j, axis;
+
+	ClearBounds( node->mins, node->maxs );
+
+	for( i = 0; i < numfacets; i++ )
+	{
+		mfacet_t *facet = &m_mesh.facets[facetnums[i]];
+		AddPointToBounds( facet->mins, node->mins, node->maxs );
+		AddPointToBounds( facet->maxs, node->mins, node->maxs );
+	}
+
+	if( numfacets <= BVH_LEAF_FACETS )
 	{
-		// create tree
-		CreateAreaNode( 0, m_mesh.mins, m_mesh.maxs );
+		mbvhleaf_t *leaf = &m_mesh.leafs[m_mesh.numleafs];
 
-		for( i = 0; i < m_mesh.numfacets; i++ )
-			RelinkFacet( &m_mesh.facets[i] );
+		for( i = 0; i < BVH_LEAF_FACETS; i++ )
+		{
+			mfacet_t *facet = ( i < numfacets ) ? &m_mesh.facets[facetnums[i]] : NULL;
+
+			for( j = 0; j < 3; j++ )
+			{
+				leaf->mins[j][i] = facet ? facet->mins[j] :  99999.0f;
+				leaf->maxs[j][i] = facet ? facet->maxs[j] : -99999.0f;
+			}
+			leaf->facets[i] = facet ? facetnums[i] : -1;
+		}
+
+		node->child = m_mesh.numleafs++;
+		node->numfacets = numfacets;
+		return nodenum;
 	}
 
-	return true;
+	ClearBounds( cmins, cmaxs );
+	for( i = 0; i < numfacets; i++ )
+		AddPointToBounds( centers[facetnums[i]], cmins, cmaxs );
+
+	Vector size = cmaxs - cmins;
+	if( size.x >= size.y && size.x >= size.z )
+		axis = 0;
+	else if( size.y >= size.z )
+		axis = 1;
+	else axis = 2;
+
+	float mid = ( cmins[axis] + cmaxs[axis] ) * 0.5f;
+
+	// partition in place
+	for( i = 0, j = numfacets - 1; i <= j; )
+	{
+		if( centers[facetnums[i]][axis] < mid )
+		{
+			i++;
+		}
+		else
+		{
+			int temp = facetnums[i];
+			facetnums[i] = facetnums[j];
+			facetnums[j--] = temp;
+		}
+	}
+
+	// degenerated split or too deep tree, just divide by half
+	if( i == 0 || i == numfacets || depth >= ( BVH_MAX_DEPTH / 2 ))
+		i = numfacets / 2;
+
+	node->numfacets = 0;
+	BuildBVHNode( facetnums, centers, i, depth + 1 );
+	int right = BuildBVHNode( facetnums + i, centers, numfacets - i, depth + 1 );
+	m_mesh.nodes[nodenum].child = right;
+
+	return nodenum;
+}
+
+/*
+================
+BuildMeshBVH
+
+build the bounding volume hierarchy over facets
+================
+*/
+void CMeshDesc :: BuildMeshBVH( void )
+{
+	int	maxnodes = m_mesh.numfacets * 2;
+	int	maxleafs = m_mesh.numfacets;
+	int	i;
+
+	if( m_mesh.numfacets <= BVH_LEAF_FACETS )
+		return; // brute force is enough
+
+	int *facetnums = (int *)malloc( sizeof( int ) * m_mesh.numfacets );
+	Vector *centers = (Vector *)malloc( sizeof( Vector ) * m_mesh.numfacets );
+	m_mesh.nodes = (mbvhnode_t *)malloc( sizeof( mbvhnode_t ) * maxnodes );
+	m_mesh.leafs = (mbvhleaf_t *)malloc( sizeof( mbvhleaf_t ) * maxleafs );
+	m_mesh.numnodes = m_mesh.numleafs = 0;
+
+	for( i = 0; i < m_mesh.numfacets; i++ )
+	{
+		centers[i] = ( m_mesh.facets[i].mins + m_mesh.facets[i].maxs ) * 0.5f;
+		facetnums[i] = i;
+	}
+
+	BuildBVHNode( facetnums, centers, m_mesh.numfacets, 0 );
+
+	// move into single block
+	size_t nodesize = sizeof( mbvhnode_t ) * m_mesh.numnodes;
+	size_t leafsize = sizeof( mbvhleaf_t ) * m_mesh.numleafs;
+	byte *buffer = (byte *)Mem_Alloc( nodesize + leafsize );
+
+	memcpy( buffer, m_mesh.nodes, nodesize );
+	memcpy( buffer + nodesize, m_mesh.leafs, leafsize );
+	free( m_mesh.nodes );
+	free( m_mesh.leafs );
+	free( facetnums );
+	free( centers );
+
+	m_mesh.nodes = (mbvhnode_t *)buffer;
+	m_mesh.leafs = (mbvhleaf_t *)(buffer + nodesize);
+	mesh_size += nodesize + leafsize;
+}
+
+void CMeshDesc :: LinkMeshFacets( void )
+{
+	if( !has_tree ) return;
+
+	// create tree
+	CreateAreaNode( 0, m_mesh.mins, m_mesh.maxs );
+
+	for( int i = 0; i < m_mesh.numfacets; i++ )
+		RelinkFacet( &m_mesh.facets[i] );
 }
 
 void CMeshDesc :: PrintMeshInfo( void )
@@ -28,6 +28,9 @@ GNU General Public License for more details.
 #define PACIFIER_STEP	40
 #define PACIFIER_REM	( PACIFIER_STEP / 10 )
 
+#define BVH_LEAF_FACETS	4		// facets per leaf, matched with SIMD width
+#define BVH_MAX_DEPTH	64		// traversal stack size
+
 typedef struct hashplane_s
 {
 	mplane_t		pl;
@@ -51,6 +54,29 @@ typedef struct mfacet_s
 	uint		*indices;			// a indexes into mesh plane pool
 } mfacet_t;
 
+// facet planes before they get merged into the shared pool
+typedef struct
+{
+	mplane_t		planes[MAX_FACET_PLANES];
+	int		numplanes;		// 0 is bad triangle
+} mfacetbevel_t;
+
+typedef struct
+{
+	Vector		mins;
+	int		child;			// inner node: second child (first is next node), leaf: index into leafs
+	Vector		maxs;
+	int		numfacets;		// non-zero for leafs
+} mbvhnode_t;
+
+// facet bounds stored as SoA for 4-wide tests, unused slots are inverted
+typedef struct
+{
+	float		mins[3][BVH_LEAF_FACETS];
+	float		maxs[3][BVH_LEAF_FACETS];
+	int		facets[BVH_LEAF_FACETS];
+} mbvhleaf_t;
+
 typedef struct
 {
 	Vector		mins, maxs;
@@ -58,6 +84,12 @@ typedef struct
 	int		numplanes;
 	mfacet_t		*facets;
 	mplane_t		*planes;			// shared plane pool
+
+	// bounding volume hierarchy (single memory block)
+	mbvhnode_t	*nodes;
+	mbvhleaf_t	*leafs;
+	int		numnodes;
+	int		numleafs;
 } mmesh_t;
 
 class CMeshDesc
@@ -92,6 +124,8 @@ public:
 	// mesh construction
 	bool InitMeshBuild( int numTrinagles ); 
 	bool AddMeshTrinagle( const mvert_t triangle[3], int skinref );
+	bool CalcFacetPlanes( const mvert_t triangle[3], mfacetbevel_t *bevel ); // thread-safe
+	bool AddMeshFacet( const mvert_t triangle[3], int skinref, const mfacetbevel_t *bevel );
 	bool FinishMeshBuild( void );
 	void FreeMeshBuild( void );
 	void FreeMesh( void );
@@ -120,6 +154,11 @@ public:
 	// AABB tree contsruction
 	areanode_t *CreateAreaNode( int depth, const Vector &mins, const Vector &maxs );
 	void RelinkFacet( mfacet_t *facet );
+	void LinkMeshFacets( void );
+
+	// BVH construction
+	void BuildMeshBVH( void );
+	int BuildBVHNode( int *facetnums, const Vector *centers, int numfacets, int depth );
 	areanode_t *GetHeadNode( void ) { return (has_tree) ? areanodes : NULL; }
 
 	// plane cache
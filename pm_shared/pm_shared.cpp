@@ -30,6 +30,7 @@
 #include "stringlib.h"
 #include "material.h"
 #include "studio.h"
+#include "profiler.h"
 
 #ifdef CLIENT_DLL
 	// Spectator Mode
@@ -3076,6 +3077,8 @@ and client.  This will ensure that prediction behaves appropriately.
 
 void PM_Move ( struct playermove_s *ppmove, int server )
 {
+	PROF_SCOPE( "PM_Move" );
+
 	assert( pm_shared_initialized );
 
 	pmove = ppmove;
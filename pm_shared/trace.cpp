@@ -22,6 +22,10 @@ GNU General Public License for more details.
 #include "trace.h"
 #include "mathlib.h"
 
+#ifdef HAVE_SSE_MATH
+#include <xmmintrin.h>
+#endif
+
 #ifdef CLIENT_DLL
 #include "cl_dll.h"
 #include "render_api.h"
@@ -180,6 +184,15 @@ void TraceMesh :: SetupTrace( const Vector &start, const Vector &mins, const Vec
 
 	material = NULL;
 	m_vecTraceDirection = m_vecEnd - m_vecStart;
+
+	// inverse delta in fraction units, large value instead of INF to avoid NaN
+	for( i = 0; i < 3; i++ )
+	{
+		if( fabs( m_vecTraceDirection[i] ) > 1e-6f )
+			m_vecInvDelta[i] = 1.0f / m_vecTraceDirection[i];
+		else m_vecInvDelta[i] = ( m_vecTraceDirection[i] < 0.0f ) ? -1e30f : 1e30f;
+	}
+
 	m_flTraceDistance = m_vecTraceDirection.Length();
 	m_vecTraceDirection = m_vecTraceDirection.Normalize();
 
@@ -528,6 +541,165 @@ void TraceMesh :: ClipToLinks( areanode_t *node )
 		ClipToLinks( node->children[1] );
 }
 
+/*
+=============
+IntersectBVHNode
+
+tnear is an entry fraction for traceline
+=============
+*/
+bool TraceMesh :: IntersectBVHNode( const mbvhnode_t *node, float &tnear )
+{
+	tnear = 0.0f;
+
+	if( !BoundsIntersect( m_vecAbsMins, m_vecAbsMaxs, node->mins, node->maxs ))
+		return false;
+
+	if( !bIsTraceLine || bIsTestPosition )
+		return true;
+
+	// slab test for a ray
+	float tmin = -1e30f, tmax = 1e30f;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		float t1 = ( node->mins[i] - m_vecStart[i] ) * m_vecInvDelta[i];
+		float t2 = ( node->maxs[i] - m_vecStart[i] ) * m_vecInvDelta[i];
+
+		if( t1 > t2 )
+		{
+			float temp = t1;
+			t1 = t2;
+			t2 = temp;
+		}
+
+		tmin = Q_max( tmin, t1 );
+		tmax = Q_min( tmax, t2 );
+	}
+
+	if( tmax < 0.0f || tmin > tmax || tmin > m_flRealFraction )
+		return false;
+
+	tnear = tmin;
+	return true;
+}
+
+/*
+=============
+ClipToBVHLeaf
+
+test all the facets bounds at once
+=============
+*/
+void TraceMesh :: ClipToBVHLeaf( const mbvhleaf_t *leaf )
+{
+	int	i, bits = 0;
+
+#ifdef HAVE_SSE_MATH
+	__m128	mask = _mm_cmpeq_ps( _mm_setzero_ps(), _mm_setzero_ps( ));
+
+	for( i = 0; i < 3; i++ )
+	{
+		mask = _mm_and_ps( mask, _mm_cmple_ps( _mm_loadu_ps( leaf->mins[i] ), _mm_set1_ps( m_vecAbsMaxs[i] )));
+		mask = _mm_and_ps( mask, _mm_cmpge_ps( _mm_loadu_ps( leaf->maxs[i] ), _mm_set1_ps( m_vecAbsMins[i] )));
+	}
+
+	bits = _mm_movemask_ps( mask );
+#else
+	for( i = 0; i < BVH_LEAF_FACETS; i++ )
+	{
+		if( leaf->mins[0][i] > m_vecAbsMaxs[0] || leaf->mins[1][i] > m_vecAbsMaxs[1] || leaf->mins[2][i] > m_vecAbsMaxs[2] )
+			continue;
+		if( leaf->maxs[0][i] < m_vecAbsMins[0] || leaf->maxs[1][i] < m_vecAbsMins[1] || leaf->maxs[2][i] < m_vecAbsMins[2] )
+			continue;
+		bits |= BIT( i );
+	}
+#endif
+	for( i = 0; i < BVH_LEAF_FACETS && bits; i++, bits >>= 1 )
+	{
+		if( !FBitSet( bits, 1 ))
+			continue;
+
+		mfacet_t *facet = &mesh->facets[leaf->facets[i]];
+
+		if( bIsTestPosition )
+			TestBoxInFacet( facet );
+		else if( bIsTraceLine )
+			ClipRayToFacet( facet );
+		else ClipBoxToFacet( facet );
+
+		if( !m_flRealFraction )
+			return;
+	}
+}
+
+/*
+=============
+ClipToBVH
+
+traceline visits nearest child first
+so far nodes can be culled by the hit
+=============
+*/
+void TraceMesh :: ClipToBVH( void )
+{
+	int	stack[BVH_MAX_DEPTH];
+	int	sp = 0, nodenum = 0;
+	float	t0, t1;
+
+	if( !IntersectBVHNode( &mesh->nodes[0], t0 ))
+		return;
+
+	while( 1 )
+	{
+		const mbvhnode_t *node = &mesh->nodes[nodenum];
+
+		if( node->numfacets )
+		{
+			ClipToBVHLeaf( &mesh->leafs[node->child] );
+			if( !m_flRealFraction ) return;
+		}
+		else
+		{
+			int child0 = nodenum + 1;
+			int child1 = node->child;
+			bool hit0 = IntersectBVHNode( &mesh->nodes[child0], t0 );
+			bool hit1 = IntersectBVHNode( &mesh->nodes[child1], t1 );
+
+			if( hit0 && hit1 )
+			{
+				if( t1 < t0 )
+				{
+					int temp = child0;
+					child0 = child1;
+					child1 = temp;
+				}
+
+				stack[sp++] = child1;
+				nodenum = child0;
+				continue;
+			}
+			else if( hit0 )
+			{
+				nodenum = child0;
+				continue;
+			}
+			else if( hit1 )
+			{
+				nodenum = child1;
+				continue;
+			}
+		}
+
+		// pop next node, it can be culled by closer hit
+		do
+		{
+			if( sp <= 0 ) return;
+			nodenum = stack[--sp];
+		} while( !IntersectBVHNode( &mesh->nodes[nodenum], t0 ));
+	}
+}
+
 bool TraceMesh :: DoTrace( void )
 {
 	if( !mesh || !BoundsIntersect( mesh->mins, mesh->maxs, m_vecAbsMins, m_vecAbsMaxs ))
@@ -535,7 +707,11 @@ bool TraceMesh :: DoTrace( void )
 
 	checkcount = 0;
 
-	if( areanodes )
+	if( m_bUseBVH && mesh->nodes )
+	{
+		ClipToBVH();
+	}
+	else if( areanodes )
 	{
 		ClipToLinks( areanodes );
 	}
@@ -40,6 +40,8 @@ private:
 	bool		bIsTestPosition;
 	bool		bIsTraceLine;	// more accurate than ClipBoxToFacet
 	bool		bUseCapsule;	// use capsule instead of bbox
+	bool		m_bUseBVH;	// allow to use BVH if mesh has it
+	Vector		m_vecInvDelta;	// for ray vs box tests
 	areanode_t	*areanodes;	// AABB for static meshes
 	mmesh_t		*mesh;		// mesh to trace
 	trace_t  		*trace;		// output
@@ -53,7 +55,7 @@ private:
 	matrix4x4		m_transform;
 	model_t		*m_pModel;
 public:
-	TraceMesh() { mesh = NULL; }
+	TraceMesh() { mesh = NULL; m_bUseBVH = true; }
 	~TraceMesh() {}
 
 	// trace stuff
@@ -64,6 +66,8 @@ public:
 		m_iBody = m_iSkin = 0; // reset it
 	}
 
+	void SetBVHEnabled( bool enable ) { m_bUseBVH = enable; }
+
 	void SetMeshParams( int body, int skin )
 	{
 		m_iBody = body;
@@ -79,6 +83,9 @@ public:
 	void TestBoxInFacet( mfacet_t	*facet );
 	bool IsTrans( const mfacet_t *facet );
 	void ClipToLinks( areanode_t *node );
+	bool IntersectBVHNode( const mbvhnode_t *node, float &tnear );
+	void ClipToBVHLeaf( const mbvhleaf_t *leaf );
+	void ClipToBVH( void );
 	bool DoTrace( void );
 };
 